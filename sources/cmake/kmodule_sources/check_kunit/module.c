@@ -0,0 +1,21 @@
+#include <linux/module.h>
+#include <kunit/test.h>
+
+MODULE_LICENSE("GPL");
+
+static void my_case(struct kunit *test)
+{
+	KUNIT_EXPECT_EQ(test, 1, 1);
+}
+
+static struct kunit_case my_cases[] = {
+	KUNIT_CASE(my_case),
+	{}
+};
+
+static struct kunit_suite my_suite = {
+	.name = "my_suite",
+	.test_cases = my_cases,
+};
+
+kunit_test_suites(&my_suite);
@@ -0,0 +1,22 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+
+MODULE_LICENSE("GPL");
+
+static int __init
+my_init(void)
+{
+	struct module *m = THIS_MODULE;
+	pr_info("%p %u %u\n", m->core_layout.base, m->core_layout.size,
+		m->core_layout.ro_size);
+	return 0;
+}
+
+static void __exit
+my_exit(void)
+{
+}
+
+module_init(my_init);
+module_exit(my_exit);
@@ -0,0 +1,21 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+
+MODULE_LICENSE("GPL");
+
+static int __init
+my_init(void)
+{
+	struct module *m = THIS_MODULE;
+	pr_info("%p %u\n", m->mem[MOD_DATA].base, m->mem[MOD_DATA].size);
+	return 0;
+}
+
+static void __exit
+my_exit(void)
+{
+}
+
+module_init(my_init);
+module_exit(my_exit);
@@ -267,3 +267,94 @@ macro(check_hlist_for_each_entry)
     endif (DEFINED HLIST_FOR_EACH_ENTRY_POS_ONLY)
     message(STATUS "${check_hlist_for_each_entry_message}")
 endmacro(check_hlist_for_each_entry)
+
+# Check whether KUnit tests may be built as a module.
+#
+# The macro sets 'KUNIT_AVAILABLE' variable. KUnit should be enabled
+# in the kernel (CONFIG_KUNIT) and support test suites in the modules
+# (kernel 5.7 and newer).
+macro(check_kunit)
+    set(check_kunit_message
+"Checking whether KUnit is available for modules"
+    )
+    message(STATUS "${check_kunit_message}")
+    if (DEFINED KUNIT_AVAILABLE)
+        set(check_kunit_message
+"${check_kunit_message} [cached] - ${KUNIT_AVAILABLE}"
+        )
+    else ()
+        kbuild_try_compile(kunit_impl
+            "${CMAKE_BINARY_DIR}/check_kunit"
+            "${kmodule_test_sources_dir}/check_kunit/module.c"
+        )
+        if (kunit_impl)
+            set(KUNIT_AVAILABLE "yes" CACHE INTERNAL
+    "Whether KUnit tests may be built as a module"
+            )
+        else ()
+            set(KUNIT_AVAILABLE "no" CACHE INTERNAL
+    "Whether KUnit tests may be built as a module"
+            )
+        endif (kunit_impl)
+
+        set(check_kunit_message
+            "${check_kunit_message} - ${KUNIT_AVAILABLE}"
+        )
+    endif (DEFINED KUNIT_AVAILABLE)
+    message(STATUS "${check_kunit_message}")
+endmacro(check_kunit)
+
+# Determine layout of the module's memory in 'struct module'.
+#
+# The macro sets variables:
+#  'MODULE_LAYOUT_MEM' - module memory is described by 'mem[]' array
+#       (kernel 6.4 and newer),
+#  'MODULE_LAYOUT_CORE_LAYOUT' - module memory is described by
+#       'core_layout' and 'init_layout' fields (kernels 4.5 - 6.3).
+# If none of them is set, 'module_core' and 'module_init' fields are used.
+macro(check_module_layout)
+    set(check_module_layout_message
+"Checking the layout of module's memory"
+    )
+    message(STATUS "${check_module_layout_message}")
+    if (DEFINED MODULE_LAYOUT_MEM)
+        set(check_module_layout_message
+"${check_module_layout_message} [cached] - done"
+        )
+    else ()
+        kbuild_try_compile(layout_mem_impl
+            "${CMAKE_BINARY_DIR}/check_module_layout_mem"
+            "${kmodule_test_sources_dir}/check_module_layout_mem/module.c"
+        )
+        if (layout_mem_impl)
+            set(MODULE_LAYOUT_MEM "yes" CACHE INTERNAL
+    "Is module's memory described by 'mem[]' array?"
+            )
+            set(MODULE_LAYOUT_CORE_LAYOUT "no" CACHE INTERNAL
+    "Is module's memory described by 'core_layout' field?"
+            )
+        else ()
+            set(MODULE_LAYOUT_MEM "no" CACHE INTERNAL
+    "Is module's memory described by 'mem[]' array?"
+            )
+            kbuild_try_compile(layout_core_layout_impl
+                "${CMAKE_BINARY_DIR}/check_module_layout_core_layout"
+                "${kmodule_test_sources_dir}/check_module_layout_core_layout/module.c"
+            )
+            if (layout_core_layout_impl)
+                set(MODULE_LAYOUT_CORE_LAYOUT "yes" CACHE INTERNAL
+    "Is module's memory described by 'core_layout' field?"
+                )
+            else ()
+                set(MODULE_LAYOUT_CORE_LAYOUT "no" CACHE INTERNAL
+    "Is module's memory described by 'core_layout' field?"
+                )
+            endif (layout_core_layout_impl)
+        endif (layout_mem_impl)
+
+        set(check_module_layout_message
+            "${check_module_layout_message} - done"
+        )
+    endif (DEFINED MODULE_LAYOUT_MEM)
+    message(STATUS "${check_module_layout_message}")
+endmacro(check_module_layout)
@@ -0,0 +1,320 @@
+/*
+ * Per-CPU ring buffers of call records.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include <kedr-coi/call_records.h>
+
+#include "kedr_coi_call_records.h"
+#include "kedr_coi_debugfs.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h> /* current, local_clock() */
+#include <linux/log2.h>
+#include <linux/err.h>
+#include <linux/percpu.h>
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val) (ACCESS_ONCE(x) = (val))
+#endif
+
+/*
+ * Number of pages with records in every per-CPU buffer.
+ *
+ * Should be power of 2. 0 disables call records.
+ */
+static unsigned int call_records_pages = 16;
+module_param(call_records_pages, uint, S_IRUGO);
+MODULE_PARM_DESC(call_records_pages,
+    "Number of pages with call records per CPU (power of 2, 0 - disable)");
+
+/* Whether to overwrite oldest records when buffer is full. */
+static bool call_records_overwrite = 0;
+module_param(call_records_overwrite, bool, S_IRUGO);
+MODULE_PARM_DESC(call_records_overwrite,
+    "Overwrite oldest call records instead of dropping new ones");
+
+/* Whole area which is mapped into userspace. NULL if disabled. */
+static void* records_area = NULL;
+static size_t records_area_size;
+
+static struct kedr_coi_call_records_info* records_info;
+
+/*
+ * Layout of the area.
+ *
+ * Mapped memory may be written from userspace, so kernel keeps the
+ * layout here and only reports it in 'records_info'. The only field
+ * kernel reads from the mapped memory is 'tail' in buffer's header.
+ */
+static int records_n_cpus;
+static size_t records_buffers_offset;
+static size_t records_buffer_size;
+static size_t records_offset;
+
+/* Number of records in buffer minus 1, for take index. */
+static u64 records_mask;
+
+/* Counters of the buffer, copied into its header for the reader. */
+struct call_records_cpu
+{
+    u64 head;
+    u64 dropped;
+};
+
+static DEFINE_PER_CPU(struct call_records_cpu, records_cpu);
+
+/* Buffer of given CPU */
+static inline struct kedr_coi_call_records_header* cpu_buffer(int cpu)
+{
+    return records_area + records_buffers_offset
+        + (size_t)cpu * records_buffer_size;
+}
+
+static inline struct kedr_coi_call_record* buffer_record(
+    struct kedr_coi_call_records_header* header, u64 index)
+{
+    struct kedr_coi_call_record* records = (void*)header + records_offset;
+
+    return &records[index & records_mask];
+}
+
+void kedr_coi_call_records_write(u16 type,
+    u32 interceptor_id,
+    size_t operation_offset,
+    const void* object,
+    const void* op_orig,
+    const void* return_address,
+    long return_value,
+    u64 duration)
+{
+    unsigned long flags;
+    int cpu;
+    struct call_records_cpu* records;
+    struct kedr_coi_call_records_header* header;
+    struct kedr_coi_call_record* record;
+    u64 head;
+
+    if(records_area == NULL) return;
+
+    /*
+     * Only current CPU writes into its buffer, so disabling of
+     * interrupts is sufficient for exclusive access.
+     */
+    local_irq_save(flags);
+
+    cpu = smp_processor_id();
+    records = this_cpu_ptr(&records_cpu);
+    header = cpu_buffer(cpu);
+    head = records->head;
+
+    if(!call_records_overwrite
+        && (head - READ_ONCE(header->tail) > records_mask))
+    {
+        WRITE_ONCE(header->dropped, ++records->dropped);
+        goto out;
+    }
+
+    record = buffer_record(header, head);
+
+    record->timestamp = local_clock();
+    record->object = (unsigned long)object;
+    record->op_orig = (unsigned long)op_orig;
+    record->return_address = (unsigned long)return_address;
+    record->return_value = return_value;
+    record->duration = duration;
+    record->pid = current->pid;
+    record->cpu = cpu;
+    record->type = type;
+    record->interceptor_id = interceptor_id;
+    record->operation_offset = operation_offset;
+
+    // Record should be visible before head is updated.
+    smp_wmb();
+    records->head = head + 1;
+    WRITE_ONCE(header->head, head + 1);
+
+out:
+    local_irq_restore(flags);
+}
+
+//********************* Character device *****************************//
+static int records_mmap(struct file* filp, struct vm_area_struct* vma)
+{
+    unsigned long size = vma->vm_end - vma->vm_start;
+
+    if(vma->vm_pgoff != 0) return -EINVAL;
+    if(size > records_area_size) return -EINVAL;
+
+    return remap_vmalloc_range(vma, records_area, 0);
+}
+
+static const struct file_operations records_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = nonseekable_open,
+    .mmap = records_mmap,
+};
+
+static struct miscdevice records_device =
+{
+    .minor = MISC_DYNAMIC_MINOR,
+    .name = KEDR_COI_CALL_RECORDS_DEVICE,
+    .fops = &records_file_operations,
+};
+
+//*************************** Debugfs ********************************//
+static int records_file_show(struct seq_file* m, void* v)
+{
+    int cpu;
+
+    seq_printf(m, "%4s %20s %20s %20s\n", "cpu", "written", "read",
+        "dropped");
+
+    for(cpu = 0; cpu < records_n_cpus; cpu++)
+    {
+        struct call_records_cpu* records = &per_cpu(records_cpu, cpu);
+        struct kedr_coi_call_records_header* header = cpu_buffer(cpu);
+
+        seq_printf(m, "%4d %20llu %20llu %20llu\n", cpu,
+            (unsigned long long)READ_ONCE(records->head),
+            (unsigned long long)READ_ONCE(header->tail),
+            (unsigned long long)READ_ONCE(records->dropped));
+    }
+
+    return 0;
+}
+
+static int records_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, records_file_show, NULL);
+}
+
+static const struct file_operations records_debugfs_operations =
+{
+    .owner = THIS_MODULE,
+    .open = records_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static struct dentry* records_debugfs_file = NULL;
+
+int kedr_coi_call_records_init(void)
+{
+    int result;
+    size_t buffer_size;
+    int n_records;
+
+    // Number of records in buffer should be power of 2.
+    BUILD_BUG_ON(sizeof(struct kedr_coi_call_record) != 64);
+
+    if(call_records_pages == 0) return 0;
+
+    if(!is_power_of_2(call_records_pages))
+    {
+        pr_err("Number of pages for call records should be power of 2, "
+            "but it is %u.", call_records_pages);
+        return -EINVAL;
+    }
+
+    n_records = call_records_pages * PAGE_SIZE
+        / sizeof(struct kedr_coi_call_record);
+    // Header occupies the whole page.
+    buffer_size = (call_records_pages + 1) * PAGE_SIZE;
+
+    records_area_size = PAGE_SIZE + buffer_size * nr_cpu_ids;
+    // Zeroed memory suitable for mapping into userspace.
+    records_area = vmalloc_user(records_area_size);
+    if(records_area == NULL)
+    {
+        pr_err("Failed to allocate buffers for call records.");
+        return -ENOMEM;
+    }
+
+    records_n_cpus = nr_cpu_ids;
+    records_buffers_offset = PAGE_SIZE;
+    records_buffer_size = buffer_size;
+    records_offset = PAGE_SIZE;
+
+    records_info = records_area;
+
+    records_info->version = KEDR_COI_CALL_RECORDS_VERSION;
+    records_info->n_cpus = records_n_cpus;
+    records_info->buffers_offset = records_buffers_offset;
+    records_info->buffer_size = records_buffer_size;
+    records_info->records_offset = records_offset;
+    records_info->n_records = n_records;
+    records_info->record_size = sizeof(struct kedr_coi_call_record);
+    records_info->overwrite = call_records_overwrite;
+
+    records_mask = n_records - 1;
+
+    result = misc_register(&records_device);
+    if(result)
+    {
+        pr_err("Failed to register device for call records.");
+        goto err_device;
+    }
+
+    if(kedr_coi_debugfs_root)
+    {
+        records_debugfs_file = debugfs_create_file("call_records", S_IRUGO,
+            kedr_coi_debugfs_root, NULL, &records_debugfs_operations);
+        if(IS_ERR_OR_NULL(records_debugfs_file)) records_debugfs_file = NULL;
+    }
+
+    return 0;
+
+err_device:
+    vfree(records_area);
+    records_area = NULL;
+
+    return result;
+}
+
+void kedr_coi_call_records_destroy(void)
+{
+    if(records_area == NULL) return;
+
+    if(records_debugfs_file)
+    {
+        debugfs_remove(records_debugfs_file);
+        records_debugfs_file = NULL;
+    }
+
+    /*
+     * Mapped pages are referenced by the mappings, so existing mappings
+     * remain valid after vfree().
+     */
+    misc_deregister(&records_device);
+
+    vfree(records_area);
+    records_area = NULL;
+}
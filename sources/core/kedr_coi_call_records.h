@@ -0,0 +1,34 @@
+#ifndef KEDR_COI_CALL_RECORDS_INTERNAL_H
+#define KEDR_COI_CALL_RECORDS_INTERNAL_H
+
+/*
+ * Per-CPU ring buffers of call records and character device for
+ * export them into userspace.
+ *
+ * See <kedr-coi/call_records.h> for the layout of the buffers.
+ */
+
+#include <linux/types.h>
+
+int kedr_coi_call_records_init(void);
+void kedr_coi_call_records_destroy(void);
+
+/*
+ * Store record into the buffer of current CPU.
+ *
+ * 'type' is one of 'kedr_coi_call_record_type'. For records about
+ * watching and forgetting of the object only 'object' and
+ * 'return_address' are meaningful.
+ *
+ * Lockless, may be called in atomic context.
+ */
+void kedr_coi_call_records_write(u16 type,
+    u32 interceptor_id,
+    size_t operation_offset,
+    const void* object,
+    const void* op_orig,
+    const void* return_address,
+    long return_value,
+    u64 duration);
+
+#endif /* KEDR_COI_CALL_RECORDS_INTERNAL_H */
@@ -0,0 +1,224 @@
+/*
+ * Per-task stacks of active intercepted calls.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_call_stack.h"
+#include "kedr_coi_debugfs.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/hardirq.h> /* in_interrupt() */
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val) (ACCESS_ONCE(x) = (val))
+#endif
+
+/*
+ * Maximum number of tasks which may have active intercepted calls at
+ * the same time.
+ *
+ * Should be power of 2.
+ */
+static unsigned int call_stack_slots = 4096;
+module_param(call_stack_slots, uint, S_IRUGO);
+MODULE_PARM_DESC(call_stack_slots,
+    "Maximum number of tasks with tracked intercepted calls (power of 2)");
+
+/* Maximum number of slots checked when search slot for the task. */
+#define CALL_STACK_MAX_PROBES 32
+
+/*
+ * Marks slot which has been used. Search for task should continue
+ * after such slot, but the slot may be reused.
+ */
+#define SLOT_RELEASED ((struct task_struct*)1)
+
+struct call_stack_slot
+{
+    // NULL for never used slot.
+    struct task_struct* task;
+    // Modified only by the task itself.
+    struct kedr_coi_hook_context* top;
+};
+
+static struct call_stack_slot* slots;
+static unsigned int slots_bits;
+
+// Calls which are not tracked because no slot is found.
+static atomic_t calls_dropped = ATOMIC_INIT(0);
+
+/* Return slot of the current task or NULL. */
+static struct call_stack_slot* find_slot(void)
+{
+    unsigned int index = hash_ptr(current, slots_bits);
+    int i;
+
+    for(i = 0; i < CALL_STACK_MAX_PROBES; i++)
+    {
+        struct call_stack_slot* slot =
+            &slots[(index + i) & (call_stack_slots - 1)];
+        struct task_struct* task = READ_ONCE(slot->task);
+
+        if(task == current) return slot;
+        if(task == NULL) break;
+    }
+
+    return NULL;
+}
+
+/* Allocate slot for the current task, which has no slot. */
+static struct call_stack_slot* claim_slot(void)
+{
+    unsigned int index = hash_ptr(current, slots_bits);
+    int i;
+
+    for(i = 0; i < CALL_STACK_MAX_PROBES; i++)
+    {
+        struct call_stack_slot* slot =
+            &slots[(index + i) & (call_stack_slots - 1)];
+        struct task_struct* task = READ_ONCE(slot->task);
+
+        if(((task == NULL) || (task == SLOT_RELEASED))
+            && (cmpxchg(&slot->task, task, current) == task))
+        {
+            slot->top = NULL;
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+void kedr_coi_call_stack_push(struct kedr_coi_hook_context* ctx)
+{
+    struct call_stack_slot* slot;
+
+    ctx->parent = NULL;
+    ctx->depth = 0;
+
+    /*
+     * Call in interrupt context doesn't belong to the interrupted task,
+     * which may be modifying its stack at that moment.
+     */
+    if(in_interrupt() || (slots == NULL)) return;
+
+    slot = find_slot();
+    if(slot == NULL) slot = claim_slot();
+    if(slot == NULL)
+    {
+        atomic_inc(&calls_dropped);
+        return;
+    }
+
+    ctx->parent = slot->top;
+    ctx->depth = ctx->parent ? ctx->parent->depth + 1 : 1;
+    WRITE_ONCE(slot->top, ctx);
+}
+
+bool kedr_coi_call_stack_pop(struct kedr_coi_hook_context* ctx)
+{
+    struct call_stack_slot* slot;
+
+    if(ctx->depth == 0) return false;
+
+    slot = find_slot();
+    if(WARN_ON_ONCE(slot == NULL)) return false;
+    if(WARN_ON_ONCE(slot->top != ctx))
+    {
+        /*
+         * Some call hasn't been popped. Calls in the stack may be
+         * already finished, so the stack is dropped.
+         */
+        slot->top = NULL;
+        smp_store_release(&slot->task, SLOT_RELEASED);
+        return false;
+    }
+
+    if(ctx->parent)
+    {
+        WRITE_ONCE(slot->top, ctx->parent);
+    }
+    else
+    {
+        // The outermost call is finished, slot is not needed anymore.
+        slot->top = NULL;
+        smp_store_release(&slot->task, SLOT_RELEASED);
+    }
+
+    return true;
+}
+
+struct kedr_coi_hook_context* kedr_coi_call_stack_top(void)
+{
+    struct call_stack_slot* slot;
+
+    if(in_interrupt() || (slots == NULL)) return NULL;
+
+    slot = find_slot();
+
+    return slot ? slot->top : NULL;
+}
+
+int kedr_coi_call_stack_init(void)
+{
+    if(call_stack_slots == 0)
+    {
+        pr_info("Tracking of nested intercepted calls is disabled.");
+        return 0;
+    }
+
+    if(!is_power_of_2(call_stack_slots))
+    {
+        pr_err("Parameter 'call_stack_slots' should be power of 2.");
+        return -EINVAL;
+    }
+
+    slots_bits = ilog2(call_stack_slots);
+
+    slots = vzalloc(call_stack_slots * sizeof(*slots));
+    if(slots == NULL)
+    {
+        pr_err("Cannot allocate slots for call stacks.");
+        return -ENOMEM;
+    }
+
+    // File is removed with the whole KEDR COI directory.
+    if(kedr_coi_debugfs_root)
+        debugfs_create_atomic_t("call_stack_dropped", S_IRUGO,
+            kedr_coi_debugfs_root, &calls_dropped);
+
+    return 0;
+}
+
+void kedr_coi_call_stack_destroy(void)
+{
+    if(slots == NULL) return;
+
+    vfree(slots);
+    slots = NULL;
+}
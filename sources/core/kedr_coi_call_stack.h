@@ -0,0 +1,42 @@
+#ifndef KEDR_COI_CALL_STACK_H
+#define KEDR_COI_CALL_STACK_H
+
+/*
+ * Per-task stacks of active intercepted calls.
+ *
+ * Elements of the stack are hook contexts, which are allocated by the
+ * intermediate operations on their stack, and linked via 'parent'
+ * field. Only the top of the stack is stored for every task, in the
+ * table which is preallocated at initialization. So pushing and
+ * popping require neither allocations nor locks.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+int kedr_coi_call_stack_init(void);
+void kedr_coi_call_stack_destroy(void);
+
+/*
+ * Push call onto the stack of the current task.
+ *
+ * Set 'parent' and 'depth' fields of the context. If call cannot be
+ * tracked (made in interrupt context or table of stacks is full),
+ * 'depth' is set to 0.
+ */
+void kedr_coi_call_stack_push(struct kedr_coi_hook_context* ctx);
+
+/*
+ * Pop call, previously pushed by kedr_coi_call_stack_push().
+ *
+ * Return true if the call is popped. Return false if the call is not
+ * tracked or it is not on the top of the stack (calls are unbalanced);
+ * 'ctx->parent' may be already finished in the last case.
+ */
+bool kedr_coi_call_stack_pop(struct kedr_coi_hook_context* ctx);
+
+/*
+ * Return the innermost active call of the current task or NULL.
+ */
+struct kedr_coi_hook_context* kedr_coi_call_stack_top(void);
+
+#endif /* KEDR_COI_CALL_STACK_H */
@@ -0,0 +1,197 @@
+/*
+ * Aggregation of intercepted calls by (operation, return address).
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_callers.h"
+#include "kedr_coi_stat_table.h"
+
+#include <kedr-coi/operations_interception.h>
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+
+/* Maximum number of callers in the report. */
+static unsigned int callers_report_size = 32;
+module_param(callers_report_size, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(callers_report_size,
+    "Number of callers shown in 'callers' report of the interceptor");
+
+/* Every CPU may hold statistic for 2^CALLERS_TABLE_BITS callers. */
+#define CALLERS_TABLE_BITS 10
+/* ... and for 2^PARENTS_TABLE_BITS enclosing operations. */
+#define PARENTS_TABLE_BITS 8
+
+struct kedr_coi_callers
+{
+    bool latency;
+    // Keyed by return address.
+    struct kedr_coi_stat_table* table;
+    /*
+     * Keyed by enclosing call: identificator of its interceptor
+     * (high 32 bits) and its operation offset. 0 for the outermost
+     * calls.
+     */
+    struct kedr_coi_stat_table* parents;
+};
+
+struct kedr_coi_callers* kedr_coi_callers_create(bool latency)
+{
+    struct kedr_coi_callers* callers = kzalloc(sizeof(*callers),
+        GFP_KERNEL);
+
+    if(callers == NULL)
+    {
+        pr_err("Cannot allocate statistic about callers.");
+        return NULL;
+    }
+
+    callers->table = kedr_coi_stat_table_create(CALLERS_TABLE_BITS, false);
+    if(callers->table == NULL) goto err_table;
+
+    callers->parents = kedr_coi_stat_table_create(PARENTS_TABLE_BITS, false);
+    if(callers->parents == NULL) goto err_parents;
+
+    callers->latency = latency;
+
+    return callers;
+
+err_parents:
+    kedr_coi_stat_table_destroy(callers->table);
+err_table:
+    kfree(callers);
+    return NULL;
+}
+
+void kedr_coi_callers_destroy(struct kedr_coi_callers* callers)
+{
+    kedr_coi_stat_table_destroy(callers->parents);
+    kedr_coi_stat_table_destroy(callers->table);
+    kfree(callers);
+}
+
+bool kedr_coi_callers_latency(struct kedr_coi_callers* callers)
+{
+    return callers->latency;
+}
+
+static inline u64 parent_key(const struct kedr_coi_hook_context* parent)
+{
+    return parent
+        ? ((u64)parent->interceptor_id << 32) | parent->operation_offset
+        : 0;
+}
+
+void kedr_coi_callers_account(struct kedr_coi_callers* callers,
+    const struct kedr_coi_hook_context* ctx,
+    u64 time,
+    u64 self_time)
+{
+    kedr_coi_stat_table_account(callers->table, ctx->operation_offset,
+        (unsigned long)ctx->return_address, time, self_time);
+    kedr_coi_stat_table_account(callers->parents, ctx->operation_offset,
+        parent_key(ctx->parent), time, self_time);
+}
+
+/* Print common part of the report line. */
+static void report_entry(struct kedr_coi_callers* callers,
+    struct seq_file* m,
+    struct kedr_coi_stat_entry* entry,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data)
+{
+    const char* name = operation_name(entry->operation_offset, data);
+
+    seq_printf(m, "%llu\t", (unsigned long long)entry->count);
+    if(callers->latency)
+        seq_printf(m, "%llu\t%llu\t",
+            (unsigned long long)div64_u64(entry->time, entry->count),
+            (unsigned long long)div64_u64(entry->self_time, entry->count));
+    else
+        seq_puts(m, "-\t-\t");
+
+    if(name)
+        seq_printf(m, "%s\t", name);
+    else
+        seq_printf(m, "%zu\t", entry->operation_offset);
+}
+
+int kedr_coi_callers_report(struct kedr_coi_callers* callers,
+    struct seq_file* m,
+    u32 interceptor_id,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data)
+{
+    struct kedr_coi_stat_entry* entries;
+    int n;
+    u64 lost;
+    int i;
+
+    entries = kedr_coi_stat_table_collect(callers->table, &n, &lost);
+    if(entries == NULL) return -ENOMEM;
+
+    seq_printf(m, "# callers: %d, lost calls: %llu\n",
+        n, (unsigned long long)lost);
+    seq_puts(m, "# calls\tavg_ns\tavg_self_ns\toperation\tcaller\n");
+
+    for(i = 0; (i < n) && (i < callers_report_size); i++)
+    {
+        report_entry(callers, m, &entries[i], operation_name, data);
+        seq_printf(m, "%pS\n", (void*)(unsigned long)entries[i].key);
+    }
+
+    vfree(entries);
+
+    entries = kedr_coi_stat_table_collect(callers->parents, &n, &lost);
+    if(entries == NULL) return -ENOMEM;
+
+    /*
+     * Enclosing operation is shown as '<interceptor-id>:<operation>',
+     * '-' means the outermost call.
+     */
+    seq_printf(m, "\n# enclosing calls: %d, lost calls: %llu\n",
+        n, (unsigned long long)lost);
+    seq_puts(m, "# calls\tavg_ns\tavg_self_ns\toperation\tenclosing\n");
+
+    for(i = 0; (i < n) && (i < callers_report_size); i++)
+    {
+        u32 parent_id = entries[i].key >> 32;
+        size_t parent_offset = (u32)entries[i].key;
+        const char* parent_name = (parent_id == interceptor_id)
+            ? operation_name(parent_offset, data) : NULL;
+
+        report_entry(callers, m, &entries[i], operation_name, data);
+
+        if(entries[i].key == 0)
+            seq_puts(m, "-\n");
+        else if(parent_name)
+            seq_printf(m, "%u:%s\n", parent_id, parent_name);
+        else
+            seq_printf(m, "%u:%zu\n", parent_id, parent_offset);
+    }
+
+    vfree(entries);
+
+    return 0;
+}
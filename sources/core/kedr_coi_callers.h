@@ -0,0 +1,58 @@
+#ifndef KEDR_COI_CALLERS_H
+#define KEDR_COI_CALLERS_H
+
+/*
+ * Aggregation of intercepted calls by (operation, return address) and
+ * by (operation, enclosing intercepted call).
+ *
+ * Statistic is stored in per-CPU tables (see kedr_coi_stat_table.h),
+ * which are merged when the report is requested.
+ */
+
+#include <linux/types.h>
+
+struct seq_file;
+struct kedr_coi_hook_context;
+
+struct kedr_coi_callers;
+
+/*
+ * Create tables for all CPUs.
+ *
+ * If 'latency' is true, time of the calls is summed too.
+ */
+struct kedr_coi_callers* kedr_coi_callers_create(bool latency);
+
+void kedr_coi_callers_destroy(struct kedr_coi_callers* callers);
+
+bool kedr_coi_callers_latency(struct kedr_coi_callers* callers);
+
+/*
+ * Account the call, which took 'time' nanoseconds, 'self_time' of them -
+ * not in nested calls.
+ *
+ * May be called in atomic context.
+ */
+void kedr_coi_callers_account(struct kedr_coi_callers* callers,
+    const struct kedr_coi_hook_context* ctx,
+    u64 time,
+    u64 self_time);
+
+/*
+ * Print callers with the most number of calls, sorted by that number,
+ * and then enclosing calls.
+ *
+ * 'interceptor_id' is identificator of the interceptor which collects
+ * the statistic. 'operation_name' returns name of the operation of that
+ * interceptor or NULL if it is not known.
+ *
+ * Should be called in process context. Concurrent accounting is
+ * allowed, but report may miss calls accounted meanwhile.
+ */
+int kedr_coi_callers_report(struct kedr_coi_callers* callers,
+    struct seq_file* m,
+    u32 interceptor_id,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data);
+
+#endif /* KEDR_COI_CALLERS_H */
@@ -0,0 +1,64 @@
+/*
+ * Directory of KEDR COI in debugfs.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_debugfs.h"
+
+#include <linux/err.h>
+
+struct dentry* kedr_coi_debugfs_root = NULL;
+
+struct dentry* kedr_coi_debugfs_create_dir(const char* name,
+    struct dentry* parent)
+{
+    struct dentry* dir;
+
+    if(parent == NULL) return NULL;
+
+    // Depending on the kernel, failure is reported via NULL or ERR_PTR.
+    dir = debugfs_create_dir(name, parent);
+    if(IS_ERR_OR_NULL(dir))
+    {
+        pr_warn("Failed to create directory '%s' in debugfs.", name);
+        return NULL;
+    }
+
+    return dir;
+}
+
+int kedr_coi_debugfs_init(void)
+{
+    struct dentry* root = debugfs_create_dir("kedr_coi", NULL);
+
+    // Absence of debugfs is not an error.
+    kedr_coi_debugfs_root = IS_ERR_OR_NULL(root) ? NULL : root;
+
+    return 0;
+}
+
+void kedr_coi_debugfs_destroy(void)
+{
+    if(kedr_coi_debugfs_root)
+    {
+        debugfs_remove_recursive(kedr_coi_debugfs_root);
+        kedr_coi_debugfs_root = NULL;
+    }
+}
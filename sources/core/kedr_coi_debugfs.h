@@ -0,0 +1,33 @@
+#ifndef KEDR_COI_DEBUGFS_H
+#define KEDR_COI_DEBUGFS_H
+
+/*
+ * Directory of KEDR COI in debugfs.
+ *
+ * Every interceptor creates its own subdirectory there for report its
+ * state and for tune it at runtime.
+ */
+
+#include <linux/debugfs.h>
+
+/*
+ * Root directory in debugfs ("kedr_coi").
+ *
+ * NULL if debugfs is not available. Absence of debugfs is not an error,
+ * files are just not created in that case.
+ */
+extern struct dentry* kedr_coi_debugfs_root;
+
+int kedr_coi_debugfs_init(void);
+void kedr_coi_debugfs_destroy(void);
+
+/*
+ * Create subdirectory in debugfs.
+ *
+ * Return NULL if directory cannot be created (e.g. there is another
+ * directory with same name) or if parent is NULL.
+ */
+struct dentry* kedr_coi_debugfs_create_dir(const char* name,
+    struct dentry* parent);
+
+#endif /* KEDR_COI_DEBUGFS_H */
@@ -169,6 +169,50 @@ void kedr_coi_hash_table_destroy(struct kedr_coi_hash_table* table,
     kfree(table->heads);
 }
 
+void kedr_coi_hash_table_get_stat(struct kedr_coi_hash_table* table,
+    struct kedr_coi_hash_table_stat* stat)
+{
+    int i;
+    
+    stat->n_elems = table->n_elems;
+    stat->n_buckets = 1 << table->bits;
+    stat->n_buckets_used = 0;
+    stat->max_chain = 0;
+    
+    for(i = 0; i < (1 << table->bits); i++)
+    {
+        struct hlist_node* node;
+        size_t chain = 0;
+        
+        hlist_for_each(node, &table->heads[i])
+            chain++;
+        
+        if(chain == 0) continue;
+        
+        stat->n_buckets_used++;
+        if(chain > stat->max_chain)
+            stat->max_chain = chain;
+    }
+}
+
+struct kedr_coi_hash_elem*
+kedr_coi_hash_table_chain_find(struct kedr_coi_hash_table* table,
+    size_t chain,
+    bool (*match)(struct kedr_coi_hash_elem* elem, void* data),
+    void* data)
+{
+    struct kedr_coi_hash_elem* elem;
+    
+    if(chain >= kedr_coi_hash_table_n_chains(table)) return NULL;
+    
+    compat_hlist_for_each_entry(elem, &table->heads[chain], node)
+    {
+        if(match(elem, data)) return elem;
+    }
+    
+    return NULL;
+}
+
 /* Implementation of auxiliary functions */
 
 static void hash_table_fill_from(
@@ -85,6 +85,54 @@ struct kedr_coi_hash_elem*
 kedr_coi_hash_table_find_elem(struct kedr_coi_hash_table* table,
     const void* key);
 
+/* Statistic about distribution of elements in the hash table. */
+struct kedr_coi_hash_table_stat
+{
+    size_t n_elems;
+    // Total number of chains (1 << bits)
+    size_t n_buckets;
+    // Number of non-empty chains
+    size_t n_buckets_used;
+    // Length of the longest chain
+    size_t max_chain;
+};
+
+/*
+ * Collect statistic about the table.
+ * 
+ * Walks all elements, so takes time proportional to the size of the table.
+ */
+void kedr_coi_hash_table_get_stat(struct kedr_coi_hash_table* table,
+    struct kedr_coi_hash_table_stat* stat);
+
+/*
+ * Find element in the given chain of the table for which 'match'
+ * returns true. Return NULL if there is no such element.
+ * 
+ * Chains are numbered from 0 to n_buckets - 1 (see
+ * kedr_coi_hash_table_get_stat), so the table may be walked
+ * incrementally, one chain at a time. Removing of the element may
+ * reallocate the table, so the walk should be continued from the same
+ * chain number, which may happen to be out of range.
+ */
+struct kedr_coi_hash_elem*
+kedr_coi_hash_table_chain_find(struct kedr_coi_hash_table* table,
+    size_t chain,
+    bool (*match)(struct kedr_coi_hash_elem* elem, void* data),
+    void* data);
+
+/* Number of chains in the table. */
+static inline size_t
+kedr_coi_hash_table_n_chains(const struct kedr_coi_hash_table* table)
+{ return (size_t)1 << table->bits; }
+
+/* Memory used by the heads of the table, in bytes. */
+static inline size_t
+kedr_coi_hash_table_heads_memory(const struct kedr_coi_hash_table* table)
+{
+    return sizeof(*table->heads) << table->bits;
+}
+
 /*
  * Move content of the element into another place.
  * 
@@ -0,0 +1,75 @@
+/*
+ * Tracepoints which are fired for every intercepted call when hooks
+ * are enabled.
+ *
+ * These tracepoints are the attach points for BPF programs (of
+ * 'raw_tracepoint' or 'tp_btf' type), which receive the whole
+ * hook context, and for ftrace.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM kedr_coi
+
+#if !defined(KEDR_COI_HOOKS_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define KEDR_COI_HOOKS_TRACE_H
+
+#include <kedr-coi/operations_interception.h>
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(kedr_coi_hook,
+    TP_PROTO(struct kedr_coi_hook_context* ctx),
+    TP_ARGS(ctx),
+    TP_STRUCT__entry(
+        __field(u32, interceptor_id)
+        __field(u32, operation_offset)
+        __field(const void*, object)
+        __field(void*, return_address)
+        __field(int, depth)
+        __field(int, n_args)
+        __array(u64, args, KEDR_COI_HOOK_MAX_ARGS)
+        __field(s64, return_value)
+    ),
+    TP_fast_assign(
+        __entry->interceptor_id = ctx->interceptor_id;
+        __entry->operation_offset = ctx->operation_offset;
+        __entry->object = ctx->object;
+        __entry->return_address = ctx->return_address;
+        __entry->depth = ctx->depth;
+        __entry->n_args = ctx->n_args;
+        memcpy(__entry->args, ctx->args, sizeof(__entry->args));
+        __entry->return_value = ctx->return_value;
+    ),
+    TP_printk("interceptor=%u offset=%u object=%p caller=%pS depth=%d "
+        "args=[0x%llx 0x%llx 0x%llx 0x%llx 0x%llx 0x%llx] ret=%lld",
+        __entry->interceptor_id, __entry->operation_offset,
+        __entry->object, __entry->return_address, __entry->depth,
+        (unsigned long long)__entry->args[0],
+        (unsigned long long)__entry->args[1],
+        (unsigned long long)__entry->args[2],
+        (unsigned long long)__entry->args[3],
+        (unsigned long long)__entry->args[4],
+        (unsigned long long)__entry->args[5],
+        (long long)__entry->return_value)
+);
+
+/* Fired before pre-handlers, 'return_value' is 0. */
+DEFINE_EVENT(kedr_coi_hook, kedr_coi_hook_pre,
+    TP_PROTO(struct kedr_coi_hook_context* ctx),
+    TP_ARGS(ctx)
+);
+
+/* Fired after post-handlers. */
+DEFINE_EVENT(kedr_coi_hook, kedr_coi_hook_post,
+    TP_PROTO(struct kedr_coi_hook_context* ctx),
+    TP_ARGS(ctx)
+);
+
+#endif /* KEDR_COI_HOOKS_TRACE_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE kedr_coi_hooks_trace
+#include <trace/define_trace.h>
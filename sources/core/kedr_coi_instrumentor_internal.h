@@ -45,9 +45,22 @@ struct instrument_data_operations;
 /* Abstract data described instrumentation of one operations object. */
 struct instrument_data
 {
+    /*
+     * Reference counter. Protected by instrumentor's lock: the last
+     * reference dropped removes the object from the hash tables.
+     */
     int refs;
     
     const struct instrument_data_operations* i_ops;
+    
+    /*
+     * Element in the instrumentor's list of instrument data, reference
+     * to which is kept for evicted watches: their objects may still use
+     * our operations. Empty if reference is not kept.
+     * 
+     * Protected by instrumentor's lock.
+     */
+    struct list_head kept_elem;
 };
 
 /* 
@@ -74,6 +87,65 @@ struct kedr_coi_instrumentor_watch_data
     struct kedr_coi_hash_elem object_elem;
     /* Referenced instrument_data object */
     struct instrument_data* idata;
+    
+    /*
+     * Hierarchy of watches (see kedr_coi_instrumentor_watch_child()).
+     * 
+     * Parent and children may belong to other instrumentors.
+     * Fields below, except 'instrumentor', are protected by the lock of
+     * the hierarchy.
+     */
+    
+    /* Instrumentor this watch belongs to. */
+    struct kedr_coi_instrumentor* instrumentor;
+    /*
+     * Lock of the hierarchy, NULL if watch has never been involved
+     * into hierarchy. Shared by all watches in the hierarchy.
+     * 
+     * When set, removing of the watch requires that lock to be taken
+     * (before instrumentor's one). Changed with both instrumentor's
+     * lock and locks of old and new hierarchies taken, or, for
+     * descendants of the watch moved, with locks of hierarchies only.
+     */
+    spinlock_t* hierarchy_lock;
+    /* Parent watch or NULL. */
+    struct kedr_coi_instrumentor_watch_data* parent;
+    /* Element in the list of parent's children. */
+    struct list_head child_elem;
+    /* List of children watches. */
+    struct list_head children;
+    
+    /*
+     * Element in the instrumentor's list of watches, which is scanned
+     * as a clock for select watch to evict. Protected by instrumentor's
+     * lock.
+     */
+    struct list_head clock_elem;
+    /*
+     * Whether watch is used after it was scanned last time. Protected
+     * by instrumentor's lock.
+     */
+    bool referenced;
+};
+
+/*
+ * Memory used by the instrumentor, in bytes.
+ * 
+ * Sizes are taken from the structures allocated, overhead of the memory
+ * allocator is not counted.
+ */
+struct kedr_coi_instrumentor_memory
+{
+    /* Watches of the objects. */
+    size_t watch_data;
+    /* Instrumentation data for operations structures. */
+    size_t idata;
+    /* Copies of operations structures. */
+    size_t ops_copies;
+    /* Heads of the hash tables, including ones of foreign instrumentors. */
+    size_t hash_heads;
+    /* Watches and instrumentation data of foreign instrumentors. */
+    size_t foreign;
 };
 
 struct kedr_coi_instrumentor
@@ -107,6 +179,33 @@ struct kedr_coi_instrumentor
     
     /* Protect all hash tables, own and ones for foreign instrumentors. */
     spinlock_t lock;
+    
+    /* Whether instrumentor is used for watch direct objects. */
+    bool is_direct;
+    
+    /* 
+     * Memory used. Heads of the hash tables are not counted here, they
+     * are calculated on request.
+     * 
+     * Fields below are protected by instrumentor's lock.
+     */
+    struct kedr_coi_instrumentor_memory memory;
+    
+    /* Limit of the memory used, 0 if not limited. */
+    size_t quota;
+    /* Whether to evict watches when quota is exceeded. */
+    bool quota_evict;
+    /* Number of watches refused and evicted because of quota. */
+    unsigned long n_refused;
+    unsigned long n_evicted;
+    
+    /* Watches in order of scanning for eviction. */
+    struct list_head clock;
+    /* Instrument data referenced by evicted watches. */
+    struct list_head kept_idata;
+    
+    /* Foreign instrumentors binded with this one. */
+    struct list_head foreign_instrumentors;
 };
 
 /* 
@@ -232,6 +331,77 @@ int kedr_coi_instrumentor_get_orig_operation(
     size_t operation_offset,
     void** op_orig);
 
+/*
+ * Collect statistic about hash table of watched objects and number of
+ * instrumented operations structures (for direct instrumentor - number
+ * of instrumented objects).
+ * 
+ * Table is walked with the instrumentor's lock taken.
+ */
+void kedr_coi_instrumentor_get_stat(
+    struct kedr_coi_instrumentor* instrumentor,
+    struct kedr_coi_hash_table_stat* objects_stat,
+    size_t* n_idata);
+
+/*
+ * Fill memory used by the instrumentor and numbers of watches refused
+ * and evicted because of the quota.
+ * 
+ * Cost doesn't depend on the number of watches.
+ */
+void kedr_coi_instrumentor_get_memory(
+    struct kedr_coi_instrumentor* instrumentor,
+    struct kedr_coi_instrumentor_memory* memory,
+    unsigned long* n_refused,
+    unsigned long* n_evicted);
+
+/*
+ * Set limit of the memory used by the instrumentor, 0 means no limit.
+ * 
+ * When new watch would exceed the limit, watches not used recently are
+ * evicted if 'evict' is true, otherwise watch fails with -EDQUOT.
+ * Watch is 'used' when it is created and when original operation is
+ * requested for it. Watches of direct instrumentor are never evicted.
+ * 
+ * Evicted watches are forgotten without accessing their objects, which
+ * may be already freed. Instrument data of the evicted watches are kept
+ * until instrumentor is destroyed, so objects which are alive continue
+ * to work with original operations. kedr_coi_instrumentor_forget() for
+ * such object restores its operations and returns 1. Watches involved
+ * into hierarchy are evicted only if lock of their hierarchy is not
+ * taken at that moment.
+ * 
+ * Limit is approximate: memory for instrumentation of new operations
+ * structure is not checked.
+ */
+void kedr_coi_instrumentor_set_quota(
+    struct kedr_coi_instrumentor* instrumentor,
+    size_t quota,
+    bool evict);
+
+/*
+ * Forget watches of dead objects.
+ * 
+ * Walk next 'n_chains' chains of the objects table, starting from
+ * '*pos', and check every watch there with 'object_is_alive', which
+ * shouldn't be NULL.
+ * 
+ * Watches of dead objects are forgotten without accessing the objects,
+ * as with kedr_coi_instrumentor_forget_children().
+ * 
+ * '*pos' is updated for the next call. Return true if the walk reaches
+ * the end of the table, '*pos' is reset to 0 in that case.
+ * Number of watches forgotten is added to '*n_collected'.
+ * 
+ * 'object_is_alive' is called with instrumentor's spinlock taken.
+ */
+bool kedr_coi_instrumentor_collect(
+    struct kedr_coi_instrumentor* instrumentor,
+    size_t* pos,
+    unsigned int n_chains,
+    bool (*object_is_alive)(const void* object),
+    size_t* n_collected);
+
 /* 
  * Similar methods, but for directly watched object, which is also a
  * container of operations.
@@ -245,12 +415,57 @@ int kedr_coi_instrumentor_forget_direct(
     void* object,
     bool norestore);
 
+/* 
+ * Create instrumentor for directly watched objects.
+ * 
+ * Such instrumentor always uses 'at_place' mechanism.
+ */
+struct kedr_coi_instrumentor* kedr_coi_instrumentor_create_direct(
+    size_t object_size,
+    const struct kedr_coi_replacement* replacements);
+
+/*
+ * Watch for given object as for child of 'parent' object, watched by
+ * 'parent_instrumentor' (which may be the same as 'instrumentor').
+ * 
+ * If object is already watched, it is re-parented.
+ * 
+ * For direct instrumentor 'ops_p' should point to the object pointer.
+ * 
+ * Return 0 on success, 1 if object was already watched, negative error
+ * on fail. If parent is not watched, return -ENOENT and do not watch
+ * object. If parent is object itself or one of its descendants,
+ * return -EINVAL (object is watched in that case, but has no parent).
+ */
+int kedr_coi_instrumentor_watch_child(
+    struct kedr_coi_instrumentor* instrumentor,
+    void* object,
+    const void** ops_p,
+    struct kedr_coi_instrumentor* parent_instrumentor,
+    const void* parent);
+
+/*
+ * Forget all descendants of the object.
+ * 
+ * Descendants are forgotten without restoring their operations (like
+ * with forget_norestore()), and their fields are not accessed.
+ * 
+ * Descendants are removed in chunks, with hierarchy lock released
+ * between chunks.
+ * 
+ * Return 0 on success, 1 if object is not watched.
+ */
+int kedr_coi_instrumentor_forget_children(
+    struct kedr_coi_instrumentor* instrumentor,
+    const void* object);
+
 //**************Foreign instrumentor************************//
 struct instrument_data_foreign_operations;
 
 /* Abstract data described instrumentation of one operations object. */
 struct instrument_data_foreign
 {
+    /* Reference counter. Same rules as for instrument_data. */
     int refs;
     
     struct instrument_data* idata_binded;
@@ -281,6 +496,12 @@ struct kedr_coi_foreign_instrumentor
     struct kedr_coi_instrumentor* instrumentor_binded;
     
     const struct kedr_coi_replacement* replacements;
+    
+    /* 
+     * Element in the list of foreign instrumentors of the binded one.
+     * Protected by lock of the binded instrumentor.
+     */
+    struct list_head list;
 };
 
 /* 
@@ -26,6 +26,7 @@
 
 #include <linux/slab.h> /* memory allocations */
 #include <linux/spinlock.h> /* spinlocks */
+#include <linux/hash.h> /* hash_ptr() */
 
 /* @ops shouldn't be NULL. */
 static void* operation_at_offset(const void* ops, size_t operation_offset)
@@ -39,7 +40,58 @@ static struct kedr_coi_replacement empty_replacements[] = {
     }
 };
 //************* Normal instrumentor *****************************
+/*
+ * Locks of the hierarchies of watches.
+ * 
+ * Lock for the hierarchy is chosen by its root when the root gets its
+ * first child, all watches in the hierarchy share it. Hierarchies with
+ * different roots rarely share the lock, so they do not serialize each
+ * other.
+ * 
+ * Lock of the hierarchy should be taken before instrumentor's lock.
+ * Two hierarchy locks are taken in order of their addresses.
+ */
+#define HIERARCHY_LOCKS_BITS 6
+#define HIERARCHY_LOCKS (1 << HIERARCHY_LOCKS_BITS)
+
+static spinlock_t hierarchy_locks[HIERARCHY_LOCKS] = {
+    [0 ... HIERARCHY_LOCKS - 1] = __SPIN_LOCK_UNLOCKED(hierarchy_locks)
+};
+
+/* Number of descendants forgotten with hierarchy lock held. */
+#define FORGET_CHILDREN_CHUNK 64
+
+/* Maximum number of watches evicted for add one new watch. */
+#define QUOTA_EVICT_MAX 16
+
 // Auxiliary functions
+/*
+ * Remove watch from the hierarchy. Its children become orphans.
+ * 
+ * Orphans keep the lock of the hierarchy, so lock protects them too.
+ * 
+ * Should be called with hierarchy lock taken.
+ */
+static void watch_data_unlink(
+    struct kedr_coi_instrumentor_watch_data* watch_data)
+{
+    struct kedr_coi_instrumentor_watch_data* child;
+    struct kedr_coi_instrumentor_watch_data* child_tmp;
+    
+    if(watch_data->parent)
+    {
+        list_del_init(&watch_data->child_elem);
+        watch_data->parent = NULL;
+    }
+    
+    list_for_each_entry_safe(child, child_tmp, &watch_data->children,
+        child_elem)
+    {
+        list_del_init(&child->child_elem);
+        child->parent = NULL;
+    }
+}
+
 /* 
  * Return watch data for given object.
  * If object is not watched, return NULL.
@@ -61,15 +113,82 @@ static struct kedr_coi_instrumentor_watch_data* instrumentor_find_watch_data(
     return watch_data;
 }
 
+/*
+ * Take instrumentor's lock for operations which may remove watch of
+ * the object.
+ * 
+ * If watch of the object is involved into hierarchy, lock of that
+ * hierarchy is taken too and returned. Otherwise NULL is returned.
+ */
+static spinlock_t* instrumentor_lock_for_remove(
+    struct kedr_coi_instrumentor* instrumentor, const void* object,
+    unsigned long* flags)
+{
+    struct kedr_coi_instrumentor_watch_data* watch_data;
+    spinlock_t* hierarchy_lock;
+    
+    spin_lock_irqsave(&instrumentor->lock, *flags);
+    
+    while(1)
+    {
+        watch_data = instrumentor_find_watch_data(instrumentor, object);
+        if(watch_data == NULL) return NULL;
+        
+        hierarchy_lock = READ_ONCE(watch_data->hierarchy_lock);
+        if(hierarchy_lock == NULL) return NULL;
+        
+        // Relock in correct order.
+        spin_unlock_irqrestore(&instrumentor->lock, *flags);
+        
+        spin_lock_irqsave(hierarchy_lock, *flags);
+        spin_lock(&instrumentor->lock);
+        
+        watch_data = instrumentor_find_watch_data(instrumentor, object);
+        if((watch_data == NULL)
+            || (READ_ONCE(watch_data->hierarchy_lock) == hierarchy_lock))
+            return hierarchy_lock;
+        
+        // Watch has been moved into another hierarchy while unlocked.
+        spin_unlock(hierarchy_lock);
+    }
+}
+
+static void instrumentor_unlock_for_remove(
+    struct kedr_coi_instrumentor* instrumentor, spinlock_t* hierarchy_lock,
+    unsigned long flags)
+{
+    if(hierarchy_lock)
+    {
+        spin_unlock(&instrumentor->lock);
+        spin_unlock_irqrestore(hierarchy_lock, flags);
+    }
+    else
+    {
+        spin_unlock_irqrestore(&instrumentor->lock, flags);
+    }
+}
+
+/* 
+ * Destroy watch data.
+ * 
+ * If watch is involved into hierarchy, lock of that hierarchy should
+ * be taken.
+ */
 static void instrumentor_destroy_watch_data(
     struct kedr_coi_instrumentor* instrumentor,
     struct kedr_coi_instrumentor_watch_data* watch_data)
 {
+    if(watch_data->hierarchy_lock)
+        watch_data_unlink(watch_data);
+    
     instrument_data_unref(instrumentor, watch_data->idata);
     
     kedr_coi_hash_table_remove_elem(&instrumentor->objects_table,
         &watch_data->object_elem);
     
+    list_del(&watch_data->clock_elem);
+    instrumentor->memory.watch_data -= sizeof(*watch_data);
+    
     kfree(watch_data);
 }
 
@@ -77,11 +196,17 @@ static void instrumentor_destroy_watch_data_norestore(
     struct kedr_coi_instrumentor* instrumentor,
     struct kedr_coi_instrumentor_watch_data* watch_data)
 {
+    if(watch_data->hierarchy_lock)
+        watch_data_unlink(watch_data);
+    
     instrument_data_unref_norestore(instrumentor, watch_data->idata);
     
     kedr_coi_hash_table_remove_elem(&instrumentor->objects_table,
         &watch_data->object_elem);
     
+    list_del(&watch_data->clock_elem);
+    instrumentor->memory.watch_data -= sizeof(*watch_data);
+    
     kfree(watch_data);
 }
 
@@ -221,11 +346,148 @@ static void* instrumentor_get_orig_operation_nodata(
     return op;
 }
 
-/* Called under lock. */
+/* Memory used by the instrumentor, including heads of hash tables. */
+static void instrumentor_memory_calc(
+    struct kedr_coi_instrumentor* instrumentor,
+    struct kedr_coi_instrumentor_memory* memory)
+{
+    struct kedr_coi_foreign_instrumentor* instrumentor_foreign;
+    
+    *memory = instrumentor->memory;
+    
+    memory->hash_heads = 
+        kedr_coi_hash_table_heads_memory(&instrumentor->objects_table)
+        + kedr_coi_hash_table_heads_memory(&instrumentor->idata_table)
+        + kedr_coi_hash_table_heads_memory(&instrumentor->foreign_ops_p_table);
+    
+    list_for_each_entry(instrumentor_foreign,
+        &instrumentor->foreign_instrumentors, list)
+    {
+        memory->hash_heads +=
+            kedr_coi_hash_table_heads_memory(&instrumentor_foreign->ids_table)
+            + kedr_coi_hash_table_heads_memory(&instrumentor_foreign->ties_table);
+    }
+}
+
+static size_t instrumentor_memory_total(
+    struct kedr_coi_instrumentor* instrumentor)
+{
+    struct kedr_coi_instrumentor_memory memory;
+    
+    instrumentor_memory_calc(instrumentor, &memory);
+    
+    return memory.watch_data + memory.idata + memory.ops_copies
+        + memory.hash_heads + memory.foreign;
+}
+
+/*
+ * Forget watch because of quota.
+ * 
+ * Object may be already freed, so it is not accessed. But it may be
+ * alive too and use our operations, so instrument data are kept until
+ * instrumentor is destroyed. Not used by direct instrumentor, which
+ * operations are the object itself.
+ * 
+ * If watch is involved into hierarchy, lock of that hierarchy should
+ * be taken.
+ */
+static void instrumentor_evict_watch(
+    struct kedr_coi_instrumentor* instrumentor,
+    struct kedr_coi_instrumentor_watch_data* watch_data)
+{
+    struct instrument_data* idata = watch_data->idata;
+    
+    if(list_empty(&idata->kept_elem))
+    {
+        instrument_data_ref(idata);
+        list_add_tail(&idata->kept_elem, &instrumentor->kept_idata);
+    }
+    
+    // Not the last reference, so operations are not restored.
+    instrumentor_destroy_watch_data(instrumentor, watch_data);
+    
+    instrumentor->n_evicted++;
+}
+
+/*
+ * Check quota before new watch is added.
+ * 
+ * If quota is exceeded, watches are evicted if it is allowed. Watches
+ * are scanned as a clock: watch used after the previous scan is given
+ * a second chance. Watch 'keep' is never evicted. Watches in
+ * hierarchies which locks cannot be taken immediately are skipped: lock
+ * of the hierarchy should be taken before instrumentor's one.
+ * 
+ * Return 0 if watch may be added, -EDQUOT otherwise.
+ * 
+ * Called under lock.
+ */
+static int instrumentor_check_quota(
+    struct kedr_coi_instrumentor* instrumentor,
+    bool can_evict,
+    struct kedr_coi_instrumentor_watch_data* keep)
+{
+    struct kedr_coi_instrumentor_watch_data* watch_data;
+    spinlock_t* hierarchy_lock;
+    size_t size = sizeof(*watch_data);
+    size_t memory_total;
+    size_t n_scan;
+    int n_evicted = 0;
+    
+    if(instrumentor->quota == 0) return 0;
+    
+    memory_total = instrumentor_memory_total(instrumentor);
+    
+    if(instrumentor->quota_evict && can_evict && !instrumentor->is_direct)
+    {
+        // Every watch is scanned at most twice.
+        n_scan = 2 * instrumentor->objects_table.n_elems;
+        
+        while((memory_total + size > instrumentor->quota)
+            && (n_evicted < QUOTA_EVICT_MAX) && (n_scan-- > 0))
+        {
+            watch_data = list_first_entry(&instrumentor->clock,
+                typeof(*watch_data), clock_elem);
+            
+            hierarchy_lock = watch_data->hierarchy_lock;
+            if(watch_data->referenced || (watch_data == keep)
+                || (hierarchy_lock && !spin_trylock(hierarchy_lock)))
+            {
+                watch_data->referenced = false;
+                list_move_tail(&watch_data->clock_elem, &instrumentor->clock);
+                continue;
+            }
+            
+            instrumentor_evict_watch(instrumentor, watch_data);
+            // Instrument data are kept, only watch itself is freed.
+            memory_total -= size;
+            n_evicted++;
+            
+            if(hierarchy_lock) spin_unlock(hierarchy_lock);
+        }
+    }
+    
+    if(memory_total + size > instrumentor->quota)
+    {
+        instrumentor->n_refused++;
+        return -EDQUOT;
+    }
+    
+    return 0;
+}
+
+/*
+ * Called under lock.
+ * 
+ * Quota may be satisfied by evicting watches (except 'keep') only if
+ * 'can_evict' is true.
+ */
 static int instrumentor_watch_internal(
     struct kedr_coi_instrumentor* instrumentor,
     void* object,
-    const void** ops_p)
+    const void** ops_p,
+    bool can_evict,
+    struct kedr_coi_instrumentor_watch_data* keep)
 {
     int err;
     struct instrument_data* idata;
@@ -259,6 +521,10 @@ static int instrumentor_watch_internal(
         instrument_data_replace_ops(idata, ops_p);
         return 1;
     }
+    
+    err = instrumentor_check_quota(instrumentor, can_evict, keep);
+    if(err) return err;
+    
     // Create new watch
     idata = instrumentor_get_data(instrumentor, *ops_p);
     if(IS_ERR(idata))
@@ -271,11 +537,20 @@ static int instrumentor_watch_internal(
     if(watch_data == NULL) goto fail_alloc_watch_data;
 
     watch_data->idata = idata;
+    watch_data->instrumentor = instrumentor;
+    watch_data->hierarchy_lock = NULL;
+    watch_data->parent = NULL;
+    INIT_LIST_HEAD(&watch_data->child_elem);
+    INIT_LIST_HEAD(&watch_data->children);
     kedr_coi_hash_elem_init(&watch_data->object_elem, object);
     err = kedr_coi_hash_table_add_elem(
         &instrumentor->objects_table, &watch_data->object_elem);
     if(err) goto fail_add_object_elem;
 
+    list_add_tail(&watch_data->clock_elem, &instrumentor->clock);
+    watch_data->referenced = false;
+    instrumentor->memory.watch_data += sizeof(*watch_data);
+
     instrument_data_replace_ops(watch_data->idata, ops_p);
     return 0;
 
@@ -313,6 +588,18 @@ struct kedr_coi_instrumentor* kedr_coi_instrumentor_create(
     instrumentor->replace_at_place = replace_at_place;
     
     spin_lock_init(&instrumentor->lock);
+    
+    instrumentor->is_direct = false;
+    
+    memset(&instrumentor->memory, 0, sizeof(instrumentor->memory));
+    instrumentor->quota = 0;
+    instrumentor->quota_evict = false;
+    instrumentor->n_refused = 0;
+    instrumentor->n_evicted = 0;
+    
+    INIT_LIST_HEAD(&instrumentor->clock);
+    INIT_LIST_HEAD(&instrumentor->kept_idata);
+    INIT_LIST_HEAD(&instrumentor->foreign_instrumentors);
 
     return instrumentor;
 
@@ -342,8 +629,29 @@ static void instrumentor_destroy_watch_data_callback(
         container_of(elem, typeof(*watch_data), object_elem);
     struct instrumentor_destroy_data* destroy_data = user_data;
     
+    if(watch_data->hierarchy_lock)
+    {
+        unsigned long flags;
+        spinlock_t* hierarchy_lock;
+        
+        // Watch may be moved into another hierarchy concurrently.
+        while(1)
+        {
+            hierarchy_lock = READ_ONCE(watch_data->hierarchy_lock);
+            spin_lock_irqsave(hierarchy_lock, flags);
+            if(watch_data->hierarchy_lock == hierarchy_lock) break;
+            spin_unlock_irqrestore(hierarchy_lock, flags);
+        }
+        
+        watch_data_unlink(watch_data);
+        spin_unlock_irqrestore(hierarchy_lock, flags);
+    }
+    
     instrument_data_unref(destroy_data->instrumentor, watch_data->idata);
     
+    list_del(&watch_data->clock_elem);
+    destroy_data->instrumentor->memory.watch_data -= sizeof(*watch_data);
+    
     kfree(watch_data);
     
     if(destroy_data->trace_unforgotten_watch)
@@ -360,9 +668,18 @@ void kedr_coi_instrumentor_destroy(struct kedr_coi_instrumentor* instrumentor,
         .trace_unforgotten_watch = trace_unforgotten_watch,
         .user_data = user_data
     };
+    struct instrument_data* idata;
+    struct instrument_data* idata_tmp;
     
     kedr_coi_hash_table_destroy(&instrumentor->objects_table,
         &instrumentor_destroy_watch_data_callback, &destroy_data);
+    
+    list_for_each_entry_safe(idata, idata_tmp, &instrumentor->kept_idata,
+        kept_elem)
+    {
+        list_del_init(&idata->kept_elem);
+        instrument_data_unref(instrumentor, idata);
+    }
 
     kedr_coi_hash_table_destroy(&instrumentor->foreign_ops_p_table,
         NULL, NULL);
@@ -379,10 +696,14 @@ int kedr_coi_instrumentor_watch(
 {
     unsigned long flags;
     int err;
+    spinlock_t* hierarchy_lock;
     
-    spin_lock_irqsave(&instrumentor->lock, flags);
-    err = instrumentor_watch_internal(instrumentor, object, ops_p);
-    spin_unlock_irqrestore(&instrumentor->lock, flags);
+    // Watch may be removed on failed update, others may be evicted.
+    hierarchy_lock = instrumentor_lock_for_remove(instrumentor, object,
+        &flags);
+    err = instrumentor_watch_internal(instrumentor, object, ops_p,
+        true, NULL);
+    instrumentor_unlock_for_remove(instrumentor, hierarchy_lock, flags);
 
     return err;
 }
@@ -397,8 +718,10 @@ int kedr_coi_instrumentor_forget(
     int err = 0;
     struct kedr_coi_instrumentor_watch_data* watch_data;
     struct instrument_data* idata;
+    spinlock_t* hierarchy_lock;
     
-    spin_lock_irqsave(&instrumentor->lock, flags);
+    hierarchy_lock = instrumentor_lock_for_remove(instrumentor, object,
+        &flags);
     
     watch_data = instrumentor_find_watch_data(instrumentor, object);
     if(watch_data)
@@ -412,14 +735,154 @@ int kedr_coi_instrumentor_forget(
     }
     else
     {
+        // Evicted object may still use our operations.
+        if(ops_p)
+        {
+            idata = instrumentor_find_data(instrumentor, *ops_p);
+            if(idata && !list_empty(&idata->kept_elem))
+                instrument_data_restore_ops(idata, ops_p);
+        }
         err = 1; //Not watched
     }
     
-    spin_unlock_irqrestore(&instrumentor->lock, flags);
+    instrumentor_unlock_for_remove(instrumentor, hierarchy_lock, flags);
     
     return err;
 }
 
+void kedr_coi_instrumentor_get_stat(
+    struct kedr_coi_instrumentor* instrumentor,
+    struct kedr_coi_hash_table_stat* objects_stat,
+    size_t* n_idata)
+{
+    unsigned long flags;
+    
+    spin_lock_irqsave(&instrumentor->lock, flags);
+    
+    kedr_coi_hash_table_get_stat(&instrumentor->objects_table, objects_stat);
+    *n_idata = instrumentor->idata_table.n_elems;
+    
+    spin_unlock_irqrestore(&instrumentor->lock, flags);
+}
+
+void kedr_coi_instrumentor_get_memory(
+    struct kedr_coi_instrumentor* instrumentor,
+    struct kedr_coi_instrumentor_memory* memory,
+    unsigned long* n_refused,
+    unsigned long* n_evicted)
+{
+    unsigned long flags;
+    
+    spin_lock_irqsave(&instrumentor->lock, flags);
+    
+    instrumentor_memory_calc(instrumentor, memory);
+    *n_refused = instrumentor->n_refused;
+    *n_evicted = instrumentor->n_evicted;
+    
+    spin_unlock_irqrestore(&instrumentor->lock, flags);
+}
+
+void kedr_coi_instrumentor_set_quota(
+    struct kedr_coi_instrumentor* instrumentor,
+    size_t quota,
+    bool evict)
+{
+    unsigned long flags;
+    
+    spin_lock_irqsave(&instrumentor->lock, flags);
+    
+    instrumentor->quota = quota;
+    instrumentor->quota_evict = evict;
+    
+    spin_unlock_irqrestore(&instrumentor->lock, flags);
+}
+
+/* Data for search of the dead object in the chain of objects table. */
+struct instrumentor_collect_data
+{
+    bool (*object_is_alive)(const void* object);
+    /* Lock of the hierarchy of the dead watch found, if any. */
+    spinlock_t* hierarchy_lock;
+};
+
+/*
+ * Dead watch in hierarchy is found only if lock of the hierarchy can
+ * be taken immediately: that lock should be taken before instrumentor's
+ * one. Otherwise watch is collected on the next pass.
+ */
+static bool instrumentor_watch_is_dead(struct kedr_coi_hash_elem* elem,
+    void* data)
+{
+    struct instrumentor_collect_data* collect_data = data;
+    struct kedr_coi_instrumentor_watch_data* watch_data =
+        container_of(elem, typeof(*watch_data), object_elem);
+    spinlock_t* hierarchy_lock;
+    
+    if(collect_data->object_is_alive(watch_data->object_elem.key))
+        return false;
+    
+    hierarchy_lock = watch_data->hierarchy_lock;
+    if(hierarchy_lock && !spin_trylock(hierarchy_lock)) return false;
+    
+    collect_data->hierarchy_lock = hierarchy_lock;
+    return true;
+}
+
+bool kedr_coi_instrumentor_collect(
+    struct kedr_coi_instrumentor* instrumentor,
+    size_t* pos,
+    unsigned int n_chains,
+    bool (*object_is_alive)(const void* object),
+    size_t* n_collected)
+{
+    unsigned long flags;
+    bool done = false;
+    struct instrumentor_collect_data collect_data =
+    {
+        .object_is_alive = object_is_alive
+    };
+    
+    spin_lock_irqsave(&instrumentor->lock, flags);
+    
+    for(; n_chains > 0; n_chains--)
+    {
+        struct kedr_coi_hash_elem* elem;
+        struct kedr_coi_instrumentor_watch_data* watch_data;
+        
+        if(*pos >= kedr_coi_hash_table_n_chains(&instrumentor->objects_table))
+        {
+            *pos = 0;
+            done = true;
+            break;
+        }
+        
+        elem = kedr_coi_hash_table_chain_find(&instrumentor->objects_table,
+            *pos, &instrumentor_watch_is_dead, &collect_data);
+        if(elem == NULL)
+        {
+            (*pos)++;
+            continue;
+        }
+        
+        watch_data = container_of(elem, typeof(*watch_data), object_elem);
+        // Same as instrumentor_forget_leaf(), object is not accessed.
+        if(instrumentor->is_direct)
+            instrumentor_destroy_watch_data_norestore(instrumentor, watch_data);
+        else
+            instrumentor_destroy_watch_data(instrumentor, watch_data);
+        
+        if(collect_data.hierarchy_lock)
+            spin_unlock(collect_data.hierarchy_lock);
+        
+        (*n_collected)++;
+        // Table may be reallocated, so the chain is searched again.
+    }
+    
+    spin_unlock_irqrestore(&instrumentor->lock, flags);
+    
+    return done;
+}
+
 int kedr_coi_instrumentor_get_orig_operation(
     struct kedr_coi_instrumentor* instrumentor,
     const void* object,
@@ -439,6 +902,10 @@ int kedr_coi_instrumentor_get_orig_operation(
     {
         idata = watch_data->idata;
         *op_orig = idata->i_ops->get_orig_operation(idata, operation_offset);
+        
+        // Avoid writing to the watch on every call.
+        if(!watch_data->referenced)
+            watch_data->referenced = true;
     }
     else
     {
@@ -488,8 +955,10 @@ int kedr_coi_instrumentor_forget_direct(
     int err = 0;
     struct kedr_coi_instrumentor_watch_data* watch_data;
     struct instrument_data* idata;
+    spinlock_t* hierarchy_lock;
     
-    spin_lock_irqsave(&instrumentor->lock, flags);
+    hierarchy_lock = instrumentor_lock_for_remove(instrumentor, object,
+        &flags);
     
     watch_data = instrumentor_find_watch_data(instrumentor, object);
     if(watch_data)
@@ -512,10 +981,326 @@ int kedr_coi_instrumentor_forget_direct(
         err = 1; //Not watched
     }
     
+    instrumentor_unlock_for_remove(instrumentor, hierarchy_lock, flags);
+    
+    return err;
+
+}
+
+/* Used for direct instrumentor. */
+static bool replace_at_place_always(const void* ops)
+{
+    (void)ops;
+    return 1;
+}
+
+struct kedr_coi_instrumentor* kedr_coi_instrumentor_create_direct(
+    size_t object_size,
+    const struct kedr_coi_replacement* replacements)
+{
+    struct kedr_coi_instrumentor* instrumentor = kedr_coi_instrumentor_create(
+        object_size, replacements, &replace_at_place_always);
+    
+    if(instrumentor)
+        instrumentor->is_direct = true;
+    
+    return instrumentor;
+}
+
+/* 
+ * Whether 'watch_data' is 'ancestor' itself or its descendant.
+ * 
+ * Should be called with hierarchy lock taken.
+ */
+static bool watch_data_is_descendant(
+    struct kedr_coi_instrumentor_watch_data* watch_data,
+    struct kedr_coi_instrumentor_watch_data* ancestor)
+{
+    for(; watch_data; watch_data = watch_data->parent)
+    {
+        if(watch_data == ancestor) return true;
+    }
+    
+    return false;
+}
+
+/*
+ * Move watch and all its descendants into the hierarchy with given lock.
+ * 
+ * Should be called with locks of both hierarchies taken.
+ */
+static void watch_data_move_hierarchy(
+    struct kedr_coi_instrumentor_watch_data* watch_data,
+    spinlock_t* hierarchy_lock)
+{
+    struct kedr_coi_instrumentor_watch_data* top = watch_data;
+    
+    // Depth-first traversal, parent is processed before its children.
+    while(1)
+    {
+        WRITE_ONCE(watch_data->hierarchy_lock, hierarchy_lock);
+        
+        if(!list_empty(&watch_data->children))
+        {
+            watch_data = list_first_entry(&watch_data->children,
+                typeof(*watch_data), child_elem);
+            continue;
+        }
+        
+        // Go to the next sibling of the nearest ancestor which has it.
+        for(; watch_data != top; watch_data = watch_data->parent)
+        {
+            if(watch_data->child_elem.next != &watch_data->parent->children)
+                break;
+        }
+        if(watch_data == top) break;
+        
+        watch_data = list_entry(watch_data->child_elem.next,
+            typeof(*watch_data), child_elem);
+    }
+}
+
+/* 
+ * Take locks of two hierarchies in correct order.
+ * 
+ * 'hierarchy_lock_other' may be NULL.
+ */
+static void hierarchy_lock_two(spinlock_t* hierarchy_lock,
+    spinlock_t* hierarchy_lock_other, unsigned long* flags)
+{
+    if(hierarchy_lock_other == NULL)
+    {
+        spin_lock_irqsave(hierarchy_lock, *flags);
+    }
+    else if(hierarchy_lock < hierarchy_lock_other)
+    {
+        spin_lock_irqsave(hierarchy_lock, *flags);
+        spin_lock_nested(hierarchy_lock_other, SINGLE_DEPTH_NESTING);
+    }
+    else
+    {
+        spin_lock_irqsave(hierarchy_lock_other, *flags);
+        spin_lock_nested(hierarchy_lock, SINGLE_DEPTH_NESTING);
+    }
+}
+
+static void hierarchy_unlock_two(spinlock_t* hierarchy_lock,
+    spinlock_t* hierarchy_lock_other, unsigned long flags)
+{
+    if(hierarchy_lock_other) spin_unlock(hierarchy_lock_other);
+    spin_unlock_irqrestore(hierarchy_lock, flags);
+}
+
+int kedr_coi_instrumentor_watch_child(
+    struct kedr_coi_instrumentor* instrumentor,
+    void* object,
+    const void** ops_p,
+    struct kedr_coi_instrumentor* parent_instrumentor,
+    const void* parent)
+{
+    unsigned long flags;
+    int err;
+    struct kedr_coi_instrumentor_watch_data* parent_watch_data;
+    struct kedr_coi_instrumentor_watch_data* watch_data;
+    /* Lock of the parent's hierarchy. */
+    spinlock_t* hierarchy_lock;
+    /* Lock of another hierarchy the object is involved into, if any. */
+    spinlock_t* hierarchy_lock_child;
+    /* Whether hierarchies have been changed while unlocked. */
+    bool retry;
+    
+again:
+    retry = false;
+
+    spin_lock_irqsave(&parent_instrumentor->lock, flags);
+    parent_watch_data = instrumentor_find_watch_data(parent_instrumentor,
+        parent);
+    if(parent_watch_data == NULL)
+    {
+        spin_unlock_irqrestore(&parent_instrumentor->lock, flags);
+        return -ENOENT;
+    }
+    hierarchy_lock = parent_watch_data->hierarchy_lock;
+    // Parent becomes a root of the new hierarchy.
+    if(hierarchy_lock == NULL)
+        hierarchy_lock = &hierarchy_locks[hash_ptr(parent_watch_data,
+            HIERARCHY_LOCKS_BITS)];
+    spin_unlock_irqrestore(&parent_instrumentor->lock, flags);
+    
+    spin_lock_irqsave(&instrumentor->lock, flags);
+    watch_data = instrumentor_find_watch_data(instrumentor, object);
+    hierarchy_lock_child = watch_data ? watch_data->hierarchy_lock : NULL;
     spin_unlock_irqrestore(&instrumentor->lock, flags);
     
+    if(hierarchy_lock_child == hierarchy_lock) hierarchy_lock_child = NULL;
+    
+    hierarchy_lock_two(hierarchy_lock, hierarchy_lock_child, &flags);
+    
+    spin_lock(&parent_instrumentor->lock);
+    parent_watch_data = instrumentor_find_watch_data(parent_instrumentor,
+        parent);
+    if(parent_watch_data == NULL)
+    {
+        err = -ENOENT;
+    }
+    else if(parent_watch_data->hierarchy_lock == NULL)
+    {
+        parent_watch_data->hierarchy_lock = hierarchy_lock;
+        err = 0;
+    }
+    else
+    {
+        // Parent may be moved into another hierarchy while unlocked.
+        retry = (parent_watch_data->hierarchy_lock != hierarchy_lock);
+        err = 0;
+    }
+    /* 
+     * Since that moment parent watch may be removed only with
+     * lock of its hierarchy taken, so it cannot disappear.
+     */
+    spin_unlock(&parent_instrumentor->lock);
+    
+    if(err || retry) goto out;
+    
+    spin_lock(&instrumentor->lock);
+    
+    // Watches may be evicted except ones in the locked hierarchies.
+    err = instrumentor_watch_internal(instrumentor, object, ops_p,
+        true, parent_watch_data);
+    if(err >= 0)
+    {
+        watch_data = instrumentor_find_watch_data(instrumentor, object);
+        BUG_ON(watch_data == NULL);
+        
+        if(watch_data->hierarchy_lock
+            && (watch_data->hierarchy_lock != hierarchy_lock)
+            && (watch_data->hierarchy_lock != hierarchy_lock_child))
+        {
+            // Object is involved into another hierarchy while unlocked.
+            retry = true;
+        }
+        else if(watch_data_is_descendant(parent_watch_data, watch_data))
+        {
+            pr_err("Attempt to make object %p a child of its own descendant.",
+                object);
+            err = -EINVAL;
+        }
+        else if(watch_data->parent != parent_watch_data)
+        {
+            if(watch_data->parent) list_del(&watch_data->child_elem);
+            
+            if(watch_data->hierarchy_lock != hierarchy_lock)
+                watch_data_move_hierarchy(watch_data, hierarchy_lock);
+            
+            watch_data->parent = parent_watch_data;
+            list_add_tail(&watch_data->child_elem,
+                &parent_watch_data->children);
+        }
+    }
+    
+    spin_unlock(&instrumentor->lock);
+out:
+    hierarchy_unlock_two(hierarchy_lock, hierarchy_lock_child, flags);
+    
+    if(retry) goto again;
+    
     return err;
+}
 
+/* 
+ * Forget watch which is a part of hierarchy and has no children.
+ * 
+ * Object's fields are not accessed.
+ * 
+ * Should be called with hierarchy lock taken.
+ */
+static void instrumentor_forget_leaf(
+    struct kedr_coi_instrumentor_watch_data* watch_data)
+{
+    struct kedr_coi_instrumentor* instrumentor = watch_data->instrumentor;
+    
+    spin_lock(&instrumentor->lock);
+    /* 
+     * For direct objects the only way to not access object is to
+     * not restore operations.
+     * 
+     * For indirect ones operations pointer just isn't restored.
+     */
+    if(instrumentor->is_direct)
+        instrumentor_destroy_watch_data_norestore(instrumentor, watch_data);
+    else
+        instrumentor_destroy_watch_data(instrumentor, watch_data);
+    spin_unlock(&instrumentor->lock);
+}
+
+int kedr_coi_instrumentor_forget_children(
+    struct kedr_coi_instrumentor* instrumentor,
+    const void* object)
+{
+    unsigned long flags;
+    struct kedr_coi_instrumentor_watch_data* root;
+    struct kedr_coi_instrumentor_watch_data* watch_data;
+    int n_forgotten;
+    bool is_first_chunk = true;
+    bool done;
+    spinlock_t* hierarchy_lock;
+    
+    do
+    {
+        hierarchy_lock = instrumentor_lock_for_remove(instrumentor, object,
+            &flags);
+        
+        root = instrumentor_find_watch_data(instrumentor, object);
+        if(root == NULL)
+        {
+            instrumentor_unlock_for_remove(instrumentor, hierarchy_lock, flags);
+            // Object may be forgotten while lock was released.
+            return is_first_chunk ? 1 : 0;
+        }
+        // Watch which is not involved into hierarchy has no children.
+        if((hierarchy_lock == NULL) || list_empty(&root->children))
+        {
+            instrumentor_unlock_for_remove(instrumentor, hierarchy_lock, flags);
+            return 0;
+        }
+        /* 
+         * Watch which has children may be removed only with lock of
+         * its hierarchy taken, so it cannot disappear.
+         */
+        spin_unlock(&instrumentor->lock);
+        
+        done = false;
+        // Depth-first traversal, leaves are forgotten.
+        watch_data = root;
+        for(n_forgotten = 0; !done && (n_forgotten < FORGET_CHILDREN_CHUNK);)
+        {
+            if(!list_empty(&watch_data->children))
+            {
+                watch_data = list_first_entry(&watch_data->children,
+                    typeof(*watch_data), child_elem);
+            }
+            else if(watch_data == root)
+            {
+                done = true;
+            }
+            else
+            {
+                struct kedr_coi_instrumentor_watch_data* parent =
+                    watch_data->parent;
+                
+                instrumentor_forget_leaf(watch_data);
+                n_forgotten++;
+                
+                watch_data = parent;
+            }
+        }
+        
+        spin_unlock_irqrestore(hierarchy_lock, flags);
+        
+        is_first_chunk = false;
+    } while(!done);
+    
+    return 0;
 }
 
 
@@ -662,6 +1447,8 @@ static void instrumentor_foreign_destroy_watch_data(
         &instrumentor->instrumentor_binded->foreign_ops_p_table,
         &watch_data->ops_p_elem);
     
+    instrumentor->instrumentor_binded->memory.foreign -= sizeof(*watch_data);
+    
     kfree(watch_data);
 }
 
@@ -831,6 +1618,8 @@ static int foreign_instrumentor_watch(
     if(err) goto fail_add_ops_p_elem;
 
 
+    instrumentor_binded->memory.foreign += sizeof(*watch_data);
+
     instrument_data_foreign_replace_ops(watch_data->idata_foreign, ops_p);
     return 0;
 
@@ -881,9 +1670,14 @@ int foreign_instrumentor_bind(
             operation_offset);
         *op_orig = instrument_data_get_orig_operation(idata, operation_offset);
         
-        // If object is already watched, 1 will be returned.
+        /*
+         * If object is already watched, 1 will be returned.
+         * 
+         * Watches involved into hierarchies are evicted only if locks
+         * of their hierarchies are not taken by others.
+         */
         return instrumentor_watch_internal(instrumentor_binded, (void*)object,
-            ops_p);
+            ops_p, true, NULL);
     }
     // Foreign tie is not watched.
 
@@ -985,6 +1779,7 @@ struct kedr_coi_foreign_instrumentor* kedr_coi_foreign_instrumentor_create(
     const struct kedr_coi_replacement* replacements)
 {
     int err;
+    unsigned long flags;
     struct kedr_coi_foreign_instrumentor* instrumentor = kmalloc(
         sizeof(*instrumentor), GFP_KERNEL);
     
@@ -1001,6 +1796,11 @@ struct kedr_coi_foreign_instrumentor* kedr_coi_foreign_instrumentor_create(
         ? replacements
         : empty_replacements;
 
+    spin_lock_irqsave(&instrumentor_binded->lock, flags);
+    list_add_tail(&instrumentor->list,
+        &instrumentor_binded->foreign_instrumentors);
+    spin_unlock_irqrestore(&instrumentor_binded->lock, flags);
+
     return instrumentor;
 
 fail_ties_table:
@@ -1038,6 +1838,8 @@ static void instrumentor_foreign_destroy_watch_data_callback(
         &instrumentor->instrumentor_binded->foreign_ops_p_table,
         &watch_data->ops_p_elem);
     
+    instrumentor->instrumentor_binded->memory.foreign -= sizeof(*watch_data);
+    
     kfree(watch_data);
     
     if(destroy_data->trace_unforgotten_watch)
@@ -1067,6 +1869,7 @@ void kedr_coi_foreign_instrumentor_destroy(
     spin_lock_irqsave(&instrumentor_binded->lock, flags);
     kedr_coi_hash_table_destroy(&instrumentor->ids_table,
         &instrumentor_foreign_destroy_watch_data_callback, &destroy_data);
+    list_del(&instrumentor->list);
     spin_unlock_irqrestore(&instrumentor_binded->lock, flags);
     
     /*
@@ -22,6 +22,7 @@
  
 #include "kedr_coi_instrumentor_internal.h"
 #include "kedr_coi_hash_table.h"
+#include "kedr_coi_mechanism_selector.h"
 
 
 #include <linux/slab.h> /* memory allocations */
@@ -60,6 +61,7 @@ static void instrument_data_init(struct instrument_data* idata,
 {
     idata->refs = 1;
     idata->i_ops = i_ops;
+    INIT_LIST_HEAD(&idata->kept_elem);
 }
 
 /* Initialize search data structure. */
@@ -310,6 +312,9 @@ static struct instrument_data_foreign* apf_idata_ops_create_foreign_data(
     list_add_tail(&apf_idata_foreign->foreign_data_elem,
         &apf_idata->foreign_data_list);
     
+    instrumentor_foreign->instrumentor_binded->memory.foreign +=
+        sizeof(*apf_idata_foreign);
+    
     for_each_replacement(replacement, instrumentor_foreign->replacements)
     {
         size_t operation_offset = replacement->operation_offset;
@@ -536,6 +541,8 @@ out:
         instrument_data_unref_norestore(instrumentor_binded,
             &apf_idata->idata_base);
     
+    instrumentor_binded->memory.foreign -= sizeof(*apf_idata_foreign);
+    
     kfree(apf_idata_foreign);
 }
 
@@ -652,6 +659,8 @@ static struct instrument_data* ap_idata_create(
         replace_operation(op_p, replacement);
     }
 
+    instrumentor->memory.idata += sizeof(*ap_idata);
+    instrumentor->memory.ops_copies += instrumentor->operations_struct_size;
     
     return ap_idata_to_idata(ap_idata);
 
@@ -669,6 +678,9 @@ static void ap_idata_destroy_norestore(
 {
     instrumentor_remove_data_search(instrumentor, &ap_idata->ops_elem);
     
+    instrumentor->memory.idata -= sizeof(*ap_idata);
+    instrumentor->memory.ops_copies -= instrumentor->operations_struct_size;
+    
     kfree(ap_idata->ops_orig);
     kfree(ap_idata);
 }
@@ -821,6 +833,9 @@ static struct instrument_data* uc_idata_create(
         replace_operation(op_p, replacement);
     }
     
+    instrumentor->memory.idata += sizeof(*uc_idata);
+    instrumentor->memory.ops_copies += instrumentor->operations_struct_size;
+    
     return uc_idata_to_idata(uc_idata);
 
 fail_add_ops_repl:
@@ -842,6 +857,10 @@ static void uc_idata_destroy(
 
     instrumentor_remove_data_search(instrumentor, &uc_idata->ops_repl_elem);
     instrumentor_remove_data_search(instrumentor, &uc_idata->ops_orig_elem);
+    
+    instrumentor->memory.idata -= sizeof(*uc_idata);
+    instrumentor->memory.ops_copies -= instrumentor->operations_struct_size;
+    
     kfree(ops_repl);
     kfree(uc_idata);
 }
@@ -933,7 +952,8 @@ struct instrument_data* instrumentor_get_data(
     
     if(ops)
     {
-        if(instrumentor->replace_at_place(ops))
+        if(kedr_coi_mechanism_selector_call(instrumentor->replace_at_place,
+            ops))
             idata = ap_idata_create(instrumentor, ops);
         else
             idata = uc_idata_create(instrumentor, ops);
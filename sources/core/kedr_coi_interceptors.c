@@ -21,12 +21,28 @@
  ======================================================================== */
 
 #include <kedr-coi/operations_interception.h>
+#include <kedr-coi/call_records.h>
 
 #include "kedr_coi_instrumentor_internal.h"
 #include "payloads.h"
+#include "kedr_coi_debugfs.h"
+#include "kedr_coi_call_records.h"
+#include "kedr_coi_perf.h"
+#include "kedr_coi_callers.h"
+#include "kedr_coi_tasks.h"
+#include "kedr_coi_objects.h"
+#include "kedr_coi_call_stack.h"
+
+#define CREATE_TRACE_POINTS
+#include "kedr_coi_hooks_trace.h"
 
 #include <linux/slab.h>
-#include <linux/module.h> /* for __module_address() */
+#include <linux/bitops.h> /* bitmap of disabled operations */
+#include <linux/seq_file.h>
+#include <linux/uaccess.h> /* copy_from_user */
+#include <linux/rcupdate.h>
+#include <linux/sched.h> /* local_clock() */
+#include <linux/workqueue.h> /* garbage collection */
 
 // Return pointer to the operations struct in the object
 static const void* indirect_operations(const void* object,
@@ -101,8 +117,103 @@ struct kedr_coi_interceptor
     bool (*replace_at_place)(const void* ops);
     void (*trace_unforgotten_object)(const void* object);
     const char* name;    
+    /*
+     * Non-zero if interception is paused.
+     * 
+     * Read by every intermediate operation, so it is an atomic
+     * variable rather than protected by any lock.
+     */
+    atomic_t paused;
+    /*
+     * Non-zero if intercepted calls, watching and forgetting of the
+     * objects are stored into call records.
+     * 
+     * Atomic for the same reason as 'paused'.
+     */
+    atomic_t recording;
+    /*
+     * Bitmap of operations for which handlers are disabled.
+     * 
+     * Bit number is offset of the operation divided by pointer size.
+     * Accessed with atomic bit operations.
+     */
+    unsigned long* operations_disabled;
+    
+    // Directory in debugfs. NULL if not created.
+    struct dentry* debugfs_dir;
+    /*
+     * Identificator of the interceptor, unique while KEDR COI core
+     * is loaded. Used in call records.
+     */
+    u32 id;
+    /*
+     * Statistic about callers of the operations. NULL if not collected.
+     * 
+     * Accessed by intermediate operations under RCU. Changed with
+     * 'callers_mutex' locked.
+     */
+    struct kedr_coi_callers __rcu* callers;
+    /*
+     * Statistic about tasks and cgroups which call the operations.
+     * NULL if not collected.
+     * 
+     * Accessed similar to 'callers'.
+     */
+    struct kedr_coi_tasks __rcu* tasks;
+    /*
+     * Statistic about objects with the most number of calls.
+     * NULL if not collected.
+     * 
+     * Accessed similar to 'callers'.
+     */
+    struct kedr_coi_objects __rcu* objects;
+    /*
+     * Limit on memory used by the instrumentor, in bytes. 0 means
+     * no limit. If 'quota_evict' is true, watches not used recently
+     * are evicted when the limit is reached, otherwise new watches
+     * are refused.
+     * 
+     * Changed with 'memory_mutex' locked and applied to the
+     * instrumentor at start.
+     */
+    size_t quota;
+    bool quota_evict;
+    /*
+     * Garbage collection of the watches for dead objects.
+     * 
+     * 'gc_interval' is interval between passes over all watches, in
+     * milliseconds, 0 if collection is disabled. 'gc_object_is_alive'
+     * checks objects, collection cannot be enabled while it is NULL.
+     * 
+     * These fields and GC statistic are protected by 'memory_mutex'.
+     */
+    unsigned int gc_interval;
+    bool (*gc_object_is_alive)(const void* object);
+    struct delayed_work gc_work;
+    // Position of the current pass in the table of watches.
+    size_t gc_pos;
+    // Number of watches collected by the current pass.
+    size_t gc_pass_collected;
+    // Number of passes finished and watches collected by them.
+    unsigned long gc_passes;
+    unsigned long gc_collected;
+    // Number of watches collected by the last finished pass.
+    size_t gc_last_collected;
 };
 
+/* 
+ * Protect 'instrumentor' field of the interceptors from being changed
+ * while it is accessed from outside of the 'started' state: debugfs
+ * files, setting of the quota and garbage collection.
+ */
+static DEFINE_MUTEX(memory_mutex);
+
+/* Number of chains of the watches table checked by one run of GC. */
+#define GC_CHUNK_CHAINS 64
+
+/* Last identificator assigned to the interceptor. */
+static atomic_t interceptor_last_id = ATOMIC_INIT(0);
+
 //*************** Factory interceptor ********************************//
 
 struct kedr_coi_factory_interceptor
@@ -207,6 +318,58 @@ void factory_interceptor_stop(
 }
 
 //*********Interceptor API implementation*****************************//
+/* Number of bits required for describe every operation in the struct. */
+static inline size_t operation_bits_number(size_t operations_struct_size)
+{
+    return DIV_ROUND_UP(operations_struct_size, sizeof(void*));
+}
+
+/* Number of the bit which describes the operation. */
+static inline size_t operation_bit(size_t operation_offset)
+{
+    return operation_offset / sizeof(void*);
+}
+
+/* Whether pre- and post- handlers shouldn't be called for operation. */
+static inline bool interceptor_handlers_disabled(
+    struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset)
+{
+    return atomic_read(&interceptor->paused)
+        || test_bit(operation_bit(operation_offset),
+            interceptor->operations_disabled);
+}
+
+/*
+ * Return value for 'hooks' field of the intermediate info, in which
+ * handlers are already set.
+ * 
+ * Hooks are called when the call has handlers, so handlers may refer to
+ * the call via the stack of calls, or when someone listens the hooks:
+ * tracepoints are enabled, statistic is collected or calls are recorded.
+ * Hooks themselves check what is listened.
+ */
+static inline void* interceptor_hooks(struct kedr_coi_interceptor* interceptor,
+    const struct kedr_coi_intermediate_info* info)
+{
+    return (info->pre || info->post
+        || trace_kedr_coi_hook_pre_enabled()
+        || trace_kedr_coi_hook_post_enabled()
+        || atomic_read(&interceptor->recording)
+        || rcu_access_pointer(interceptor->callers)
+        || rcu_access_pointer(interceptor->tasks)
+        || rcu_access_pointer(interceptor->objects))
+        ? interceptor : NULL;
+}
+
+static void interceptor_debugfs_create(
+    struct kedr_coi_interceptor* interceptor);
+static void interceptor_perf_create(
+    struct kedr_coi_interceptor* interceptor);
+static void interceptor_debugfs_destroy(
+    struct kedr_coi_interceptor* interceptor);
+static void interceptor_gc_work(struct work_struct* work);
+
 /* 'replace_at_place' callback used for direct interceptor. */
 static bool replace_at_place_always(const void* ops)
 {
@@ -243,12 +406,35 @@ kedr_coi_interceptor_create_common(const char* name,
     
     interceptor->trace_unforgotten_object = NULL;
     
+    atomic_set(&interceptor->paused, 0);
+    atomic_set(&interceptor->recording, 0);
+    
+    interceptor->id = atomic_inc_return(&interceptor_last_id);
+    
+    interceptor->operations_disabled = kzalloc(
+        BITS_TO_LONGS(operation_bits_number(operations_struct_size))
+            * sizeof(unsigned long),
+        GFP_KERNEL);
+    if(interceptor->operations_disabled == NULL)
+    {
+        pr_err("Cannot allocate bitmap of disabled operations.");
+        goto fail_operations_disabled;
+    }
+    
     mutex_init(&interceptor->m);
 
     INIT_LIST_HEAD(&interceptor->factory_interceptors);
     
+    INIT_DELAYED_WORK(&interceptor->gc_work, interceptor_gc_work);
+    
+    interceptor_debugfs_create(interceptor);
+    
+    interceptor_perf_create(interceptor);
+    
     return interceptor;
 
+fail_operations_disabled:
+    operation_payloads_destroy(&interceptor->payloads);
 fail_payloads:
     kfree(interceptor);
     return NULL;
@@ -296,11 +482,86 @@ struct kedr_coi_interceptor* kedr_coi_interceptor_create_direct(
 }
 
 
+/*
+ * Schedule next pass of garbage collection, if it is enabled and
+ * interceptor is started. Called with 'memory_mutex' locked.
+ */
+static void interceptor_gc_schedule(struct kedr_coi_interceptor* interceptor)
+{
+    if(interceptor->instrumentor && interceptor->gc_interval)
+        mod_delayed_work(system_unbound_wq, &interceptor->gc_work,
+            msecs_to_jiffies(interceptor->gc_interval));
+}
+
+/*
+ * Every run of the work checks a chunk of the watches, so the lock of
+ * the instrumentor is not held for long. Chunks of the same pass are
+ * separated with minimal delay, so other work is not delayed.
+ */
+static void interceptor_gc_work(struct work_struct* work)
+{
+    struct kedr_coi_interceptor* interceptor = container_of(
+        to_delayed_work(work), struct kedr_coi_interceptor, gc_work);
+    bool done;
+    
+    mutex_lock(&memory_mutex);
+    
+    // Interceptor is stopped or collection is disabled.
+    if((interceptor->instrumentor == NULL) || !interceptor->gc_interval)
+        goto out;
+    
+    done = kedr_coi_instrumentor_collect(interceptor->instrumentor,
+        &interceptor->gc_pos, GC_CHUNK_CHAINS,
+        interceptor->gc_object_is_alive, &interceptor->gc_pass_collected);
+    if(!done)
+    {
+        queue_delayed_work(system_unbound_wq, &interceptor->gc_work, 1);
+        goto out;
+    }
+    
+    if(interceptor->gc_pass_collected)
+        pr_info("Interceptor '%s': %zu watches of dead objects are collected.",
+            interceptor->name, interceptor->gc_pass_collected);
+    
+    interceptor->gc_passes++;
+    interceptor->gc_collected += interceptor->gc_pass_collected;
+    interceptor->gc_last_collected = interceptor->gc_pass_collected;
+    interceptor->gc_pass_collected = 0;
+    
+    interceptor_gc_schedule(interceptor);
+out:
+    mutex_unlock(&memory_mutex);
+}
+
+int kedr_coi_interceptor_set_gc(
+    struct kedr_coi_interceptor* interceptor,
+    unsigned int interval,
+    bool (*object_is_alive)(const void* object))
+{
+    if(interval && (object_is_alive == NULL))
+    {
+        pr_err("Cannot enable garbage collection for interceptor '%s' "
+            "without liveness check.", interceptor->name);
+        return -EINVAL;
+    }
+    
+    mutex_lock(&memory_mutex);
+    
+    interceptor->gc_interval = interval;
+    interceptor->gc_object_is_alive = object_is_alive;
+    interceptor_gc_schedule(interceptor);
+    
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
 int kedr_coi_interceptor_start(struct kedr_coi_interceptor* interceptor)
 {
 	int result;
     struct kedr_coi_factory_interceptor* factory_interceptor;
     const struct kedr_coi_replacement* replacements;
+    struct kedr_coi_instrumentor* instrumentor;
     
 	BUG_ON(interceptor->state != interceptor_state_initialized);
 
@@ -310,16 +571,34 @@ int kedr_coi_interceptor_start(struct kedr_coi_interceptor* interceptor)
     replacements = operation_payloads_get_replacements(
         &interceptor->payloads);
 
-    interceptor->instrumentor = kedr_coi_instrumentor_create(
-        interceptor->operations_struct_size,
-        replacements,
-        interceptor->replace_at_place);
-    if(interceptor->instrumentor == NULL)
+    if(interceptor->operations_field_offset != -1)
+    {
+        instrumentor = kedr_coi_instrumentor_create(
+            interceptor->operations_struct_size,
+            replacements,
+            interceptor->replace_at_place);
+    }
+    else
+    {
+        instrumentor = kedr_coi_instrumentor_create_direct(
+            interceptor->operations_struct_size,
+            replacements);
+    }
+    if(instrumentor == NULL)
     {
         result = -ENOMEM;
         goto err_create_instrumentor;
     }
     
+    mutex_lock(&memory_mutex);
+    kedr_coi_instrumentor_set_quota(instrumentor, interceptor->quota,
+        interceptor->quota_evict);
+    interceptor->instrumentor = instrumentor;
+    interceptor->gc_pos = 0;
+    interceptor->gc_pass_collected = 0;
+    interceptor_gc_schedule(interceptor);
+    mutex_unlock(&memory_mutex);
+    
     interceptor->state = interceptor_state_started;
     // Also start all foreign interceptors created for this one.
     list_for_each_entry(factory_interceptor, &interceptor->factory_interceptors, list)
@@ -342,10 +621,13 @@ err_foreign_start:
     
     interceptor->state = interceptor_state_initialized;
 
-    kedr_coi_instrumentor_destroy(interceptor->instrumentor,
-        NULL, NULL);
-
+    mutex_lock(&memory_mutex);
     interceptor->instrumentor = NULL;
+    mutex_unlock(&memory_mutex);
+    // GC work doesn't requeue itself without instrumentor.
+    cancel_delayed_work_sync(&interceptor->gc_work);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
 
 err_create_instrumentor:
     
@@ -370,6 +652,7 @@ static void interceptor_trace_unforgotten_watch(const void* object,
 void kedr_coi_interceptor_stop(struct kedr_coi_interceptor* interceptor)
 {
     struct kedr_coi_factory_interceptor* factory_interceptor;
+    struct kedr_coi_instrumentor* instrumentor;
 
 	BUG_ON(interceptor->state == interceptor_state_uninitialized);
 	
@@ -384,19 +667,41 @@ void kedr_coi_interceptor_stop(struct kedr_coi_interceptor* interceptor)
 
     interceptor->state = interceptor_state_initialized;
 
-    kedr_coi_instrumentor_destroy(interceptor->instrumentor,
+    mutex_lock(&memory_mutex);
+    instrumentor = interceptor->instrumentor;
+    interceptor->instrumentor = NULL;
+    mutex_unlock(&memory_mutex);
+    // GC work doesn't requeue itself without instrumentor.
+    cancel_delayed_work_sync(&interceptor->gc_work);
+
+    kedr_coi_instrumentor_destroy(instrumentor,
         interceptor_trace_unforgotten_watch,
         interceptor);
-
-    interceptor->instrumentor = NULL;
     
     operation_payloads_unuse(&interceptor->payloads);
 }
 
+/* 
+ * Store record about watching or forgetting of the object, if calls
+ * are recorded.
+ */
+static inline void interceptor_record_object(
+    struct kedr_coi_interceptor* interceptor,
+    u16 type,
+    const void* object,
+    const void* return_address)
+{
+    if(atomic_read(&interceptor->recording))
+        kedr_coi_call_records_write(type, interceptor->id, 0, object,
+            NULL, return_address, 0, 0);
+}
+
 int kedr_coi_interceptor_watch(
     struct kedr_coi_interceptor* interceptor,
     void* object)
 {
+    int result;
+    
     if(interceptor->state == interceptor_state_initialized)
 		return -EPERM;
 
@@ -405,23 +710,32 @@ int kedr_coi_interceptor_watch(
     if(interceptor->operations_field_offset != -1)
     {
         const void** ops_p = indirect_operations_p(object, interceptor->operations_field_offset);
-        return kedr_coi_instrumentor_watch(
+        result = kedr_coi_instrumentor_watch(
             interceptor->instrumentor,
             object,
             ops_p);
     }
     else
     {
-        return kedr_coi_instrumentor_watch_direct(
+        result = kedr_coi_instrumentor_watch_direct(
             interceptor->instrumentor,
             object);
     }
+    
+    if(result == 0)
+        interceptor_record_object(interceptor,
+            kedr_coi_call_record_type_watch, object,
+            __builtin_return_address(0));
+    
+    return result;
 }
 
 int kedr_coi_interceptor_forget(
     struct kedr_coi_interceptor* interceptor,
     void* object)
 {
+    int result;
+    
 	if(interceptor->state == interceptor_state_initialized)
 		return -EPERM;
 
@@ -429,24 +743,33 @@ int kedr_coi_interceptor_forget(
 
     if(interceptor->operations_field_offset != -1)
     {
-        return kedr_coi_instrumentor_forget(
+        result = kedr_coi_instrumentor_forget(
             interceptor->instrumentor,
             object,
             indirect_operations_p(object, interceptor->operations_field_offset));
     }
     else
     {
-        return kedr_coi_instrumentor_forget_direct(
+        result = kedr_coi_instrumentor_forget_direct(
             interceptor->instrumentor,
             object,
             0);
     }
+    
+    if(result == 0)
+        interceptor_record_object(interceptor,
+            kedr_coi_call_record_type_forget, object,
+            __builtin_return_address(0));
+    
+    return result;
 }
 
 int kedr_coi_interceptor_forget_norestore(
     struct kedr_coi_interceptor* interceptor,
     void* object)
 {
+    int result;
+    
 	if(interceptor->state == interceptor_state_initialized)
 		return -EPERM;
 
@@ -454,18 +777,153 @@ int kedr_coi_interceptor_forget_norestore(
 
     if(interceptor->operations_field_offset != -1)
     {
-        return kedr_coi_instrumentor_forget(
+        result = kedr_coi_instrumentor_forget(
             interceptor->instrumentor,
             object,
             NULL);
     }
     else
     {
-        return kedr_coi_instrumentor_forget_direct(
+        result = kedr_coi_instrumentor_forget_direct(
             interceptor->instrumentor,
             object,
             1);
     }
+    
+    if(result == 0)
+        interceptor_record_object(interceptor,
+            kedr_coi_call_record_type_forget, object,
+            __builtin_return_address(0));
+    
+    return result;
+}
+
+int kedr_coi_interceptor_watch_child(
+    struct kedr_coi_interceptor* interceptor,
+    void* object,
+    struct kedr_coi_interceptor* parent_interceptor,
+    const void* parent)
+{
+    const void** ops_p;
+    int result;
+    
+    if((interceptor->state == interceptor_state_initialized)
+        || (parent_interceptor->state == interceptor_state_initialized))
+		return -EPERM;
+
+	BUG_ON(interceptor->state != interceptor_state_started);
+	BUG_ON(parent_interceptor->state != interceptor_state_started);
+    
+    if(interceptor->operations_field_offset != -1)
+        ops_p = indirect_operations_p(object, interceptor->operations_field_offset);
+    else
+        ops_p = (const void**)&object;
+    
+    result = kedr_coi_instrumentor_watch_child(
+        interceptor->instrumentor,
+        object,
+        ops_p,
+        parent_interceptor->instrumentor,
+        parent);
+    
+    if(result == 0)
+        interceptor_record_object(interceptor,
+            kedr_coi_call_record_type_watch, object,
+            __builtin_return_address(0));
+    
+    return result;
+}
+
+int kedr_coi_interceptor_forget_children(
+    struct kedr_coi_interceptor* interceptor,
+    const void* object)
+{
+	if(interceptor->state == interceptor_state_initialized)
+		return -EPERM;
+
+	BUG_ON(interceptor->state != interceptor_state_started);
+
+    return kedr_coi_instrumentor_forget_children(
+        interceptor->instrumentor,
+        object);
+}
+
+int kedr_coi_interceptor_get_stat(
+    struct kedr_coi_interceptor* interceptor,
+    struct kedr_coi_interceptor_stat* stat)
+{
+    struct kedr_coi_hash_table_stat objects_stat;
+    size_t n_idata;
+    struct kedr_coi_instrumentor_memory memory;
+    unsigned long n_refused, n_evicted;
+    
+	if(interceptor->state == interceptor_state_initialized)
+		return -EPERM;
+
+	BUG_ON(interceptor->state != interceptor_state_started);
+    
+    kedr_coi_instrumentor_get_stat(interceptor->instrumentor,
+        &objects_stat, &n_idata);
+    kedr_coi_instrumentor_get_memory(interceptor->instrumentor,
+        &memory, &n_refused, &n_evicted);
+    
+    stat->n_watches = objects_stat.n_elems;
+    stat->n_operations = n_idata;
+    stat->n_buckets = objects_stat.n_buckets;
+    stat->n_buckets_used = objects_stat.n_buckets_used;
+    stat->max_chain = objects_stat.max_chain;
+    
+    stat->memory = memory.watch_data + memory.idata + memory.ops_copies
+        + memory.hash_heads + memory.foreign;
+    
+    return 0;
+}
+
+int kedr_coi_interceptor_get_memory(
+    struct kedr_coi_interceptor* interceptor,
+    struct kedr_coi_interceptor_memory* memory)
+{
+    struct kedr_coi_instrumentor_memory instrumentor_memory;
+    
+	if(interceptor->state == interceptor_state_initialized)
+		return -EPERM;
+
+	BUG_ON(interceptor->state != interceptor_state_started);
+    
+    kedr_coi_instrumentor_get_memory(interceptor->instrumentor,
+        &instrumentor_memory, &memory->n_refused, &memory->n_evicted);
+    
+    memory->watch_data = instrumentor_memory.watch_data;
+    memory->idata = instrumentor_memory.idata;
+    memory->ops_copies = instrumentor_memory.ops_copies;
+    memory->hash_heads = instrumentor_memory.hash_heads;
+    memory->foreign = instrumentor_memory.foreign;
+    memory->total = memory->watch_data + memory->idata
+        + memory->ops_copies + memory->hash_heads + memory->foreign;
+    
+    return 0;
+}
+
+/* Pass quota to the instrumentor, if any. Called with 'memory_mutex' locked. */
+static void interceptor_apply_quota(struct kedr_coi_interceptor* interceptor)
+{
+    if(interceptor->instrumentor)
+        kedr_coi_instrumentor_set_quota(interceptor->instrumentor,
+            interceptor->quota, interceptor->quota_evict);
+}
+
+void kedr_coi_interceptor_set_quota(
+    struct kedr_coi_interceptor* interceptor,
+    size_t quota,
+    enum kedr_coi_quota_policy policy)
+{
+    mutex_lock(&memory_mutex);
+    
+    interceptor->quota = quota;
+    interceptor->quota_evict = (policy == kedr_coi_quota_evict);
+    interceptor_apply_quota(interceptor);
+    
+    mutex_unlock(&memory_mutex);
 }
 
 int kedr_coi_payload_register(
@@ -530,11 +988,27 @@ int kedr_coi_interceptor_get_intermediate_info(
         &info->op_orig);
 
     
+    info->hooks = NULL;
+    info->measure = NULL;
+    
     if(result == 0)
+        kedr_coi_perf_count(interceptor->id, operation_offset);
+    
+    if((result == 0)
+        && interceptor_handlers_disabled(interceptor, operation_offset))
+    {
+        // Call original operation directly, as if no interception at all.
+        info->pre = NULL;
+        info->post = NULL;
+
+        return 0;
+    }
+    else if(result == 0)
     {
         operation_payloads_get_interception_info(&interceptor->payloads,
             operation_offset, info->op_orig? 0 : 1,
-            &info->pre, &info->post);
+            &info->pre, &info->post, &info->measure);
+        info->hooks = interceptor_hooks(interceptor, info);
 
         return 0;
     }
@@ -552,6 +1026,61 @@ int kedr_coi_interceptor_get_intermediate_info(
 }
 
 
+void kedr_coi_interceptor_pause(struct kedr_coi_interceptor* interceptor)
+{
+    atomic_set(&interceptor->paused, 1);
+}
+
+void kedr_coi_interceptor_resume(struct kedr_coi_interceptor* interceptor)
+{
+    atomic_set(&interceptor->paused, 0);
+}
+
+bool kedr_coi_interceptor_is_paused(struct kedr_coi_interceptor* interceptor)
+{
+    return atomic_read(&interceptor->paused) != 0;
+}
+
+int kedr_coi_interceptor_operation_disable(
+    struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset)
+{
+    if(!operation_payloads_has_operation(&interceptor->payloads,
+        operation_offset))
+        return -EINVAL;
+    
+    set_bit(operation_bit(operation_offset),
+        interceptor->operations_disabled);
+    
+    return 0;
+}
+
+int kedr_coi_interceptor_operation_enable(
+    struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset)
+{
+    if(!operation_payloads_has_operation(&interceptor->payloads,
+        operation_offset))
+        return -EINVAL;
+    
+    clear_bit(operation_bit(operation_offset),
+        interceptor->operations_disabled);
+    
+    return 0;
+}
+
+int kedr_coi_interceptor_operation_is_enabled(
+    struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset)
+{
+    if(!operation_payloads_has_operation(&interceptor->payloads,
+        operation_offset))
+        return -EINVAL;
+    
+    return !test_bit(operation_bit(operation_offset),
+        interceptor->operations_disabled);
+}
+
 void kedr_coi_interceptor_destroy(
 	struct kedr_coi_interceptor* interceptor)
 {
@@ -569,7 +1098,24 @@ void kedr_coi_interceptor_destroy(
         list_del_init(&factory_interceptor->list);
     }
 
+    kedr_coi_perf_remove_events(interceptor->id);
+    
+    interceptor_debugfs_destroy(interceptor);
+
+    // Intermediates cannot be called now, so no need to wait for them.
+    if(rcu_access_pointer(interceptor->callers))
+        kedr_coi_callers_destroy(rcu_dereference_protected(
+            interceptor->callers, 1));
+    if(rcu_access_pointer(interceptor->tasks))
+        kedr_coi_tasks_destroy(rcu_dereference_protected(
+            interceptor->tasks, 1));
+    if(rcu_access_pointer(interceptor->objects))
+        kedr_coi_objects_destroy(rcu_dereference_protected(
+            interceptor->objects, 1));
+
     operation_payloads_destroy(&interceptor->payloads);
+    
+    kfree(interceptor->operations_disabled);
 
     /*
      *  For control that nobody will access interceptor
@@ -580,26 +1126,979 @@ void kedr_coi_interceptor_destroy(
     kfree(interceptor);
 }
 
-//*********Factory interceptor API implementation*********************//
-static struct kedr_coi_factory_interceptor*
-kedr_coi_factory_interceptor_create_common(
-    struct kedr_coi_interceptor* interceptor,
-    const char* name,
-    const struct kedr_coi_intermediate* intermediate_operations)
+//*************************** Perf events ****************************//
+static void interceptor_perf_add_event(size_t operation_offset,
+    const char* name, void* data)
 {
-    struct kedr_coi_factory_interceptor* factory_interceptor;
-    int err;
+    struct kedr_coi_interceptor* interceptor = data;
     
-    if(interceptor->operations_field_offset == -1)
-    {
-        pr_err("Cannot create factory interceptor for direct normal one.");
-        return NULL;
-    }
+    // Unnamed operations may be counted only via raw config.
+    if(name)
+        kedr_coi_perf_add_event(interceptor->id, interceptor->name,
+            operation_offset, name);
+}
 
-    BUG_ON(interceptor->state != interceptor_state_initialized);
-    
-    if((intermediate_operations == NULL) ||
-        (intermediate_operations[0].operation_offset == -1))
+/* Create named perf event for every operation of the interceptor. */
+static void interceptor_perf_create(struct kedr_coi_interceptor* interceptor)
+{
+    operation_payloads_for_each_operation(&interceptor->payloads,
+        interceptor_perf_add_event, interceptor);
+}
+
+//***************************** Hooks ********************************//
+void kedr_coi_hook_pre(void* hooks, struct kedr_coi_hook_context* ctx)
+{
+    struct kedr_coi_interceptor* interceptor = hooks;
+    
+    ctx->interceptor_id = interceptor->id;
+    ctx->children_time = 0;
+    
+    kedr_coi_call_stack_push(ctx);
+    
+    ctx->start_time = local_clock();
+    
+    trace_kedr_coi_hook_pre(ctx);
+}
+
+void kedr_coi_hook_post(void* hooks, struct kedr_coi_hook_context* ctx)
+{
+    struct kedr_coi_interceptor* interceptor = hooks;
+    struct kedr_coi_callers* callers;
+    struct kedr_coi_tasks* tasks;
+    struct kedr_coi_objects* objects;
+    // Inclusive and exclusive time of the call.
+    u64 time = local_clock() - ctx->start_time;
+    u64 self_time = time > ctx->children_time ? time - ctx->children_time : 0;
+    
+    ctx->interceptor_id = interceptor->id;
+    
+    rcu_read_lock();
+    callers = rcu_dereference(interceptor->callers);
+    if(callers)
+        kedr_coi_callers_account(callers, ctx, time, self_time);
+    tasks = rcu_dereference(interceptor->tasks);
+    if(tasks)
+        kedr_coi_tasks_account(tasks, ctx->operation_offset,
+            time, self_time);
+    objects = rcu_dereference(interceptor->objects);
+    if(objects)
+        kedr_coi_objects_account(objects, ctx->operation_offset,
+            ctx->object);
+    rcu_read_unlock();
+    
+    if(atomic_read(&interceptor->recording))
+        kedr_coi_call_records_write(kedr_coi_call_record_type_call,
+            interceptor->id, ctx->operation_offset, ctx->object, NULL,
+            ctx->return_address, ctx->return_value, time);
+    
+    trace_kedr_coi_hook_post(ctx);
+    
+    // Parent is accessed only if the stack of calls is consistent.
+    if(kedr_coi_call_stack_pop(ctx) && ctx->parent)
+        ctx->parent->children_time += time;
+}
+
+const struct kedr_coi_hook_context* kedr_coi_current_call(void)
+{
+    return kedr_coi_call_stack_top();
+}
+
+//************************* Call records *****************************//
+void kedr_coi_call_record(struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset,
+    const void* object,
+    const struct kedr_coi_operation_call_info* call_info,
+    long return_value)
+{
+    kedr_coi_call_records_write(kedr_coi_call_record_type_call,
+        interceptor->id,
+        operation_offset,
+        object,
+        call_info->op_orig,
+        call_info->return_address,
+        return_value,
+        0);
+}
+
+//************* Interceptor's files in debugfs ************************//
+/*
+ * 'paused' file: 1 if interceptor is paused, 0 otherwise.
+ * Writing to the file pauses or resumes interceptor.
+ */
+static int paused_file_get(void* data, u64* val)
+{
+    *val = kedr_coi_interceptor_is_paused(data) ? 1 : 0;
+    return 0;
+}
+
+static int paused_file_set(void* data, u64 val)
+{
+    if(val)
+        kedr_coi_interceptor_pause(data);
+    else
+        kedr_coi_interceptor_resume(data);
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(paused_file_operations,
+    paused_file_get, paused_file_set, "%llu\n");
+
+/*
+ * 'operations' file: list of operations with their state. For named
+ * operations offset is shown in the third column.
+ * 
+ * Writing "disable <operation>" or "enable <operation>" changes state
+ * of the operation. Operation is referred by name or by offset.
+ */
+struct operations_file_show_data
+{
+    struct kedr_coi_interceptor* interceptor;
+    struct seq_file* m;
+};
+
+static void operations_file_show_operation(size_t operation_offset,
+    const char* name, void* data)
+{
+    struct operations_file_show_data* show_data = data;
+    const char* state = (kedr_coi_interceptor_operation_is_enabled(
+        show_data->interceptor, operation_offset) == 1)
+        ? "enabled" : "disabled";
+    
+    if(name)
+        seq_printf(show_data->m, "%s\t%s\t%zu\n", name, state,
+            operation_offset);
+    else
+        seq_printf(show_data->m, "%zu\t%s\n", operation_offset, state);
+}
+
+static int operations_file_show(struct seq_file* m, void* v)
+{
+    struct operations_file_show_data show_data =
+    {
+        .interceptor = m->private,
+        .m = m
+    };
+    
+    operation_payloads_for_each_operation(&show_data.interceptor->payloads,
+        operations_file_show_operation, &show_data);
+    
+    return 0;
+}
+
+static int operations_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, operations_file_show, inode->i_private);
+}
+
+static ssize_t operations_file_write(struct file* filp,
+    const char __user* buf, size_t count, loff_t* f_pos)
+{
+    struct seq_file* m = filp->private_data;
+    struct kedr_coi_interceptor* interceptor = m->private;
+    char cmd[64];
+    char* operation_name;
+    size_t operation_offset;
+    bool enable;
+    int result;
+    
+    if(count >= sizeof(cmd)) return -EINVAL;
+    if(copy_from_user(cmd, buf, count)) return -EFAULT;
+    cmd[count] = '\0';
+    
+    operation_name = strim(cmd);
+    if(!strncmp(operation_name, "enable ", 7))
+    {
+        enable = true;
+        operation_name += 7;
+    }
+    else if(!strncmp(operation_name, "disable ", 8))
+    {
+        enable = false;
+        operation_name += 8;
+    }
+    else
+    {
+        return -EINVAL;
+    }
+    operation_name = strim(operation_name);
+    
+    operation_offset = operation_payloads_find_operation_by_name(
+        &interceptor->payloads, operation_name);
+    if(operation_offset == -1)
+    {
+        unsigned long offset;
+        if(kstrtoul(operation_name, 10, &offset)) return -EINVAL;
+        operation_offset = offset;
+    }
+    
+    result = enable
+        ? kedr_coi_interceptor_operation_enable(interceptor, operation_offset)
+        : kedr_coi_interceptor_operation_disable(interceptor, operation_offset);
+    
+    return result ? result : count;
+}
+
+static const struct file_operations operations_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = operations_file_open,
+    .read = seq_read,
+    .write = operations_file_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/*
+ * 'callers_mode' file: whether statistic about callers is collected.
+ * 
+ * 0 - not collected, 1 - count calls, 2 - count calls and their time.
+ * Every write resets the statistic.
+ */
+static DEFINE_MUTEX(callers_mutex);
+
+enum callers_mode
+{
+    callers_mode_off = 0,
+    callers_mode_count,
+    callers_mode_latency,
+};
+
+static int callers_mode_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    struct kedr_coi_callers* callers;
+    
+    mutex_lock(&callers_mutex);
+    callers = rcu_dereference_protected(interceptor->callers,
+        lockdep_is_held(&callers_mutex));
+    if(callers == NULL)
+        *val = callers_mode_off;
+    else if(kedr_coi_callers_latency(callers))
+        *val = callers_mode_latency;
+    else
+        *val = callers_mode_count;
+    mutex_unlock(&callers_mutex);
+    
+    return 0;
+}
+
+static int callers_mode_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    struct kedr_coi_callers* callers_old;
+    struct kedr_coi_callers* callers_new = NULL;
+    
+    if(val > callers_mode_latency) return -EINVAL;
+    
+    if(val != callers_mode_off)
+    {
+        callers_new = kedr_coi_callers_create(val == callers_mode_latency);
+        if(callers_new == NULL) return -ENOMEM;
+    }
+    
+    mutex_lock(&callers_mutex);
+    callers_old = rcu_dereference_protected(interceptor->callers,
+        lockdep_is_held(&callers_mutex));
+    rcu_assign_pointer(interceptor->callers, callers_new);
+    mutex_unlock(&callers_mutex);
+    
+    if(callers_old)
+    {
+        // Wait until intermediates stop to use old statistic.
+        synchronize_rcu();
+        kedr_coi_callers_destroy(callers_old);
+    }
+    
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(callers_mode_file_operations,
+    callers_mode_file_get, callers_mode_file_set, "%llu\n");
+
+/*
+ * 'callers' file: callers with the most number of calls.
+ */
+static const char* interceptor_operation_name(size_t operation_offset,
+    void* data)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    
+    return operation_payloads_get_operation_name(&interceptor->payloads,
+        operation_offset);
+}
+
+static int callers_file_show(struct seq_file* m, void* v)
+{
+    struct kedr_coi_interceptor* interceptor = m->private;
+    struct kedr_coi_callers* callers;
+    int result = 0;
+    
+    // Mutex prevents statistic from being freed.
+    mutex_lock(&callers_mutex);
+    callers = rcu_dereference_protected(interceptor->callers,
+        lockdep_is_held(&callers_mutex));
+    if(callers)
+        result = kedr_coi_callers_report(callers, m, interceptor->id,
+            interceptor_operation_name, interceptor);
+    else
+        seq_puts(m, "# Statistic is not collected, see 'callers_mode'.\n");
+    mutex_unlock(&callers_mutex);
+    
+    return result;
+}
+
+static int callers_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, callers_file_show, inode->i_private);
+}
+
+static const struct file_operations callers_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = callers_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/*
+ * 'tasks_mode' file: whether statistic about tasks and cgroups is
+ * collected.
+ * 
+ * Values are the same as for 'callers_mode'. Every write resets the
+ * statistic.
+ */
+static DEFINE_MUTEX(tasks_mutex);
+
+static int tasks_mode_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    struct kedr_coi_tasks* tasks;
+    
+    mutex_lock(&tasks_mutex);
+    tasks = rcu_dereference_protected(interceptor->tasks,
+        lockdep_is_held(&tasks_mutex));
+    if(tasks == NULL)
+        *val = callers_mode_off;
+    else if(kedr_coi_tasks_latency(tasks))
+        *val = callers_mode_latency;
+    else
+        *val = callers_mode_count;
+    mutex_unlock(&tasks_mutex);
+    
+    return 0;
+}
+
+static int tasks_mode_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    struct kedr_coi_tasks* tasks_old;
+    struct kedr_coi_tasks* tasks_new = NULL;
+    
+    if(val > callers_mode_latency) return -EINVAL;
+    
+    if(val != callers_mode_off)
+    {
+        tasks_new = kedr_coi_tasks_create(val == callers_mode_latency);
+        if(tasks_new == NULL) return -ENOMEM;
+    }
+    
+    mutex_lock(&tasks_mutex);
+    tasks_old = rcu_dereference_protected(interceptor->tasks,
+        lockdep_is_held(&tasks_mutex));
+    rcu_assign_pointer(interceptor->tasks, tasks_new);
+    mutex_unlock(&tasks_mutex);
+    
+    if(tasks_old)
+    {
+        // Wait until intermediates stop to use old statistic.
+        synchronize_rcu();
+        kedr_coi_tasks_destroy(tasks_old);
+    }
+    
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(tasks_mode_file_operations,
+    tasks_mode_file_get, tasks_mode_file_set, "%llu\n");
+
+/*
+ * 'tasks' and 'cgroups' files: tasks and cgroups with the most number
+ * of calls.
+ */
+static int tasks_file_show_common(struct seq_file* m,
+    int (*report)(struct kedr_coi_tasks* tasks,
+        struct seq_file* m,
+        const char* (*operation_name)(size_t operation_offset, void* data),
+        void* data))
+{
+    struct kedr_coi_interceptor* interceptor = m->private;
+    struct kedr_coi_tasks* tasks;
+    int result = 0;
+    
+    // Mutex prevents statistic from being freed.
+    mutex_lock(&tasks_mutex);
+    tasks = rcu_dereference_protected(interceptor->tasks,
+        lockdep_is_held(&tasks_mutex));
+    if(tasks)
+        result = report(tasks, m, interceptor_operation_name, interceptor);
+    else
+        seq_puts(m, "# Statistic is not collected, see 'tasks_mode'.\n");
+    mutex_unlock(&tasks_mutex);
+    
+    return result;
+}
+
+static int tasks_file_show(struct seq_file* m, void* v)
+{
+    return tasks_file_show_common(m, kedr_coi_tasks_report_pids);
+}
+
+static int cgroups_file_show(struct seq_file* m, void* v)
+{
+    return tasks_file_show_common(m, kedr_coi_tasks_report_cgroups);
+}
+
+static int tasks_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, tasks_file_show, inode->i_private);
+}
+
+static int cgroups_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, cgroups_file_show, inode->i_private);
+}
+
+static const struct file_operations tasks_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = tasks_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static const struct file_operations cgroups_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = cgroups_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/*
+ * 'objects_mode' file: whether objects with the most number of calls
+ * are tracked.
+ * 
+ * 0 - not tracked, 1 - tracked. Every write resets the statistic.
+ */
+static DEFINE_MUTEX(objects_mutex);
+
+static int objects_mode_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    
+    mutex_lock(&objects_mutex);
+    *val = rcu_dereference_protected(interceptor->objects,
+        lockdep_is_held(&objects_mutex)) ? 1 : 0;
+    mutex_unlock(&objects_mutex);
+    
+    return 0;
+}
+
+static int objects_mode_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    struct kedr_coi_objects* objects_old;
+    struct kedr_coi_objects* objects_new = NULL;
+    
+    if(val > 1) return -EINVAL;
+    
+    if(val)
+    {
+        objects_new = kedr_coi_objects_create();
+        if(objects_new == NULL) return -ENOMEM;
+    }
+    
+    mutex_lock(&objects_mutex);
+    objects_old = rcu_dereference_protected(interceptor->objects,
+        lockdep_is_held(&objects_mutex));
+    rcu_assign_pointer(interceptor->objects, objects_new);
+    mutex_unlock(&objects_mutex);
+    
+    if(objects_old)
+    {
+        // Wait until intermediates stop to use old statistic.
+        synchronize_rcu();
+        kedr_coi_objects_destroy(objects_old);
+    }
+    
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(objects_mode_file_operations,
+    objects_mode_file_get, objects_mode_file_set, "%llu\n");
+
+/*
+ * 'objects' file: objects with the most number of calls.
+ */
+static int objects_file_show(struct seq_file* m, void* v)
+{
+    struct kedr_coi_interceptor* interceptor = m->private;
+    struct kedr_coi_objects* objects;
+    int result = 0;
+    
+    // Mutex prevents statistic from being freed.
+    mutex_lock(&objects_mutex);
+    objects = rcu_dereference_protected(interceptor->objects,
+        lockdep_is_held(&objects_mutex));
+    if(objects)
+        result = kedr_coi_objects_report(objects, m,
+            interceptor_operation_name, interceptor);
+    else
+        seq_puts(m, "# Objects are not tracked, see 'objects_mode'.\n");
+    mutex_unlock(&objects_mutex);
+    
+    return result;
+}
+
+static int objects_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, objects_file_show, inode->i_private);
+}
+
+static const struct file_operations objects_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = objects_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/*
+ * 'payloads' file: state of the payloads and time of their handlers.
+ *
+ * Writing "<payload> normal", "<payload> throttled" or
+ * "<payload> disabled" changes state of the payload. Payload is referred
+ * by name of its module.
+ */
+static int payloads_file_show(struct seq_file* m, void* v)
+{
+    struct kedr_coi_interceptor* interceptor = m->private;
+
+    operation_payloads_report(&interceptor->payloads, m);
+
+    return 0;
+}
+
+static int payloads_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, payloads_file_show, inode->i_private);
+}
+
+static ssize_t payloads_file_write(struct file* filp,
+    const char __user* buf, size_t count, loff_t* f_pos)
+{
+    struct seq_file* m = filp->private_data;
+    struct kedr_coi_interceptor* interceptor = m->private;
+    char cmd[MODULE_NAME_LEN + 16];
+    char* name;
+    char* state_name;
+    enum payload_state state;
+    int result;
+
+    if(count >= sizeof(cmd)) return -EINVAL;
+    if(copy_from_user(cmd, buf, count)) return -EFAULT;
+    cmd[count] = '\0';
+
+    state_name = strim(cmd);
+    name = strsep(&state_name, " ");
+    if(state_name == NULL) return -EINVAL;
+    state_name = strim(state_name);
+
+    if(!strcmp(state_name, "normal"))
+        state = payload_state_normal;
+    else if(!strcmp(state_name, "throttled"))
+        state = payload_state_throttled;
+    else if(!strcmp(state_name, "disabled"))
+        state = payload_state_disabled;
+    else
+        return -EINVAL;
+
+    result = operation_payloads_set_state(&interceptor->payloads,
+        name, state);
+
+    return result ? result : count;
+}
+
+static const struct file_operations payloads_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = payloads_file_open,
+    .read = seq_read,
+    .write = payloads_file_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/*
+ * 'payloads_cost_mode' file: whether cost of the payloads' handlers is
+ * accounted. Every write resets the statistic.
+ *
+ * 'payloads_cost' file: calls and cycles of the handlers per payload.
+ */
+static int payloads_cost_mode_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+
+    *val = operation_payloads_get_cost_accounting(&interceptor->payloads)
+        ? 1 : 0;
+    return 0;
+}
+
+static int payloads_cost_mode_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+
+    if(val > 1) return -EINVAL;
+
+    operation_payloads_set_cost_accounting(&interceptor->payloads, val);
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(payloads_cost_mode_file_operations,
+    payloads_cost_mode_file_get, payloads_cost_mode_file_set, "%llu\n");
+
+static int payloads_cost_file_show(struct seq_file* m, void* v)
+{
+    struct kedr_coi_interceptor* interceptor = m->private;
+
+    operation_payloads_report_cost(&interceptor->payloads, m);
+
+    return 0;
+}
+
+static int payloads_cost_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, payloads_cost_file_show, inode->i_private);
+}
+
+static const struct file_operations payloads_cost_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = payloads_cost_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/*
+ * 'record_mode' file: whether intercepted calls, watching and
+ * forgetting of the objects are stored into call records.
+ */
+static int record_mode_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+
+    *val = atomic_read(&interceptor->recording) ? 1 : 0;
+    return 0;
+}
+
+static int record_mode_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+
+    if(val > 1) return -EINVAL;
+
+    atomic_set(&interceptor->recording, val);
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(record_mode_file_operations,
+    record_mode_file_get, record_mode_file_set, "%llu\n");
+
+/*
+ * 'memory' file: memory used by the interceptor and its quota.
+ */
+static int memory_file_show(struct seq_file* m, void* v)
+{
+    struct kedr_coi_interceptor* interceptor = m->private;
+    struct kedr_coi_instrumentor_memory memory;
+    unsigned long n_refused, n_evicted;
+    size_t total;
+    
+    mutex_lock(&memory_mutex);
+    
+    if(interceptor->instrumentor == NULL)
+    {
+        seq_puts(m, "# Interceptor is not started.\n");
+        goto out;
+    }
+    
+    kedr_coi_instrumentor_get_memory(interceptor->instrumentor,
+        &memory, &n_refused, &n_evicted);
+    total = memory.watch_data + memory.idata + memory.ops_copies
+        + memory.hash_heads + memory.foreign;
+    
+    seq_printf(m, "watch_data: %zu\n", memory.watch_data);
+    seq_printf(m, "idata: %zu\n", memory.idata);
+    seq_printf(m, "ops_copies: %zu\n", memory.ops_copies);
+    seq_printf(m, "hash_heads: %zu\n", memory.hash_heads);
+    seq_printf(m, "foreign: %zu\n", memory.foreign);
+    seq_printf(m, "total: %zu\n", total);
+    seq_printf(m, "quota: %zu\n", interceptor->quota);
+    seq_printf(m, "refused: %lu\n", n_refused);
+    seq_printf(m, "evicted: %lu\n", n_evicted);
+
+out:
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
+static int memory_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, memory_file_show, inode->i_private);
+}
+
+static const struct file_operations memory_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = memory_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/*
+ * 'quota' file: limit on memory used by the interceptor, in bytes.
+ * 
+ * 0 means no limit.
+ */
+static int quota_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    
+    mutex_lock(&memory_mutex);
+    *val = interceptor->quota;
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
+static int quota_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    
+    if(val != (size_t)val) return -EINVAL;
+    
+    mutex_lock(&memory_mutex);
+    interceptor->quota = val;
+    interceptor_apply_quota(interceptor);
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(quota_file_operations,
+    quota_file_get, quota_file_set, "%llu\n");
+
+/*
+ * 'quota_policy' file: what to do when quota is reached.
+ * 
+ * 0 - refuse new watches, 1 - evict watches not used recently.
+ */
+static int quota_policy_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    
+    mutex_lock(&memory_mutex);
+    *val = interceptor->quota_evict ? 1 : 0;
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
+static int quota_policy_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    
+    if(val > 1) return -EINVAL;
+    
+    mutex_lock(&memory_mutex);
+    interceptor->quota_evict = val;
+    interceptor_apply_quota(interceptor);
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(quota_policy_file_operations,
+    quota_policy_file_get, quota_policy_file_set, "%llu\n");
+
+/*
+ * 'gc_interval' file: interval between passes of garbage collection,
+ * in milliseconds.
+ * 
+ * 0 disables collection. Liveness check set by
+ * kedr_coi_interceptor_set_gc() is kept. Collection cannot be enabled
+ * if no liveness check is set.
+ */
+static int gc_interval_file_get(void* data, u64* val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    
+    mutex_lock(&memory_mutex);
+    *val = interceptor->gc_interval;
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
+static int gc_interval_file_set(void* data, u64 val)
+{
+    struct kedr_coi_interceptor* interceptor = data;
+    int result = 0;
+    
+    if(val > UINT_MAX) return -EINVAL;
+    
+    mutex_lock(&memory_mutex);
+    if(val && (interceptor->gc_object_is_alive == NULL))
+    {
+        result = -EINVAL;
+        goto out;
+    }
+    interceptor->gc_interval = val;
+    interceptor_gc_schedule(interceptor);
+out:
+    mutex_unlock(&memory_mutex);
+    
+    return result;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(gc_interval_file_operations,
+    gc_interval_file_get, gc_interval_file_set, "%llu\n");
+
+/*
+ * 'gc' file: statistic of garbage collection.
+ */
+static int gc_file_show(struct seq_file* m, void* v)
+{
+    struct kedr_coi_interceptor* interceptor = m->private;
+    
+    mutex_lock(&memory_mutex);
+    
+    seq_printf(m, "interval: %u\n", interceptor->gc_interval);
+    seq_printf(m, "check: %s\n", interceptor->gc_object_is_alive
+        ? "callback" : "none");
+    seq_printf(m, "passes: %lu\n", interceptor->gc_passes);
+    seq_printf(m, "collected: %lu\n", interceptor->gc_collected);
+    seq_printf(m, "last_pass_collected: %zu\n",
+        interceptor->gc_last_collected);
+    
+    mutex_unlock(&memory_mutex);
+    
+    return 0;
+}
+
+static int gc_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, gc_file_show, inode->i_private);
+}
+
+static const struct file_operations gc_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = gc_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+/* 
+ * Create directory and files in debugfs for interceptor.
+ * 
+ * Failure is not an error, interceptor just will not be accessible
+ * via debugfs.
+ */
+void interceptor_debugfs_create(struct kedr_coi_interceptor* interceptor)
+{
+    interceptor->debugfs_dir = kedr_coi_debugfs_create_dir(
+        interceptor->name, kedr_coi_debugfs_root);
+    if(interceptor->debugfs_dir == NULL) return;
+    
+    debugfs_create_file("paused", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &paused_file_operations);
+    debugfs_create_file("operations", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &operations_file_operations);
+    debugfs_create_u32("id", S_IRUGO,
+        interceptor->debugfs_dir, &interceptor->id);
+    debugfs_create_file("callers_mode", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &callers_mode_file_operations);
+    debugfs_create_file("callers", S_IRUGO,
+        interceptor->debugfs_dir, interceptor, &callers_file_operations);
+    debugfs_create_file("tasks_mode", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &tasks_mode_file_operations);
+    debugfs_create_file("tasks", S_IRUGO,
+        interceptor->debugfs_dir, interceptor, &tasks_file_operations);
+    debugfs_create_file("cgroups", S_IRUGO,
+        interceptor->debugfs_dir, interceptor, &cgroups_file_operations);
+    debugfs_create_file("objects_mode", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &objects_mode_file_operations);
+    debugfs_create_file("objects", S_IRUGO,
+        interceptor->debugfs_dir, interceptor, &objects_file_operations);
+    debugfs_create_file("payloads", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &payloads_file_operations);
+    debugfs_create_file("payloads_cost_mode", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor,
+        &payloads_cost_mode_file_operations);
+    debugfs_create_file("payloads_cost", S_IRUGO,
+        interceptor->debugfs_dir, interceptor, &payloads_cost_file_operations);
+    debugfs_create_file("record_mode", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &record_mode_file_operations);
+    debugfs_create_file("memory", S_IRUGO,
+        interceptor->debugfs_dir, interceptor, &memory_file_operations);
+    debugfs_create_file("quota", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &quota_file_operations);
+    debugfs_create_file("quota_policy", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &quota_policy_file_operations);
+    debugfs_create_file("gc_interval", S_IRUGO | S_IWUSR,
+        interceptor->debugfs_dir, interceptor, &gc_interval_file_operations);
+    debugfs_create_file("gc", S_IRUGO,
+        interceptor->debugfs_dir, interceptor, &gc_file_operations);
+}
+
+void interceptor_debugfs_destroy(struct kedr_coi_interceptor* interceptor)
+{
+    if(interceptor->debugfs_dir)
+    {
+        debugfs_remove_recursive(interceptor->debugfs_dir);
+        interceptor->debugfs_dir = NULL;
+    }
+}
+
+//*********Factory interceptor API implementation*********************//
+static struct kedr_coi_factory_interceptor*
+kedr_coi_factory_interceptor_create_common(
+    struct kedr_coi_interceptor* interceptor,
+    const char* name,
+    const struct kedr_coi_intermediate* intermediate_operations)
+{
+    struct kedr_coi_factory_interceptor* factory_interceptor;
+    int err;
+    
+    if(interceptor->operations_field_offset == -1)
+    {
+        pr_err("Cannot create factory interceptor for direct normal one.");
+        return NULL;
+    }
+
+    BUG_ON(interceptor->state != interceptor_state_initialized);
+    
+    if((intermediate_operations == NULL) ||
+        (intermediate_operations[0].operation_offset == -1))
     {
         pr_err("For factory interceptor at least one "
             "intermediate should be defined.");
@@ -813,11 +2312,28 @@ int kedr_coi_factory_interceptor_bind_object(
         &info->op_chained,
         &info->op_orig);
 
+    info->hooks = NULL;
+    info->measure = NULL;
+    
     if(result == 0)
+        kedr_coi_perf_count(interceptor_binded->id, operation_offset);
+    
+    if((result == 0)
+        && interceptor_handlers_disabled(interceptor_binded, operation_offset))
+    {
+        // Call chained operation directly, as if no interception at all.
+        info->pre = NULL;
+        info->post = NULL;
+
+        return 0;
+    }
+    else if(result == 0)
     {
         operation_payloads_get_interception_info(&factory_interceptor->payloads,
             operation_offset, info->op_orig? 0 : 1,
-            &info->pre, &info->post);
+            &info->pre, &info->post, &info->measure);
+        // Calls are reported on behalf of the binded interceptor.
+        info->hooks = interceptor_hooks(interceptor_binded, info);
 
         return 0;
     }
@@ -871,22 +2387,6 @@ void kedr_coi_factory_interceptor_trace_unforgotten_object(
 }
 
 
-bool kedr_coi_default_mechanism_selector(const void* addr)
-{
-    struct module* m = __module_address((unsigned long)addr);
-#ifdef CONFIG_DEBUG_SET_MODULE_RONX
-    // Not all module sections are writable.
-    if(m)
-    {
-        if(addr >= m->module_core && addr < m->module_core + m->core_size)
-            return addr >= m->module_core + m->core_ro_size;
-        else
-            return addr >= m->module_init + m->init_ro_size;
-    }
-#endif /* CONFIG_DEBUG_SET_MODULE_RONX */
-    return !!m;
-}
-
 void kedr_coi_interceptor_mechanism_selector(
     struct kedr_coi_interceptor* interceptor,
     bool (*replace_at_place)(const void* ops))
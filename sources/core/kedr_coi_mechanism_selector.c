@@ -0,0 +1,520 @@
+/*
+ * Caching of interception mechanism selector's decisions.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include <kedr-coi/operations_interception.h>
+
+#include "kedr_coi_mechanism_selector.h"
+#include "kedr_coi_hash_table.h"
+
+#include <linux/version.h>
+#include <linux/module.h> /* __module_address(), module notifier */
+#include <linux/slab.h> /* memory allocations */
+#include <linux/spinlock.h> /* spinlocks */
+#include <linux/list.h>
+
+#include "config_kernel.h"
+
+/*
+ * Whether module loader protects read-only sections of the module
+ * (code, constant data) from writing.
+ */
+#if defined(CONFIG_DEBUG_SET_MODULE_RONX) || defined(CONFIG_STRICT_MODULE_RWX)
+#define MODULE_RO_PROTECTED 1
+#else
+#define MODULE_RO_PROTECTED 0
+#endif
+
+/*
+ * Maximum number of cached selector's decisions.
+ *
+ * When this limit is reached, the oldest decision is evicted.
+ */
+#define SELECTOR_CACHE_MAX_ELEMS 4096
+
+/* Initial capacity of the interval table of module areas. */
+#define MODULE_RANGES_CAPACITY_DEFAULT 16
+
+/* Maximum number of intervals which one module may have. */
+#define MODULE_RANGES_MAX 16
+
+/* One contiguous memory area of the module with same access rights. */
+struct module_range
+{
+    unsigned long start;
+    unsigned long end;
+    /* Used only as identificator of the module. */
+    const struct module* m;
+
+    bool writable;
+};
+
+/* Cached decision of the selector for operations pointer. */
+struct selector_cache_elem
+{
+    /* Element of the 'selector_cache' table, key is operations pointer. */
+    struct kedr_coi_hash_elem ops_elem;
+    /* Element of 'selector_cache_list'. */
+    struct list_head list;
+
+    bool (*selector)(const void* ops);
+    bool result;
+};
+
+/* Protects all data below. */
+static DEFINE_SPINLOCK(selector_lock);
+
+/* Table of cached decisions. Elements are selector_cache_elem. */
+static struct kedr_coi_hash_table selector_cache;
+/* List of all cached decisions, oldest first. */
+static LIST_HEAD(selector_cache_list);
+/*
+ * Incremented every time when cached decisions are invalidated.
+ *
+ * Used for detect invalidation while selector is called.
+ */
+static unsigned long selector_cache_generation;
+
+/*
+ * Interval table of module areas, sorted by start address.
+ *
+ * Intervals never intersect.
+ */
+static struct module_range* module_ranges;
+static size_t module_ranges_n;
+static size_t module_ranges_capacity;
+
+//******************** Module areas ***********************************
+/*
+ * Fill ranges for memory area of the module, first 'ro_size' bytes of
+ * which are read-only.
+ *
+ * Return number of ranges filled.
+ */
+static int module_area_get_ranges(const struct module* m,
+    const void* base, unsigned long size, unsigned long ro_size,
+    struct module_range* ranges)
+{
+    int n = 0;
+
+    if(!MODULE_RO_PROTECTED) ro_size = 0;
+    if(ro_size > size) ro_size = size;
+
+    if(ro_size)
+    {
+        ranges[n].start = (unsigned long)base;
+        ranges[n].end = (unsigned long)base + ro_size;
+        ranges[n].m = m;
+        ranges[n].writable = false;
+        n++;
+    }
+    if(size > ro_size)
+    {
+        ranges[n].start = (unsigned long)base + ro_size;
+        ranges[n].end = (unsigned long)base + size;
+        ranges[n].m = m;
+        ranges[n].writable = true;
+        n++;
+    }
+
+    return n;
+}
+
+/*
+ * Fill ranges for all memory areas of the module.
+ *
+ * Init areas are included only if 'with_init' is true.
+ *
+ * Return number of ranges filled.
+ */
+static int module_get_ranges(const struct module* m, bool with_init,
+    struct module_range* ranges)
+{
+    int n = 0;
+#if defined(MODULE_LAYOUT_MEM)
+    /* Since kernel 6.4 every type of module memory is allocated separately. */
+    int type;
+
+    for(type = 0; type < MOD_MEM_NUM_TYPES; type++)
+    {
+        bool writable = (type == MOD_DATA) || (type == MOD_INIT_DATA);
+        bool is_init = (type == MOD_INIT_TEXT) || (type == MOD_INIT_DATA)
+            || (type == MOD_INIT_RODATA);
+
+        if(is_init && !with_init) continue;
+
+        n += module_area_get_ranges(m, m->mem[type].base,
+            m->mem[type].size, writable ? 0 : m->mem[type].size,
+            &ranges[n]);
+    }
+#elif defined(MODULE_LAYOUT_CORE_LAYOUT)
+    /* Kernels 4.5 - 6.3. */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,8,0)
+    n += module_area_get_ranges(m, m->core_layout.base,
+        m->core_layout.size, m->core_layout.ro_after_init_size,
+        &ranges[n]);
+    if(with_init)
+        n += module_area_get_ranges(m, m->init_layout.base,
+            m->init_layout.size, m->init_layout.ro_after_init_size,
+            &ranges[n]);
+#else
+    n += module_area_get_ranges(m, m->core_layout.base,
+        m->core_layout.size, m->core_layout.ro_size, &ranges[n]);
+    if(with_init)
+        n += module_area_get_ranges(m, m->init_layout.base,
+            m->init_layout.size, m->init_layout.ro_size, &ranges[n]);
+#endif
+#else
+    n += module_area_get_ranges(m, m->module_core,
+        m->core_size, m->core_ro_size, &ranges[n]);
+    if(with_init)
+        n += module_area_get_ranges(m, m->module_init,
+            m->init_size, m->init_ro_size, &ranges[n]);
+#endif /* MODULE_LAYOUT_MEM */
+    return n;
+}
+
+/* Search range in the array of unsorted ranges. */
+static const struct module_range* ranges_find(
+    const struct module_range* ranges, int n, unsigned long addr)
+{
+    int i;
+    for(i = 0; i < n; i++)
+    {
+        if((addr >= ranges[i].start) && (addr < ranges[i].end))
+            return &ranges[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Search range in the interval table.
+ *
+ * Should be called with lock taken.
+ */
+static const struct module_range* module_ranges_find(unsigned long addr)
+{
+    size_t low = 0;
+    size_t high = module_ranges_n;
+
+    while(low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        const struct module_range* range = &module_ranges[mid];
+
+        if(addr < range->start)
+            high = mid;
+        else if(addr >= range->end)
+            low = mid + 1;
+        else
+            return range;
+    }
+
+    return NULL;
+}
+
+/*
+ * Insert range into interval table.
+ *
+ * Range which intersects with one already in the table is ignored.
+ *
+ * Should be called with lock taken.
+ */
+static int module_ranges_insert(const struct module_range* range)
+{
+    size_t low = 0;
+    size_t high = module_ranges_n;
+
+    if(module_ranges_n == module_ranges_capacity)
+    {
+        size_t capacity_new = module_ranges_capacity
+            ? module_ranges_capacity * 2
+            : MODULE_RANGES_CAPACITY_DEFAULT;
+        struct module_range* ranges_new = krealloc(module_ranges,
+            capacity_new * sizeof(*module_ranges), GFP_ATOMIC);
+
+        if(ranges_new == NULL) return -ENOMEM;
+
+        module_ranges = ranges_new;
+        module_ranges_capacity = capacity_new;
+    }
+    // Position of the first range which starts after new one.
+    while(low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if(module_ranges[mid].start > range->start)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    if((low > 0) && (module_ranges[low - 1].end > range->start))
+        return 0;
+    if((low < module_ranges_n) && (module_ranges[low].start < range->end))
+        return 0;
+
+    memmove(&module_ranges[low + 1], &module_ranges[low],
+        (module_ranges_n - low) * sizeof(*module_ranges));
+    module_ranges[low] = *range;
+    module_ranges_n++;
+
+    return 0;
+}
+
+/*
+ * Remove all ranges of the module from the interval table.
+ *
+ * Should be called with lock taken.
+ */
+static void module_ranges_remove(const struct module* m)
+{
+    size_t i, j;
+
+    for(i = 0, j = 0; i < module_ranges_n; i++)
+    {
+        if(module_ranges[i].m == m) continue;
+        if(i != j) module_ranges[j] = module_ranges[i];
+        j++;
+    }
+
+    module_ranges_n = j;
+}
+
+/*
+ * Determine whether address is writable using information about
+ * modules, and store this information in the interval table.
+ *
+ * Should be called with lock taken.
+ */
+static bool module_address_is_writable(unsigned long addr)
+{
+    struct module_range ranges[MODULE_RANGES_MAX];
+    const struct module_range* range;
+    int n, i;
+
+    struct module* m = __module_address(addr);
+    if(m == NULL) return false;
+
+    /*
+     * Init areas are freed soon after module becomes live.
+     *
+     * Ranges for module which is going away will never be removed
+     * from the table, so do not add them.
+     */
+    n = module_get_ranges(m, m->state != MODULE_STATE_LIVE, ranges);
+    if(m->state != MODULE_STATE_GOING)
+    {
+        for(i = 0; i < n; i++)
+        {
+            if(module_ranges_insert(&ranges[i])) break;
+        }
+    }
+
+    range = ranges_find(ranges, n, addr);
+    // Address belongs to the module, but its area is unknown.
+    if(range == NULL) return true;
+
+    return range->writable;
+}
+
+//*************** Cache of selector's decisions ***********************
+
+/* Remove element from the cache and free it. Should be called with lock taken. */
+static void selector_cache_elem_free(struct selector_cache_elem* cache_elem)
+{
+    kedr_coi_hash_table_remove_elem(&selector_cache, &cache_elem->ops_elem);
+    list_del(&cache_elem->list);
+    kfree(cache_elem);
+}
+
+static void selector_cache_destroy_elem_callback(
+    struct kedr_coi_hash_elem* ops_elem, void* data)
+{
+    struct selector_cache_elem* cache_elem = container_of(ops_elem,
+        typeof(*cache_elem), ops_elem);
+    (void)data;
+
+    list_del(&cache_elem->list);
+    kfree(cache_elem);
+}
+
+bool kedr_coi_mechanism_selector_call(bool (*selector)(const void* ops),
+    const void* ops)
+{
+    unsigned long flags;
+    unsigned long generation;
+    bool result;
+    struct kedr_coi_hash_elem* ops_elem;
+    struct selector_cache_elem* cache_elem;
+
+    spin_lock_irqsave(&selector_lock, flags);
+    ops_elem = kedr_coi_hash_table_find_elem(&selector_cache, ops);
+    if(ops_elem)
+    {
+        cache_elem = container_of(ops_elem, typeof(*cache_elem), ops_elem);
+        if(cache_elem->selector == selector)
+        {
+            result = cache_elem->result;
+            spin_unlock_irqrestore(&selector_lock, flags);
+            return result;
+        }
+        // Decision was made by another selector, it is useless now.
+        selector_cache_elem_free(cache_elem);
+    }
+    generation = selector_cache_generation;
+    spin_unlock_irqrestore(&selector_lock, flags);
+
+    /*
+     * Call selector without lock: default selector takes it by itself,
+     * and custom ones may be slow.
+     */
+    result = selector(ops);
+
+    // Failure to cache decision is not an error.
+    cache_elem = kmalloc(sizeof(*cache_elem), GFP_ATOMIC);
+    if(cache_elem == NULL) return result;
+
+    kedr_coi_hash_elem_init(&cache_elem->ops_elem, ops);
+    cache_elem->selector = selector;
+    cache_elem->result = result;
+
+    spin_lock_irqsave(&selector_lock, flags);
+    if((generation != selector_cache_generation)
+        || kedr_coi_hash_table_find_elem(&selector_cache, ops))
+    {
+        // Decision may be outdated or already cached.
+        goto out_free;
+    }
+
+    if(selector_cache.n_elems >= SELECTOR_CACHE_MAX_ELEMS)
+    {
+        selector_cache_elem_free(list_first_entry(&selector_cache_list,
+            struct selector_cache_elem, list));
+    }
+
+    if(kedr_coi_hash_table_add_elem(&selector_cache, &cache_elem->ops_elem))
+        goto out_free;
+
+    list_add_tail(&cache_elem->list, &selector_cache_list);
+    spin_unlock_irqrestore(&selector_lock, flags);
+
+    return result;
+
+out_free:
+    spin_unlock_irqrestore(&selector_lock, flags);
+    kfree(cache_elem);
+    return result;
+}
+
+/*
+ * Invalidate all information about module when it appears, becomes
+ * live (init areas are freed) or goes away.
+ */
+static int selector_module_notifier_call(struct notifier_block* nb,
+    unsigned long action, void* data)
+{
+    unsigned long flags;
+    struct module_range ranges[MODULE_RANGES_MAX];
+    int n;
+    struct selector_cache_elem* cache_elem;
+    struct selector_cache_elem* cache_elem_tmp;
+
+    struct module* m = data;
+
+    if((action != MODULE_STATE_COMING) && (action != MODULE_STATE_LIVE)
+        && (action != MODULE_STATE_GOING))
+        return NOTIFY_DONE;
+
+    n = module_get_ranges(m, true, ranges);
+
+    spin_lock_irqsave(&selector_lock, flags);
+    selector_cache_generation++;
+
+    list_for_each_entry_safe(cache_elem, cache_elem_tmp,
+        &selector_cache_list, list)
+    {
+        if(ranges_find(ranges, n, (unsigned long)cache_elem->ops_elem.key))
+            selector_cache_elem_free(cache_elem);
+    }
+
+    module_ranges_remove(m);
+    spin_unlock_irqrestore(&selector_lock, flags);
+
+    return NOTIFY_OK;
+}
+
+static struct notifier_block selector_module_notifier =
+{
+    .notifier_call = selector_module_notifier_call,
+};
+
+//*********************** Exported functions **************************
+bool kedr_coi_default_mechanism_selector(const void* addr)
+{
+    unsigned long flags;
+    const struct module_range* range;
+    bool result;
+
+    /*
+     * Lock does not keep the module from being freed. Ranges in the table
+     * are valid because module notifier removes them on MODULE_STATE_GOING,
+     * before module memory is freed, and takes the same lock for that.
+     * Disabled preemption is also what __module_address() requires.
+     */
+    spin_lock_irqsave(&selector_lock, flags);
+    range = module_ranges_find((unsigned long)addr);
+    result = range
+        ? range->writable
+        : module_address_is_writable((unsigned long)addr);
+    spin_unlock_irqrestore(&selector_lock, flags);
+
+    return result;
+}
+
+//*********************** Global functions ****************************
+int kedr_coi_mechanism_selector_init(void)
+{
+    int err = kedr_coi_hash_table_init(&selector_cache);
+    if(err) return err;
+
+    err = register_module_notifier(&selector_module_notifier);
+    if(err)
+    {
+        kedr_coi_hash_table_destroy(&selector_cache, NULL, NULL);
+        return err;
+    }
+
+    return 0;
+}
+
+void kedr_coi_mechanism_selector_destroy(void)
+{
+    unregister_module_notifier(&selector_module_notifier);
+
+    kedr_coi_hash_table_destroy(&selector_cache,
+        selector_cache_destroy_elem_callback, NULL);
+
+    kfree(module_ranges);
+    module_ranges = NULL;
+    module_ranges_n = 0;
+    module_ranges_capacity = 0;
+}
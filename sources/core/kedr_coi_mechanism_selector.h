@@ -0,0 +1,35 @@
+#ifndef KEDR_COI_MECHANISM_SELECTOR_H
+#define KEDR_COI_MECHANISM_SELECTOR_H
+
+/*
+ * Caching of interception mechanism selector's decisions.
+ *
+ * Result of the selector is stored per operations pointer, so
+ * subsequent instrumentation of the same operations doesn't call the
+ * selector again.
+ *
+ * Cached results are invalidated when a module which contains cached
+ * operations pointer is loaded or unloaded.
+ *
+ * Also, memory areas of the modules are collected into sorted interval
+ * table, which is used by kedr_coi_default_mechanism_selector() instead
+ * of searching the module every time.
+ */
+
+#include <linux/types.h> /* bool */
+
+int kedr_coi_mechanism_selector_init(void);
+void kedr_coi_mechanism_selector_destroy(void);
+
+/*
+ * Return result of 'selector' for given operations.
+ *
+ * Selector is called only if there is no cached result for 'ops' and
+ * given selector.
+ *
+ * May be called in atomic context.
+ */
+bool kedr_coi_mechanism_selector_call(bool (*selector)(const void* ops),
+    const void* ops);
+
+#endif /* KEDR_COI_MECHANISM_SELECTOR_H */
@@ -23,6 +23,11 @@
 #include <kedr-coi/operations_interception.h>
 
 #include "kedr_coi_instrumentor_internal.h"
+#include "kedr_coi_mechanism_selector.h"
+#include "kedr_coi_debugfs.h"
+#include "kedr_coi_call_records.h"
+#include "kedr_coi_perf.h"
+#include "kedr_coi_call_stack.h"
 
 #include <linux/version.h>
 #include <linux/module.h>
@@ -34,13 +39,48 @@ MODULE_LICENSE("GPL");
 static int __init
 kedr_coi_module_init(void)
 {
-    return kedr_coi_instrumentors_init();
+    int result = kedr_coi_debugfs_init();
+    if(result) return result;
+    
+    result = kedr_coi_mechanism_selector_init();
+    if(result) goto fail_mechanism_selector;
+
+    result = kedr_coi_instrumentors_init();
+    if(result) goto fail_instrumentors;
+
+    result = kedr_coi_call_records_init();
+    if(result) goto fail_call_records;
+
+    result = kedr_coi_perf_init();
+    if(result) goto fail_perf;
+
+    result = kedr_coi_call_stack_init();
+    if(result) goto fail_call_stack;
+
+    return 0;
+
+fail_call_stack:
+    kedr_coi_perf_destroy();
+fail_perf:
+    kedr_coi_call_records_destroy();
+fail_call_records:
+    kedr_coi_instrumentors_destroy();
+fail_instrumentors:
+    kedr_coi_mechanism_selector_destroy();
+fail_mechanism_selector:
+    kedr_coi_debugfs_destroy();
+    return result;
 }
 
 static void __exit
 kedr_coi_module_exit(void)
 {
+    kedr_coi_call_stack_destroy();
+    kedr_coi_perf_destroy();
+    kedr_coi_call_records_destroy();
     kedr_coi_instrumentors_destroy();
+    kedr_coi_mechanism_selector_destroy();
+    kedr_coi_debugfs_destroy();
 }
 
 module_init(kedr_coi_module_init);
@@ -59,6 +99,28 @@ EXPORT_SYMBOL(kedr_coi_interceptor_watch);
 EXPORT_SYMBOL(kedr_coi_interceptor_forget);
 EXPORT_SYMBOL(kedr_coi_interceptor_forget_norestore);
 
+EXPORT_SYMBOL(kedr_coi_interceptor_watch_child);
+EXPORT_SYMBOL(kedr_coi_interceptor_forget_children);
+EXPORT_SYMBOL(kedr_coi_interceptor_get_stat);
+EXPORT_SYMBOL(kedr_coi_interceptor_get_memory);
+EXPORT_SYMBOL(kedr_coi_interceptor_set_quota);
+EXPORT_SYMBOL(kedr_coi_interceptor_set_gc);
+
+EXPORT_SYMBOL(kedr_coi_interceptor_pause);
+EXPORT_SYMBOL(kedr_coi_interceptor_resume);
+EXPORT_SYMBOL(kedr_coi_interceptor_is_paused);
+
+EXPORT_SYMBOL(kedr_coi_interceptor_operation_disable);
+EXPORT_SYMBOL(kedr_coi_interceptor_operation_enable);
+EXPORT_SYMBOL(kedr_coi_interceptor_operation_is_enabled);
+
+EXPORT_SYMBOL(kedr_coi_call_record);
+EXPORT_SYMBOL(kedr_coi_hook_pre);
+EXPORT_SYMBOL(kedr_coi_hook_post);
+EXPORT_SYMBOL(kedr_coi_current_call);
+EXPORT_SYMBOL(kedr_coi_handler_start);
+EXPORT_SYMBOL(kedr_coi_handler_stop);
+
 EXPORT_SYMBOL(kedr_coi_interceptor_create);
 EXPORT_SYMBOL(kedr_coi_interceptor_create_direct);
 
@@ -0,0 +1,205 @@
+/*
+ * Tracking of objects with the most number of intercepted calls.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_objects.h"
+#include "kedr_coi_stat_table.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+
+/* Maximum number of objects in the report. */
+static unsigned int objects_report_size = 16;
+module_param(objects_report_size, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(objects_report_size,
+    "Number of objects shown in 'objects' report of the interceptor");
+
+/*
+ * Every CPU tracks 2^OBJECTS_TABLE_BITS (operation, object) pairs.
+ *
+ * Pairs with more than 1/2^OBJECTS_TABLE_BITS part of the calls are
+ * guaranteed to be tracked.
+ */
+#define OBJECTS_TABLE_BITS 9
+
+struct kedr_coi_objects
+{
+    // Keyed by object
+    struct kedr_coi_stat_table* table;
+};
+
+struct kedr_coi_objects* kedr_coi_objects_create(void)
+{
+    struct kedr_coi_objects* objects = kzalloc(sizeof(*objects),
+        GFP_KERNEL);
+
+    if(objects == NULL)
+    {
+        pr_err("Cannot allocate statistic about objects.");
+        return NULL;
+    }
+
+    objects->table = kedr_coi_stat_table_create(OBJECTS_TABLE_BITS, true);
+    if(objects->table == NULL)
+    {
+        kfree(objects);
+        return NULL;
+    }
+
+    return objects;
+}
+
+void kedr_coi_objects_destroy(struct kedr_coi_objects* objects)
+{
+    kedr_coi_stat_table_destroy(objects->table);
+    kfree(objects);
+}
+
+void kedr_coi_objects_account(struct kedr_coi_objects* objects,
+    size_t operation_offset,
+    const void* object)
+{
+    kedr_coi_stat_table_account(objects->table, operation_offset,
+        (unsigned long)object, 0, 0);
+}
+
+//**************************** Report *********************************//
+/* Calls of all operations for the object. */
+struct object_total
+{
+    u64 object;
+    u64 count;
+    u64 error;
+    // Entries for the object, sorted by count.
+    int first_entry;
+    int n_entries;
+};
+
+// Ascending order of the object, descending order of count
+static int entry_cmp_object(const void* a, const void* b)
+{
+    const struct kedr_coi_stat_entry* entry_a = a;
+    const struct kedr_coi_stat_entry* entry_b = b;
+
+    if(entry_a->key != entry_b->key)
+        return entry_a->key < entry_b->key ? -1 : 1;
+    if(entry_a->count != entry_b->count)
+        return entry_a->count > entry_b->count ? -1 : 1;
+    return 0;
+}
+
+// Descending order of count
+static int object_total_cmp_count(const void* a, const void* b)
+{
+    const struct object_total* total_a = a;
+    const struct object_total* total_b = b;
+
+    if(total_a->count != total_b->count)
+        return total_a->count > total_b->count ? -1 : 1;
+    return 0;
+}
+
+int kedr_coi_objects_report(struct kedr_coi_objects* objects,
+    struct seq_file* m,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data)
+{
+    struct kedr_coi_stat_entry* entries;
+    struct object_total* totals;
+    int n_entries, n_totals = 0;
+    u64 lost;
+    int i, j;
+
+    entries = kedr_coi_stat_table_collect(objects->table, &n_entries, &lost);
+    if(entries == NULL) return -ENOMEM;
+
+    totals = vmalloc((n_entries ? n_entries : 1) * sizeof(*totals));
+    if(totals == NULL)
+    {
+        vfree(entries);
+        return -ENOMEM;
+    }
+
+    // Group entries by object.
+    sort(entries, n_entries, sizeof(*entries), entry_cmp_object, NULL);
+    for(i = 0; i < n_entries; i++)
+    {
+        struct object_total* total;
+
+        if((n_totals == 0) || (totals[n_totals - 1].object != entries[i].key))
+        {
+            total = &totals[n_totals++];
+            total->object = entries[i].key;
+            total->count = 0;
+            total->error = 0;
+            total->first_entry = i;
+            total->n_entries = 0;
+        }
+        else
+        {
+            total = &totals[n_totals - 1];
+        }
+
+        total->count += entries[i].count;
+        total->error += entries[i].error;
+        total->n_entries++;
+    }
+
+    sort(totals, n_totals, sizeof(*totals), object_total_cmp_count, NULL);
+
+    seq_printf(m, "# objects: %d\n", n_totals);
+    seq_puts(m, "# calls\terror\tobject\n#\tcalls\terror\toperation\n");
+
+    for(i = 0; (i < n_totals) && (i < objects_report_size); i++)
+    {
+        struct object_total* total = &totals[i];
+
+        seq_printf(m, "%llu\t%llu\t%p\n",
+            (unsigned long long)total->count,
+            (unsigned long long)total->error,
+            (void*)(unsigned long)total->object);
+
+        for(j = total->first_entry;
+            j < total->first_entry + total->n_entries;
+            j++)
+        {
+            struct kedr_coi_stat_entry* entry = &entries[j];
+            const char* name = operation_name(entry->operation_offset, data);
+
+            seq_printf(m, "\t%llu\t%llu\t",
+                (unsigned long long)entry->count,
+                (unsigned long long)entry->error);
+            if(name)
+                seq_printf(m, "%s\n", name);
+            else
+                seq_printf(m, "%zu\n", entry->operation_offset);
+        }
+    }
+
+    vfree(totals);
+    vfree(entries);
+
+    return 0;
+}
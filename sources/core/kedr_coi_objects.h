@@ -0,0 +1,46 @@
+#ifndef KEDR_COI_OBJECTS_H
+#define KEDR_COI_OBJECTS_H
+
+/*
+ * Tracking of objects which receive the most number of intercepted
+ * calls ("heavy hitters").
+ *
+ * Calls are counted per (operation, object) in per-CPU tables in
+ * 'space saving' mode (see kedr_coi_stat_table.h), so memory used does
+ * not depend on the number of watched objects.
+ */
+
+#include <linux/types.h>
+
+struct seq_file;
+
+struct kedr_coi_objects;
+
+struct kedr_coi_objects* kedr_coi_objects_create(void);
+
+void kedr_coi_objects_destroy(struct kedr_coi_objects* objects);
+
+/*
+ * Account call of the operation for the object.
+ *
+ * May be called in atomic context.
+ */
+void kedr_coi_objects_account(struct kedr_coi_objects* objects,
+    size_t operation_offset,
+    const void* object);
+
+/*
+ * Print objects with the most number of calls, sorted by that number,
+ * with per-operation breakdown.
+ *
+ * 'operation_name' returns name of the operation or NULL if it is not
+ * known.
+ *
+ * Should be called in process context.
+ */
+int kedr_coi_objects_report(struct kedr_coi_objects* objects,
+    struct seq_file* m,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data);
+
+#endif /* KEDR_COI_OBJECTS_H */
@@ -0,0 +1,315 @@
+/*
+ * PMU which counts calls of intercepted operations.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_perf.h"
+
+#include <linux/module.h>
+#include <linux/perf_event.h>
+#include <linux/percpu.h>
+#include <linux/rculist.h>
+#include <linux/hash.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/device.h>
+#include <linux/sysfs.h>
+
+#define KEDR_COI_PMU_NAME "kedr_coi"
+
+DEFINE_STATIC_KEY_FALSE(kedr_coi_perf_enabled);
+
+static inline u64 perf_config(u32 interceptor_id, size_t operation_offset)
+{
+    return ((u64)operation_offset << 32) | interceptor_id;
+}
+
+/*
+ * Events which are currently scheduled on the CPU, hashed by config.
+ *
+ * Lists are modified only on its own CPU with interrupts disabled
+ * (pmu->add() and pmu->del()), and traversed under RCU.
+ */
+#define ACTIVE_EVENTS_HASH_BITS 6
+#define ACTIVE_EVENTS_HASH_SIZE (1 << ACTIVE_EVENTS_HASH_BITS)
+
+static DEFINE_PER_CPU(struct hlist_head [ACTIVE_EVENTS_HASH_SIZE],
+    active_events);
+
+static inline struct hlist_head* active_events_head(u64 config)
+{
+    return &this_cpu_ptr(active_events)[hash_64(config,
+        ACTIVE_EVENTS_HASH_BITS)];
+}
+
+void kedr_coi_perf_count_slow(u32 interceptor_id, size_t operation_offset)
+{
+    u64 config = perf_config(interceptor_id, operation_offset);
+    struct perf_event* event;
+
+    preempt_disable();
+    rcu_read_lock();
+
+    hlist_for_each_entry_rcu(event, active_events_head(config), hlist_entry)
+    {
+        if((event->attr.config == config) && !event->hw.state)
+            local64_inc(&event->count);
+    }
+
+    rcu_read_unlock();
+    preempt_enable();
+}
+
+//*************************** PMU callbacks ****************************//
+static void kedr_coi_pmu_event_destroy(struct perf_event* event)
+{
+    static_branch_dec(&kedr_coi_perf_enabled);
+}
+
+static int kedr_coi_pmu_event_init(struct perf_event* event);
+
+static void kedr_coi_pmu_start(struct perf_event* event, int flags)
+{
+    event->hw.state = 0;
+}
+
+static void kedr_coi_pmu_stop(struct perf_event* event, int flags)
+{
+    event->hw.state = PERF_HES_STOPPED;
+}
+
+static int kedr_coi_pmu_add(struct perf_event* event, int flags)
+{
+    event->hw.state = (flags & PERF_EF_START) ? 0 : PERF_HES_STOPPED;
+
+    hlist_add_head_rcu(&event->hlist_entry,
+        active_events_head(event->attr.config));
+
+    return 0;
+}
+
+static void kedr_coi_pmu_del(struct perf_event* event, int flags)
+{
+    hlist_del_rcu(&event->hlist_entry);
+}
+
+static void kedr_coi_pmu_read(struct perf_event* event)
+{
+    // Counter is updated directly on every call.
+}
+
+//************************** Sysfs attributes **************************//
+PMU_FORMAT_ATTR(interceptor, "config:0-31");
+PMU_FORMAT_ATTR(operation, "config:32-63");
+
+static struct attribute* kedr_coi_pmu_format_attrs[] =
+{
+    &format_attr_interceptor.attr,
+    &format_attr_operation.attr,
+    NULL,
+};
+
+static struct attribute_group kedr_coi_pmu_format_group =
+{
+    .name = "format",
+    .attrs = kedr_coi_pmu_format_attrs,
+};
+
+/* Events are added into this group when interceptors are created. */
+static struct attribute* kedr_coi_pmu_events_attrs[] =
+{
+    NULL,
+};
+
+static struct attribute_group kedr_coi_pmu_events_group =
+{
+    .name = "events",
+    .attrs = kedr_coi_pmu_events_attrs,
+};
+
+static const struct attribute_group* kedr_coi_pmu_attr_groups[] =
+{
+    &kedr_coi_pmu_format_group,
+    &kedr_coi_pmu_events_group,
+    NULL,
+};
+
+static struct pmu kedr_coi_pmu =
+{
+    .module = THIS_MODULE,
+    .task_ctx_nr = perf_sw_context,
+    .capabilities = PERF_PMU_CAP_NO_INTERRUPT,
+    .attr_groups = kedr_coi_pmu_attr_groups,
+    .event_init = kedr_coi_pmu_event_init,
+    .add = kedr_coi_pmu_add,
+    .del = kedr_coi_pmu_del,
+    .start = kedr_coi_pmu_start,
+    .stop = kedr_coi_pmu_stop,
+    .read = kedr_coi_pmu_read,
+};
+
+static int kedr_coi_pmu_event_init(struct perf_event* event)
+{
+    if(event->attr.type != kedr_coi_pmu.type)
+        return -ENOENT;
+
+    // Interrupts are not generated, so sampling is impossible.
+    if(is_sampling_event(event))
+        return -EOPNOTSUPP;
+
+    static_branch_inc(&kedr_coi_perf_enabled);
+    event->destroy = kedr_coi_pmu_event_destroy;
+
+    return 0;
+}
+
+// Whether PMU has been registered.
+static bool pmu_registered = false;
+
+//**************************** Named events ****************************//
+struct perf_named_event
+{
+    struct list_head list;
+
+    u32 interceptor_id;
+    u64 config;
+
+    struct device_attribute attr;
+    // "<interceptor>.<operation>"
+    char name[];
+};
+
+static LIST_HEAD(named_events);
+// Protects list of named events.
+static DEFINE_MUTEX(named_events_mutex);
+
+static ssize_t named_event_show(struct device* dev,
+    struct device_attribute* attr, char* buf)
+{
+    struct perf_named_event* named_event =
+        container_of(attr, struct perf_named_event, attr);
+
+    return sprintf(buf, "config=0x%llx\n",
+        (unsigned long long)named_event->config);
+}
+
+void kedr_coi_perf_add_event(u32 interceptor_id,
+    const char* interceptor_name,
+    size_t operation_offset,
+    const char* operation_name)
+{
+    struct perf_named_event* named_event;
+    int result;
+
+    if(!pmu_registered || (kedr_coi_pmu.dev == NULL)) return;
+
+    named_event = kzalloc(sizeof(*named_event)
+        + strlen(interceptor_name) + strlen(operation_name) + 2,
+        GFP_KERNEL);
+    if(named_event == NULL)
+    {
+        pr_warn("Cannot allocate perf event for operation '%s' of '%s'.",
+            operation_name, interceptor_name);
+        return;
+    }
+
+    sprintf(named_event->name, "%s.%s", interceptor_name, operation_name);
+    named_event->interceptor_id = interceptor_id;
+    named_event->config = perf_config(interceptor_id, operation_offset);
+
+    sysfs_attr_init(&named_event->attr.attr);
+    named_event->attr.attr.name = named_event->name;
+    named_event->attr.attr.mode = S_IRUGO;
+    named_event->attr.show = named_event_show;
+
+    result = sysfs_add_file_to_group(&kedr_coi_pmu.dev->kobj,
+        &named_event->attr.attr, kedr_coi_pmu_events_group.name);
+    if(result)
+    {
+        pr_warn("Cannot create perf event '%s': %d.",
+            named_event->name, result);
+        kfree(named_event);
+        return;
+    }
+
+    mutex_lock(&named_events_mutex);
+    list_add_tail(&named_event->list, &named_events);
+    mutex_unlock(&named_events_mutex);
+}
+
+static void named_event_destroy(struct perf_named_event* named_event)
+{
+    list_del(&named_event->list);
+    sysfs_remove_file_from_group(&kedr_coi_pmu.dev->kobj,
+        &named_event->attr.attr, kedr_coi_pmu_events_group.name);
+    kfree(named_event);
+}
+
+void kedr_coi_perf_remove_events(u32 interceptor_id)
+{
+    struct perf_named_event* named_event;
+    struct perf_named_event* tmp;
+
+    mutex_lock(&named_events_mutex);
+    list_for_each_entry_safe(named_event, tmp, &named_events, list)
+    {
+        if(named_event->interceptor_id == interceptor_id)
+            named_event_destroy(named_event);
+    }
+    mutex_unlock(&named_events_mutex);
+}
+
+//**************************** Initialization **************************//
+int kedr_coi_perf_init(void)
+{
+    int cpu;
+    int i;
+    int result;
+
+    for_each_possible_cpu(cpu)
+    {
+        for(i = 0; i < ACTIVE_EVENTS_HASH_SIZE; i++)
+            INIT_HLIST_HEAD(&per_cpu(active_events, cpu)[i]);
+    }
+
+    result = perf_pmu_register(&kedr_coi_pmu, KEDR_COI_PMU_NAME, -1);
+    if(result)
+    {
+        // Not fatal: interception works without perf events.
+        pr_warn("Failed to register PMU '" KEDR_COI_PMU_NAME "': %d.",
+            result);
+        return 0;
+    }
+
+    pmu_registered = true;
+
+    return 0;
+}
+
+void kedr_coi_perf_destroy(void)
+{
+    if(!pmu_registered) return;
+
+    // All interceptors should be destroyed at this stage.
+    WARN_ON(!list_empty(&named_events));
+
+    perf_pmu_unregister(&kedr_coi_pmu);
+    pmu_registered = false;
+}
@@ -0,0 +1,53 @@
+#ifndef KEDR_COI_PERF_H
+#define KEDR_COI_PERF_H
+
+/*
+ * PMU 'kedr_coi' which counts calls of intercepted operations.
+ *
+ * Every operation of every interceptor is a separate event, named
+ * "<interceptor>.<operation>":
+ *
+ *     perf stat -e kedr_coi/file_operations_interceptor.read/ ...
+ *
+ * Config of the event is built from identificator of the interceptor
+ * (bits 0-31, 'interceptor' format field) and offset of the operation
+ * (bits 32-63, 'operation' format field).
+ */
+
+#include <linux/types.h>
+#include <linux/jump_label.h>
+
+int kedr_coi_perf_init(void);
+void kedr_coi_perf_destroy(void);
+
+/*
+ * Create named event for the operation of the interceptor.
+ *
+ * Failure is not an error, event just will not be accessible by name.
+ */
+void kedr_coi_perf_add_event(u32 interceptor_id,
+    const char* interceptor_name,
+    size_t operation_offset,
+    const char* operation_name);
+
+/* Remove all named events for the interceptor. */
+void kedr_coi_perf_remove_events(u32 interceptor_id);
+
+/* Enabled while at least one event exists. */
+extern struct static_key_false kedr_coi_perf_enabled;
+
+void kedr_coi_perf_count_slow(u32 interceptor_id, size_t operation_offset);
+
+/*
+ * Account call of the operation.
+ *
+ * Costs only a (patched) jump when no event is active.
+ */
+static inline void kedr_coi_perf_count(u32 interceptor_id,
+    size_t operation_offset)
+{
+    if(static_branch_unlikely(&kedr_coi_perf_enabled))
+        kedr_coi_perf_count_slow(interceptor_id, operation_offset);
+}
+
+#endif /* KEDR_COI_PERF_H */
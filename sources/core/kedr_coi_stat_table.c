@@ -0,0 +1,246 @@
+/*
+ * Per-CPU tables with statistic about intercepted calls.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_stat_table.h"
+
+#include <linux/module.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/sort.h>
+#include <linux/smp.h>
+#include <linux/irqflags.h>
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val) (ACCESS_ONCE(x) = (val))
+#endif
+
+/*
+ * Maximum number of entries checked when search place for the key.
+ *
+ * If all of them are occupied by other keys, the coldest one is evicted.
+ */
+#define STAT_TABLE_MAX_PROBES 16
+
+struct stat_cpu_table
+{
+    // Calls lost because of eviction.
+    u64 lost;
+    struct kedr_coi_stat_entry entries[];
+};
+
+struct kedr_coi_stat_table
+{
+    unsigned int bits;
+    bool space_saving;
+    // Size of per-CPU table, aligned to cache line.
+    size_t cpu_table_size;
+
+    char cpu_tables[];
+};
+
+static inline struct stat_cpu_table* cpu_table(
+    struct kedr_coi_stat_table* table, int cpu)
+{
+    return (void*)(table->cpu_tables + cpu * table->cpu_table_size);
+}
+
+struct kedr_coi_stat_table* kedr_coi_stat_table_create(unsigned int bits,
+    bool space_saving)
+{
+    struct kedr_coi_stat_table* table;
+    size_t cpu_table_size = ALIGN(sizeof(struct stat_cpu_table)
+        + (sizeof(struct kedr_coi_stat_entry) << bits), SMP_CACHE_BYTES);
+
+    table = vzalloc(sizeof(*table) + nr_cpu_ids * cpu_table_size);
+    if(table == NULL)
+    {
+        pr_err("Cannot allocate statistic tables.");
+        return NULL;
+    }
+
+    table->bits = bits;
+    table->space_saving = space_saving;
+    table->cpu_table_size = cpu_table_size;
+
+    return table;
+}
+
+void kedr_coi_stat_table_destroy(struct kedr_coi_stat_table* table)
+{
+    vfree(table);
+}
+
+void kedr_coi_stat_table_account(struct kedr_coi_stat_table* table,
+    size_t operation_offset,
+    u64 key,
+    u64 time,
+    u64 self_time)
+{
+    struct stat_cpu_table* t;
+    struct kedr_coi_stat_entry* entry;
+    struct kedr_coi_stat_entry* coldest = NULL;
+    unsigned long flags;
+    unsigned int mask = (1 << table->bits) - 1;
+    unsigned int index;
+    int i;
+
+    // Protect from interrupts on the same CPU.
+    local_irq_save(flags);
+
+    t = cpu_table(table, smp_processor_id());
+    index = hash_64(key ^ operation_offset, table->bits);
+
+    for(i = 0; i < STAT_TABLE_MAX_PROBES; i++)
+    {
+        entry = &t->entries[(index + i) & mask];
+
+        if(entry->count == 0)
+            goto new_entry;
+        if((entry->key == key)
+            && (entry->operation_offset == operation_offset))
+            goto account;
+        if((coldest == NULL) || (entry->count < coldest->count))
+            coldest = entry;
+    }
+
+    // Evict the coldest entry.
+    entry = coldest;
+    if(table->space_saving)
+    {
+        // New key inherits the count, which becomes its error.
+        entry->error = entry->count;
+        entry->time = 0;
+        entry->self_time = 0;
+        goto new_entry;
+    }
+    WRITE_ONCE(t->lost, t->lost + entry->count);
+    WRITE_ONCE(entry->count, 0);
+    // Readers should not see old count with the new key.
+    smp_wmb();
+    entry->time = 0;
+    entry->self_time = 0;
+
+new_entry:
+    entry->key = key;
+    entry->operation_offset = operation_offset;
+    // Key should be visible to readers before the count.
+    smp_wmb();
+
+account:
+    WRITE_ONCE(entry->count, entry->count + 1);
+    WRITE_ONCE(entry->time, entry->time + time);
+    WRITE_ONCE(entry->self_time, entry->self_time + self_time);
+
+    local_irq_restore(flags);
+}
+
+//************************* Collect statistic *************************//
+static int stat_entry_cmp_key(const void* a, const void* b)
+{
+    const struct kedr_coi_stat_entry* entry_a = a;
+    const struct kedr_coi_stat_entry* entry_b = b;
+
+    if(entry_a->operation_offset != entry_b->operation_offset)
+        return entry_a->operation_offset < entry_b->operation_offset
+            ? -1 : 1;
+    if(entry_a->key != entry_b->key)
+        return entry_a->key < entry_b->key ? -1 : 1;
+    return 0;
+}
+
+// Descending order of count
+static int stat_entry_cmp_count(const void* a, const void* b)
+{
+    const struct kedr_coi_stat_entry* entry_a = a;
+    const struct kedr_coi_stat_entry* entry_b = b;
+
+    if(entry_a->count != entry_b->count)
+        return entry_a->count > entry_b->count ? -1 : 1;
+    return 0;
+}
+
+struct kedr_coi_stat_entry* kedr_coi_stat_table_collect(
+    struct kedr_coi_stat_table* table, int* n, u64* lost)
+{
+    struct kedr_coi_stat_entry* merged;
+    unsigned int n_entries = 1 << table->bits;
+    int n_merged = 0;
+    int cpu;
+    int i, j;
+
+    merged = vmalloc(nr_cpu_ids * sizeof(*merged) * n_entries);
+    if(merged == NULL) return NULL;
+
+    *lost = 0;
+
+    for_each_possible_cpu(cpu)
+    {
+        struct stat_cpu_table* t = cpu_table(table, cpu);
+
+        for(i = 0; i < n_entries; i++)
+        {
+            struct kedr_coi_stat_entry* entry = &t->entries[i];
+            struct kedr_coi_stat_entry* copy = &merged[n_merged];
+
+            copy->count = READ_ONCE(entry->count);
+            if(copy->count == 0) continue;
+            // Paired with smp_wmb() in kedr_coi_stat_table_account().
+            smp_rmb();
+            copy->time = READ_ONCE(entry->time);
+            copy->self_time = READ_ONCE(entry->self_time);
+            copy->error = READ_ONCE(entry->error);
+            copy->key = entry->key;
+            copy->operation_offset = entry->operation_offset;
+            smp_rmb();
+            // Entry has been evicted while copied.
+            if(READ_ONCE(entry->count) < copy->count) continue;
+
+            n_merged++;
+        }
+        *lost += READ_ONCE(t->lost);
+    }
+
+    // Combine entries for the same key from different CPUs.
+    sort(merged, n_merged, sizeof(*merged), stat_entry_cmp_key, NULL);
+    for(i = 0, j = 0; i < n_merged; i++)
+    {
+        if((j > 0) && !stat_entry_cmp_key(&merged[j - 1], &merged[i]))
+        {
+            merged[j - 1].count += merged[i].count;
+            merged[j - 1].time += merged[i].time;
+            merged[j - 1].self_time += merged[i].self_time;
+            merged[j - 1].error += merged[i].error;
+        }
+        else
+        {
+            merged[j++] = merged[i];
+        }
+    }
+    n_merged = j;
+
+    sort(merged, n_merged, sizeof(*merged), stat_entry_cmp_count, NULL);
+
+    *n = n_merged;
+
+    return merged;
+}
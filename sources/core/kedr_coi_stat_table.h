@@ -0,0 +1,70 @@
+#ifndef KEDR_COI_STAT_TABLE_H
+#define KEDR_COI_STAT_TABLE_H
+
+/*
+ * Statistic about intercepted calls, aggregated by (operation, key).
+ *
+ * Every CPU has its own fixed-size hash table, so accounting requires
+ * neither locks nor allocations and memory used is bounded. When there
+ * is no place for new key, the coldest entry among the candidates is
+ * evicted; its calls are counted as lost.
+ *
+ * In 'space saving' mode the new key inherits count of the evicted
+ * entry instead, as in Space-Saving algorithm for heavy hitters: count
+ * of every key is never underestimated, and the overestimation is
+ * bounded by 'error' of the entry.
+ */
+
+#include <linux/types.h>
+
+struct kedr_coi_stat_table;
+
+struct kedr_coi_stat_entry
+{
+    size_t operation_offset;
+    u64 key;
+    // Number of calls, 0 for free entry.
+    u64 count;
+    // Summary time of the calls, in nanoseconds.
+    u64 time;
+    // Summary time of the calls excluding nested calls.
+    u64 self_time;
+    // Maximum overestimation of 'count', only in 'space saving' mode.
+    u64 error;
+};
+
+/*
+ * Create table for every CPU, with 2^bits entries each.
+ */
+struct kedr_coi_stat_table* kedr_coi_stat_table_create(unsigned int bits,
+    bool space_saving);
+
+void kedr_coi_stat_table_destroy(struct kedr_coi_stat_table* table);
+
+/*
+ * Account call of the operation with given key, which took 'time'
+ * nanoseconds, 'self_time' of them - not in nested calls.
+ *
+ * May be called in atomic context.
+ */
+void kedr_coi_stat_table_account(struct kedr_coi_stat_table* table,
+    size_t operation_offset,
+    u64 key,
+    u64 time,
+    u64 self_time);
+
+/*
+ * Merge tables of all CPUs.
+ *
+ * Return array of entries sorted by number of calls in descending
+ * order, or NULL on error. Number of entries is stored into 'n',
+ * number of lost calls - into 'lost'. Array should be freed with
+ * vfree().
+ *
+ * Should be called in process context. Concurrent accounting is
+ * allowed, but result may miss calls accounted meanwhile.
+ */
+struct kedr_coi_stat_entry* kedr_coi_stat_table_collect(
+    struct kedr_coi_stat_table* table, int* n, u64* lost);
+
+#endif /* KEDR_COI_STAT_TABLE_H */
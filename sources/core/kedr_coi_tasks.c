@@ -0,0 +1,215 @@
+/*
+ * Aggregation of intercepted calls by tasks and cgroups.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_tasks.h"
+#include "kedr_coi_stat_table.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/pid.h>
+#include <linux/pid_namespace.h>
+#include <linux/rcupdate.h>
+#include <linux/cgroup.h>
+
+/* Maximum number of entries in the reports. */
+static unsigned int tasks_report_size = 32;
+module_param(tasks_report_size, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tasks_report_size,
+    "Number of entries shown in 'tasks' and 'cgroups' reports of the interceptor");
+
+/* Every CPU may hold statistic for 2^TASKS_TABLE_BITS tasks. */
+#define TASKS_TABLE_BITS 10
+/* ... and for 2^CGROUPS_TABLE_BITS cgroups. */
+#define CGROUPS_TABLE_BITS 8
+
+struct kedr_coi_tasks
+{
+    bool latency;
+    // Keyed by pid
+    struct kedr_coi_stat_table* pids;
+    // Keyed by cgroup id
+    struct kedr_coi_stat_table* cgroups;
+};
+
+struct kedr_coi_tasks* kedr_coi_tasks_create(bool latency)
+{
+    struct kedr_coi_tasks* tasks = kzalloc(sizeof(*tasks), GFP_KERNEL);
+
+    if(tasks == NULL)
+    {
+        pr_err("Cannot allocate statistic about tasks.");
+        return NULL;
+    }
+
+    tasks->pids = kedr_coi_stat_table_create(TASKS_TABLE_BITS, false);
+    if(tasks->pids == NULL) goto err_pids;
+
+    tasks->cgroups = kedr_coi_stat_table_create(CGROUPS_TABLE_BITS, false);
+    if(tasks->cgroups == NULL) goto err_cgroups;
+
+    tasks->latency = latency;
+
+    return tasks;
+
+err_cgroups:
+    kedr_coi_stat_table_destroy(tasks->pids);
+err_pids:
+    kfree(tasks);
+    return NULL;
+}
+
+void kedr_coi_tasks_destroy(struct kedr_coi_tasks* tasks)
+{
+    kedr_coi_stat_table_destroy(tasks->cgroups);
+    kedr_coi_stat_table_destroy(tasks->pids);
+    kfree(tasks);
+}
+
+bool kedr_coi_tasks_latency(struct kedr_coi_tasks* tasks)
+{
+    return tasks->latency;
+}
+
+/* Id of the cgroup of the current task in the default hierarchy. */
+static u64 current_cgroup_id(void)
+{
+#ifdef CONFIG_CGROUPS
+    u64 id;
+
+    rcu_read_lock();
+    id = cgroup_id(task_dfl_cgroup(current));
+    rcu_read_unlock();
+
+    return id;
+#else
+    return 0;
+#endif
+}
+
+void kedr_coi_tasks_account(struct kedr_coi_tasks* tasks,
+    size_t operation_offset,
+    u64 time,
+    u64 self_time)
+{
+    kedr_coi_stat_table_account(tasks->pids, operation_offset,
+        task_pid_nr(current), time, self_time);
+    kedr_coi_stat_table_account(tasks->cgroups, operation_offset,
+        current_cgroup_id(), time, self_time);
+}
+
+//**************************** Reports ********************************//
+/*
+ * Print common part of the report line.
+ *
+ * Line is finished by the caller.
+ */
+static void report_entry(struct kedr_coi_tasks* tasks,
+    struct seq_file* m,
+    struct kedr_coi_stat_entry* entry,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data)
+{
+    const char* name = operation_name(entry->operation_offset, data);
+
+    seq_printf(m, "%llu\t", (unsigned long long)entry->count);
+    if(tasks->latency)
+        seq_printf(m, "%llu\t%llu\t", (unsigned long long)entry->time,
+            (unsigned long long)entry->self_time);
+    else
+        seq_puts(m, "-\t-\t");
+
+    if(name)
+        seq_printf(m, "%s\t", name);
+    else
+        seq_printf(m, "%zu\t", entry->operation_offset);
+}
+
+int kedr_coi_tasks_report_cgroups(struct kedr_coi_tasks* tasks,
+    struct seq_file* m,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data)
+{
+    struct kedr_coi_stat_entry* entries;
+    int n;
+    u64 lost;
+    int i;
+
+    entries = kedr_coi_stat_table_collect(tasks->cgroups, &n, &lost);
+    if(entries == NULL) return -ENOMEM;
+
+    seq_printf(m, "# entries: %d, lost calls: %llu\n",
+        n, (unsigned long long)lost);
+    seq_printf(m, "# calls\ttime_ns\tself_ns\toperation\tcgroup_id\n");
+
+    for(i = 0; (i < n) && (i < tasks_report_size); i++)
+    {
+        report_entry(tasks, m, &entries[i], operation_name, data);
+        seq_printf(m, "%llu\n", (unsigned long long)entries[i].key);
+    }
+
+    vfree(entries);
+
+    return 0;
+}
+
+int kedr_coi_tasks_report_pids(struct kedr_coi_tasks* tasks,
+    struct seq_file* m,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data)
+{
+    struct kedr_coi_stat_entry* entries;
+    int n;
+    u64 lost;
+    int i;
+
+    entries = kedr_coi_stat_table_collect(tasks->pids, &n, &lost);
+    if(entries == NULL) return -ENOMEM;
+
+    seq_printf(m, "# entries: %d, lost calls: %llu\n",
+        n, (unsigned long long)lost);
+    seq_printf(m, "# calls\ttime_ns\tself_ns\toperation\tpid\tcomm\n");
+
+    for(i = 0; (i < n) && (i < tasks_report_size); i++)
+    {
+        struct task_struct* task;
+        char comm[TASK_COMM_LEN] = "-";
+
+        // Task may already exit.
+        rcu_read_lock();
+        task = pid_task(find_pid_ns(entries[i].key, &init_pid_ns),
+            PIDTYPE_PID);
+        if(task) get_task_comm(comm, task);
+        rcu_read_unlock();
+
+        report_entry(tasks, m, &entries[i], operation_name, data);
+        seq_printf(m, "%llu\t%s\n", (unsigned long long)entries[i].key,
+            comm);
+    }
+
+    vfree(entries);
+
+    return 0;
+}
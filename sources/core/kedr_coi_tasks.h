@@ -0,0 +1,60 @@
+#ifndef KEDR_COI_TASKS_H
+#define KEDR_COI_TASKS_H
+
+/*
+ * Aggregation of intercepted calls by the task which makes the call and
+ * by its cgroup.
+ *
+ * Statistic is stored in per-CPU tables (see kedr_coi_stat_table.h),
+ * so memory used is bounded: cold entries are evicted when there is no
+ * place for new ones.
+ */
+
+#include <linux/types.h>
+
+struct seq_file;
+
+struct kedr_coi_tasks;
+
+/*
+ * Create tables for all CPUs.
+ *
+ * If 'latency' is true, time of the calls is summed too.
+ */
+struct kedr_coi_tasks* kedr_coi_tasks_create(bool latency);
+
+void kedr_coi_tasks_destroy(struct kedr_coi_tasks* tasks);
+
+bool kedr_coi_tasks_latency(struct kedr_coi_tasks* tasks);
+
+/*
+ * Account call of the operation by the current task, which took 'time'
+ * nanoseconds, 'self_time' of them - not in nested calls.
+ *
+ * May be called in atomic context.
+ */
+void kedr_coi_tasks_account(struct kedr_coi_tasks* tasks,
+    size_t operation_offset,
+    u64 time,
+    u64 self_time);
+
+/*
+ * Print statistic for cgroups (of the default hierarchy) or for tasks,
+ * sorted by number of calls.
+ *
+ * 'operation_name' returns name of the operation or NULL if it is not
+ * known.
+ *
+ * Should be called in process context.
+ */
+int kedr_coi_tasks_report_cgroups(struct kedr_coi_tasks* tasks,
+    struct seq_file* m,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data);
+
+int kedr_coi_tasks_report_pids(struct kedr_coi_tasks* tasks,
+    struct seq_file* m,
+    const char* (*operation_name)(size_t operation_offset, void* data),
+    void* data);
+
+#endif /* KEDR_COI_TASKS_H */
@@ -1,6 +1,66 @@
 #include "payloads.h"
 
+#include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
+#include <linux/string.h> /* strcmp */
+#include <linux/percpu.h>
+#include <linux/sched.h> /* local_clock() */
+#include <linux/jiffies.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+#include <linux/timex.h> /* get_cycles() */
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val) (ACCESS_ONCE(x) = (val))
+#endif
+
+/*
+ * Watchdog for time spent in the handlers.
+ *
+ * Time of the handlers is measured for every 'handler_sample_period'-th
+ * intercepted call which has handlers. When handlers of the payload
+ * exceed the budget, the payload is throttled: its handlers are called
+ * only for every 'handler_throttle_period'-th call. If throttled payload
+ * exceeds the budget again, it is disabled.
+ */
+static unsigned int handler_sample_period = 64;
+module_param(handler_sample_period, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(handler_sample_period,
+    "Measure time of the handlers for every N-th call, 0 - never");
+
+static unsigned long handler_budget_ns = 0;
+module_param(handler_budget_ns, ulong, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(handler_budget_ns,
+    "Maximum time of one call of the handler in nanoseconds, 0 - unlimited");
+
+static unsigned int handler_budget_per_sec_ms = 0;
+module_param(handler_budget_per_sec_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(handler_budget_per_sec_ms,
+    "Maximum time spent in the handlers of the payload per second, "
+    "in milliseconds, 0 - unlimited");
+
+enum budget_action
+{
+    budget_action_log = 0,
+    budget_action_throttle,
+    budget_action_disable,
+};
+
+static unsigned int handler_budget_action = budget_action_throttle;
+module_param(handler_budget_action, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(handler_budget_action,
+    "Action when handlers exceed the budget: 0 - only report, "
+    "1 - throttle the payload, 2 - disable the payload");
+
+static unsigned int handler_throttle_period = 16;
+module_param(handler_throttle_period, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(handler_throttle_period,
+    "Handlers of throttled payload are called for every N-th call only");
+
+static DEFINE_PER_CPU(unsigned int, measure_count);
+static DEFINE_PER_CPU(unsigned int, throttle_count);
 
 /*
  * Array of pointers which is allowed to grow.
@@ -56,6 +116,161 @@ static int parray_add_elem(struct parray* array, void* elem)
     return 0;
 }
 
+/* Whether arrays contain the same elements. */
+static bool parray_equal(const struct parray* array1,
+    const struct parray* array2)
+{
+    if(array1->n_elems != array2->n_elems) return false;
+    if(array1->n_elems == 0) return true;
+
+    return !memcmp(array1->elems, array2->elems,
+        sizeof(*array1->elems) * array1->n_elems);
+}
+
+
+/* Statistic about handlers of one payload for one operation. */
+struct handler_stat_cpu
+{
+    // Number of measured calls of the handlers.
+    u64 calls;
+    // Summary and maximum time of the measured calls, in nanoseconds.
+    u64 time;
+    u64 max_time;
+    /*
+     * Calls of pre- and post- handlers and cycles spent in them, only
+     * while cost accounting is enabled.
+     */
+    u64 pre_calls;
+    u64 pre_cycles;
+    u64 post_calls;
+    u64 post_cycles;
+};
+
+struct handler_stat
+{
+    // Element in the list of payload's statistics.
+    struct list_head list;
+
+    struct payload_elem* elem;
+    struct operation_info* operation;
+
+    struct handler_stat_cpu __percpu* cpu;
+};
+
+/*
+ * Set of pre- and post- handlers of the operation.
+ *
+ * Every handler has corresponding statistic (in the same position).
+ */
+struct handlers_set
+{
+    struct parray pre;
+    struct parray post;
+
+    struct parray pre_stats;
+    struct parray post_stats;
+    // Element in the list of retired sets.
+    struct list_head list;
+};
+
+static void handlers_set_init(struct handlers_set* set)
+{
+    parray_init(&set->pre);
+    parray_init(&set->post);
+    parray_init(&set->pre_stats);
+    parray_init(&set->post_stats);
+    INIT_LIST_HEAD(&set->list);
+}
+
+static void handlers_set_reset(struct handlers_set* set)
+{
+    parray_reset(&set->pre);
+    parray_reset(&set->post);
+    parray_reset(&set->pre_stats);
+    parray_reset(&set->post_stats);
+}
+
+static int handlers_set_add_pre(struct handlers_set* set,
+    void* pre, struct handler_stat* stat)
+{
+    int result = parray_add_elem(&set->pre, pre);
+    if(result) return result;
+
+    return parray_add_elem(&set->pre_stats, stat);
+}
+
+static int handlers_set_add_post(struct handlers_set* set,
+    void* post, struct handler_stat* stat)
+{
+    int result = parray_add_elem(&set->post, post);
+    if(result) return result;
+
+    return parray_add_elem(&set->post_stats, stat);
+}
+
+static inline bool handlers_set_is_empty(const struct handlers_set* set)
+{
+    return (set->pre.n_elems == 0) && (set->post.n_elems == 0);
+}
+
+static bool handlers_set_equal(const struct handlers_set* set1,
+    const struct handlers_set* set2)
+{
+    return parray_equal(&set1->pre, &set2->pre)
+        && parray_equal(&set1->post, &set2->post)
+        && parray_equal(&set1->pre_stats, &set2->pre_stats)
+        && parray_equal(&set1->post_stats, &set2->post_stats);
+}
+
+/*
+ * Return set with handlers from 'src', payloads of which have state not
+ * greater than 'max_state'.
+ *
+ * If all handlers are taken, return 'src' itself. On error return NULL.
+ */
+static struct handlers_set* handlers_set_create_filtered(
+    struct handlers_set* src, int max_state)
+{
+    struct handlers_set* set;
+    int i;
+
+    set = kmalloc(sizeof(*set), GFP_KERNEL);
+    if(set == NULL) return NULL;
+
+    handlers_set_init(set);
+
+    for(i = 0; i < src->pre.n_elems; i++)
+    {
+        struct handler_stat* stat = src->pre_stats.elems[i];
+
+        if(atomic_read(&stat->elem->state) > max_state) continue;
+        if(handlers_set_add_pre(set, src->pre.elems[i], stat)) goto err;
+    }
+
+    for(i = 0; i < src->post.n_elems; i++)
+    {
+        struct handler_stat* stat = src->post_stats.elems[i];
+
+        if(atomic_read(&stat->elem->state) > max_state) continue;
+        if(handlers_set_add_post(set, src->post.elems[i], stat)) goto err;
+    }
+
+    if((set->pre.n_elems == src->pre.n_elems)
+        && (set->post.n_elems == src->post.n_elems))
+    {
+        // Nothing is filtered.
+        handlers_set_reset(set);
+        kfree(set);
+        return src;
+    }
+
+    return set;
+
+err:
+    handlers_set_reset(set);
+    kfree(set);
+    return NULL;
+}
 
 /*
  *  Information about operation, which may be intercepted.
@@ -66,33 +281,113 @@ struct operation_info
     struct list_head list;
     
     size_t operation_offset;
+    // Name of the operation, may be NULL.
+    const char* name;
     
     void* repl;
     int group_id;
     bool internal_only;
     // Whether operation should be intercepted
     bool is_intercepted;
-    // Arrays of pre- and post- handlers
-    struct parray pre_handlers;
-    struct parray post_handlers;
+    // Pre- and post- handlers
+    struct handlers_set handlers;
 
     // Same for the case when original operation pointer is NULL
     bool default_is_intercepted;
-    struct parray default_pre_handlers;
-    struct parray default_post_handlers;
-};
+    struct handlers_set default_handlers;
 
+    /*
+     * Sets which are used for interception, indexed by 'is_default'.
+     *
+     * 'allowed' excludes handlers of disabled payloads, 'reduced'
+     * excludes handlers of throttled payloads too. While all payloads
+     * are in normal state, both point to the sets above.
+     */
+    struct handlers_set* allowed[2];
+    struct handlers_set* reduced[2];
+};
 
+static inline struct handlers_set* operation_info_full_set(
+    struct operation_info* operation, int is_default)
+{
+    return is_default ? &operation->default_handlers : &operation->handlers;
+}
 
 // Initialize payload element structure
 static void payload_elem_init(
     struct payload_elem* elem,
-    struct kedr_coi_payload* payload)
+    struct kedr_coi_payload* payload,
+    struct operation_payloads* payloads)
 {
     elem->payload = payload;
     INIT_LIST_HEAD(&elem->list);
     elem->is_fixed = 0;
     INIT_LIST_HEAD(&elem->list_used);
+
+    elem->payloads = payloads;
+    atomic_set(&elem->state, payload_state_normal);
+    atomic_set(&elem->violations, 0);
+    INIT_LIST_HEAD(&elem->handler_stats);
+    atomic64_set(&elem->window_time, 0);
+    elem->window_start = jiffies;
+}
+
+/*
+ * Name of the payload for reports: name of its module or its address.
+ *
+ * 'buf' should have at least MODULE_NAME_LEN bytes.
+ */
+static const char* payload_elem_name(struct payload_elem* elem, char* buf)
+{
+    if(elem->payload->mod != NULL)
+        return module_name(elem->payload->mod);
+
+    snprintf(buf, MODULE_NAME_LEN, "%p", elem->payload);
+    return buf;
+}
+
+/*
+ * Return statistic for handlers of the payload for the operation,
+ * create it if needed.
+ */
+static struct handler_stat* payload_elem_get_stat(
+    struct payload_elem* elem, struct operation_info* operation)
+{
+    struct handler_stat* stat;
+
+    list_for_each_entry(stat, &elem->handler_stats, list)
+    {
+        if(stat->operation == operation) return stat;
+    }
+
+    stat = kmalloc(sizeof(*stat), GFP_KERNEL);
+    if(stat == NULL) return NULL;
+
+    stat->cpu = alloc_percpu(struct handler_stat_cpu);
+    if(stat->cpu == NULL)
+    {
+        kfree(stat);
+        return NULL;
+    }
+
+    stat->elem = elem;
+    stat->operation = operation;
+    list_add_tail(&stat->list, &elem->handler_stats);
+
+    return stat;
+}
+
+static void payload_elem_free_stats(struct payload_elem* elem)
+{
+    while(!list_empty(&elem->handler_stats))
+    {
+        struct handler_stat* stat = list_first_entry(&elem->handler_stats,
+            struct handler_stat, list);
+
+        list_del(&stat->list);
+        free_percpu(stat->cpu);
+        kfree(stat);
+    }
 }
 
 
@@ -103,18 +398,21 @@ static void operation_info_init(struct operation_info* operation,
     INIT_LIST_HEAD(&operation->list);
 
     operation->operation_offset = intermediate->operation_offset;
+    operation->name = intermediate->name;
 
     operation->repl = intermediate->repl;
     operation->group_id = intermediate->group_id;
     operation->internal_only = intermediate->internal_only;
 
     operation->is_intercepted = false;
-    parray_init(&operation->pre_handlers);
-    parray_init(&operation->post_handlers);
+    handlers_set_init(&operation->handlers);
 
     operation->default_is_intercepted = false;
-    parray_init(&operation->default_pre_handlers);
-    parray_init(&operation->default_post_handlers);
+    handlers_set_init(&operation->default_handlers);
+
+    operation->allowed[0] = operation->reduced[0] = &operation->handlers;
+    operation->allowed[1] = operation->reduced[1] =
+        &operation->default_handlers;
 }
 
 /* 
@@ -128,17 +426,20 @@ operation_info_clear_interception(struct operation_info* operation)
     {
         operation->is_intercepted = false;
 
-        parray_reset(&operation->pre_handlers);
-        parray_reset(&operation->post_handlers);
+        handlers_set_reset(&operation->handlers);
     }
 
     if(operation->default_is_intercepted)
     {
         operation->default_is_intercepted = false;
 
-        parray_reset(&operation->default_pre_handlers);
-        parray_reset(&operation->default_post_handlers);
+        handlers_set_reset(&operation->default_handlers);
     }
+
+    // Filtered sets should be retired before.
+    operation->allowed[0] = operation->reduced[0] = &operation->handlers;
+    operation->allowed[1] = operation->reduced[1] =
+        &operation->default_handlers;
 }
 
 /*
@@ -148,9 +449,9 @@ operation_info_clear_interception(struct operation_info* operation)
  */
 static int
 operation_info_add_pre(struct operation_info* operation,
-    void* pre, bool external)
+    void* pre, bool external, struct handler_stat* stat)
 {
-    int result = parray_add_elem(&operation->pre_handlers, pre);
+    int result = handlers_set_add_pre(&operation->handlers, pre, stat);
     if(result)
     {
         pr_err("Failed to add pre handler for operation.");
@@ -161,7 +462,8 @@ operation_info_add_pre(struct operation_info* operation,
     
     if(external)
     {
-        result = parray_add_elem(&operation->default_pre_handlers, pre);
+        result = handlers_set_add_pre(&operation->default_handlers,
+            pre, stat);
         if(result)
         {
             pr_err("Failed to add default pre handler for operation.");
@@ -181,9 +483,9 @@ operation_info_add_pre(struct operation_info* operation,
  */
 static int
 operation_info_add_post(struct operation_info* operation,
-    void* post, bool external)
+    void* post, bool external, struct handler_stat* stat)
 {
-    int result = parray_add_elem(&operation->post_handlers, post);
+    int result = handlers_set_add_post(&operation->handlers, post, stat);
     
     if(result)
     {
@@ -195,7 +497,8 @@ operation_info_add_post(struct operation_info* operation,
 
     if(external)
     {
-        result = parray_add_elem(&operation->default_post_handlers, post);
+        result = handlers_set_add_post(&operation->default_handlers,
+            post, stat);
         
         if(result)
         {
@@ -210,6 +513,354 @@ operation_info_add_post(struct operation_info* operation,
 
 
 
+//**************************** Watchdog *********************************//
+/*
+ * Move set, which is no longer published, into the list of retired sets.
+ *
+ * Intermediate uses the set during the whole call of the original
+ * operation, which may sleep, so there is no moment when retired set is
+ * known to be unused until the payloads become unused. Instead, retired
+ * sets are published again when the same handlers are needed (see
+ * operation_payloads_reuse_set()), so the number of sets is bounded by
+ * the number of different combinations of payloads states.
+ */
+static void operation_payloads_retire_set(
+    struct operation_payloads* payloads,
+    struct operation_info* operation,
+    struct handlers_set* set)
+{
+    if((set == &operation->handlers) || (set == &operation->default_handlers))
+        return;
+
+    list_add_tail(&set->list, &payloads->retired_sets);
+}
+
+/*
+ * Return set with the same handlers as the just created 'set', which is
+ * either one of the sets currently published ('published1' and
+ * 'published2') or retired one. In that case 'set' is freed. If there is
+ * no such set, return 'set' itself.
+ *
+ * Retired set returned is removed from the list of retired sets.
+ */
+static struct handlers_set* operation_payloads_reuse_set(
+    struct operation_payloads* payloads,
+    struct operation_info* operation,
+    struct handlers_set* set,
+    struct handlers_set* published1,
+    struct handlers_set* published2)
+{
+    struct handlers_set* set_old;
+
+    if((set == &operation->handlers) || (set == &operation->default_handlers))
+        return set;
+
+    if(handlers_set_equal(set, published1))
+        set_old = published1;
+    else if(handlers_set_equal(set, published2))
+        set_old = published2;
+    else
+    {
+        list_for_each_entry(set_old, &payloads->retired_sets, list)
+        {
+            if(handlers_set_equal(set, set_old)) break;
+        }
+        if(&set_old->list == &payloads->retired_sets) return set;
+
+        list_del_init(&set_old->list);
+    }
+
+    handlers_set_reset(set);
+    kfree(set);
+
+    return set_old;
+}
+
+static void operation_payloads_free_retired(
+    struct operation_payloads* payloads)
+{
+    while(!list_empty(&payloads->retired_sets))
+    {
+        struct handlers_set* set = list_first_entry(&payloads->retired_sets,
+            struct handlers_set, list);
+
+        list_del(&set->list);
+        handlers_set_reset(set);
+        kfree(set);
+    }
+}
+
+/*
+ * Recalculate sets of handlers used for interception of the operation
+ * according to the current states of the payloads.
+ *
+ * Should be called with mutex locked.
+ */
+static void operation_payloads_rebuild_operation(
+    struct operation_payloads* payloads,
+    struct operation_info* operation)
+{
+    int is_default;
+
+    for(is_default = 0; is_default < 2; is_default++)
+    {
+        struct handlers_set* full = operation_info_full_set(operation,
+            is_default);
+        struct handlers_set* allowed;
+        struct handlers_set* reduced;
+        struct handlers_set* allowed_old = operation->allowed[is_default];
+        struct handlers_set* reduced_old = operation->reduced[is_default];
+
+        allowed = handlers_set_create_filtered(full, payload_state_throttled);
+        if(allowed == NULL) goto err;
+
+        reduced = handlers_set_create_filtered(allowed, payload_state_normal);
+        if(reduced == NULL)
+        {
+            if(allowed != full)
+            {
+                handlers_set_reset(allowed);
+                kfree(allowed);
+            }
+            goto err;
+        }
+
+        // Sets with the same handlers may already exist.
+        if(reduced != allowed)
+        {
+            reduced = operation_payloads_reuse_set(payloads, operation,
+                reduced, reduced_old, allowed_old);
+            allowed = operation_payloads_reuse_set(payloads, operation,
+                allowed, allowed_old, reduced_old);
+        }
+        else
+        {
+            allowed = operation_payloads_reuse_set(payloads, operation,
+                allowed, allowed_old, reduced_old);
+            reduced = allowed;
+        }
+
+        // Content of the sets should be visible before the pointers.
+        smp_wmb();
+        WRITE_ONCE(operation->allowed[is_default], allowed);
+        WRITE_ONCE(operation->reduced[is_default], reduced);
+
+        // Intermediates may still use old sets.
+        if((allowed_old != allowed) && (allowed_old != reduced))
+            operation_payloads_retire_set(payloads, operation, allowed_old);
+        if((reduced_old != allowed_old) && (reduced_old != allowed)
+            && (reduced_old != reduced))
+            operation_payloads_retire_set(payloads, operation, reduced_old);
+        continue;
+err:
+        pr_err("Failed to change handlers of operation '%s' for interceptor '%s'.",
+            operation->name ? operation->name : "<unknown>",
+            payloads->interceptor_name);
+    }
+}
+
+static void operation_payloads_rebuild(struct operation_payloads* payloads)
+{
+    struct operation_info* operation;
+
+    list_for_each_entry(operation, &payloads->operations, list)
+    {
+        operation_payloads_rebuild_operation(payloads, operation);
+    }
+}
+
+static void operation_payloads_rebuild_work(struct work_struct* work)
+{
+    struct operation_payloads* payloads = container_of(work,
+        struct operation_payloads, rebuild_work);
+
+    mutex_lock(&payloads->m);
+    if(payloads->is_used)
+        operation_payloads_rebuild(payloads);
+    mutex_unlock(&payloads->m);
+}
+
+static const char* payload_state_names[] =
+{
+    [payload_state_normal] = "normal",
+    [payload_state_throttled] = "throttled",
+    [payload_state_disabled] = "disabled",
+};
+
+static void payload_elem_reset_window(struct payload_elem* elem)
+{
+    WRITE_ONCE(elem->window_start, jiffies);
+    atomic64_set(&elem->window_time, 0);
+}
+
+/*
+ * Process exceeding of time budget by the handlers of the payload.
+ *
+ * 'what' describes the budget, 'time' is the time which exceeds it.
+ */
+static void payload_elem_violate(struct payload_elem* elem,
+    const char* what, u64 time)
+{
+    char buf[MODULE_NAME_LEN];
+    int state = atomic_read(&elem->state);
+    int state_new;
+
+    if(atomic_inc_return(&elem->violations) == 1)
+        pr_warn("Handlers of payload %s for interceptor '%s' exceed "
+            "time budget: %s is %llu ns.",
+            payload_elem_name(elem, buf), elem->payloads->interceptor_name,
+            what, (unsigned long long)time);
+
+    if(handler_budget_action == budget_action_log) return;
+    if(state == payload_state_disabled) return;
+
+    state_new = ((handler_budget_action == budget_action_disable)
+        || (state == payload_state_throttled))
+        ? payload_state_disabled : payload_state_throttled;
+
+    // State may be changed concurrently, e.g. on another CPU.
+    if(atomic_cmpxchg(&elem->state, state, state_new) != state) return;
+
+    pr_warn("Handlers of payload %s for interceptor '%s' are %s.",
+        payload_elem_name(elem, buf), elem->payloads->interceptor_name,
+        payload_state_names[state_new]);
+
+    payload_elem_reset_window(elem);
+    schedule_work(&elem->payloads->rebuild_work);
+}
+
+/*
+ * 'weight' is number of calls which are represented by the measured one.
+ */
+static void payload_elem_check_budget(struct payload_elem* elem, u64 time,
+    unsigned int weight)
+{
+    if(handler_budget_ns && (time > handler_budget_ns))
+        payload_elem_violate(elem, "time of the call", time);
+
+    if(handler_budget_per_sec_ms)
+    {
+        unsigned long start = READ_ONCE(elem->window_start);
+        u64 window_time;
+
+        if(time_after_eq(jiffies, start + HZ)
+            && (cmpxchg(&elem->window_start, start, jiffies) == start))
+            atomic64_set(&elem->window_time, 0);
+
+        window_time = atomic64_add_return(time * weight,
+            &elem->window_time);
+        if(window_time > (u64)handler_budget_per_sec_ms * NSEC_PER_MSEC)
+            payload_elem_violate(elem, "estimated time per second",
+                window_time);
+    }
+}
+
+static void handler_stat_account(struct handler_stat* stat, u64 time,
+    bool is_pre, u64 cycles, bool cost)
+{
+    struct handler_stat_cpu* stat_cpu;
+    unsigned long flags;
+
+    // Protect from interrupts on the same CPU.
+    local_irq_save(flags);
+    stat_cpu = this_cpu_ptr(stat->cpu);
+    stat_cpu->calls++;
+    stat_cpu->time += time;
+    if(time > stat_cpu->max_time) stat_cpu->max_time = time;
+    if(cost && is_pre)
+    {
+        stat_cpu->pre_calls++;
+        stat_cpu->pre_cycles += cycles;
+    }
+    else if(cost)
+    {
+        stat_cpu->post_calls++;
+        stat_cpu->post_cycles += cycles;
+    }
+    local_irq_restore(flags);
+}
+
+void kedr_coi_handler_start(void* measure,
+    struct kedr_coi_handler_timestamp* start)
+{
+    start->time = local_clock();
+    start->cycles = get_cycles();
+}
+
+void kedr_coi_handler_stop(void* measure, void* const* handler,
+    const struct kedr_coi_handler_timestamp* start)
+{
+    u64 cycles = get_cycles() - start->cycles;
+    u64 time = local_clock() - start->time;
+    struct handlers_set* set = measure;
+    struct handler_stat* stat;
+    void* const* pre = (void* const*)set->pre.elems;
+    void* const* post = (void* const*)set->post.elems;
+    bool is_pre;
+    bool cost;
+
+    if(pre && (handler >= pre) && (handler < pre + set->pre.n_elems))
+    {
+        stat = set->pre_stats.elems[handler - pre];
+        is_pre = true;
+    }
+    else if(post && (handler >= post) && (handler < post + set->post.n_elems))
+    {
+        stat = set->post_stats.elems[handler - post];
+        is_pre = false;
+    }
+    else
+        return;
+
+    cost = READ_ONCE(stat->elem->payloads->cost_accounting);
+
+    handler_stat_account(stat, time, is_pre, cycles, cost);
+    /*
+     * Without cost accounting only one of 'handler_sample_period' calls
+     * is measured.
+     */
+    payload_elem_check_budget(stat->elem, time,
+        cost ? 1 : handler_sample_period);
+}
+
+/* Sum statistic over all CPUs. */
+static void handler_stat_collect(struct handler_stat* stat,
+    struct handler_stat_cpu* total)
+{
+    int cpu;
+
+    memset(total, 0, sizeof(*total));
+
+    for_each_possible_cpu(cpu)
+    {
+        struct handler_stat_cpu* stat_cpu = per_cpu_ptr(stat->cpu, cpu);
+
+        total->calls += READ_ONCE(stat_cpu->calls);
+        total->time += READ_ONCE(stat_cpu->time);
+        total->max_time = max_t(u64, total->max_time,
+            READ_ONCE(stat_cpu->max_time));
+        total->pre_calls += READ_ONCE(stat_cpu->pre_calls);
+        total->pre_cycles += READ_ONCE(stat_cpu->pre_cycles);
+        total->post_calls += READ_ONCE(stat_cpu->post_calls);
+        total->post_cycles += READ_ONCE(stat_cpu->post_cycles);
+    }
+}
+
+static void handler_stat_reset_cost(struct handler_stat* stat)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+    {
+        struct handler_stat_cpu* stat_cpu = per_cpu_ptr(stat->cpu, cpu);
+
+        WRITE_ONCE(stat_cpu->pre_calls, 0);
+        WRITE_ONCE(stat_cpu->pre_cycles, 0);
+        WRITE_ONCE(stat_cpu->post_calls, 0);
+        WRITE_ONCE(stat_cpu->post_cycles, 0);
+    }
+}
+
 /*
  * Return information about operation with given offset.
  * 
@@ -264,6 +915,11 @@ int operation_payloads_init(struct operation_payloads* payloads,
     
     payloads->is_used = 0;
 
+    INIT_LIST_HEAD(&payloads->retired_sets);
+    INIT_WORK(&payloads->rebuild_work, operation_payloads_rebuild_work);
+
+    payloads->cost_accounting = false;
+
     return 0;
 
 err_operation:
@@ -292,6 +948,11 @@ static int operation_payloads_fix_elem(
     
     list_add_tail(&elem->list_used, &payloads->payload_elems_used);
 
+    // Every use starts with the handlers enabled.
+    atomic_set(&elem->state, payload_state_normal);
+    atomic_set(&elem->violations, 0);
+    payload_elem_reset_window(elem);
+
     return 0;
 }
 
@@ -304,6 +965,8 @@ static void operation_payloads_release_elem(
 {
     (void)payloads;
     
+    payload_elem_free_stats(elem);
+
     if(elem->payload->mod != NULL)
         module_put(elem->payload->mod);
     
@@ -466,13 +1129,17 @@ static int operation_payloads_use_elem(
             pre_handler++)
         {
             int result;
+            struct handler_stat* stat;
             struct operation_info* operation = operation_payloads_find_operation(
                 payloads, pre_handler->operation_offset);
 
             BUG_ON(operation == NULL);//payloads should be checked when registered
-            
+
+            stat = payload_elem_get_stat(elem, operation);
+            if(stat == NULL) return -ENOMEM;
+
             result = operation_info_add_pre(operation,
-                pre_handler->func, pre_handler->external);
+                pre_handler->func, pre_handler->external, stat);
             if(result) return result;
         }
     }
@@ -485,13 +1152,17 @@ static int operation_payloads_use_elem(
             post_handler++)
         {
             int result;
+            struct handler_stat* stat;
             struct operation_info* operation = operation_payloads_find_operation(
                 payloads, post_handler->operation_offset);
 
             BUG_ON(operation == NULL);//payloads should be checked when registered
 
+            stat = payload_elem_get_stat(elem, operation);
+            if(stat == NULL) return -ENOMEM;
+
             result = operation_info_add_post(operation,
-                post_handler->func, post_handler->external);
+                post_handler->func, post_handler->external, stat);
             if(result) return result;
         }
     }
@@ -508,6 +1179,19 @@ static void operation_payloads_unuse_all(
     struct operation_info* operation;
     list_for_each_entry(operation, &payloads->operations, list)
     {
+        int is_default;
+
+        // Filtered sets are freed with retired ones.
+        for(is_default = 0; is_default < 2; is_default++)
+        {
+            struct handlers_set* allowed = operation->allowed[is_default];
+            struct handlers_set* reduced = operation->reduced[is_default];
+
+            if(reduced != allowed)
+                operation_payloads_retire_set(payloads, operation, reduced);
+            operation_payloads_retire_set(payloads, operation, allowed);
+        }
+
         operation_info_clear_interception(operation);
     }
 }
@@ -659,9 +1343,14 @@ void operation_payloads_unuse(struct operation_payloads* payloads)
     
     operation_payloads_unuse_all(payloads);
     
+    operation_payloads_free_retired(payloads);
+
     operation_payloads_release_all(payloads);
     
     mutex_unlock(&payloads->m);
+
+    // Rebuilding is no-op when payloads are not used, just wait it.
+    cancel_work_sync(&payloads->rebuild_work);
 }
 
 int operation_payloads_add(
@@ -681,7 +1370,7 @@ int operation_payloads_add(
         return -ENOMEM;
     }
 
-    payload_elem_init(elem, payload);
+    payload_elem_init(elem, payload, payloads);
     
     result = mutex_lock_killable(&payloads->m);
     if(result)
@@ -761,6 +1450,8 @@ void operation_payloads_destroy(
 {
     BUG_ON(payloads->is_used);
 
+    cancel_work_sync(&payloads->rebuild_work);
+
     /*
      * Unregister all payloads which wasn't unregistered before this
      * moment.
@@ -788,9 +1479,13 @@ void operation_payloads_destroy(
 
 void operation_payloads_get_interception_info(
     struct operation_payloads* payloads, size_t operation_offset,
-    int is_default, void* const** pre_p, void* const** post_p)
+    int is_default, void* const** pre_p, void* const** post_p,
+    void** measure_p)
 {
     struct operation_info* operation;
+    struct handlers_set* set;
+    struct handlers_set* allowed;
+    unsigned int period;
     
     BUG_ON(payloads->is_used == 0);
     
@@ -798,12 +1493,27 @@ void operation_payloads_get_interception_info(
     
     BUG_ON(operation == NULL);
     
-    *pre_p = is_default
-        ? operation->default_pre_handlers.elems
-        : operation->pre_handlers.elems;
-    *post_p = is_default
-        ? operation->default_post_handlers.elems
-        : operation->post_handlers.elems;
+    is_default = is_default ? 1 : 0;
+    set = READ_ONCE(operation->reduced[is_default]);
+    allowed = READ_ONCE(operation->allowed[is_default]);
+
+    // Handlers of throttled payloads are called only for some calls.
+    period = READ_ONCE(handler_throttle_period);
+    if((set != allowed) && ((period <= 1)
+        || (this_cpu_inc_return(throttle_count) % period == 0)))
+        set = allowed;
+
+    *pre_p = (void* const*)set->pre.elems;
+    *post_p = (void* const*)set->post.elems;
+
+    *measure_p = NULL;
+    if(handlers_set_is_empty(set)) return;
+
+    period = READ_ONCE(handler_sample_period);
+    if(READ_ONCE(payloads->cost_accounting))
+        *measure_p = set;
+    else if(period && (this_cpu_inc_return(measure_count) % period == 0))
+        *measure_p = set;
 }
 
 const struct kedr_coi_replacement* operation_payloads_get_replacements(
@@ -813,3 +1523,205 @@ const struct kedr_coi_replacement* operation_payloads_get_replacements(
     
     return payloads->replacements;
 }
+
+bool operation_payloads_has_operation(struct operation_payloads* payloads,
+    size_t operation_offset)
+{
+    return operation_payloads_find_operation(payloads, operation_offset)
+        != NULL;
+}
+
+size_t operation_payloads_find_operation_by_name(
+    struct operation_payloads* payloads, const char* name)
+{
+    struct operation_info* operation;
+    
+    list_for_each_entry(operation, &payloads->operations, list)
+    {
+        if(operation->name && !strcmp(operation->name, name))
+            return operation->operation_offset;
+    }
+    
+    return -1;
+}
+
+const char* operation_payloads_get_operation_name(
+    struct operation_payloads* payloads, size_t operation_offset)
+{
+    struct operation_info* operation =
+        operation_payloads_find_operation(payloads, operation_offset);
+    
+    return operation ? operation->name : NULL;
+}
+
+void operation_payloads_for_each_operation(
+    struct operation_payloads* payloads,
+    void (*cb)(size_t operation_offset, const char* name, void* data),
+    void* data)
+{
+    struct operation_info* operation;
+    
+    list_for_each_entry(operation, &payloads->operations, list)
+    {
+        cb(operation->operation_offset, operation->name, data);
+    }
+}
+
+void operation_payloads_report(struct operation_payloads* payloads,
+    struct seq_file* m)
+{
+    struct payload_elem* elem;
+    char buf[MODULE_NAME_LEN];
+
+    mutex_lock(&payloads->m);
+
+    if(!payloads->is_used)
+    {
+        seq_puts(m, "# Payloads are not used now.\n");
+        goto out;
+    }
+
+    if(payloads->cost_accounting)
+        seq_puts(m, "# handlers are measured for every call\n");
+    else
+        seq_printf(m, "# handlers are measured for 1 of %u calls\n",
+            handler_sample_period);
+    seq_puts(m, "# payload\tstate\tviolations\n");
+    seq_puts(m, "#\toperation\tmeasured_calls\tavg_ns\tmax_ns\n");
+
+    list_for_each_entry(elem, &payloads->payload_elems_used, list_used)
+    {
+        struct handler_stat* stat;
+
+        seq_printf(m, "%s\t%s\t%d\n", payload_elem_name(elem, buf),
+            payload_state_names[atomic_read(&elem->state)],
+            atomic_read(&elem->violations));
+
+        list_for_each_entry(stat, &elem->handler_stats, list)
+        {
+            struct handler_stat_cpu total;
+
+            handler_stat_collect(stat, &total);
+
+            if(stat->operation->name)
+                seq_printf(m, "\t%s", stat->operation->name);
+            else
+                seq_printf(m, "\t%zu", stat->operation->operation_offset);
+
+            seq_printf(m, "\t%llu\t%llu\t%llu\n",
+                (unsigned long long)total.calls,
+                (unsigned long long)(total.calls
+                    ? div64_u64(total.time, total.calls) : 0),
+                (unsigned long long)total.max_time);
+        }
+    }
+
+out:
+    mutex_unlock(&payloads->m);
+}
+
+int operation_payloads_set_state(struct operation_payloads* payloads,
+    const char* name, enum payload_state state)
+{
+    struct payload_elem* elem;
+    char buf[MODULE_NAME_LEN];
+    int result;
+
+    result = mutex_lock_killable(&payloads->m);
+    if(result) return result;
+
+    result = -ENOENT;
+    if(!payloads->is_used) goto out;
+
+    list_for_each_entry(elem, &payloads->payload_elems_used, list_used)
+    {
+        if(strcmp(payload_elem_name(elem, buf), name)) continue;
+
+        atomic_set(&elem->state, state);
+        payload_elem_reset_window(elem);
+        operation_payloads_rebuild(payloads);
+
+        result = 0;
+        break;
+    }
+
+out:
+    mutex_unlock(&payloads->m);
+
+    return result;
+}
+
+bool operation_payloads_get_cost_accounting(
+    struct operation_payloads* payloads)
+{
+    return READ_ONCE(payloads->cost_accounting);
+}
+
+void operation_payloads_set_cost_accounting(
+    struct operation_payloads* payloads, bool enable)
+{
+    struct payload_elem* elem;
+    struct handler_stat* stat;
+
+    mutex_lock(&payloads->m);
+
+    if(payloads->is_used)
+    {
+        list_for_each_entry(elem, &payloads->payload_elems_used, list_used)
+        {
+            list_for_each_entry(stat, &elem->handler_stats, list)
+            {
+                handler_stat_reset_cost(stat);
+            }
+        }
+    }
+
+    WRITE_ONCE(payloads->cost_accounting, enable);
+
+    mutex_unlock(&payloads->m);
+}
+
+void operation_payloads_report_cost(struct operation_payloads* payloads,
+    struct seq_file* m)
+{
+    struct payload_elem* elem;
+    char buf[MODULE_NAME_LEN];
+
+    mutex_lock(&payloads->m);
+
+    if(!payloads->cost_accounting)
+        seq_puts(m, "# Cost of the handlers is not accounted now.\n");
+
+    if(!payloads->is_used) goto out;
+
+    seq_puts(m, "# payload\toperation\tpre_calls\tpre_cycles"
+        "\tpost_calls\tpost_cycles\n");
+
+    list_for_each_entry(elem, &payloads->payload_elems_used, list_used)
+    {
+        const char* name = payload_elem_name(elem, buf);
+        struct handler_stat* stat;
+
+        list_for_each_entry(stat, &elem->handler_stats, list)
+        {
+            struct handler_stat_cpu total;
+
+            handler_stat_collect(stat, &total);
+
+            seq_printf(m, "%s\t", name);
+            if(stat->operation->name)
+                seq_printf(m, "%s", stat->operation->name);
+            else
+                seq_printf(m, "%zu", stat->operation->operation_offset);
+
+            seq_printf(m, "\t%llu\t%llu\t%llu\t%llu\n",
+                (unsigned long long)total.pre_calls,
+                (unsigned long long)total.pre_cycles,
+                (unsigned long long)total.post_calls,
+                (unsigned long long)total.post_cycles);
+        }
+    }
+
+out:
+    mutex_unlock(&payloads->m);
+}
@@ -10,6 +10,24 @@
 #include "kedr_coi_instrumentor_internal.h"
 
 #include <linux/list.h>
+#include <linux/workqueue.h>
+
+struct seq_file;
+struct operation_payloads;
+
+/*
+ * State of the payload's handlers, set by the watchdog when handlers
+ * exceed time budget or by the user.
+ */
+enum payload_state
+{
+    // Handlers are called for every intercepted call.
+    payload_state_normal = 0,
+    // Handlers are called only for some intercepted calls.
+    payload_state_throttled,
+    // Handlers are not called.
+    payload_state_disabled,
+};
 
  /*
  * Element of the payload registration.
@@ -28,6 +46,21 @@ struct payload_elem
      * NOTE: This list is constant after fix payloads.
      */
     struct list_head list_used;
+
+    // Object which contains this element.
+    struct operation_payloads* payloads;
+    /*
+     * Fields below are used only while payload is used.
+     */
+    // One of payload_state values.
+    atomic_t state;
+    // Number of times the handlers have exceeded time budget.
+    atomic_t violations;
+    // Statistic about handlers of the payload, per operation.
+    struct list_head handler_stats;
+    // Estimated time spent in the handlers since 'window_start' (in ns).
+    atomic64_t window_time;
+    unsigned long window_start;
 };
 
 
@@ -58,6 +91,19 @@ struct operation_payloads
     struct list_head payload_elems_used;
     // Replacements collected from all used payloads
     struct kedr_coi_replacement* replacements;
+    /*
+     * Handler sets which are no longer published but may be used by
+     * intermediates. Reused when the same handlers are needed again,
+     * freed when payloads become unused.
+     */
+    struct list_head retired_sets;
+    // Rebuild handler sets after state of some payload has been changed.
+    struct work_struct rebuild_work;
+    /*
+     * Whether handlers are measured for every call and their calls and
+     * cycles are accounted.
+     */
+    bool cost_accounting;
 };
 
 /* Initialize object with operations payloads.*/
@@ -100,17 +146,91 @@ const struct kedr_coi_replacement* operation_payloads_get_replacements
  * 'is_default' flag should be 0 if need pre- and post- handlers when
  * original operation is NULL, non-zero otherwise.
  * 
+ * 'measure_p' is set to non-NULL if time of the handlers should be
+ * measured for this call, see kedr_coi_handler_stop().
+ *
  * May be called only after _use().
  */
 
 void operation_payloads_get_interception_info(
     struct operation_payloads* payloads, size_t operation_offset,
-    int is_default, void* const** pre_p, void* const** post_p);
+    int is_default, void* const** pre_p, void* const** post_p,
+    void** measure_p);
 
 /* 
  * Revert using of payloads. 
  */
 void operation_payloads_unuse(struct operation_payloads* payloads);
 
+/*
+ * Print state of the used payloads and time spent in their handlers.
+ *
+ * Payload is referred by name of its module.
+ */
+void operation_payloads_report(struct operation_payloads* payloads,
+    struct seq_file* m);
+
+/*
+ * Set state of the used payload, which is referred by name of its module.
+ *
+ * Return 0 on success, negative error code otherwise.
+ */
+int operation_payloads_set_state(struct operation_payloads* payloads,
+    const char* name, enum payload_state state);
+
+/*
+ * Enable or disable accounting of the handlers cost: number of calls of
+ * pre- and post- handlers of every payload for every operation and
+ * cycles spent in them.
+ *
+ * Every call resets the statistic. Accounting may be enabled at any
+ * time, but the statistic is collected only while payloads are used.
+ */
+void operation_payloads_set_cost_accounting(
+    struct operation_payloads* payloads, bool enable);
+
+bool operation_payloads_get_cost_accounting(
+    struct operation_payloads* payloads);
+
+/* Print cost of the handlers per payload and operation. */
+void operation_payloads_report_cost(struct operation_payloads* payloads,
+    struct seq_file* m);
+
+/*
+ * Functions below access only list of operations, which is constant
+ * after initialization. So they may be called at any time without
+ * locks and in atomic context.
+ */
+
+/* Return true if intermediate is provided for operation. */
+bool operation_payloads_has_operation(struct operation_payloads* payloads,
+    size_t operation_offset);
+
+/* 
+ * Return offset of the operation with given name.
+ * 
+ * If not found, return -1.
+ */
+size_t operation_payloads_find_operation_by_name(
+    struct operation_payloads* payloads, const char* name);
+
+/* 
+ * Return name of the operation with given offset.
+ * 
+ * If operation is not found or its name is not known, return NULL.
+ */
+const char* operation_payloads_get_operation_name(
+    struct operation_payloads* payloads, size_t operation_offset);
+
+/* 
+ * Call 'cb' for every operation for which intermediate is provided.
+ * 
+ * 'name' may be NULL if name of operation is not known.
+ */
+void operation_payloads_for_each_operation(
+    struct operation_payloads* payloads,
+    void (*cb)(size_t operation_offset, const char* name, void* data),
+    void* data);
+
 
 #endif /* KEDR_COI_PAYLOADS_H */
\ No newline at end of file
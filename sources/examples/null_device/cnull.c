@@ -0,0 +1,321 @@
+/* cnull.c - character device which operations do nothing except
+ * configurable amount of work. Used as a target for benchmarking
+ * interception of file operations.
+ *
+ * Derived from 'cfake' device (see examples/read_counter/cfake.c), which
+ * is taken from KEDR project (examples/sample_target/). Unlike 'cfake',
+ * operations have no data to copy and no lock, so with zero work the
+ * cost of the syscall consists of the kernel's one and the interception
+ * overhead.
+ *
+ * The module is annotated for interception of its file operations in
+ * the same way as 'cfake' is annotated for read counter.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2010-2011, Institute for System Programming
+ *                          of the Russian Academy of Sciences (ISPRAS)
+ * Authors:
+ *      Eugene A. Shatokhin <spectre@ispras.ru>
+ *      Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ ======================================================================== */
+
+#include <linux/version.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/init.h>
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/fs.h>
+#include <linux/errno.h>
+#include <linux/err.h>
+#include <linux/cdev.h>
+#include <linux/device.h>
+#include <linux/poll.h>
+#include <linux/delay.h>
+
+#include "cnull.h"
+
+// Use interception for this module
+#include "null_interception.h"
+
+MODULE_AUTHOR("Eugene A. Shatokhin");
+MODULE_LICENSE("GPL");
+
+#define CNULL_DEVICE_NAME "cnull"
+
+/* parameters */
+static int cnull_ndevices = CNULL_NDEVICES;
+/* Work done by every operation, in nanoseconds (busy wait). */
+static unsigned long op_delay_ns = 0;
+
+module_param(cnull_ndevices, int, S_IRUGO);
+module_param(op_delay_ns, ulong, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(op_delay_ns,
+    "Time of busy wait in every file operation, in nanoseconds");
+/* ================================================================ */
+
+static unsigned int cnull_major = 0;
+static struct cnull_dev *cnull_devices = NULL;
+static struct class *cnull_class = NULL;
+/* ================================================================ */
+
+static inline void
+cnull_work(void)
+{
+    unsigned long delay = op_delay_ns;
+
+    if (delay)
+        ndelay(delay);
+}
+
+int
+cnull_open(struct inode *inode, struct file *filp)
+{
+    unsigned int mj = imajor(inode);
+    unsigned int mn = iminor(inode);
+
+    if (mj != cnull_major || mn >= cnull_ndevices)
+    {
+        printk(KERN_WARNING "[target] "
+            "No device found with minor=%d and major=%d\n",
+            mj, mn);
+        return -ENODEV; /* No such device */
+    }
+
+    if (inode->i_cdev != &cnull_devices[mn].cdev)
+    {
+        printk(KERN_WARNING "[target] open: internal error\n");
+        return -ENODEV; /* No such device */
+    }
+
+    filp->private_data = &cnull_devices[mn];
+    return 0;
+}
+
+int
+cnull_release(struct inode *inode, struct file *filp)
+{
+    return 0;
+}
+
+/* As for /dev/null, reading always returns EOF. */
+ssize_t
+cnull_read(struct file *filp, char __user *buf, size_t count,
+    loff_t *f_pos)
+{
+    cnull_work();
+    return 0;
+}
+
+/* ... and all data written are discarded. */
+ssize_t
+cnull_write(struct file *filp, const char __user *buf, size_t count,
+    loff_t *f_pos)
+{
+    cnull_work();
+    return count;
+}
+
+loff_t
+cnull_llseek(struct file *filp, loff_t off, int whence)
+{
+    cnull_work();
+    filp->f_pos = 0;
+    return 0;
+}
+
+long
+cnull_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+    cnull_work();
+    return 0;
+}
+
+unsigned int
+cnull_poll(struct file *filp, struct poll_table_struct *wait)
+{
+    cnull_work();
+    return POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+}
+
+/* Device has no memory to map, but the operation is called. */
+int
+cnull_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+    cnull_work();
+    return -ENODEV;
+}
+
+struct file_operations cnull_fops = {
+    .owner =          THIS_MODULE,
+    .read =           cnull_read,
+    .write =          cnull_write,
+    .open =           cnull_open,
+    .release =        cnull_release,
+    .llseek =         cnull_llseek,
+    .unlocked_ioctl = cnull_ioctl,
+    .poll =           cnull_poll,
+    .mmap =           cnull_mmap,
+};
+
+/* ================================================================ */
+/* Setup and register the device with specific index (the index is also
+ * the minor number of the device).
+ * Device class should be created beforehand.
+ */
+static int
+cnull_construct_device(struct cnull_dev *dev, int minor,
+    struct class *class)
+{
+    int err = 0;
+    dev_t devno = MKDEV(cnull_major, minor);
+    struct device *device = NULL;
+
+    BUG_ON(dev == NULL || class == NULL);
+
+    cdev_init(&dev->cdev, &cnull_fops);
+    dev->cdev.owner = THIS_MODULE;
+
+    CDEV_ADD_ANNOTATION(&dev->cdev);
+    err = cdev_add(&dev->cdev, devno, 1);
+    if (err)
+    {
+        printk(KERN_WARNING "[target] Error %d while trying to add %s%d",
+            err, CNULL_DEVICE_NAME, minor);
+        CDEV_DEL_ANNOTATION(&dev->cdev);
+        return err;
+    }
+
+    device = device_create(class, NULL, /* no parent device */
+        devno, NULL, /* no additional data */
+        CNULL_DEVICE_NAME "%d", minor);
+
+    if (IS_ERR(device)) {
+        err = PTR_ERR(device);
+        printk(KERN_WARNING "[target] Error %d while trying to create %s%d",
+            err, CNULL_DEVICE_NAME, minor);
+        cdev_del(&dev->cdev);
+        CDEV_DEL_ANNOTATION(&dev->cdev);
+        return err;
+    }
+    return 0;
+}
+
+/* Destroy the device */
+static void
+cnull_destroy_device(struct cnull_dev *dev, int minor,
+    struct class *class)
+{
+    BUG_ON(dev == NULL || class == NULL);
+    device_destroy(class, MKDEV(cnull_major, minor));
+    cdev_del(&dev->cdev);
+    CDEV_DEL_ANNOTATION(&dev->cdev);
+    return;
+}
+
+/* ================================================================ */
+static void
+cnull_cleanup_module(int devices_to_destroy)
+{
+    int i;
+
+    /* Get rid of character devices (if any exist) */
+    if (cnull_devices) {
+        for (i = 0; i < devices_to_destroy; ++i) {
+            cnull_destroy_device(&cnull_devices[i], i, cnull_class);
+        }
+        kfree(cnull_devices);
+    }
+
+    if (cnull_class)
+        class_destroy(cnull_class);
+
+    /* [NB] cnull_cleanup_module is never called if alloc_chrdev_region()
+     * has failed. */
+    unregister_chrdev_region(MKDEV(cnull_major, 0), cnull_ndevices);
+    return;
+}
+
+static int __init
+cnull_init_module(void)
+{
+    int err = 0;
+    int i = 0;
+    int devices_to_destroy = 0;
+    dev_t dev = 0;
+
+    err = null_interception_init();
+    if(err)
+    {
+        printk(KERN_WARNING "[target-instrumentation] Failed to init interception.");
+        return err;
+    }
+
+    if (cnull_ndevices <= 0)
+    {
+        printk(KERN_WARNING "[target] Invalid value of cnull_ndevices: %d\n",
+            cnull_ndevices);
+        err = -EINVAL;
+        null_interception_destroy();
+        return err;
+    }
+
+    /* Get a range of minor numbers (starting with 0) to work with */
+    err = alloc_chrdev_region(&dev, 0, cnull_ndevices, CNULL_DEVICE_NAME);
+    if (err < 0) {
+        printk(KERN_WARNING "[target] alloc_chrdev_region() failed\n");
+        null_interception_destroy();
+        return err;
+    }
+    cnull_major = MAJOR(dev);
+
+    /* Create device class (before allocation of the array of devices) */
+    cnull_class = class_create(THIS_MODULE, CNULL_DEVICE_NAME);
+    if (IS_ERR(cnull_class)) {
+        err = PTR_ERR(cnull_class);
+        cnull_class = NULL;
+        goto fail;
+    }
+
+    /* Allocate the array of devices */
+    cnull_devices = (struct cnull_dev *)kzalloc(
+        cnull_ndevices * sizeof(struct cnull_dev),
+        GFP_KERNEL);
+    if (cnull_devices == NULL) {
+        err = -ENOMEM;
+        goto fail;
+    }
+
+    /* Construct devices */
+    for (i = 0; i < cnull_ndevices; ++i) {
+        err = cnull_construct_device(&cnull_devices[i], i, cnull_class);
+        if (err) {
+            devices_to_destroy = i;
+            goto fail;
+        }
+    }
+    return 0; /* success */
+
+fail:
+    cnull_cleanup_module(devices_to_destroy);
+    null_interception_destroy();
+    return err;
+}
+
+static void __exit
+cnull_exit_module(void)
+{
+    cnull_cleanup_module(cnull_ndevices);
+    null_interception_destroy();
+    return;
+}
+
+module_init(cnull_init_module);
+module_exit(cnull_exit_module);
+/* ================================================================ */
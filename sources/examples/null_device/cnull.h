@@ -0,0 +1,24 @@
+/*
+ * cnull.h
+ * 
+ * Character device for benchmarks, derived from 'cfake' device.
+ */
+
+#ifndef CNULL_H_INCLUDED
+#define CNULL_H_INCLUDED
+
+/* Number of devices to create (default: cnull0) */
+#ifndef CNULL_NDEVICES
+#define CNULL_NDEVICES 1
+#endif
+
+/* The structure to represent 'cnull' devices. 
+ *  cdev - character device structure.
+ * 
+ * Device has no data and no lock, so its operations cost only the
+ * work they are configured to do.
+ */
+struct cnull_dev {
+	struct cdev cdev;
+};
+#endif /* CNULL_H_INCLUDED */
@@ -0,0 +1,284 @@
+/*
+ * Load generator for 'cnull' character device.
+ *
+ * Every thread opens the device and calls given operation on its file
+ * in a loop until time is out. Result is printed as one tab-separated
+ * line:
+ *
+ *     <operation> <threads> <calls> <calls_per_sec> <ns_per_call>
+ *
+ * where <ns_per_call> is the average time of the call in one thread.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+enum load_op
+{
+    load_op_read,
+    load_op_write,
+    load_op_llseek,
+    load_op_ioctl,
+    load_op_poll,
+    load_op_mmap,
+};
+
+static const char* load_op_names[] =
+{
+    [load_op_read] = "read",
+    [load_op_write] = "write",
+    [load_op_llseek] = "llseek",
+    [load_op_ioctl] = "ioctl",
+    [load_op_poll] = "poll",
+    [load_op_mmap] = "mmap",
+};
+
+#define LOAD_OP_COUNT (sizeof(load_op_names) / sizeof(load_op_names[0]))
+
+/* Calls between checks of the 'stop' flag. */
+#define LOAD_CALLS_BATCH 64
+
+struct load_thread
+{
+    pthread_t thread;
+    const char* device;
+    enum load_op op;
+    size_t buf_size;
+
+    unsigned long long calls;
+    unsigned long long errors;
+    int result;
+};
+
+static volatile int load_stop;
+
+static void usage(const char* prog)
+{
+    size_t i;
+
+    fprintf(stderr, "Usage: %s [-t threads] [-d seconds] [-b bytes] "
+        "-o operation device\n", prog);
+    fprintf(stderr, "Operations:");
+    for(i = 0; i < LOAD_OP_COUNT; i++)
+        fprintf(stderr, " %s", load_op_names[i]);
+    fprintf(stderr, "\n");
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Call operation once, return 0 on expected result. */
+static int load_call(struct load_thread* t, int fd, char* buf)
+{
+    struct pollfd pfd;
+    void* addr;
+
+    switch(t->op)
+    {
+    case load_op_read:
+        return read(fd, buf, t->buf_size) < 0;
+    case load_op_write:
+        return write(fd, buf, t->buf_size) < 0;
+    case load_op_llseek:
+        return lseek(fd, 0, SEEK_SET) < 0;
+    case load_op_ioctl:
+        return ioctl(fd, 0, 0) < 0;
+    case load_op_poll:
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        return poll(&pfd, 1, 0) < 0;
+    case load_op_mmap:
+        // Device has nothing to map, so mmap() fails after the call.
+        addr = mmap(NULL, 4096, PROT_READ, MAP_SHARED, fd, 0);
+        if(addr != MAP_FAILED)
+        {
+            munmap(addr, 4096);
+            return 1;
+        }
+        return errno != ENODEV;
+    }
+    return 1;
+}
+
+static void* load_thread_func(void* data)
+{
+    struct load_thread* t = data;
+    char* buf;
+    int fd;
+    int i;
+
+    buf = calloc(1, t->buf_size ? t->buf_size : 1);
+    if(buf == NULL)
+    {
+        t->result = -ENOMEM;
+        return NULL;
+    }
+
+    fd = open(t->device, O_RDWR);
+    if(fd == -1)
+    {
+        t->result = -errno;
+        free(buf);
+        return NULL;
+    }
+
+    while(!load_stop)
+    {
+        for(i = 0; i < LOAD_CALLS_BATCH; i++)
+        {
+            if(load_call(t, fd, buf)) t->errors++;
+        }
+        t->calls += LOAD_CALLS_BATCH;
+    }
+
+    close(fd);
+    free(buf);
+
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    struct load_thread* threads;
+    unsigned int n_threads = 1;
+    unsigned int duration = 5;
+    size_t buf_size = 1;
+    int op = -1;
+    unsigned long long calls = 0;
+    unsigned long long errors = 0;
+    double start, elapsed;
+    unsigned int i;
+    int opt;
+    int result = 0;
+
+    while((opt = getopt(argc, argv, "t:d:b:o:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 't':
+            n_threads = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            duration = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            buf_size = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            for(i = 0; i < LOAD_OP_COUNT; i++)
+                if(!strcmp(optarg, load_op_names[i])) op = i;
+            if(op == -1)
+            {
+                fprintf(stderr, "Unknown operation '%s'.\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if((optind != argc - 1) || (op == -1) || (n_threads == 0))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    threads = calloc(n_threads, sizeof(*threads));
+    if(threads == NULL)
+    {
+        fprintf(stderr, "Failed to allocate threads.\n");
+        return 1;
+    }
+
+    start = time_now();
+
+    for(i = 0; i < n_threads; i++)
+    {
+        threads[i].device = argv[optind];
+        threads[i].op = op;
+        threads[i].buf_size = buf_size;
+        if(pthread_create(&threads[i].thread, NULL, load_thread_func,
+            &threads[i]))
+        {
+            fprintf(stderr, "Failed to create thread.\n");
+            load_stop = 1;
+            n_threads = i;
+            result = 1;
+            break;
+        }
+    }
+
+    if(!result) sleep(duration);
+    load_stop = 1;
+
+    for(i = 0; i < n_threads; i++)
+    {
+        pthread_join(threads[i].thread, NULL);
+        if(threads[i].result)
+        {
+            fprintf(stderr, "Thread failed to open device: %s\n",
+                strerror(-threads[i].result));
+            result = 1;
+        }
+        calls += threads[i].calls;
+        errors += threads[i].errors;
+    }
+
+    elapsed = time_now() - start;
+
+    if(!result && (calls == 0))
+    {
+        fprintf(stderr, "No calls are made.\n");
+        result = 1;
+    }
+
+    if(errors)
+    {
+        fprintf(stderr, "%llu calls have unexpected result.\n", errors);
+        result = 1;
+    }
+
+    if(!result)
+        printf("%s\t%u\t%llu\t%.0f\t%.1f\n", load_op_names[op], n_threads,
+            calls, calls / elapsed, elapsed * 1e9 * n_threads / calls);
+
+    free(threads);
+
+    return result;
+}
@@ -0,0 +1,223 @@
+/*
+ * Interception of file operations for 'cnull' character device.
+ *
+ * Files of the device are watched from their creation (via
+ * interception of cdev's operations) till release. Depended on the
+ * 'interception' parameter, operations used by benchmark have no
+ * handlers or have empty pre-handlers, so only overhead of the
+ * interception itself is measured.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+
+#include <linux/fs.h>
+#include <linux/cdev.h>
+
+#include <kedr-coi-kernel/interceptors/file_operations_interceptor.h>
+#include "cdev_file_operations_interceptor.h"
+
+#include "null_interception.h"
+
+/* See null_interception.h for possible values. */
+static unsigned int interception = 1;
+module_param(interception, uint, S_IRUGO);
+MODULE_PARM_DESC(interception,
+    "0 - no interception, 1 - interception without handlers, "
+    "2 - interception with handlers");
+
+/** Determine lifetime of file object */
+
+/* Set watching for the file (file operations interceptor)*/
+static void file_operation_open_post_file_lifetime(struct inode* inode,
+    struct file* filp, struct kedr_coi_operation_call_info* call_info)
+{
+    int kedr_coi_declare_return_value(call_info, returnValue);
+    if(returnValue == 0)
+    {
+        //update
+        file_operations_interceptor_watch(filp);
+    }
+    else
+    {
+        //error-path
+        file_operations_interceptor_forget(filp);
+    }
+}
+
+static void file_operation_release_post_file_lifetime(struct inode* inode,
+    struct file* filp, struct kedr_coi_operation_call_info* call_info)
+{
+    int kedr_coi_declare_return_value(call_info, returnValue);
+    if(returnValue == 0)
+    {
+        file_operations_interceptor_forget(filp);
+    }
+}
+
+static struct kedr_coi_handler file_operations_lifetime_post_handlers[] =
+{
+    file_operations_open_handler(file_operation_open_post_file_lifetime),
+    file_operations_release_handler_external(file_operation_release_post_file_lifetime),
+    kedr_coi_handler_end
+};
+
+/*
+ * Because payloads are embedded into module implemented character
+ * device, 'mod' field shouldn't be set for them.
+ *
+ * Otherwise one will unable to unload module.
+ */
+static struct kedr_coi_payload file_operations_lifetime_payload =
+{
+    .post_handlers = file_operations_lifetime_post_handlers,
+};
+
+/** Handlers which do nothing, only their calls are measured. */
+static void file_operation_read_pre(struct file* filp,
+    char __user* buf, size_t count, loff_t* f_pos,
+    struct kedr_coi_operation_call_info* call_info)
+{
+}
+
+static void file_operation_write_pre(struct file* filp,
+    const char __user* buf, size_t count, loff_t* f_pos,
+    struct kedr_coi_operation_call_info* call_info)
+{
+}
+
+static void file_operation_llseek_pre(struct file* filp,
+    loff_t offset, int whence,
+    struct kedr_coi_operation_call_info* call_info)
+{
+}
+
+static void file_operation_unlocked_ioctl_pre(struct file* filp,
+    unsigned int cmd, unsigned long arg,
+    struct kedr_coi_operation_call_info* call_info)
+{
+}
+
+static void file_operation_poll_pre(struct file* filp,
+    struct poll_table_struct* wait,
+    struct kedr_coi_operation_call_info* call_info)
+{
+}
+
+static void file_operation_mmap_pre(struct file* filp,
+    struct vm_area_struct* vma,
+    struct kedr_coi_operation_call_info* call_info)
+{
+}
+
+static struct kedr_coi_handler file_operations_pre_handlers[] =
+{
+    file_operations_read_handler(file_operation_read_pre),
+    file_operations_write_handler(file_operation_write_pre),
+    file_operations_llseek_handler(file_operation_llseek_pre),
+    file_operations_unlocked_ioctl_handler(file_operation_unlocked_ioctl_pre),
+    file_operations_poll_handler(file_operation_poll_pre),
+    file_operations_mmap_handler(file_operation_mmap_pre),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload file_operations_payload =
+{
+    .pre_handlers = file_operations_pre_handlers,
+};
+
+int null_interception_init(void)
+{
+    int result;
+
+    if(interception > 2)
+    {
+        pr_err("Incorrect interception mode: %u.", interception);
+        return -EINVAL;
+    }
+
+    if(interception == 0) return 0;
+
+    result = file_operations_interceptor_init();
+    if(result) goto err_file_operations;
+
+    result = cdev_file_operations_interceptor_init(
+        file_operations_interceptor_factory_interceptor_create);
+
+    if(result) goto err_cdev_file_operations;
+
+    result = file_operations_interceptor_payload_register(
+        &file_operations_lifetime_payload);
+    if(result) goto err_file_operations_lifetime_payload;
+
+    if(interception == 2)
+    {
+        result = file_operations_interceptor_payload_register(
+            &file_operations_payload);
+        if(result) goto err_file_operations_payload;
+    }
+
+    result = file_operations_interceptor_start();
+    if(result) goto err_file_operations_start;
+
+    return 0;
+
+err_file_operations_start:
+    if(interception == 2)
+        file_operations_interceptor_payload_unregister(&file_operations_payload);
+err_file_operations_payload:
+    file_operations_interceptor_payload_unregister(
+        &file_operations_lifetime_payload);
+err_file_operations_lifetime_payload:
+    cdev_file_operations_interceptor_destroy();
+err_cdev_file_operations:
+    file_operations_interceptor_destroy();
+err_file_operations:
+
+    return result;
+}
+
+void null_interception_destroy(void)
+{
+    if(interception == 0) return;
+
+    file_operations_interceptor_stop();
+    if(interception == 2)
+        file_operations_interceptor_payload_unregister(&file_operations_payload);
+    file_operations_interceptor_payload_unregister(
+        &file_operations_lifetime_payload);
+    cdev_file_operations_interceptor_destroy();
+    file_operations_interceptor_destroy();
+}
+
+int null_interception_cdev_add(struct cdev* dev)
+{
+    if(interception == 0) return 0;
+
+    return cdev_file_operations_interceptor_watch(dev);
+}
+
+void null_interception_cdev_del(struct cdev* dev)
+{
+    if(interception == 0) return;
+
+    cdev_file_operations_interceptor_forget(dev);
+}
@@ -0,0 +1,25 @@
+#ifndef NULL_INTERCEPTION_H
+#define NULL_INTERCEPTION_H
+
+/*
+ * Exported functions and annotations for use in module implemented
+ * character device for intercept operations of files of this device.
+ * 
+ * Interception mode is selected by 'interception' parameter of the
+ * module:
+ * 
+ * 0 - operations are not intercepted,
+ * 1 - operations are intercepted, but have no handlers,
+ * 2 - every operation used by benchmark has (empty) pre-handler.
+ */
+
+int null_interception_init(void);
+void null_interception_destroy(void);
+
+int null_interception_cdev_add(struct cdev* dev);
+void null_interception_cdev_del(struct cdev* dev);
+
+#define CDEV_ADD_ANNOTATION(cdev) null_interception_cdev_add(cdev)
+#define CDEV_DEL_ANNOTATION(cdev) null_interception_cdev_del(cdev)
+
+#endif /* NULL_INTERCEPTION_H */
@@ -0,0 +1,128 @@
+#ifndef KEDR_COI_CALL_RECORDS_H
+#define KEDR_COI_CALL_RECORDS_H
+
+/*
+ * Records of intercepted calls.
+ *
+ * KEDR COI core maintains per-CPU ring buffers of fixed-size records,
+ * into which handlers may store information about intercepted calls.
+ * Buffers are exported to userspace via character device, which
+ * should be mmap()'ed by the reader.
+ *
+ * This header is shared between kernel and userspace: it describes
+ * layout of the mapped memory.
+ *
+ * Layout of the mapping:
+ *
+ *  - info page ('struct kedr_coi_call_records_info'),
+ *  - per-CPU buffers, 'buffer_size' bytes each, starting at
+ *    'buffers_offset'. Buffer for CPU 'i' starts at
+ *    'buffers_offset + i * buffer_size'.
+ *
+ * Every per-CPU buffer starts with the header
+ * ('struct kedr_coi_call_records_header'), records follow it at
+ * 'records_offset' from the start of the buffer.
+ *
+ * Kernel is the only writer of the records and of 'head' field. Reader
+ * consumes records in [tail, head) and advances 'tail'. Everything else
+ * in the mapping is output-only: kernel never reads it back.
+ */
+
+#include <linux/types.h>
+
+/* Name of the device in /dev. */
+#define KEDR_COI_CALL_RECORDS_DEVICE "kedr_coi_calls"
+
+/* Version of the layout, changed on incompatible changes. */
+#define KEDR_COI_CALL_RECORDS_VERSION 2
+
+/* Types of the records, see 'type' field of the record. */
+enum kedr_coi_call_record_type
+{
+    /* Intercepted call. */
+    kedr_coi_call_record_type_call = 0,
+    /* Object is watched by the interceptor. */
+    kedr_coi_call_record_type_watch = 1,
+    /* Object is forgotten by the interceptor. */
+    kedr_coi_call_record_type_forget = 2,
+};
+
+struct kedr_coi_call_records_info
+{
+    __u32 version;
+    /* Number of per-CPU buffers. */
+    __u32 n_cpus;
+    /* Offset of the first buffer from the start of the mapping. */
+    __u32 buffers_offset;
+    /* Size of one per-CPU buffer, including its header. */
+    __u32 buffer_size;
+    /* Offset of records from the start of the buffer. */
+    __u32 records_offset;
+    /* Number of records in the buffer, power of 2. */
+    __u32 n_records;
+    /* Size of one record. */
+    __u32 record_size;
+    /*
+     * Non-zero if buffer is overwritten when full. Otherwise new
+     * records are dropped in that case.
+     */
+    __u32 overwrite;
+};
+
+struct kedr_coi_call_records_header
+{
+    /* Number of records written into the buffer. */
+    __u64 head;
+    /* Number of records consumed by the reader. Updated by the reader. */
+    __u64 tail;
+    /* Number of records dropped because buffer was full. */
+    __u64 dropped;
+};
+
+struct kedr_coi_call_record
+{
+    /* Local CPU clock, in nanoseconds. */
+    __u64 timestamp;
+    __u64 object;
+    __u64 op_orig;
+    __u64 return_address;
+    __s64 return_value;
+    /*
+     * Time of the call in nanoseconds, the call is started at
+     * 'timestamp - duration'. 0 if unknown (records stored by handlers).
+     */
+    __u64 duration;
+    __u32 pid;
+    __u16 cpu;
+    /* One of 'kedr_coi_call_record_type'. */
+    __u16 type;
+    /* See 'id' file in the interceptor's directory in debugfs. */
+    __u32 interceptor_id;
+    __u32 operation_offset;
+};
+
+#ifdef __KERNEL__
+
+struct kedr_coi_interceptor;
+struct kedr_coi_operation_call_info;
+
+/*
+ * Store record about intercepted call into the buffer of current CPU.
+ *
+ * Intended to be called from the handlers, usually from the post one,
+ * because only it knows return value of the operation. For operations
+ * which return nothing 'return_value' may be arbitrary.
+ *
+ * Function doesn't take any locks and may be called in atomic context.
+ * If call records are disabled (see 'call_records_pages' parameter of
+ * the core module), function does nothing.
+ */
+void kedr_coi_call_record(struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset,
+    const void* object,
+    const struct kedr_coi_operation_call_info* call_info,
+    long return_value);
+
+#endif /* __KERNEL__ */
+
+#endif /* KEDR_COI_CALL_RECORDS_H */
@@ -364,6 +364,9 @@ void kedr_coi_interceptor_stop(struct kedr_coi_interceptor* interceptor);
  * with operations. If these fields are changed outside of the interceptor,
  * this function should be called again.
  * 
+ * If quota is set for the interceptor (see kedr_coi_interceptor_set_quota)
+ * and it is reached, new object is not watched and -EDQUOT is returned.
+ * 
  * NOTE: This operation should be called only in 'interception' state
  * of the interceptor. Otherwise it will return error(-EINVAL).
  */
@@ -407,6 +410,256 @@ int kedr_coi_interceptor_forget_norestore(
     struct kedr_coi_interceptor* interceptor,
     void* object);
 
+/*
+ * Watch for the object as for a child of another, already watched,
+ * object (parent). Parent may be watched by other interceptor.
+ * 
+ * Apart from relation, watching is the same as with
+ * kedr_coi_interceptor_watch(). If object is already watched, it is
+ * reparented.
+ * 
+ * Return 0 if object wasn't watched before, 1 if it was, negative
+ * error code on fail. -ENOENT is returned if parent is not watched,
+ * -EINVAL if parent is the object itself or its descendant.
+ * 
+ * Relation disappears when either object is forgotten; children of the
+ * forgotten object are kept watched, but without parent.
+ */
+int kedr_coi_interceptor_watch_child(
+    struct kedr_coi_interceptor* interceptor,
+    void* object,
+    struct kedr_coi_interceptor* parent_interceptor,
+    const void* parent);
+
+/*
+ * Forget all descendants of the object, the object itself is kept
+ * watched.
+ * 
+ * Descendants are forgotten in a 'norestore' way (see
+ * kedr_coi_interceptor_forget_norestore()), so the function is intended
+ * for the case when descendant objects are about to be destroyed
+ * together with their parent (e.g. files of the filesystem being
+ * unmounted).
+ * 
+ * Cost is proportional to the number of descendants. Descendants
+ * are forgotten by chunks, so other watch/forget requests are not
+ * blocked for a long time.
+ * 
+ * Return 0 on success, 1 if object is not watched.
+ * 
+ * Should be called in 'interception' state of the interceptor.
+ */
+int kedr_coi_interceptor_forget_children(
+    struct kedr_coi_interceptor* interceptor,
+    const void* object);
+
+/*
+ * Statistic about objects watched by the interceptor.
+ */
+struct kedr_coi_interceptor_stat
+{
+    /* Number of watched objects. */
+    size_t n_watches;
+    /*
+     * Number of instrumented operations structures. For direct
+     * interceptor every watched object has its own one.
+     */
+    size_t n_operations;
+    /*
+     * Memory used for watches and instrumented operations, in bytes.
+     * 
+     * It is estimated from the sizes of the structures, overhead of
+     * the memory allocator is not counted.
+     */
+    size_t memory;
+    /* Distribution of watched objects in the hash table. */
+    size_t n_buckets;
+    size_t n_buckets_used;
+    size_t max_chain;
+};
+
+/*
+ * Fill statistic about objects watched by the interceptor.
+ * 
+ * The function walks all watches with interceptor's spinlock taken,
+ * so it takes time proportional to their number and shouldn't be called
+ * often. Intended for benchmarks and diagnostics.
+ * 
+ * Return 0 on success, -EPERM if interceptor is not in 'interception'
+ * state.
+ */
+int kedr_coi_interceptor_get_stat(
+    struct kedr_coi_interceptor* interceptor,
+    struct kedr_coi_interceptor_stat* stat);
+
+/*
+ * Memory used by the interceptor, in bytes.
+ * 
+ * Unlike 'memory' in the statistic above, it is accounted when memory
+ * is allocated and freed, so it is cheap to obtain.
+ */
+struct kedr_coi_interceptor_memory
+{
+    /* Watches of the objects. */
+    size_t watch_data;
+    /* Instrumented operations structures. */
+    size_t idata;
+    /* Copies of the operations structures they hold. */
+    size_t ops_copies;
+    /* Heads of the hash tables. */
+    size_t hash_heads;
+    /* Data of the factory interceptors created for this one. */
+    size_t foreign;
+    /* Sum of all above. */
+    size_t total;
+    /* Number of watches refused and evicted because of quota. */
+    unsigned long n_refused;
+    unsigned long n_evicted;
+};
+
+/*
+ * Fill information about memory used by the interceptor.
+ * 
+ * May be called in atomic context.
+ * 
+ * Return 0 on success, -EPERM if interceptor is not in 'interception'
+ * state.
+ * 
+ * The same information is shown by 'memory' file in the interceptor's
+ * directory in debugfs.
+ */
+int kedr_coi_interceptor_get_memory(
+    struct kedr_coi_interceptor* interceptor,
+    struct kedr_coi_interceptor_memory* memory);
+
+/* What to do when quota of the interceptor is reached. */
+enum kedr_coi_quota_policy
+{
+    /* Refuse to watch new objects with -EDQUOT. */
+    kedr_coi_quota_refuse = 0,
+    /*
+     * Evict watches of objects whose operations were not called
+     * recently. Evicted objects are not accessed, as they may be
+     * already freed; alive ones continue to work with the original
+     * operations, and kedr_coi_interceptor_forget() for them restores
+     * operations and returns 1. If eviction is not sufficient, new
+     * object is refused. Objects of direct interceptor are never
+     * evicted.
+     */
+    kedr_coi_quota_evict,
+};
+
+/*
+ * Limit memory used by the interceptor (see 'total' above).
+ * 
+ * @quota is in bytes, 0 means no limit (default). Limit is checked
+ * when new object is watched, so it is approximate: operations
+ * structures created for new watch are not taken into account.
+ * 
+ * Objects in hierarchy (see kedr_coi_interceptor_watch_child) are not
+ * evicted while other operation on the same hierarchy is in progress.
+ * 
+ * May be called in any state of the interceptor, but not in atomic
+ * context. Quota is preserved when interceptor is stopped.
+ * 
+ * The same may be done via 'quota' and 'quota_policy' files in the
+ * interceptor's directory in debugfs.
+ */
+void kedr_coi_interceptor_set_quota(
+    struct kedr_coi_interceptor* interceptor,
+    size_t quota,
+    enum kedr_coi_quota_policy policy);
+
+/*
+ * Enable periodic garbage collection of the watches for objects which
+ * are already destroyed but not forgotten.
+ * 
+ * Every @interval milliseconds watches of the interceptor are checked
+ * in background. Check is made in small chunks, so interception is not
+ * delayed for long. Watches of dead objects are forgotten without
+ * accessing the objects, as with kedr_coi_interceptor_forget_children().
+ * 
+ * @object_is_alive should return false for dead objects. It is called
+ * in atomic context, and it shouldn't access fields of dead object.
+ * Core cannot tell dead object from alive one by itself, so collection
+ * cannot be enabled without @object_is_alive: -EINVAL is returned in
+ * that case.
+ * 
+ * @interval 0 disables collection, it is default. @object_is_alive may
+ * be NULL in that case.
+ * 
+ * Number of watches collected by a pass, if any, is reported into the
+ * kernel log and accumulated in 'gc' file in the interceptor's
+ * directory in debugfs. Interval may be changed via 'gc_interval'
+ * file there, if @object_is_alive is set.
+ * 
+ * May be called in any state of the interceptor, but not in atomic
+ * context.
+ */
+int kedr_coi_interceptor_set_gc(
+    struct kedr_coi_interceptor* interceptor,
+    unsigned int interval,
+    bool (*object_is_alive)(const void* object));
+
+/*
+ * Pause interception: from that moment intermediate operations call
+ * original operations directly, pre- and post- handlers are not called.
+ * 
+ * Unlike kedr_coi_interceptor_stop(), objects are not forgotten and
+ * their operations are not restored, so interception may be resumed
+ * at any time with kedr_coi_interceptor_resume().
+ * 
+ * Pausing of the interceptor also pauses all factory interceptors
+ * created for it.
+ * 
+ * Both functions are O(1) and may be called in atomic context and in
+ * any state of the interceptor. Pause state is not reset by
+ * kedr_coi_interceptor_stop().
+ */
+void kedr_coi_interceptor_pause(struct kedr_coi_interceptor* interceptor);
+
+void kedr_coi_interceptor_resume(struct kedr_coi_interceptor* interceptor);
+
+/* Return true if interception is paused. */
+bool kedr_coi_interceptor_is_paused(struct kedr_coi_interceptor* interceptor);
+
+/*
+ * Disable and enable handlers for particular operation.
+ * 
+ * While operation is disabled, its intermediate calls original
+ * operation directly, as if interceptor was paused for this operation
+ * only. Set of operations replaced by the interceptor is not changed.
+ * Handlers of factory interceptors binded with the interceptor are
+ * disabled for this operation too.
+ * 
+ * @operation_offset should be offset of the operation for which
+ * intermediate is provided at interceptor creation. Otherwise -EINVAL
+ * is returned. kedr_coi_interceptor_operation_is_enabled() returns 1 if
+ * operation is enabled and 0 if it is disabled.
+ * 
+ * Functions may be called in any state of the interceptor and in
+ * atomic context. Initially all operations are enabled.
+ * 
+ * The same may be done via 'operations' file in the interceptor's
+ * directory in debugfs (<debugfs>/kedr_coi/<interceptor-name>/):
+ * reading it lists operations with their state, writing
+ * "disable <operation>" or "enable <operation>" changes the state.
+ * Operation is specified by its name (if given in intermediate) or
+ * offset. Writing 1 or 0 to the 'paused' file in the same directory
+ * pauses or resumes the interceptor.
+ */
+int kedr_coi_interceptor_operation_disable(
+    struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset);
+
+int kedr_coi_interceptor_operation_enable(
+    struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset);
+
+int kedr_coi_interceptor_operation_is_enabled(
+    struct kedr_coi_interceptor* interceptor,
+    size_t operation_offset);
+
 /**********Creation of the operations interceptor*******************/
 
 /*
@@ -422,8 +675,120 @@ struct kedr_coi_intermediate_info
     void* const* pre;
     // NULL-terminated array of functions of post handlers for this operation.
     void* const* post;
+    /*
+     * Non-NULL if hooks should be called for this operation call.
+     * 
+     * Should be passed to kedr_coi_hook_pre() and kedr_coi_hook_post().
+     */
+    void* hooks;
+    /*
+     * Non-NULL if time of the handlers should be measured for this
+     * operation call.
+     * 
+     * Should be passed to kedr_coi_handler_stop().
+     */
+    void* measure;
 };
 
+/* Maximum number of operation's arguments stored in the hook context. */
+#define KEDR_COI_HOOK_MAX_ARGS 6
+
+/*
+ * Context of the intercepted call, passed to the hooks.
+ * 
+ * Hooks are tracepoints 'kedr_coi:kedr_coi_hook_pre' and
+ * 'kedr_coi:kedr_coi_hook_post', which accept pointer to this
+ * structure. BPF programs attached to these tracepoints act as pre-
+ * and post-handlers for all interceptors without building modules.
+ * 
+ * Hooks are called for the operation with handlers, and for any
+ * operation while any of these tracepoints is enabled or KEDR COI core
+ * collects statistic for the interceptor.
+ */
+struct kedr_coi_hook_context
+{
+    // Filled by KEDR COI core.
+    u32 interceptor_id;
+    u32 operation_offset;
+    const void* object;
+    void* return_address;
+    // Number of arguments stored, not more than KEDR_COI_HOOK_MAX_ARGS.
+    int n_args;
+    // Arguments of the operation, pointers are stored as addresses.
+    u64 args[KEDR_COI_HOOK_MAX_ARGS];
+    // Returned value, for post hook only.
+    s64 return_value;
+    /*
+     * Fields below are set by KEDR COI core.
+     * 
+     * Enclosing intercepted call, made by the same task, or NULL for the
+     * outermost call. Only calls for which hooks are called are tracked.
+     */
+    struct kedr_coi_hook_context* parent;
+    // Nesting level of the call: 1 for the outermost call, 0 if not tracked.
+    int depth;
+    // Time when the call is started, for measure its time.
+    u64 start_time;
+    // Summary time of the calls nested into this one.
+    u64 children_time;
+};
+
+/*
+ * Call hooks. 'hooks' is the corresponding field of the intermediate
+ * info, all fields of 'ctx' except 'interceptor_id' and ones set by
+ * KEDR COI core should be set.
+ * 
+ * Pre-hook should be called before pre-handlers, post-hook - after
+ * post-handlers.
+ * 
+ * These functions are intended to be used ONLY in the implementation
+ * of the intermediate operation.
+ */
+void kedr_coi_hook_pre(void* hooks, struct kedr_coi_hook_context* ctx);
+void kedr_coi_hook_post(void* hooks, struct kedr_coi_hook_context* ctx);
+
+/*
+ * Return the innermost intercepted call, which is currently executed
+ * by the current task, or NULL.
+ * 
+ * Calls are tracked when they have handlers or hooks are enabled for
+ * them (e.g., when statistic about callers is collected). Calls made
+ * in interrupt context are not tracked. The call may be used for
+ * determine nesting of the calls via 'parent' and 'depth' fields, and
+ * for measure time of the call.
+ * 
+ * Being called from the handler, returns the call for which the
+ * handler is executed.
+ */
+const struct kedr_coi_hook_context* kedr_coi_current_call(void);
+
+/* Start of the handler call, filled by kedr_coi_handler_start(). */
+struct kedr_coi_handler_timestamp
+{
+    u64 time;
+    u64 cycles;
+};
+
+/*
+ * Measure time of the handler call.
+ * 
+ * When 'measure' field of the intermediate info is not NULL, the
+ * intermediate operation should call kedr_coi_handler_start() before
+ * every handler and kedr_coi_handler_stop() after it, passing pointer
+ * to the handler's element in 'pre' or 'post' array.
+ * 
+ * KEDR COI core uses measured time for watch that handlers of every
+ * payload do not exceed time budget, and for account cost of the
+ * handlers of every payload.
+ * 
+ * These functions are intended to be used ONLY in the implementation
+ * of the intermediate operation.
+ */
+void kedr_coi_handler_start(void* measure,
+    struct kedr_coi_handler_timestamp* start);
+void kedr_coi_handler_stop(void* measure, void* const* handler,
+    const struct kedr_coi_handler_timestamp* start);
+
 
 /*
  * Get information about intermediate for given operation in the given object.
@@ -499,6 +864,13 @@ struct kedr_coi_intermediate
      * inside this intermediate.
      */
     bool internal_only;
+    /*
+     * Name of the operation (optional).
+     * 
+     * Used only for refer to the operation at runtime, e.g. in debugfs.
+     * If not set, operation is referred by its offset.
+     */
+    const char* name;
 };
 
 /*
@@ -828,6 +1200,10 @@ void kedr_coi_factory_interceptor_trace_unforgotten_object(
  * 
  * Return true if given address belongs to the module sections and is
  * writable.
+ * 
+ * Memory areas of the modules are collected into an internal table
+ * when requested first time, so subsequent calls for addresses of the
+ * same module do not search the module.
  */
 bool kedr_coi_default_mechanism_selector(const void* addr);
 
@@ -852,6 +1228,12 @@ bool kedr_coi_default_mechanism_selector(const void* addr);
  * When pointer to operations struct is NULL, special interception
  * mechanism is used, selector callback is not called in that case.
  * 
+ * Decision of the selector is cached per pointer to operations
+ * struct, so selector is called only once for given operations.
+ * Cached decision is dropped when module, which contains operations,
+ * is loaded or unloaded. So selector's result should depend only on
+ * the address of the operations and on the modules loaded.
+ * 
  * Selector can be set only for interceptor, created by
  * kedr_coi_interceptor_create(). 'direct' interceptor always use
  * 'at_place' mechanism, as there is no pointer to operations stored in
@@ -17,6 +17,11 @@
 <$for operation in operations if operation.implementation_header$>
 {{ operation.implementation_header }}
 <$endfor$>
+<$if trace_events$>
+
+#define CREATE_TRACE_POINTS
+#include "{{interceptor.name}}_trace.h"
+<$endif$>
 
 <$ block prepare scoped$>
 #define OPERATION_OFFSET(operation_name) offsetof(<$include 'operations_type'$>, operation_name)
@@ -53,6 +58,7 @@ static <$if operation.returnType$>{{operation.returnType}}<$else$>void<$endif$>
 {
     struct kedr_coi_operation_call_info call_info;
     struct kedr_coi_intermediate_info intermediate_info;
+    struct kedr_coi_hook_context hook_context;
 <$if operation.returnType$>
     {{operation.returnType}} returnValue;
 <$endif$>
@@ -71,12 +77,30 @@ static <$if operation.returnType$>{{operation.returnType}}<$else$>void<$endif$>
         BUG();
     }
 <$ endblock fill_info$>
+<$if trace_events$>
+    trace_{{interceptor.name}}_{{operation.name}}_entry(<$include 'argumentList'$>);
+
+<$endif$>
     call_info.return_address = __builtin_return_address(0);
     call_info.op_orig = intermediate_info.op_orig;
 <$if operation.returnType$>
     call_info.return_value = &returnValue;
 <$endif$>
 
+    if(intermediate_info.hooks != NULL)
+    {
+        hook_context.operation_offset = OPERATION_OFFSET({{operation.name}});
+        hook_context.object = {{operation.object}};
+        hook_context.return_address = call_info.return_address;
+<# Only first KEDR_COI_HOOK_MAX_ARGS arguments are stored. #>
+        hook_context.n_args = {{ [operation.args|length, 6]|min }};
+<$for arg in operation.args[:6]$>
+        hook_context.args[{{loop.index0}}] = (u64)<$if arg.is_pointer or ('*' in arg.type)$>(unsigned long)<$endif$>{{arg.name}};
+<$endfor$>
+        hook_context.return_value = 0;
+        kedr_coi_hook_pre(intermediate_info.hooks, &hook_context);
+    }
+    
     if(intermediate_info.pre != NULL)
     {
         void (**pre_function)(<$include 'argumentTypeSpec_comma'$>struct kedr_coi_operation_call_info*);
@@ -84,7 +108,19 @@ static <$if operation.returnType$>{{operation.returnType}}<$else$>void<$endif$>
         for(pre_function = (typeof(pre_function))intermediate_info.pre;
             *pre_function != NULL;
             pre_function++)
+        {
+            struct kedr_coi_handler_timestamp handler_start;
+
+            if(intermediate_info.measure != NULL)
+                kedr_coi_handler_start(intermediate_info.measure,
+                    &handler_start);
+
             (*pre_function)(<$include 'argumentList_comma'$>&call_info);
+
+            if(intermediate_info.measure != NULL)
+                kedr_coi_handler_stop(intermediate_info.measure,
+                    (void* const*)pre_function, &handler_start);
+        }
     }
     
 <$if not operation.default$>
@@ -100,9 +136,33 @@ static <$if operation.returnType$>{{operation.returnType}}<$else$>void<$endif$>
         for(post_function = (typeof(post_function))intermediate_info.post;
             *post_function != NULL;
             post_function++)
+        {
+            struct kedr_coi_handler_timestamp handler_start;
+
+            if(intermediate_info.measure != NULL)
+                kedr_coi_handler_start(intermediate_info.measure,
+                    &handler_start);
+
             (*post_function)(<$include 'argumentList_comma'$>&call_info);
+
+            if(intermediate_info.measure != NULL)
+                kedr_coi_handler_stop(intermediate_info.measure,
+                    (void* const*)post_function, &handler_start);
+        }
+    }
+
+    if(intermediate_info.hooks != NULL)
+    {
+<$if operation.returnType$>
+        hook_context.return_value = (s64)<$if '*' in operation.returnType$>(unsigned long)<$endif$>returnValue;
+<$endif$>
+        kedr_coi_hook_post(intermediate_info.hooks, &hook_context);
     }
 
+<$if trace_events$>
+    trace_{{interceptor.name}}_{{operation.name}}_exit(<$if operation.returnType$><$include 'argumentList_comma'$>returnValue<$else$><$include 'argumentList'$><$endif$>);
+
+<$endif$>
 <$if operation.returnType$>
     return returnValue;
 <$endif$>
@@ -116,6 +176,7 @@ static struct kedr_coi_intermediate intermediate_operations[] =
     {
         .operation_offset = OPERATION_OFFSET({{operation.name}}),
         .repl = OPERATION_CHECKED_TYPE(&intermediate_repl_{{operation.name}}, {{operation.name}}),
+        .name = "{{operation.name}}",
 <$if operation.group_id$>
         .group_id = {{operation.group_id}},
 <$endif$>
@@ -189,6 +250,43 @@ int {{interceptor.name}}_forget_norestore({{object.type}} *object)
     return kedr_coi_interceptor_forget_norestore(interceptor, object);
 }
 
+struct kedr_coi_interceptor* {{interceptor.name}}_get_interceptor(void)
+{
+    return interceptor;
+}
+
+int {{interceptor.name}}_watch_child({{object.type}} *object,
+    struct kedr_coi_interceptor* parent_interceptor, void* parent)
+{
+    return kedr_coi_interceptor_watch_child(interceptor, object,
+        parent_interceptor, parent);
+}
+
+int {{interceptor.name}}_forget_children({{object.type}} *object)
+{
+    return kedr_coi_interceptor_forget_children(interceptor, object);
+}
+
+void {{interceptor.name}}_pause(void)
+{
+    kedr_coi_interceptor_pause(interceptor);
+}
+
+void {{interceptor.name}}_resume(void)
+{
+    kedr_coi_interceptor_resume(interceptor);
+}
+
+int {{interceptor.name}}_operation_disable(size_t operation_offset)
+{
+    return kedr_coi_interceptor_operation_disable(interceptor, operation_offset);
+}
+
+int {{interceptor.name}}_operation_enable(size_t operation_offset)
+{
+    return kedr_coi_interceptor_operation_enable(interceptor, operation_offset);
+}
+
 <$if not interceptor.is_direct$>
 void {{interceptor.name}}_mechanism_selector(
     bool (*replace_at_place)(const {{object.operations_type}}* ops))
@@ -25,6 +25,19 @@ int {{interceptor.name}}_forget({{object.type}}* object);
 
 int {{interceptor.name}}_forget_norestore({{object.type}}* object);
 
+/* Interceptor object, may be used as parent_interceptor for other ones. */
+struct kedr_coi_interceptor* {{interceptor.name}}_get_interceptor(void);
+
+int {{interceptor.name}}_watch_child({{object.type}}* object,
+    struct kedr_coi_interceptor* parent_interceptor, void* parent);
+int {{interceptor.name}}_forget_children({{object.type}}* object);
+
+void {{interceptor.name}}_pause(void);
+void {{interceptor.name}}_resume(void);
+
+int {{interceptor.name}}_operation_disable(size_t operation_offset);
+int {{interceptor.name}}_operation_enable(size_t operation_offset);
+
 <$if not interceptor.is_direct$>
 void {{interceptor.name}}_mechanism_selector(
     bool (*replace_at_place)(const {{object.operations_type}}* ops));
@@ -0,0 +1,94 @@
+<#
+ Pointers are stored as addresses, other parameters as signed 64-bit
+ integers.
+#>
+<$ macro is_pointer(type, explicit) $><$if explicit or ('*' in type)$>1<$endif$><$ endmacro $>
+<$ macro field_type(type, explicit) $><$if is_pointer(type, explicit)$>unsigned long<$else$>s64<$endif$><$ endmacro $>
+<$ macro field_format(type, explicit) $><$if is_pointer(type, explicit)$>0x%lx<$else$>%lld<$endif$><$ endmacro $>
+<$ macro field_value(name, type, explicit) $><$if is_pointer(type, explicit)$>__entry->{{name}}<$else$>(long long)__entry->{{name}}<$endif$><$ endmacro $>
+/*
+ * Trace events for operations intercepted by {{interceptor.name}}.
+ *
+ * Every operation has two events: '<operation>_entry' is fired before
+ * pre-handlers are called, '<operation>_exit' - after post-handlers.
+ *
+ * Directory with this file should be in the include path when
+ * compile the interceptor.
+ */
+
+<$if header$>
+{{ header }}
+<$endif$>
+<$if implementation_header$>
+{{ implementation_header }}
+<$endif$>
+<$for operation in operations if operation.header$>
+{{ operation.header }}
+<$endfor$>
+<$for operation in operations if operation.implementation_header$>
+{{ operation.implementation_header }}
+<$endfor$>
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM {{interceptor.name}}
+
+#if !defined({{interceptor.name|upper}}_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define {{interceptor.name|upper}}_TRACE_H
+
+#include <linux/tracepoint.h>
+
+<$for operation in operations$>
+TRACE_EVENT({{interceptor.name}}_{{operation.name}}_entry,
+    TP_PROTO(<$include 'argumentSpec'$>),
+    TP_ARGS(<$include 'argumentList'$>),
+    TP_STRUCT__entry(
+<$for arg in operation.args$>
+        __field({{field_type(arg.type, arg.is_pointer)}}, {{arg.name}})
+<$endfor$>
+    ),
+    TP_fast_assign(
+<$for arg in operation.args$>
+        __entry->{{arg.name}} = ({{field_type(arg.type, arg.is_pointer)}}){{arg.name}};
+<$endfor$>
+    ),
+    TP_printk("<$for arg in operation.args$><$if not loop.first$> <$endif$>{{arg.name}}={{field_format(arg.type, arg.is_pointer)}}<$endfor$>"<$for arg in operation.args$>,
+        {{field_value(arg.name, arg.type, arg.is_pointer)}}<$endfor$>)
+);
+
+TRACE_EVENT({{interceptor.name}}_{{operation.name}}_exit,
+<$if operation.returnType$>
+    TP_PROTO(<$include 'argumentSpec_comma'$>{{operation.returnType}} returnValue),
+    TP_ARGS(<$include 'argumentList_comma'$>returnValue),
+<$else$>
+    TP_PROTO(<$include 'argumentSpec'$>),
+    TP_ARGS(<$include 'argumentList'$>),
+<$endif$>
+    TP_STRUCT__entry(
+        __field(unsigned long, object)
+<$if operation.returnType$>
+        __field({{field_type(operation.returnType, false)}}, returnValue)
+<$endif$>
+    ),
+    TP_fast_assign(
+        __entry->object = (unsigned long)({{operation.object}});
+<$if operation.returnType$>
+        __entry->returnValue = ({{field_type(operation.returnType, false)}})returnValue;
+<$endif$>
+    ),
+<$if operation.returnType$>
+    TP_printk("object=0x%lx returnValue={{field_format(operation.returnType, false)}}",
+        __entry->object, {{field_value('returnValue', operation.returnType, false)}})
+<$else$>
+    TP_printk("object=0x%lx", __entry->object)
+<$endif$>
+);
+
+<$endfor$>
+#endif /* {{interceptor.name|upper}}_TRACE_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE {{interceptor.name}}_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,874 @@
+/*
+ * Benchmark for overhead of intercepted calls.
+ *
+ * For every interception mechanism, number of handlers, watched and
+ * unwatched objects and number of concurrent threads the module measures
+ * time of the operation calls made in a tight loop.
+ *
+ * Benchmark is run when the module is loaded and every time when
+ * anything is written to 'run' file in 'kedr_coi_benchmark_overhead'
+ * directory in debugfs. Results are shown in 'results' file in the same
+ * directory, one configuration per line, and are printed into the
+ * system log.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#include "test_harness.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/utsname.h>
+
+MODULE_AUTHOR("Tsyvarev Andrey");
+MODULE_LICENSE("GPL");
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val) (ACCESS_ONCE(x) = (val))
+#endif
+
+/* Maximum number of handlers for the operation. */
+#define BENCH_MAX_HANDLERS 16
+
+static unsigned int n_objects = 1024;
+module_param(n_objects, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(n_objects,
+    "Number of objects, which are divided between threads");
+
+static unsigned int n_calls = 1000000;
+module_param(n_calls, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(n_calls, "Number of calls made by every thread");
+
+static unsigned int n_factory_calls = 10000;
+module_param(n_factory_calls, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(n_factory_calls,
+    "Number of calls made by every thread for factory interceptor "
+    "(every call binds the object and then forgets it)");
+
+static unsigned int max_handlers = 8;
+module_param(max_handlers, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(max_handlers,
+    "Maximum number of handlers for the operation (up to 16)");
+
+static unsigned int max_threads = 0;
+module_param(max_threads, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(max_threads,
+    "Maximum number of concurrent threads, 0 - number of online CPUs");
+
+static bool run_on_load = true;
+module_param(run_on_load, bool, S_IRUGO);
+MODULE_PARM_DESC(run_on_load, "Whether to run benchmark when module is loaded");
+
+//************************* Objects and operations ***********************//
+typedef void (*bench_op_t)(void* object, void* data);
+
+/* Operations of the object for indirect interceptors. */
+struct bench_operations
+{
+    bench_op_t op;
+};
+
+/*
+ * Object for all mechanisms: indirect interceptors intercept operation
+ * in 'ops', direct interceptor intercepts 'op' field itself. Offset of
+ * the operation is 0 in both cases, so intermediate and handlers are
+ * shared.
+ */
+struct bench_object
+{
+    bench_op_t op;
+    const struct bench_operations* ops;
+};
+
+/* Factory of the objects for factory interceptor. */
+struct bench_factory
+{
+    const struct bench_operations* factory_ops;
+};
+
+#define BENCH_OPERATION_OFFSET 0
+
+static noinline void bench_op_orig(void* object, void* data)
+{
+    // Prevent the call from being optimized out.
+    barrier();
+}
+
+/* Operations shared by all objects. */
+static struct bench_operations bench_ops =
+{
+    .op = bench_op_orig,
+};
+
+static struct bench_operations bench_factory_ops =
+{
+    .op = bench_op_orig,
+};
+
+static struct bench_factory bench_factory =
+{
+    .factory_ops = &bench_factory_ops,
+};
+
+//********************* Interceptors and payloads ***********************//
+static struct kedr_coi_interceptor* bench_interceptor;
+static struct kedr_coi_factory_interceptor* bench_factory_interceptor;
+
+static __always_inline void bench_call_handlers(
+    struct kedr_coi_intermediate_info* info,
+    void* const* handlers,
+    void* object,
+    void* data,
+    struct kedr_coi_operation_call_info* call_info)
+{
+    void (**handler)(void*, void*, struct kedr_coi_operation_call_info*);
+
+    for(handler = (typeof(handler))handlers; *handler != NULL; handler++)
+    {
+        struct kedr_coi_handler_timestamp handler_start;
+
+        if(info->measure != NULL)
+            kedr_coi_handler_start(info->measure, &handler_start);
+
+        (*handler)(object, data, call_info);
+
+        if(info->measure != NULL)
+            kedr_coi_handler_stop(info->measure, (void* const*)handler,
+                &handler_start);
+    }
+}
+
+/*
+ * Call the operation in the same way as intermediates generated from
+ * templates do.
+ */
+static __always_inline void bench_call_intercepted(void* object,
+    void* data,
+    struct kedr_coi_intermediate_info* info,
+    bench_op_t op)
+{
+    struct kedr_coi_operation_call_info call_info;
+    struct kedr_coi_hook_context hook_context;
+
+    call_info.return_address = __builtin_return_address(0);
+    call_info.op_orig = info->op_orig;
+
+    if(info->hooks != NULL)
+    {
+        hook_context.operation_offset = BENCH_OPERATION_OFFSET;
+        hook_context.object = object;
+        hook_context.return_address = call_info.return_address;
+        hook_context.n_args = 2;
+        hook_context.args[0] = (u64)(unsigned long)object;
+        hook_context.args[1] = (u64)(unsigned long)data;
+        hook_context.return_value = 0;
+        kedr_coi_hook_pre(info->hooks, &hook_context);
+    }
+
+    if(info->pre != NULL)
+        bench_call_handlers(info, info->pre, object, data, &call_info);
+
+    op(object, data);
+
+    if(info->post != NULL)
+        bench_call_handlers(info, info->post, object, data, &call_info);
+
+    if(info->hooks != NULL)
+        kedr_coi_hook_post(info->hooks, &hook_context);
+}
+
+static void bench_intermediate(void* object, void* data)
+{
+    struct kedr_coi_intermediate_info info;
+
+    kedr_coi_interceptor_get_intermediate_info(bench_interceptor,
+        object, BENCH_OPERATION_OFFSET, &info);
+
+    bench_call_intercepted(object, data, &info, (bench_op_t)info.op_orig);
+}
+
+static void bench_factory_intermediate(void* object, void* data)
+{
+    struct kedr_coi_intermediate_info info;
+    int result;
+
+    result = kedr_coi_factory_interceptor_bind_object(
+        bench_factory_interceptor, object, data,
+        BENCH_OPERATION_OFFSET, &info);
+    BUG_ON(result < 0);
+
+    bench_call_intercepted(object, data, &info, (bench_op_t)info.op_chained);
+}
+
+static struct kedr_coi_intermediate bench_intermediates[] =
+{
+    {
+        .operation_offset = BENCH_OPERATION_OFFSET,
+        .repl = (void*)&bench_intermediate,
+        .name = "op",
+    },
+    INTERMEDIATE_FINAL
+};
+
+static struct kedr_coi_intermediate bench_factory_intermediates[] =
+{
+    {
+        .operation_offset = BENCH_OPERATION_OFFSET,
+        .repl = (void*)&bench_factory_intermediate,
+        .name = "op",
+    },
+    INTERMEDIATE_FINAL
+};
+
+static noinline void bench_handler(void* object, void* data,
+    struct kedr_coi_operation_call_info* call_info)
+{
+    barrier();
+}
+
+static struct kedr_coi_handler bench_pre_handlers[] =
+{
+    {
+        .operation_offset = BENCH_OPERATION_OFFSET,
+        .func = (void*)&bench_handler,
+    },
+    kedr_coi_handler_end
+};
+
+/* Every payload adds one handler; filled at module load. */
+static struct kedr_coi_payload bench_payloads[BENCH_MAX_HANDLERS];
+
+//**************************** Mechanisms ******************************//
+enum bench_mechanism
+{
+    // Calls are not intercepted at all.
+    bench_mechanism_none = 0,
+    bench_mechanism_at_place,
+    bench_mechanism_use_copy,
+    bench_mechanism_direct,
+    // Every call binds new object to the interceptor.
+    bench_mechanism_factory,
+    bench_mechanism_count,
+};
+
+static const char* bench_mechanism_names[bench_mechanism_count] =
+{
+    [bench_mechanism_none] = "none",
+    [bench_mechanism_at_place] = "indirect_at_place",
+    [bench_mechanism_use_copy] = "indirect_use_copy",
+    [bench_mechanism_direct] = "direct",
+    [bench_mechanism_factory] = "factory",
+};
+
+static void bench_objects_init(struct bench_object* objects, unsigned int n)
+{
+    unsigned int i;
+
+    for(i = 0; i < n; i++)
+    {
+        objects[i].op = bench_op_orig;
+        objects[i].ops = &bench_ops;
+    }
+}
+
+static void bench_interceptors_destroy(void)
+{
+    if(bench_factory_interceptor)
+    {
+        kedr_coi_factory_interceptor_destroy(bench_factory_interceptor);
+        bench_factory_interceptor = NULL;
+    }
+    if(bench_interceptor)
+    {
+        kedr_coi_interceptor_destroy(bench_interceptor);
+        bench_interceptor = NULL;
+    }
+}
+
+static int bench_interceptors_create(enum bench_mechanism mechanism)
+{
+    switch(mechanism)
+    {
+    case bench_mechanism_none:
+        return 0;
+    case bench_mechanism_at_place:
+    case bench_mechanism_factory:
+        bench_interceptor = kedr_coi_interceptor_create_at_place(
+            "kedr_coi_benchmark",
+            offsetof(struct bench_object, ops),
+            sizeof(struct bench_operations),
+            bench_intermediates);
+        break;
+    case bench_mechanism_use_copy:
+        bench_interceptor = kedr_coi_interceptor_create_use_copy(
+            "kedr_coi_benchmark",
+            offsetof(struct bench_object, ops),
+            sizeof(struct bench_operations),
+            bench_intermediates);
+        break;
+    case bench_mechanism_direct:
+        bench_interceptor = kedr_coi_interceptor_create_direct(
+            "kedr_coi_benchmark",
+            sizeof(struct bench_object),
+            bench_intermediates);
+        break;
+    default:
+        BUG();
+    }
+
+    if(bench_interceptor == NULL)
+    {
+        pr_err("Failed to create interceptor.");
+        return -EINVAL;
+    }
+
+    if(mechanism != bench_mechanism_factory) return 0;
+
+    bench_factory_interceptor = kedr_coi_factory_interceptor_create(
+        bench_interceptor,
+        "kedr_coi_benchmark_factory",
+        offsetof(struct bench_factory, factory_ops),
+        bench_factory_intermediates);
+    if(bench_factory_interceptor == NULL)
+    {
+        pr_err("Failed to create factory interceptor.");
+        bench_interceptors_destroy();
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*
+ * Create interceptors for the mechanism with 'n_handlers' handlers,
+ * start them and watch for the objects.
+ */
+static int bench_setup(enum bench_mechanism mechanism,
+    unsigned int n_handlers,
+    struct bench_object* objects,
+    unsigned int n)
+{
+    unsigned int i;
+    unsigned int n_watched = 0;
+    int result;
+
+    result = bench_interceptors_create(mechanism);
+    if(result) return result;
+
+    if(mechanism == bench_mechanism_none) return 0;
+
+    for(i = 0; i < n_handlers; i++)
+    {
+        result = kedr_coi_payload_register(bench_interceptor,
+            &bench_payloads[i]);
+        if(result)
+        {
+            pr_err("Failed to register payload.");
+            goto err_payload;
+        }
+    }
+
+    result = kedr_coi_interceptor_start(bench_interceptor);
+    if(result)
+    {
+        pr_err("Failed to start interceptor.");
+        goto err_payload;
+    }
+
+    if(mechanism == bench_mechanism_factory)
+    {
+        result = kedr_coi_factory_interceptor_watch(
+            bench_factory_interceptor, &bench_factory);
+        if(result < 0)
+        {
+            pr_err("Failed to watch for the factory.");
+            goto err_watch;
+        }
+        return 0;
+    }
+
+    for(n_watched = 0; n_watched < n; n_watched++)
+    {
+        result = kedr_coi_interceptor_watch(bench_interceptor,
+            &objects[n_watched]);
+        if(result < 0)
+        {
+            pr_err("Failed to watch for the object.");
+            goto err_watch;
+        }
+    }
+
+    return 0;
+
+err_watch:
+    for(i = 0; i < n_watched; i++)
+        kedr_coi_interceptor_forget(bench_interceptor, &objects[i]);
+    kedr_coi_interceptor_stop(bench_interceptor);
+    i = n_handlers;
+err_payload:
+    while(i-- > 0)
+        kedr_coi_payload_unregister(bench_interceptor, &bench_payloads[i]);
+    bench_interceptors_destroy();
+    return result;
+}
+
+static void bench_teardown(enum bench_mechanism mechanism,
+    unsigned int n_handlers,
+    struct bench_object* objects,
+    unsigned int n)
+{
+    unsigned int i;
+
+    if(mechanism == bench_mechanism_none) return;
+
+    if(mechanism == bench_mechanism_factory)
+    {
+        kedr_coi_factory_interceptor_forget(bench_factory_interceptor,
+            &bench_factory);
+    }
+    else
+    {
+        for(i = 0; i < n; i++)
+            kedr_coi_interceptor_forget(bench_interceptor, &objects[i]);
+    }
+
+    kedr_coi_interceptor_stop(bench_interceptor);
+
+    for(i = 0; i < n_handlers; i++)
+        kedr_coi_payload_unregister(bench_interceptor, &bench_payloads[i]);
+
+    bench_interceptors_destroy();
+}
+
+//****************************** Threads *******************************//
+struct bench_thread
+{
+    struct task_struct* task;
+
+    enum bench_mechanism mechanism;
+    // Objects used only by this thread.
+    struct bench_object* objects;
+    unsigned int n_objects;
+    unsigned int n_calls;
+    // Time of all calls, in nanoseconds.
+    u64 time;
+};
+
+// Number of threads which are ready to start.
+static atomic_t bench_ready;
+// Set when all threads should start calls.
+static int bench_go;
+
+static int bench_thread_func(void* data)
+{
+    struct bench_thread* thread = data;
+    unsigned int i;
+    unsigned int j = 0;
+    ktime_t start;
+
+    atomic_inc(&bench_ready);
+    while(!READ_ONCE(bench_go))
+        cond_resched();
+
+    start = ktime_get();
+
+    switch(thread->mechanism)
+    {
+    case bench_mechanism_direct:
+        for(i = 0; i < thread->n_calls; i++)
+        {
+            struct bench_object* object = &thread->objects[j];
+
+            object->op(object, NULL);
+            if(++j == thread->n_objects) j = 0;
+        }
+        break;
+    case bench_mechanism_factory:
+        for(i = 0; i < thread->n_calls; i++)
+        {
+            struct bench_object* object = &thread->objects[j];
+
+            // As if the object is created by the factory.
+            object->ops = bench_factory.factory_ops;
+            object->ops->op(object, &bench_factory);
+            kedr_coi_interceptor_forget(bench_interceptor, object);
+            if(++j == thread->n_objects) j = 0;
+        }
+        break;
+    default:
+        for(i = 0; i < thread->n_calls; i++)
+        {
+            struct bench_object* object = &thread->objects[j];
+
+            object->ops->op(object, NULL);
+            if(++j == thread->n_objects) j = 0;
+        }
+        break;
+    }
+
+    thread->time = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+    return 0;
+}
+
+/*
+ * Run 'n_threads' threads on different CPUs, each of them calls
+ * operation for its part of the objects.
+ */
+static int bench_threads_run(struct bench_thread* threads,
+    unsigned int n_threads)
+{
+    unsigned int i;
+    int cpu = -1;
+    int result = 0;
+
+    atomic_set(&bench_ready, 0);
+    WRITE_ONCE(bench_go, 0);
+
+    for(i = 0; i < n_threads; i++)
+    {
+        struct task_struct* task;
+
+        cpu = cpumask_next(cpu, cpu_online_mask);
+        if(cpu >= nr_cpu_ids) cpu = cpumask_first(cpu_online_mask);
+
+        task = kthread_create(bench_thread_func, &threads[i],
+            "kedr_coi_bench/%u", i);
+        if(IS_ERR(task))
+        {
+            pr_err("Failed to create benchmark thread.");
+            result = PTR_ERR(task);
+            break;
+        }
+        // Thread may finish before kthread_stop() is called.
+        get_task_struct(task);
+        kthread_bind(task, cpu);
+        threads[i].task = task;
+        wake_up_process(task);
+    }
+    n_threads = i;
+
+    while(atomic_read(&bench_ready) < n_threads)
+        msleep(1);
+
+    WRITE_ONCE(bench_go, 1);
+
+    for(i = 0; i < n_threads; i++)
+    {
+        kthread_stop(threads[i].task);
+        put_task_struct(threads[i].task);
+    }
+
+    return result;
+}
+
+//****************************** Results *******************************//
+struct bench_result
+{
+    struct list_head list;
+
+    enum bench_mechanism mechanism;
+    unsigned int n_handlers;
+    bool watched;
+    unsigned int n_threads;
+    // Calls made by every thread.
+    unsigned int n_calls;
+    // Summary and maximum time of the threads, in nanoseconds.
+    u64 time_sum;
+    u64 time_max;
+};
+
+static LIST_HEAD(bench_results);
+// Protects results and serializes benchmark runs.
+static DEFINE_MUTEX(bench_mutex);
+
+static void bench_results_free(void)
+{
+    while(!list_empty(&bench_results))
+    {
+        struct bench_result* res = list_first_entry(&bench_results,
+            struct bench_result, list);
+
+        list_del(&res->list);
+        kfree(res);
+    }
+}
+
+static void bench_result_print(struct seq_file* m, struct bench_result* res)
+{
+    u64 calls = (u64)res->n_calls * res->n_threads;
+    // Time of one call in picoseconds.
+    u64 ps_per_call = div64_u64(res->time_sum * 1000, calls);
+    u64 calls_per_sec = res->time_max
+        ? div64_u64(calls * NSEC_PER_SEC, res->time_max) : 0;
+    char line[128];
+
+    snprintf(line, sizeof(line), "%s\t%u\t%s\t%u\t%llu.%03u\t%llu\n",
+        bench_mechanism_names[res->mechanism], res->n_handlers,
+        res->watched ? "watched" : "unwatched", res->n_threads,
+        (unsigned long long)div64_u64(ps_per_call, 1000),
+        (unsigned int)(ps_per_call - div64_u64(ps_per_call, 1000) * 1000),
+        (unsigned long long)calls_per_sec);
+
+    // Without seq_file the result is printed into the system log.
+    if(m)
+        seq_puts(m, line);
+    else
+        pr_info("%s", line);
+}
+
+//***************************** Benchmark ******************************//
+/*
+ * Measure calls for every number of threads: 1, 2, 4, ... up to
+ * 'threads_limit'.
+ */
+static int bench_measure(enum bench_mechanism mechanism,
+    unsigned int n_handlers,
+    bool watched,
+    struct bench_object* objects,
+    unsigned int n,
+    unsigned int threads_limit)
+{
+    struct bench_thread* threads;
+    unsigned int n_threads;
+    int result = 0;
+
+    threads = kcalloc(threads_limit, sizeof(*threads), GFP_KERNEL);
+    if(threads == NULL) return -ENOMEM;
+
+    for(n_threads = 1; ; n_threads = min(n_threads * 2, threads_limit))
+    {
+        struct bench_result* res;
+        unsigned int per_thread = n / n_threads;
+        unsigned int i;
+
+        // Factory binds objects, so every thread needs its own ones.
+        if(per_thread == 0)
+        {
+            pr_warn("Too few objects for %u threads.", n_threads);
+            break;
+        }
+
+        for(i = 0; i < n_threads; i++)
+        {
+            threads[i].mechanism = mechanism;
+            threads[i].objects = objects + i * per_thread;
+            threads[i].n_objects = per_thread;
+            threads[i].n_calls = (mechanism == bench_mechanism_factory)
+                ? n_factory_calls : n_calls;
+            threads[i].time = 0;
+        }
+
+        result = bench_threads_run(threads, n_threads);
+        if(result) break;
+
+        res = kzalloc(sizeof(*res), GFP_KERNEL);
+        if(res == NULL)
+        {
+            result = -ENOMEM;
+            break;
+        }
+
+        res->mechanism = mechanism;
+        res->n_handlers = n_handlers;
+        res->watched = watched;
+        res->n_threads = n_threads;
+        res->n_calls = threads[0].n_calls;
+        for(i = 0; i < n_threads; i++)
+        {
+            res->time_sum += threads[i].time;
+            res->time_max = max(res->time_max, threads[i].time);
+        }
+
+        bench_result_print(NULL, res);
+        list_add_tail(&res->list, &bench_results);
+
+        if(n_threads == threads_limit) break;
+    }
+
+    kfree(threads);
+
+    return result;
+}
+
+static int bench_run(void)
+{
+    struct bench_object* objects;
+    struct bench_object* unwatched;
+    unsigned int threads_limit = max_threads ? max_threads : num_online_cpus();
+    unsigned int handlers_limit = min_t(unsigned int, max_handlers,
+        BENCH_MAX_HANDLERS);
+    unsigned int n = n_objects;
+    enum bench_mechanism mechanism;
+    int result = 0;
+
+    if(n == 0) return -EINVAL;
+
+    objects = vmalloc(sizeof(*objects) * n * 2);
+    if(objects == NULL) return -ENOMEM;
+    unwatched = objects + n;
+
+    bench_results_free();
+
+    pr_info("Benchmark of interception overhead, kernel %s, %u CPUs.",
+        init_utsname()->release, num_online_cpus());
+    pr_info("# mechanism\thandlers\tobject\tthreads\tns_per_call\tcalls_per_sec\n");
+
+    for(mechanism = 0; mechanism < bench_mechanism_count; mechanism++)
+    {
+        unsigned int n_handlers = 0;
+
+        while(1)
+        {
+            bench_objects_init(objects, n);
+            bench_objects_init(unwatched, n);
+
+            result = bench_setup(mechanism, n_handlers, objects, n);
+            if(result) goto out;
+
+            /*
+             * Unwatched objects share operations with the watched ones,
+             * so they are affected by at-place replacement. Factory
+             * benchmark has no watched objects before the calls.
+             */
+            if(mechanism != bench_mechanism_none)
+                result = bench_measure(mechanism, n_handlers, true,
+                    objects, n, threads_limit);
+            if(!result && (mechanism != bench_mechanism_factory))
+                result = bench_measure(mechanism, n_handlers, false,
+                    unwatched, n, threads_limit);
+
+            bench_teardown(mechanism, n_handlers, objects, n);
+            if(result) goto out;
+
+            // Handlers make no sense without interception.
+            if(mechanism == bench_mechanism_none) break;
+            if(n_handlers >= handlers_limit) break;
+            n_handlers = (n_handlers == 0) ? 1 : handlers_limit;
+        }
+    }
+
+out:
+    vfree(objects);
+
+    return result;
+}
+
+//****************************** Debugfs *******************************//
+static struct dentry* bench_debugfs_dir;
+
+static int results_file_show(struct seq_file* m, void* v)
+{
+    struct bench_result* res;
+
+    mutex_lock(&bench_mutex);
+
+    seq_printf(m, "# kernel: %s, cpus: %u\n",
+        init_utsname()->release, num_online_cpus());
+    seq_puts(m, "# mechanism\thandlers\tobject\tthreads\tns_per_call\tcalls_per_sec\n");
+    list_for_each_entry(res, &bench_results, list)
+        bench_result_print(m, res);
+
+    mutex_unlock(&bench_mutex);
+
+    return 0;
+}
+
+static int results_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, results_file_show, inode->i_private);
+}
+
+static const struct file_operations results_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = results_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static ssize_t run_file_write(struct file* filp,
+    const char __user* buf, size_t count, loff_t* f_pos)
+{
+    int result;
+
+    result = mutex_lock_killable(&bench_mutex);
+    if(result) return result;
+
+    result = bench_run();
+
+    mutex_unlock(&bench_mutex);
+
+    return result ? result : count;
+}
+
+static const struct file_operations run_file_operations =
+{
+    .owner = THIS_MODULE,
+    .write = run_file_write,
+};
+
+//*************************** Initialization ***************************//
+static int __init bench_init(void)
+{
+    int i;
+    int result;
+
+    BUILD_BUG_ON(offsetof(struct bench_object, op) != BENCH_OPERATION_OFFSET);
+    BUILD_BUG_ON(offsetof(struct bench_operations, op) != BENCH_OPERATION_OFFSET);
+
+    for(i = 0; i < BENCH_MAX_HANDLERS; i++)
+        bench_payloads[i].pre_handlers = bench_pre_handlers;
+
+    bench_debugfs_dir = debugfs_create_dir("kedr_coi_benchmark_overhead",
+        NULL);
+    if(IS_ERR_OR_NULL(bench_debugfs_dir))
+    {
+        pr_err("Failed to create directory for benchmark in debugfs.");
+        return -EINVAL;
+    }
+
+    debugfs_create_file("results", S_IRUGO, bench_debugfs_dir, NULL,
+        &results_file_operations);
+    debugfs_create_file("run", S_IWUSR, bench_debugfs_dir, NULL,
+        &run_file_operations);
+
+    if(run_on_load)
+    {
+        mutex_lock(&bench_mutex);
+        result = bench_run();
+        mutex_unlock(&bench_mutex);
+
+        if(result)
+        {
+            pr_err("Benchmark failed: %d.", result);
+            debugfs_remove_recursive(bench_debugfs_dir);
+            bench_results_free();
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static void __exit bench_exit(void)
+{
+    debugfs_remove_recursive(bench_debugfs_dir);
+    bench_results_free();
+}
+
+module_init(bench_init);
+module_exit(bench_exit);
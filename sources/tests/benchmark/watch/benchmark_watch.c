@@ -0,0 +1,769 @@
+/*
+ * Benchmark for scalability of watching and forgetting objects.
+ *
+ * For every number of objects from 'min_objects' up to 'max_objects'
+ * (multiplied by 10 on every step) the module watches all objects with
+ * one interceptor and then forgets them. Objects are processed in
+ * sequential order, in random order and concurrently by threads on all
+ * online CPUs.
+ *
+ * For every step the module measures throughput of watch and forget,
+ * maximum time of one call (interceptor's lock is taken with interrupts
+ * disabled, so it is an upper bound of time with interrupts disabled),
+ * memory used per watched object, distribution of watched objects in
+ * the hash table and, for the sequential order, time of
+ * kedr_coi_interceptor_stop() for all objects still watched.
+ *
+ * Benchmark is run when the module is loaded and every time when
+ * anything is written to 'run' file in 'kedr_coi_benchmark_watch'
+ * directory in debugfs. Results are shown in 'results' file in the same
+ * directory, one step per line, and are printed into the system log.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#include "test_harness.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/utsname.h>
+
+MODULE_AUTHOR("Tsyvarev Andrey");
+MODULE_LICENSE("GPL");
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val) (ACCESS_ONCE(x) = (val))
+#endif
+
+static unsigned int min_objects = 1000;
+module_param(min_objects, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(min_objects, "Number of objects on the first step");
+
+static unsigned int max_objects = 10000000;
+module_param(max_objects, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(max_objects, "Maximum number of objects");
+
+static unsigned int max_threads = 0;
+module_param(max_threads, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(max_threads,
+    "Number of threads for concurrent order, 0 - number of online CPUs");
+
+static bool use_copy = false;
+module_param(use_copy, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(use_copy,
+    "Whether interceptor should use 'use_copy' mechanism instead of "
+    "'at_place'");
+
+static unsigned int time_limit_ms = 60000;
+module_param(time_limit_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(time_limit_ms,
+    "Time limit for watching objects on one step, in milliseconds. "
+    "When exceeded, rest objects are not watched and further steps "
+    "for the same order are skipped");
+
+static bool run_on_load = true;
+module_param(run_on_load, bool, S_IRUGO);
+MODULE_PARM_DESC(run_on_load, "Whether to run benchmark when module is loaded");
+
+//************************* Objects and operations ***********************//
+struct bench_operations
+{
+    void (*op)(void* object);
+};
+
+struct bench_object
+{
+    const struct bench_operations* ops;
+};
+
+static void bench_op_orig(void* object)
+{
+}
+
+/* Operations shared by all objects. */
+static struct bench_operations bench_ops =
+{
+    .op = bench_op_orig,
+};
+
+static struct kedr_coi_interceptor* bench_interceptor;
+
+/* Operation is never called by the benchmark, but should be correct. */
+static void bench_intermediate(void* object)
+{
+    struct kedr_coi_intermediate_info info;
+    int result;
+
+    result = kedr_coi_interceptor_get_intermediate_info(bench_interceptor,
+        object, offsetof(struct bench_operations, op), &info);
+    BUG_ON(result < 0);
+
+    ((typeof(bench_ops.op))info.op_orig)(object);
+}
+
+static struct kedr_coi_intermediate bench_intermediates[] =
+{
+    {
+        .operation_offset = offsetof(struct bench_operations, op),
+        .repl = (void*)&bench_intermediate,
+        .name = "op",
+    },
+    INTERMEDIATE_FINAL
+};
+
+//****************************** Orders ********************************//
+enum bench_order
+{
+    bench_order_sequential = 0,
+    bench_order_random,
+    // Random order, divided between threads.
+    bench_order_concurrent,
+    bench_order_count,
+};
+
+static const char* bench_order_names[bench_order_count] =
+{
+    [bench_order_sequential] = "sequential",
+    [bench_order_random] = "random",
+    [bench_order_concurrent] = "concurrent",
+};
+
+/*
+ * Simple pseudo-random generator (xorshift). Fixed seed makes the order
+ * the same for every run, so results are comparable.
+ */
+static u32 bench_random(u32* state)
+{
+    u32 x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+static void bench_order_fill(unsigned int* order, unsigned int n,
+    enum bench_order bench_order)
+{
+    unsigned int i;
+    u32 state = 2463534242U;
+
+    for(i = 0; i < n; i++)
+        order[i] = i;
+
+    if(bench_order == bench_order_sequential) return;
+
+    // Fisher-Yates shuffle.
+    for(i = n - 1; i > 0; i--)
+    {
+        unsigned int j = bench_random(&state) % (i + 1);
+        unsigned int tmp = order[i];
+
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+//****************************** Threads *******************************//
+struct bench_thread
+{
+    struct task_struct* task;
+
+    bool forget;
+    struct bench_object* objects;
+    // Part of the order processed by this thread.
+    const unsigned int* order;
+    unsigned int n;
+    // Watch stops after that moment, in nanoseconds.
+    u64 deadline;
+
+    // Number of objects processed. Forget processes objects watched.
+    unsigned int n_done;
+    // Time of all calls and maximum time of one call, in nanoseconds.
+    u64 time;
+    u64 time_max;
+    int result;
+};
+
+// Number of threads which are ready to start.
+static atomic_t bench_ready;
+// Set when all threads should start.
+static int bench_go;
+
+// Deadline is checked once per that number of objects.
+#define BENCH_DEADLINE_CHECK_PERIOD 1024
+
+static int bench_thread_func(void* data)
+{
+    struct bench_thread* thread = data;
+    unsigned int i;
+    ktime_t start;
+
+    atomic_inc(&bench_ready);
+    while(!READ_ONCE(bench_go))
+        cond_resched();
+
+    start = ktime_get();
+
+    for(i = 0; i < thread->n; i++)
+    {
+        struct bench_object* object = &thread->objects[thread->order[i]];
+        u64 call_start, call_time;
+        int result;
+
+        if(i % BENCH_DEADLINE_CHECK_PERIOD == 0)
+        {
+            // Steps with many objects may take a long time.
+            cond_resched();
+            if(!thread->forget
+                && (ktime_to_ns(ktime_get()) > thread->deadline))
+                break;
+        }
+
+        // Threads are bound to CPUs, so local clock is consistent.
+        call_start = local_clock();
+        if(thread->forget)
+            result = kedr_coi_interceptor_forget(bench_interceptor, object);
+        else
+            result = kedr_coi_interceptor_watch(bench_interceptor, object);
+        call_time = local_clock() - call_start;
+
+        if(result < 0)
+        {
+            thread->result = result;
+            break;
+        }
+        if(call_time > thread->time_max)
+            thread->time_max = call_time;
+    }
+
+    thread->n_done = i;
+    thread->time = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+    return 0;
+}
+
+/*
+ * Run 'n_threads' threads on different CPUs, each of them processes its
+ * part of the objects.
+ */
+static int bench_threads_run(struct bench_thread* threads,
+    unsigned int n_threads)
+{
+    unsigned int i;
+    int cpu = -1;
+    int result = 0;
+
+    atomic_set(&bench_ready, 0);
+    WRITE_ONCE(bench_go, 0);
+
+    for(i = 0; i < n_threads; i++)
+    {
+        struct task_struct* task;
+
+        cpu = cpumask_next(cpu, cpu_online_mask);
+        if(cpu >= nr_cpu_ids) cpu = cpumask_first(cpu_online_mask);
+
+        task = kthread_create(bench_thread_func, &threads[i],
+            "kedr_coi_bench/%u", i);
+        if(IS_ERR(task))
+        {
+            pr_err("Failed to create benchmark thread.");
+            result = PTR_ERR(task);
+            break;
+        }
+        // Thread may finish before kthread_stop() is called.
+        get_task_struct(task);
+        kthread_bind(task, cpu);
+        threads[i].task = task;
+        wake_up_process(task);
+    }
+    n_threads = i;
+
+    while(atomic_read(&bench_ready) < n_threads)
+        msleep(1);
+
+    WRITE_ONCE(bench_go, 1);
+
+    for(i = 0; i < n_threads; i++)
+    {
+        kthread_stop(threads[i].task);
+        put_task_struct(threads[i].task);
+        if(!result && threads[i].result)
+        {
+            pr_err("Failed to %s object: %d.",
+                threads[i].forget ? "forget" : "watch", threads[i].result);
+            result = threads[i].result;
+        }
+    }
+
+    return result;
+}
+
+//****************************** Results *******************************//
+struct bench_phase
+{
+    u64 time_sum;
+    // Wall time of the phase: maximum time of the threads.
+    u64 time_max;
+    // Maximum time of one call.
+    u64 call_max;
+};
+
+struct bench_result
+{
+    struct list_head list;
+
+    enum bench_order order;
+    unsigned int n_objects;
+    unsigned int n_threads;
+    // Less than 'n_objects' if time limit is exceeded.
+    unsigned int n_watched;
+
+    struct bench_phase watch;
+    struct bench_phase forget;
+
+    struct kedr_coi_interceptor_stat stat;
+    // Time of kedr_coi_interceptor_stop(), 0 if not measured.
+    u64 stop_time;
+};
+
+static LIST_HEAD(bench_results);
+// Protects results and serializes benchmark runs.
+static DEFINE_MUTEX(bench_mutex);
+
+static void bench_results_free(void)
+{
+    while(!list_empty(&bench_results))
+    {
+        struct bench_result* res = list_first_entry(&bench_results,
+            struct bench_result, list);
+
+        list_del(&res->list);
+        kfree(res);
+    }
+}
+
+#define BENCH_RESULT_HEADER "# order\tobjects\tthreads\twatched" \
+    "\twatch_ns\twatch_per_sec\twatch_max_ns" \
+    "\tforget_ns\tforget_per_sec\tforget_max_ns" \
+    "\tbytes_per_object\tbuckets\tbuckets_used\tmax_chain\tstop_ns\n"
+
+static void bench_phase_print(char* buf, size_t size,
+    const struct bench_phase* phase, unsigned int n)
+{
+    snprintf(buf, size, "%llu\t%llu\t%llu",
+        (unsigned long long)(n ? div64_u64(phase->time_sum, n) : 0),
+        (unsigned long long)(phase->time_max
+            ? div64_u64((u64)n * NSEC_PER_SEC, phase->time_max) : 0),
+        (unsigned long long)phase->call_max);
+}
+
+static void bench_result_print(struct seq_file* m, struct bench_result* res)
+{
+    char watch[64];
+    char forget[64];
+    char stop[24];
+    char line[256];
+
+    bench_phase_print(watch, sizeof(watch), &res->watch, res->n_watched);
+    bench_phase_print(forget, sizeof(forget), &res->forget, res->n_watched);
+
+    if(res->order == bench_order_sequential)
+        snprintf(stop, sizeof(stop), "%llu",
+            (unsigned long long)res->stop_time);
+    else
+        strcpy(stop, "-");
+
+    snprintf(line, sizeof(line),
+        "%s\t%u\t%u\t%u\t%s\t%s\t%zu\t%zu\t%zu\t%zu\t%s\n",
+        bench_order_names[res->order], res->n_objects, res->n_threads,
+        res->n_watched, watch, forget,
+        res->stat.n_watches ? res->stat.memory / res->stat.n_watches : 0,
+        res->stat.n_buckets, res->stat.n_buckets_used, res->stat.max_chain,
+        stop);
+
+    // Without seq_file the result is printed into the system log.
+    if(m)
+        seq_puts(m, line);
+    else
+        pr_info("%s", line);
+}
+
+//***************************** Benchmark ******************************//
+/*
+ * Watch or forget objects in given order by 'n_threads' threads.
+ *
+ * Forget should follow watch with the same threads: every thread
+ * forgets objects it has watched.
+ */
+static int bench_phase_run(struct bench_thread* threads,
+    unsigned int n_threads,
+    bool forget,
+    struct bench_object* objects,
+    const unsigned int* order,
+    unsigned int n,
+    struct bench_phase* phase)
+{
+    u64 deadline = ktime_to_ns(ktime_get())
+        + (u64)time_limit_ms * NSEC_PER_MSEC;
+    unsigned int i;
+    int result;
+
+    for(i = 0; i < n_threads; i++)
+    {
+        unsigned int from = div_u64((u64)n * i, n_threads);
+        unsigned int to = div_u64((u64)n * (i + 1), n_threads);
+
+        threads[i].forget = forget;
+        threads[i].objects = objects;
+        threads[i].order = order + from;
+        threads[i].n = forget ? threads[i].n_done : to - from;
+        threads[i].deadline = deadline;
+        threads[i].n_done = 0;
+        threads[i].time = 0;
+        threads[i].time_max = 0;
+        threads[i].result = 0;
+    }
+
+    result = bench_threads_run(threads, n_threads);
+
+    memset(phase, 0, sizeof(*phase));
+    for(i = 0; i < n_threads; i++)
+    {
+        phase->time_sum += threads[i].time;
+        phase->time_max = max(phase->time_max, threads[i].time);
+        phase->call_max = max(phase->call_max, threads[i].time_max);
+    }
+
+    return result;
+}
+
+/* Forget objects left watched after failed phase. */
+static void bench_forget_all(struct bench_object* objects, unsigned int n)
+{
+    unsigned int i;
+
+    for(i = 0; i < n; i++)
+    {
+        kedr_coi_interceptor_forget(bench_interceptor, &objects[i]);
+        if(i % BENCH_DEADLINE_CHECK_PERIOD == 0)
+            cond_resched();
+    }
+}
+
+/*
+ * Measure kedr_coi_interceptor_stop() with 'n' objects watched.
+ *
+ * Interceptor is started again after that.
+ */
+static int bench_measure_stop(struct bench_object* objects,
+    const unsigned int* order,
+    unsigned int n,
+    u64* stop_time)
+{
+    unsigned int i;
+    ktime_t start;
+    int result;
+
+    for(i = 0; i < n; i++)
+    {
+        result = kedr_coi_interceptor_watch(bench_interceptor,
+            &objects[order[i]]);
+        if(result < 0)
+        {
+            pr_err("Failed to watch object: %d.", result);
+            bench_forget_all(objects, n);
+            return result;
+        }
+        if(i % BENCH_DEADLINE_CHECK_PERIOD == 0)
+            cond_resched();
+    }
+
+    start = ktime_get();
+    kedr_coi_interceptor_stop(bench_interceptor);
+    *stop_time = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+    result = kedr_coi_interceptor_start(bench_interceptor);
+    if(result) pr_err("Failed to restart interceptor.");
+
+    return result;
+}
+
+/*
+ * Process one step: watch and forget 'n' objects in given order.
+ *
+ * Return 1 if time limit is exceeded.
+ */
+static int bench_step(enum bench_order bench_order,
+    struct bench_object* objects,
+    unsigned int* order,
+    unsigned int n,
+    struct bench_thread* threads,
+    unsigned int threads_limit)
+{
+    unsigned int n_threads = (bench_order == bench_order_concurrent)
+        ? min(threads_limit, n) : 1;
+    struct bench_result* res;
+    unsigned int i;
+    int result;
+
+    res = kzalloc(sizeof(*res), GFP_KERNEL);
+    if(res == NULL) return -ENOMEM;
+
+    res->order = bench_order;
+    res->n_objects = n;
+    res->n_threads = n_threads;
+
+    bench_order_fill(order, n, bench_order);
+
+    result = bench_phase_run(threads, n_threads, false, objects, order, n,
+        &res->watch);
+    if(result) goto err;
+
+    for(i = 0; i < n_threads; i++)
+        res->n_watched += threads[i].n_done;
+
+    result = kedr_coi_interceptor_get_stat(bench_interceptor, &res->stat);
+    if(result) goto err;
+
+    result = bench_phase_run(threads, n_threads, true, objects, order, n,
+        &res->forget);
+    if(result) goto err;
+
+    if(bench_order == bench_order_sequential)
+    {
+        result = bench_measure_stop(objects, order, res->n_watched,
+            &res->stop_time);
+        if(result)
+        {
+            kfree(res);
+            return result;
+        }
+    }
+
+    bench_result_print(NULL, res);
+    list_add_tail(&res->list, &bench_results);
+
+    return res->n_watched < n ? 1 : 0;
+
+err:
+    bench_forget_all(objects, n);
+    kfree(res);
+    return result;
+}
+
+static int bench_run(void)
+{
+    struct bench_object* objects;
+    unsigned int* order;
+    struct bench_thread* threads;
+    unsigned int threads_limit = max_threads ? max_threads : num_online_cpus();
+    bool limited[bench_order_count] = {false};
+    enum bench_order bench_order;
+    unsigned int i;
+    unsigned int n;
+    int result = 0;
+
+    if((min_objects == 0) || (min_objects > max_objects)) return -EINVAL;
+
+    threads = kcalloc(threads_limit, sizeof(*threads), GFP_KERNEL);
+    if(threads == NULL) return -ENOMEM;
+
+    if(use_copy)
+        bench_interceptor = kedr_coi_interceptor_create_use_copy(
+            "kedr_coi_benchmark_watch",
+            offsetof(struct bench_object, ops),
+            sizeof(struct bench_operations),
+            bench_intermediates);
+    else
+        bench_interceptor = kedr_coi_interceptor_create_at_place(
+            "kedr_coi_benchmark_watch",
+            offsetof(struct bench_object, ops),
+            sizeof(struct bench_operations),
+            bench_intermediates);
+    if(bench_interceptor == NULL)
+    {
+        pr_err("Failed to create interceptor.");
+        result = -EINVAL;
+        goto err_interceptor;
+    }
+
+    result = kedr_coi_interceptor_start(bench_interceptor);
+    if(result)
+    {
+        pr_err("Failed to start interceptor.");
+        goto err_start;
+    }
+
+    bench_results_free();
+
+    pr_info("Benchmark of watch and forget, kernel %s, %u CPUs, %s.",
+        init_utsname()->release, num_online_cpus(),
+        use_copy ? "use_copy" : "at_place");
+    pr_info(BENCH_RESULT_HEADER);
+
+    for(n = min_objects; n <= max_objects; n *= 10)
+    {
+        /*
+         * Memory for the largest steps may be unavailable, which is not
+         * an error of the benchmark.
+         */
+        objects = vmalloc(sizeof(*objects) * n);
+        order = vmalloc(sizeof(*order) * n);
+        if((objects == NULL) || (order == NULL))
+        {
+            pr_warn("Not enough memory for %u objects.", n);
+            vfree(order);
+            vfree(objects);
+            break;
+        }
+
+        for(i = 0; i < n; i++)
+            objects[i].ops = &bench_ops;
+
+        for(bench_order = 0; bench_order < bench_order_count; bench_order++)
+        {
+            if(limited[bench_order]) continue;
+
+            result = bench_step(bench_order, objects, order, n,
+                threads, threads_limit);
+            if(result < 0) break;
+            if(result > 0)
+            {
+                pr_warn("Time limit is exceeded for %s order, %u objects.",
+                    bench_order_names[bench_order], n);
+                limited[bench_order] = true;
+                result = 0;
+            }
+        }
+
+        vfree(order);
+        vfree(objects);
+
+        if(result) break;
+        if(n > max_objects / 10) break;
+    }
+
+    kedr_coi_interceptor_stop(bench_interceptor);
+err_start:
+    kedr_coi_interceptor_destroy(bench_interceptor);
+    bench_interceptor = NULL;
+err_interceptor:
+    kfree(threads);
+
+    return result;
+}
+
+//****************************** Debugfs *******************************//
+static struct dentry* bench_debugfs_dir;
+
+static int results_file_show(struct seq_file* m, void* v)
+{
+    struct bench_result* res;
+
+    mutex_lock(&bench_mutex);
+
+    seq_printf(m, "# kernel: %s, cpus: %u, mechanism: %s\n",
+        init_utsname()->release, num_online_cpus(),
+        use_copy ? "use_copy" : "at_place");
+    seq_puts(m, BENCH_RESULT_HEADER);
+    list_for_each_entry(res, &bench_results, list)
+        bench_result_print(m, res);
+
+    mutex_unlock(&bench_mutex);
+
+    return 0;
+}
+
+static int results_file_open(struct inode* inode, struct file* filp)
+{
+    return single_open(filp, results_file_show, inode->i_private);
+}
+
+static const struct file_operations results_file_operations =
+{
+    .owner = THIS_MODULE,
+    .open = results_file_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static ssize_t run_file_write(struct file* filp,
+    const char __user* buf, size_t count, loff_t* f_pos)
+{
+    int result;
+
+    result = mutex_lock_killable(&bench_mutex);
+    if(result) return result;
+
+    result = bench_run();
+
+    mutex_unlock(&bench_mutex);
+
+    return result ? result : count;
+}
+
+static const struct file_operations run_file_operations =
+{
+    .owner = THIS_MODULE,
+    .write = run_file_write,
+};
+
+//*************************** Initialization ***************************//
+static int __init bench_init(void)
+{
+    int result;
+
+    bench_debugfs_dir = debugfs_create_dir("kedr_coi_benchmark_watch", NULL);
+    if(IS_ERR_OR_NULL(bench_debugfs_dir))
+    {
+        pr_err("Failed to create directory for benchmark in debugfs.");
+        return -EINVAL;
+    }
+
+    debugfs_create_file("results", S_IRUGO, bench_debugfs_dir, NULL,
+        &results_file_operations);
+    debugfs_create_file("run", S_IWUSR, bench_debugfs_dir, NULL,
+        &run_file_operations);
+
+    if(run_on_load)
+    {
+        mutex_lock(&bench_mutex);
+        result = bench_run();
+        mutex_unlock(&bench_mutex);
+
+        if(result)
+        {
+            pr_err("Benchmark failed: %d.", result);
+            debugfs_remove_recursive(bench_debugfs_dir);
+            bench_results_free();
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static void __exit bench_exit(void)
+{
+    debugfs_remove_recursive(bench_debugfs_dir);
+    bench_results_free();
+}
+
+module_init(bench_init);
+module_exit(bench_exit);
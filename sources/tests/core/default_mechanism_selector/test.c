@@ -49,7 +49,7 @@ int test_run(void)
     res = kedr_coi_default_mechanism_selector(&buf_possibly_ro);
     
 // Currently returned value is depend from module's load implementation.
-#ifdef CONFIG_DEBUG_SET_MODULE_RONX
+#if defined(CONFIG_DEBUG_SET_MODULE_RONX) || defined(CONFIG_STRICT_MODULE_RWX)
     if(res)
     {
         pr_info("kedr_coi_default_mechanism_selector should return false for readonly module's data");
@@ -61,7 +61,7 @@ int test_run(void)
         pr_info("kedr_coi_default_mechanism_selector should return true for readonly module's data, if module loading implementation doesn't protect them");
         return -EINVAL;
     }
-#endif /* CONFIG_DEBUG_SET_MODULE_RONX */
+#endif /* defined(CONFIG_DEBUG_SET_MODULE_RONX) || defined(CONFIG_STRICT_MODULE_RWX) */
 
     if(res)
     {
@@ -69,7 +69,20 @@ int test_run(void)
         ((struct sample_ops_t*)&buf_possibly_ro)->op1 = NULL;
     }
     
-    // #3 - kernel data
+    // #3 - repeated requests are served from the table of module areas.
+    if(!kedr_coi_default_mechanism_selector(buf_writable))
+    {
+        pr_info("kedr_coi_default_mechanism_selector should return true for module's writable addresses when called again.");
+        return -EINVAL;
+    }
+    
+    if(kedr_coi_default_mechanism_selector(&buf_possibly_ro) != res)
+    {
+        pr_info("kedr_coi_default_mechanism_selector should return same value for readonly module's data when called again.");
+        return -EINVAL;
+    }
+    
+    // #4 - kernel data
     res = kedr_coi_default_mechanism_selector(current);
     
     if(res)
@@ -0,0 +1,234 @@
+/*
+ * Test that disabling operation for interceptor also disables
+ * factory handlers for that operation.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct test_operations, op_name)
+#include "test_harness.h"
+#include "test_harness_factory.h"
+
+/* Operations for test */
+struct test_operations
+{
+    void* some_field;
+    kedr_coi_test_op_t op1;
+    void* other_fields[5];
+    kedr_coi_test_op_t op2;
+};
+
+
+struct test_object
+{
+    int some_field;
+    const struct test_operations* ops;
+};
+
+int op1_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op1_orig, op1_call_counter);
+
+int op2_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op2_orig, op2_call_counter);
+
+struct test_operations test_operations_orig =
+{
+    .op1 = op1_orig,
+    .op2 = op2_orig
+};
+
+struct kedr_coi_interceptor* interceptor;
+
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl, OPERATION_OFFSET(op1), interceptor);
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op2_repl, OPERATION_OFFSET(op2), interceptor);
+
+static struct kedr_coi_intermediate intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_repl),
+    INTERMEDIATE(op2, op2_repl),
+    INTERMEDIATE_FINAL
+};
+
+// Factory type and factory interceptor
+struct test_factory
+{
+    int some_another_fields[7];
+    const struct test_operations* factory_ops;
+};
+
+static void* get_factory(void* data)
+{
+    return data;
+}
+
+struct kedr_coi_factory_interceptor* factory_interceptor;
+
+KEDR_COI_TEST_DEFINE_FACTORY_INTERMEDIATE_FUNC(op1_factory_repl,
+    get_factory, OPERATION_OFFSET(op1), factory_interceptor);
+
+static struct kedr_coi_intermediate factory_intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_factory_repl),
+    INTERMEDIATE_FINAL
+};
+
+// Factory payload
+int op1_pre1_factory_call_counter;
+KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op1_pre1_factory, op1_pre1_factory_call_counter)
+
+static struct kedr_coi_handler pre_handlers_factory[] =
+{
+    HANDLER(op1, op1_pre1_factory),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload payload_factory =
+{
+    .pre_handlers = pre_handlers_factory,
+};
+
+/*
+ * Create object from the factory, call its operation 1 and check
+ * whether factory handler is called.
+ *
+ * Return 0 on success.
+ */
+static int call_and_check(struct test_factory* factory,
+    int op1_handled)
+{
+    int result;
+    struct test_object object;
+
+    // As if normal object was created from prototype and its
+    // operation 1 was called.
+    object.ops = factory->factory_ops;
+
+    op1_call_counter = 0;
+    op1_pre1_factory_call_counter = 0;
+
+    object.ops->op1(&object, factory);
+
+    result = 0;
+
+    if(op1_call_counter == 0)
+    {
+        pr_err("Original operation 1 wasn't called.");
+        result = -EINVAL;
+    }
+    else if((op1_pre1_factory_call_counter != 0) != (op1_handled != 0))
+    {
+        pr_err("Factory handler for operation 1 is %s, but it shouldn't.",
+            op1_pre1_factory_call_counter ? "called" : "not called");
+        result = -EINVAL;
+    }
+
+    kedr_coi_interceptor_forget(interceptor, &object);
+
+    return result;
+}
+
+//******************Test infrastructure**********************************//
+int test_init(void)
+{
+    interceptor = INDIRECT_CONSTRUCTOR("Indirect interceptor with disabled operations",
+        offsetof(struct test_object, ops),
+        sizeof(struct test_operations),
+        intermediate_operations);
+    
+    if(interceptor == NULL)
+    {
+        pr_err("Failed to create interceptor for test.");
+        return -EINVAL;
+    }
+    
+    factory_interceptor = kedr_coi_factory_interceptor_create(
+        interceptor,
+        "Factory interceptor with disabled operations",
+        offsetof(struct test_factory, factory_ops),
+        factory_intermediate_operations);
+    
+    if(factory_interceptor == NULL)
+    {
+        pr_err("Failed to create factory interceptor for test.");
+        kedr_coi_interceptor_destroy(interceptor);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+void test_cleanup(void)
+{
+    kedr_coi_factory_interceptor_destroy(factory_interceptor);
+    kedr_coi_interceptor_destroy(interceptor);
+}
+
+// Test itself
+int test_run(void)
+{
+    int result;
+    struct test_factory factory = {.factory_ops = &test_operations_orig};
+    
+    result = kedr_coi_factory_payload_register(factory_interceptor,
+        &payload_factory);
+    if(result)
+    {
+        pr_err("Failed to register payload for factory.");
+        goto err_payload_factory;
+    }
+    
+    result = kedr_coi_interceptor_start(interceptor);
+    if(result)
+    {
+        pr_err("Interceptor failed to start.");
+        goto err_start;
+    }
+
+    result = kedr_coi_factory_interceptor_watch(factory_interceptor,
+        &factory);
+    if(result < 0)
+    {
+        pr_err("Factory interceptor failed to watch for an object.");
+        goto err_factory_watch;
+    }
+
+    result = call_and_check(&factory, 1);
+    if(result) goto err_test;
+
+    result = kedr_coi_interceptor_operation_disable(interceptor,
+        OPERATION_OFFSET(op1));
+    if(result)
+    {
+        pr_err("Failed to disable operation 1.");
+        goto err_test;
+    }
+
+    result = call_and_check(&factory, 0);
+    if(result) goto err_test;
+
+    result = kedr_coi_interceptor_operation_enable(interceptor,
+        OPERATION_OFFSET(op1));
+    if(result)
+    {
+        pr_err("Failed to enable operation 1.");
+        goto err_test;
+    }
+
+    result = call_and_check(&factory, 1);
+    if(result) goto err_test;
+
+    kedr_coi_factory_interceptor_forget(factory_interceptor, &factory);
+    kedr_coi_interceptor_stop(interceptor);
+    kedr_coi_factory_payload_unregister(factory_interceptor, &payload_factory);
+
+    return 0;
+
+err_test:
+    kedr_coi_factory_interceptor_forget(factory_interceptor, &factory);
+err_factory_watch:
+    kedr_coi_interceptor_stop(interceptor);
+err_start:
+    kedr_coi_factory_payload_unregister(factory_interceptor, &payload_factory);
+err_payload_factory:
+    kedr_coi_interceptor_operation_enable(interceptor, OPERATION_OFFSET(op1));
+    return result;
+}
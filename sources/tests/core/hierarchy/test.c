@@ -0,0 +1,264 @@
+/*
+ * Test hierarchy of watched objects: watching objects as children and
+ * forgetting descendants of the object.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct test_operations, op_name)
+#include "test_harness.h"
+
+/* Operations for test */
+struct test_operations
+{
+    void* some_field;
+    kedr_coi_test_op_t op1;
+};
+
+
+struct test_object
+{
+    int some_field;
+    const struct test_operations* ops;
+};
+
+
+int op1_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op1_orig, op1_call_counter);
+
+/* Parents and children use different interceptors, so different operations. */
+struct test_operations test_operations_parent =
+{
+    .op1 = op1_orig,
+};
+
+struct test_operations test_operations_child =
+{
+    .op1 = op1_orig,
+};
+
+struct kedr_coi_interceptor* parent_interceptor;
+struct kedr_coi_interceptor* child_interceptor;
+
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl_parent, OPERATION_OFFSET(op1), parent_interceptor);
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl_child, OPERATION_OFFSET(op1), child_interceptor);
+
+static struct kedr_coi_intermediate intermediate_operations_parent[] =
+{
+    INTERMEDIATE(op1, op1_repl_parent),
+    INTERMEDIATE_FINAL
+};
+
+static struct kedr_coi_intermediate intermediate_operations_child[] =
+{
+    INTERMEDIATE(op1, op1_repl_child),
+    INTERMEDIATE_FINAL
+};
+
+/* Check that object is (not) watched by forgetting it. */
+static int check_forget(struct kedr_coi_interceptor* interceptor,
+    struct test_object* object, int watched_expected, const char* object_name)
+{
+    int result = kedr_coi_interceptor_forget(interceptor, object);
+    
+    if(result < 0)
+    {
+        pr_err("Failed to forget %s.", object_name);
+        return result;
+    }
+    
+    if(watched_expected && (result == 1))
+    {
+        pr_err("%s is expected to be watched, but it is not.", object_name);
+        return -EINVAL;
+    }
+    else if(!watched_expected && (result == 0))
+    {
+        pr_err("%s is expected to be forgotten, but it is watched.", object_name);
+        return -EINVAL;
+    }
+    
+    return 0;
+}
+
+//******************Test infrastructure**********************************//
+int test_init(void)
+{
+    parent_interceptor = kedr_coi_interceptor_create_at_place(
+        "Parent interceptor",
+        offsetof(struct test_object, ops),
+        sizeof(struct test_operations),
+        intermediate_operations_parent);
+    
+    if(parent_interceptor == NULL)
+    {
+        pr_err("Failed to create parent interceptor for test.");
+        goto err_parent;
+    }
+    
+    child_interceptor = kedr_coi_interceptor_create_at_place(
+        "Child interceptor",
+        offsetof(struct test_object, ops),
+        sizeof(struct test_operations),
+        intermediate_operations_child);
+    
+    if(child_interceptor == NULL)
+    {
+        pr_err("Failed to create child interceptor for test.");
+        goto err_child;
+    }
+    
+    return 0;
+
+err_child:
+    kedr_coi_interceptor_destroy(parent_interceptor);
+err_parent:
+    return -EINVAL;
+}
+void test_cleanup(void)
+{
+    kedr_coi_interceptor_destroy(child_interceptor);
+    kedr_coi_interceptor_destroy(parent_interceptor);
+}
+
+// Test itself
+int test_run(void)
+{
+    int result;
+    struct test_object parent = {.ops = &test_operations_parent};
+    struct test_object unwatched = {.ops = &test_operations_parent};
+    struct test_object child1 = {.ops = &test_operations_child};
+    struct test_object child2 = {.ops = &test_operations_child};
+    struct test_object grandchild = {.ops = &test_operations_child};
+    
+    result = kedr_coi_interceptor_start(parent_interceptor);
+    if(result)
+    {
+        pr_err("Parent interceptor failed to start.");
+        goto err_start_parent;
+    }
+    
+    result = kedr_coi_interceptor_start(child_interceptor);
+    if(result)
+    {
+        pr_err("Child interceptor failed to start.");
+        goto err_start_child;
+    }
+    
+    result = kedr_coi_interceptor_watch(parent_interceptor, &parent);
+    if(result < 0)
+    {
+        pr_err("Interceptor failed to watch for the parent object.");
+        goto err_test;
+    }
+    
+    result = kedr_coi_interceptor_watch_child(child_interceptor, &child1,
+        parent_interceptor, &unwatched);
+    if(result != -ENOENT)
+    {
+        pr_err("Watching for a child of unwatched object should fail "
+            "with -ENOENT, but it returns %d.", result);
+        result = -EINVAL;
+        goto err_test;
+    }
+    
+    result = kedr_coi_interceptor_watch_child(child_interceptor, &child1,
+        parent_interceptor, &parent);
+    if(result < 0) goto err_watch_child;
+    
+    result = kedr_coi_interceptor_watch_child(child_interceptor, &child2,
+        parent_interceptor, &parent);
+    if(result < 0) goto err_watch_child;
+    
+    result = kedr_coi_interceptor_watch_child(child_interceptor, &grandchild,
+        child_interceptor, &child1);
+    if(result < 0) goto err_watch_child;
+    
+    // Cycles are not allowed.
+    result = kedr_coi_interceptor_watch_child(child_interceptor, &child1,
+        child_interceptor, &grandchild);
+    if(result != -EINVAL)
+    {
+        pr_err("Making object a child of its descendant should fail "
+            "with -EINVAL, but it returns %d.", result);
+        result = -EINVAL;
+        goto err_test;
+    }
+    
+    // Children are intercepted as normal watched objects.
+    op1_call_counter = 0;
+    grandchild.ops->op1(&grandchild, NULL);
+    if(op1_call_counter != 1)
+    {
+        pr_err("Operation of the child object wasn't called.");
+        result = -EINVAL;
+        goto err_test;
+    }
+    
+    result = kedr_coi_interceptor_forget_children(parent_interceptor, &parent);
+    if(result)
+    {
+        pr_err("Failed to forget children of the object.");
+        goto err_test;
+    }
+    
+    result = check_forget(child_interceptor, &child1, 0, "Child object");
+    if(result) goto err_test;
+    result = check_forget(child_interceptor, &child2, 0, "Child object");
+    if(result) goto err_test;
+    result = check_forget(child_interceptor, &grandchild, 0, "Grandchild object");
+    if(result) goto err_test;
+    
+    result = kedr_coi_interceptor_forget_children(parent_interceptor,
+        &unwatched);
+    if(result != 1)
+    {
+        pr_err("Forgetting children of unwatched object should return 1, "
+            "but it returns %d.", result);
+        result = -EINVAL;
+        goto err_test;
+    }
+    
+    // Forgetting of the object breaks relation with its children.
+    result = kedr_coi_interceptor_watch_child(child_interceptor, &child1,
+        parent_interceptor, &parent);
+    if(result < 0) goto err_watch_child;
+    
+    result = kedr_coi_interceptor_watch_child(child_interceptor, &grandchild,
+        child_interceptor, &child1);
+    if(result < 0) goto err_watch_child;
+    
+    result = check_forget(child_interceptor, &child1, 1, "Child object");
+    if(result) goto err_test;
+    
+    result = kedr_coi_interceptor_forget_children(parent_interceptor, &parent);
+    if(result)
+    {
+        pr_err("Failed to forget children of the object.");
+        goto err_test;
+    }
+    
+    result = check_forget(child_interceptor, &grandchild, 1, "Orphaned object");
+    if(result) goto err_test;
+    
+    result = check_forget(parent_interceptor, &parent, 1, "Parent object");
+    if(result) goto err_test;
+    
+    kedr_coi_interceptor_stop(child_interceptor);
+    kedr_coi_interceptor_stop(parent_interceptor);
+
+    return 0;
+
+err_watch_child:
+    pr_err("Interceptor failed to watch for a child object.");
+err_test:
+    kedr_coi_interceptor_forget(child_interceptor, &grandchild);
+    kedr_coi_interceptor_forget(child_interceptor, &child2);
+    kedr_coi_interceptor_forget(child_interceptor, &child1);
+    kedr_coi_interceptor_forget(parent_interceptor, &parent);
+    kedr_coi_interceptor_stop(child_interceptor);
+err_start_child:
+    kedr_coi_interceptor_stop(parent_interceptor);
+err_start_parent:
+    return result;
+}
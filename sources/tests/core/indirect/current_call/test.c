@@ -0,0 +1,208 @@
+/*
+ * Test that handlers see the current intercepted call and the call
+ * enclosing it, while no hooks are listened.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct test_operations, op_name)
+#include "test_harness.h"
+
+/* Operations for test */
+struct test_operations
+{
+    void* some_field;
+    kedr_coi_test_op_t op1;
+    kedr_coi_test_op_t op2;
+};
+
+
+struct test_object
+{
+    int some_field;
+    const struct test_operations* ops;
+};
+
+
+/* Operation 1 calls operation 2 of the same object. */
+int op1_call_counter = 0;
+static void op1_orig(void* object, void* data)
+{
+    struct test_object* test_object = object;
+
+    op1_call_counter++;
+    test_object->ops->op2(object, data);
+}
+
+int op2_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op2_orig, op2_call_counter);
+
+struct test_operations test_operations_orig =
+{
+    .op1 = op1_orig,
+    .op2 = op2_orig,
+};
+
+struct kedr_coi_interceptor* interceptor;
+
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl, OPERATION_OFFSET(op1), interceptor);
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op2_repl, OPERATION_OFFSET(op2), interceptor);
+
+static struct kedr_coi_intermediate intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_repl),
+    INTERMEDIATE(op2, op2_repl),
+    INTERMEDIATE_FINAL
+};
+
+/* Calls seen by handlers, as copies: contexts exist only during calls. */
+static struct kedr_coi_hook_context op1_call;
+static bool op1_call_found;
+static struct kedr_coi_hook_context op2_call;
+static bool op2_call_found;
+static struct kedr_coi_hook_context op2_parent;
+static bool op2_parent_found;
+
+static void op1_pre(void* object, void* data,
+    struct kedr_coi_operation_call_info* call_info, int unused)
+{
+    const struct kedr_coi_hook_context* call = kedr_coi_current_call();
+
+    op1_call_found = (call != NULL);
+    if(call) op1_call = *call;
+}
+
+static void op2_pre(void* object, void* data,
+    struct kedr_coi_operation_call_info* call_info, int unused)
+{
+    const struct kedr_coi_hook_context* call = kedr_coi_current_call();
+
+    op2_call_found = (call != NULL);
+    if(call == NULL) return;
+
+    op2_call = *call;
+    op2_parent_found = (call->parent != NULL);
+    if(call->parent) op2_parent = *call->parent;
+}
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    HANDLER(op1, op1_pre),
+    HANDLER(op2, op2_pre),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload payload =
+{
+    .pre_handlers = pre_handlers,
+};
+
+//******************Test infrastructure**********************************//
+int test_init(void)
+{
+    interceptor = INDIRECT_CONSTRUCTOR("Indirect interceptor with nested calls",
+        offsetof(struct test_object, ops),
+        sizeof(struct test_operations),
+        intermediate_operations);
+    
+    if(interceptor == NULL)
+    {
+        pr_err("Failed to create interceptor for test.");
+        return -EINVAL;
+    }
+    
+    return 0;
+}
+void test_cleanup(void)
+{
+    kedr_coi_interceptor_destroy(interceptor);
+}
+
+// Test itself
+int test_run(void)
+{
+    int result;
+    struct test_object object = {.ops = &test_operations_orig};
+    
+    result = kedr_coi_payload_register(interceptor, &payload);
+    if(result)
+    {
+        pr_err("Failed to register payload.");
+        goto err_payload;
+    }
+    
+    result = kedr_coi_interceptor_start(interceptor);
+    if(result)
+    {
+        pr_err("Interceptor failed to start.");
+        goto err_start;
+    }
+    
+    result = kedr_coi_interceptor_watch(interceptor, &object);
+    if(result < 0)
+    {
+        pr_err("Interceptor failed to watch for an object.");
+        goto err_watch;
+    }
+
+    object.ops->op1(&object, NULL);
+
+    result = -EINVAL;
+    
+    if((op1_call_counter == 0) || (op2_call_counter == 0))
+    {
+        pr_err("Original operations weren't called.");
+        goto err_test;
+    }
+    
+    if(!op1_call_found || !op2_call_found)
+    {
+        pr_err("Handler of operation %d doesn't see the current call.",
+            op1_call_found ? 2 : 1);
+        goto err_test;
+    }
+    
+    if((op1_call.operation_offset != OPERATION_OFFSET(op1))
+        || (op1_call.object != &object) || (op1_call.depth != 1))
+    {
+        pr_err("Incorrect current call for operation 1: offset %u, depth %d.",
+            op1_call.operation_offset, op1_call.depth);
+        goto err_test;
+    }
+    
+    if((op2_call.operation_offset != OPERATION_OFFSET(op2))
+        || (op2_call.depth != 2))
+    {
+        pr_err("Incorrect current call for operation 2: offset %u, depth %d.",
+            op2_call.operation_offset, op2_call.depth);
+        goto err_test;
+    }
+    
+    if(!op2_parent_found
+        || (op2_parent.operation_offset != OPERATION_OFFSET(op1)))
+    {
+        pr_err("Call of operation 1 should enclose call of operation 2.");
+        goto err_test;
+    }
+    
+    if(kedr_coi_current_call() != NULL)
+    {
+        pr_err("Call is reported as current after it is finished.");
+        goto err_test;
+    }
+    
+    kedr_coi_interceptor_forget(interceptor, &object);
+    kedr_coi_interceptor_stop(interceptor);
+    kedr_coi_payload_unregister(interceptor, &payload);
+
+    return 0;
+
+err_test:
+    kedr_coi_interceptor_forget(interceptor, &object);
+err_watch:
+    kedr_coi_interceptor_stop(interceptor);
+err_start:
+    kedr_coi_payload_unregister(interceptor, &payload);
+err_payload:
+    return result;
+}
@@ -0,0 +1,221 @@
+/*
+ * Test disabling and enabling of handlers for particular operation.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct test_operations, op_name)
+#include "test_harness.h"
+
+/* Operations for test */
+struct test_operations
+{
+    void* some_field;
+    kedr_coi_test_op_t op1;
+    kedr_coi_test_op_t op2;
+    kedr_coi_test_op_t op3;
+};
+
+
+struct test_object
+{
+    int some_field;
+    const struct test_operations* ops;
+};
+
+
+int op1_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op1_orig, op1_call_counter);
+
+int op2_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op2_orig, op2_call_counter);
+
+struct test_operations test_operations_orig =
+{
+    .op1 = op1_orig,
+    .op2 = op2_orig,
+};
+
+struct kedr_coi_interceptor* interceptor;
+
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl, OPERATION_OFFSET(op1), interceptor);
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op2_repl, OPERATION_OFFSET(op2), interceptor);
+
+/* No intermediate for op3. */
+static struct kedr_coi_intermediate intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_repl),
+    INTERMEDIATE(op2, op2_repl),
+    INTERMEDIATE_FINAL
+};
+
+
+int op1_pre1_call_counter;
+KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op1_pre1, op1_pre1_call_counter)
+
+int op2_pre1_call_counter;
+KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op2_pre1, op2_pre1_call_counter)
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    HANDLER(op1, op1_pre1),
+    HANDLER(op2, op2_pre1),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload payload =
+{
+    .pre_handlers = pre_handlers,
+};
+
+/* 
+ * Call both operations and check which handlers are called.
+ * 
+ * Return 0 on success.
+ */
+static int call_and_check(struct test_object* object,
+    int op1_handled, int op2_handled)
+{
+    op1_call_counter = 0;
+    op2_call_counter = 0;
+    op1_pre1_call_counter = 0;
+    op2_pre1_call_counter = 0;
+    
+    object->ops->op1(object, NULL);
+    object->ops->op2(object, NULL);
+    
+    if((op1_call_counter == 0) || (op2_call_counter == 0))
+    {
+        pr_err("Original operations weren't called.");
+        return -EINVAL;
+    }
+    
+    if((op1_pre1_call_counter != 0) != (op1_handled != 0))
+    {
+        pr_err("Handler for operation 1 is %s, but it shouldn't.",
+            op1_pre1_call_counter ? "called" : "not called");
+        return -EINVAL;
+    }
+
+    if((op2_pre1_call_counter != 0) != (op2_handled != 0))
+    {
+        pr_err("Handler for operation 2 is %s, but it shouldn't.",
+            op2_pre1_call_counter ? "called" : "not called");
+        return -EINVAL;
+    }
+    
+    return 0;
+}
+
+//******************Test infrastructure**********************************//
+int test_init(void)
+{
+    interceptor = INDIRECT_CONSTRUCTOR("Indirect interceptor with disabled operations",
+        offsetof(struct test_object, ops),
+        sizeof(struct test_operations),
+        intermediate_operations);
+    
+    if(interceptor == NULL)
+    {
+        pr_err("Failed to create interceptor for test.");
+        return -EINVAL;
+    }
+    
+    return 0;
+}
+void test_cleanup(void)
+{
+    kedr_coi_interceptor_destroy(interceptor);
+}
+
+// Test itself
+int test_run(void)
+{
+    int result;
+    struct test_object object = {.ops = &test_operations_orig};
+    
+    if(kedr_coi_interceptor_operation_disable(interceptor,
+        OPERATION_OFFSET(op3)) != -EINVAL)
+    {
+        pr_err("Disabling of operation without intermediate should fail.");
+        return -EINVAL;
+    }
+    
+    if(kedr_coi_interceptor_operation_is_enabled(interceptor,
+        OPERATION_OFFSET(op3)) != -EINVAL)
+    {
+        pr_err("State of operation without intermediate should be unknown.");
+        return -EINVAL;
+    }
+    
+    result = kedr_coi_payload_register(interceptor, &payload);
+    
+    if(result)
+    {
+        pr_err("Failed to register payload.");
+        goto err_payload;
+    }
+    
+    result = kedr_coi_interceptor_start(interceptor);
+    if(result)
+    {
+        pr_err("Interceptor failed to start.");
+        goto err_start;
+    }
+    
+    result = kedr_coi_interceptor_watch(interceptor, &object);
+    if(result < 0)
+    {
+        pr_err("Interceptor failed to watch for an object.");
+        goto err_watch;
+    }
+
+    result = call_and_check(&object, 1, 1);
+    if(result) goto err_test;
+    
+    result = kedr_coi_interceptor_operation_disable(interceptor,
+        OPERATION_OFFSET(op1));
+    if(result)
+    {
+        pr_err("Failed to disable operation 1.");
+        goto err_test;
+    }
+    
+    if(kedr_coi_interceptor_operation_is_enabled(interceptor,
+        OPERATION_OFFSET(op1)) != 0)
+    {
+        pr_err("Operation 1 is reported as enabled after disabling.");
+        result = -EINVAL;
+        goto err_test;
+    }
+    
+    result = call_and_check(&object, 0, 1);
+    if(result) goto err_test;
+    
+    result = kedr_coi_interceptor_operation_enable(interceptor,
+        OPERATION_OFFSET(op1));
+    if(result)
+    {
+        pr_err("Failed to enable operation 1.");
+        goto err_test;
+    }
+    
+    result = call_and_check(&object, 1, 1);
+    if(result) goto err_test;
+    
+    kedr_coi_interceptor_forget(interceptor, &object);
+    kedr_coi_interceptor_stop(interceptor);
+    kedr_coi_payload_unregister(interceptor, &payload);
+
+    return 0;
+
+err_test:
+    kedr_coi_interceptor_forget(interceptor, &object);
+err_watch:
+    kedr_coi_interceptor_stop(interceptor);
+err_start:
+    kedr_coi_payload_unregister(interceptor, &payload);
+err_payload:
+    kedr_coi_interceptor_operation_enable(interceptor, OPERATION_OFFSET(op1));
+    return result;
+}
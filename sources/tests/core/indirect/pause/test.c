@@ -0,0 +1,197 @@
+/*
+ * Test pausing and resuming of indirect interceptor.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct test_operations, op_name)
+#include "test_harness.h"
+
+/* Operations for test */
+struct test_operations
+{
+    void* some_field;
+    kedr_coi_test_op_t op1;
+};
+
+
+struct test_object
+{
+    int some_field;
+    const struct test_operations* ops;
+};
+
+
+int op1_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op1_orig, op1_call_counter);
+
+struct test_operations test_operations_orig =
+{
+    .op1 = op1_orig,
+};
+
+struct kedr_coi_interceptor* interceptor;
+
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl, OPERATION_OFFSET(op1), interceptor);
+
+static struct kedr_coi_intermediate intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_repl),
+    INTERMEDIATE_FINAL
+};
+
+
+int op1_pre1_call_counter;
+KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op1_pre1, op1_pre1_call_counter)
+
+int op1_post1_call_counter;
+KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op1_post1, op1_post1_call_counter)
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    HANDLER(op1, op1_pre1),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_handler post_handlers[] =
+{
+    HANDLER(op1, op1_post1),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload payload =
+{
+    .pre_handlers = pre_handlers,
+    .post_handlers = post_handlers
+};
+
+/* 
+ * Call operation and check whether handlers are called.
+ * 
+ * Return 0 on success.
+ */
+static int call_and_check(struct test_object* object, int handlers_expected)
+{
+    op1_call_counter = 0;
+    op1_pre1_call_counter = 0;
+    op1_post1_call_counter = 0;
+    
+    object->ops->op1(object, NULL);
+    
+    if(op1_call_counter == 0)
+    {
+        pr_err("Original operation wasn't called.");
+        return -EINVAL;
+    }
+    
+    if(handlers_expected)
+    {
+        if((op1_pre1_call_counter == 0) || (op1_post1_call_counter == 0))
+        {
+            pr_err("Handlers weren't called while interception is active.");
+            return -EINVAL;
+        }
+    }
+    else
+    {
+        if((op1_pre1_call_counter != 0) || (op1_post1_call_counter != 0))
+        {
+            pr_err("Handlers were called while interception is paused.");
+            return -EINVAL;
+        }
+    }
+    
+    return 0;
+}
+
+//******************Test infrastructure**********************************//
+int test_init(void)
+{
+    interceptor = INDIRECT_CONSTRUCTOR("Paused indirect interceptor",
+        offsetof(struct test_object, ops),
+        sizeof(struct test_operations),
+        intermediate_operations);
+    
+    if(interceptor == NULL)
+    {
+        pr_err("Failed to create interceptor for test.");
+        return -EINVAL;
+    }
+    
+    return 0;
+}
+void test_cleanup(void)
+{
+    kedr_coi_interceptor_destroy(interceptor);
+}
+
+// Test itself
+int test_run(void)
+{
+    int result;
+    struct test_object object = {.ops = &test_operations_orig};
+    
+    result = kedr_coi_payload_register(interceptor, &payload);
+    
+    if(result)
+    {
+        pr_err("Failed to register payload.");
+        goto err_payload;
+    }
+    
+    result = kedr_coi_interceptor_start(interceptor);
+    if(result)
+    {
+        pr_err("Interceptor failed to start.");
+        goto err_start;
+    }
+    
+    result = kedr_coi_interceptor_watch(interceptor, &object);
+    if(result < 0)
+    {
+        pr_err("Interceptor failed to watch for an object.");
+        goto err_watch;
+    }
+
+    result = call_and_check(&object, 1);
+    if(result) goto err_test;
+    
+    kedr_coi_interceptor_pause(interceptor);
+    if(!kedr_coi_interceptor_is_paused(interceptor))
+    {
+        pr_err("Interceptor isn't reported as paused after pause.");
+        result = -EINVAL;
+        goto err_test;
+    }
+    
+    result = call_and_check(&object, 0);
+    if(result) goto err_test;
+    
+    kedr_coi_interceptor_resume(interceptor);
+    if(kedr_coi_interceptor_is_paused(interceptor))
+    {
+        pr_err("Interceptor is reported as paused after resume.");
+        result = -EINVAL;
+        goto err_test;
+    }
+    
+    // Object should be intercepted without watching it again.
+    result = call_and_check(&object, 1);
+    if(result) goto err_test;
+    
+    kedr_coi_interceptor_forget(interceptor, &object);
+    kedr_coi_interceptor_stop(interceptor);
+    kedr_coi_payload_unregister(interceptor, &payload);
+
+    return 0;
+
+err_test:
+    kedr_coi_interceptor_resume(interceptor);
+    kedr_coi_interceptor_forget(interceptor, &object);
+err_watch:
+    kedr_coi_interceptor_stop(interceptor);
+err_start:
+    kedr_coi_payload_unregister(interceptor, &payload);
+err_payload:
+    return result;
+}
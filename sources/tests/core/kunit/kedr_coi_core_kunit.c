@@ -0,0 +1,749 @@
+/*
+ * KUnit suites for the core of the interceptors.
+ *
+ * Every suite checks one kind of interceptors: indirect ones (both
+ * mechanisms of interception), direct ones and factory ones. All suites
+ * are contained in one module, so the whole set is executed by single
+ * module loading, either on a real kernel or on UML one.
+ *
+ * Cases are ported from the tests in the neighbour directories, which
+ * are kept as is: every such test is a separate module and checks
+ * more details.
+ *
+ * Apart from functional checks, suites contain performance cases for
+ * the hot paths of the interception: intercepted call and watching of
+ * the object. Average time of these operations is compared with the
+ * bounds set by the module parameters. Bounds are generous, so cases
+ * fail only on severe regressions; 0 value disables the check.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct test_operations, op_name)
+#include "test_harness.h"
+#include "test_harness_factory.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#include <kunit/test.h>
+
+MODULE_AUTHOR("Tsyvarev Andrey");
+MODULE_LICENSE("GPL");
+
+static unsigned int perf_iterations = 100000;
+module_param(perf_iterations, uint, S_IRUGO);
+MODULE_PARM_DESC(perf_iterations,
+    "Number of iterations in the performance cases");
+
+static unsigned long max_call_overhead_ns = 1000;
+module_param(max_call_overhead_ns, ulong, S_IRUGO);
+MODULE_PARM_DESC(max_call_overhead_ns,
+    "Maximum overhead of the intercepted call, in nanoseconds (0 - no limit)");
+
+static unsigned long max_watch_ns = 20000;
+module_param(max_watch_ns, ulong, S_IRUGO);
+MODULE_PARM_DESC(max_watch_ns,
+    "Maximum time of watching and forgetting the object, in nanoseconds "
+    "(0 - no limit)");
+
+/* Objects used by performance cases. */
+#define KUNIT_PERF_OBJECTS 256
+
+//************************* Objects and operations ***********************//
+
+/* Operations for indirect and factory interceptors */
+struct test_operations
+{
+    void* some_field;
+    kedr_coi_test_op_t op1;
+    void* other_fields[5];
+    kedr_coi_test_op_t op2;
+};
+
+struct test_object
+{
+    int some_field;
+    const struct test_operations* ops;
+};
+
+/*
+ * Object for direct interceptor.
+ *
+ * Layout of the operations is the same as in 'struct test_operations',
+ * so intermediates and handlers are shared by all interceptors.
+ */
+struct test_direct_object
+{
+    void* some_field;
+    kedr_coi_test_op_t op1;
+    void* other_fields[5];
+    kedr_coi_test_op_t op2;
+};
+
+/* Factory for factory interceptor */
+struct test_factory
+{
+    int some_another_fields[7];
+    const struct test_operations* factory_ops;
+};
+
+static int op1_call_counter;
+static KEDR_COI_TEST_DEFINE_OP_ORIG(op1_orig, op1_call_counter);
+
+static int op2_call_counter;
+static KEDR_COI_TEST_DEFINE_OP_ORIG(op2_orig, op2_call_counter);
+
+/*
+ * Replaced by indirect interceptor when 'at place' mechanism is used,
+ * so the field isn't const.
+ */
+static struct test_operations test_operations_orig =
+{
+    .op1 = op1_orig,
+    .op2 = op2_orig
+};
+
+/* Interceptors for the current case, set by suite's 'init' */
+static struct kedr_coi_interceptor* interceptor;
+static struct kedr_coi_factory_interceptor* factory_interceptor;
+
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl, OPERATION_OFFSET(op1), interceptor);
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op2_repl, OPERATION_OFFSET(op2), interceptor);
+
+static struct kedr_coi_intermediate intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_repl),
+    INTERMEDIATE(op2, op2_repl),
+    INTERMEDIATE_FINAL
+};
+
+static void* get_factory(void* data)
+{
+    return data;
+}
+
+static KEDR_COI_TEST_DEFINE_FACTORY_INTERMEDIATE_FUNC(op1_factory_repl,
+    get_factory, OPERATION_OFFSET(op1), factory_interceptor);
+
+static struct kedr_coi_intermediate factory_intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_factory_repl),
+    INTERMEDIATE_FINAL
+};
+
+//******************************* Payloads *******************************//
+static int op1_pre1_call_counter;
+static KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op1_pre1, op1_pre1_call_counter)
+
+static int op2_post1_call_counter;
+static KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op2_post1, op2_post1_call_counter)
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    HANDLER(op1, op1_pre1),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_handler post_handlers[] =
+{
+    HANDLER(op2, op2_post1),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload payload =
+{
+    .pre_handlers = pre_handlers,
+    .post_handlers = post_handlers
+};
+
+/* Second payload, with handlers for the same operation. */
+static int op1_pre2_call_counter;
+static KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op1_pre2, op1_pre2_call_counter)
+
+static struct kedr_coi_handler pre_handlers2[] =
+{
+    HANDLER(op1, op1_pre2),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload payload2 =
+{
+    .pre_handlers = pre_handlers2,
+};
+
+static void reset_counters(void)
+{
+    op1_call_counter = 0;
+    op2_call_counter = 0;
+    op1_pre1_call_counter = 0;
+    op2_post1_call_counter = 0;
+    op1_pre2_call_counter = 0;
+}
+
+//************************** Context of the case **************************//
+/*
+ * Objects and state of the interceptor used by the case.
+ *
+ * Failed assertion aborts the case, so everything is cleaned in the
+ * suite's 'exit' callback according to the context.
+ */
+struct kunit_coi_context
+{
+    bool payload_registered;
+    bool payload2_registered;
+    bool started;
+
+    struct test_object objects[KUNIT_PERF_OBJECTS];
+    struct test_direct_object direct_objects[KUNIT_PERF_OBJECTS];
+    struct test_factory factory;
+};
+
+static int kunit_coi_context_init(struct kunit* test)
+{
+    struct kunit_coi_context* ctx;
+    int i;
+
+    ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+    if(ctx == NULL) return -ENOMEM;
+
+    for(i = 0; i < KUNIT_PERF_OBJECTS; i++)
+    {
+        ctx->objects[i].ops = &test_operations_orig;
+        ctx->direct_objects[i].op1 = op1_orig;
+        ctx->direct_objects[i].op2 = op2_orig;
+    }
+    ctx->factory.factory_ops = &test_operations_orig;
+
+    test->priv = ctx;
+
+    reset_counters();
+
+    return 0;
+}
+
+/* Register given payloads and start interceptor. */
+static void kunit_coi_start(struct kunit* test, bool with_payload2)
+{
+    struct kunit_coi_context* ctx = test->priv;
+
+    KUNIT_ASSERT_EQ(test, kedr_coi_payload_register(interceptor, &payload), 0);
+    ctx->payload_registered = true;
+
+    if(with_payload2)
+    {
+        KUNIT_ASSERT_EQ(test,
+            kedr_coi_payload_register(interceptor, &payload2), 0);
+        ctx->payload2_registered = true;
+    }
+
+    KUNIT_ASSERT_EQ(test, kedr_coi_interceptor_start(interceptor), 0);
+    ctx->started = true;
+}
+
+/*
+ * Stop interceptor and unregister payloads.
+ *
+ * Objects which are still watched are forgotten by the interceptor.
+ */
+static void kunit_coi_stop(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+
+    if(ctx == NULL) return;
+
+    if(kedr_coi_interceptor_is_paused(interceptor))
+        kedr_coi_interceptor_resume(interceptor);
+
+    if(ctx->started)
+    {
+        kedr_coi_interceptor_stop(interceptor);
+        ctx->started = false;
+    }
+    if(ctx->payload2_registered)
+    {
+        kedr_coi_payload_unregister(interceptor, &payload2);
+        ctx->payload2_registered = false;
+    }
+    if(ctx->payload_registered)
+    {
+        kedr_coi_payload_unregister(interceptor, &payload);
+        ctx->payload_registered = false;
+    }
+}
+
+/* Watch for object and check the result. */
+#define KUNIT_COI_WATCH(test, object) \
+    KUNIT_ASSERT_GE(test, kedr_coi_interceptor_watch(interceptor, object), 0)
+
+//************************** Suites' callbacks ****************************//
+static int indirect_init_common(struct kunit* test, bool use_copy)
+{
+    if(use_copy)
+        interceptor = kedr_coi_interceptor_create_use_copy(
+            "KUnit indirect interceptor",
+            offsetof(struct test_object, ops),
+            sizeof(struct test_operations),
+            intermediate_operations);
+    else
+        interceptor = kedr_coi_interceptor_create_at_place(
+            "KUnit indirect interceptor",
+            offsetof(struct test_object, ops),
+            sizeof(struct test_operations),
+            intermediate_operations);
+
+    if(interceptor == NULL) return -ENOMEM;
+
+    return kunit_coi_context_init(test);
+}
+
+static int indirect_at_place_init(struct kunit* test)
+{
+    return indirect_init_common(test, false);
+}
+
+static int indirect_use_copy_init(struct kunit* test)
+{
+    return indirect_init_common(test, true);
+}
+
+static int direct_init(struct kunit* test)
+{
+    interceptor = kedr_coi_interceptor_create_direct(
+        "KUnit direct interceptor",
+        sizeof(struct test_direct_object),
+        intermediate_operations);
+
+    if(interceptor == NULL) return -ENOMEM;
+
+    return kunit_coi_context_init(test);
+}
+
+static int factory_init(struct kunit* test)
+{
+    int result = indirect_at_place_init(test);
+    if(result) return result;
+
+    factory_interceptor = kedr_coi_factory_interceptor_create(
+        interceptor,
+        "KUnit factory interceptor",
+        offsetof(struct test_factory, factory_ops),
+        factory_intermediate_operations);
+
+    /* Interceptor itself is destroyed in 'exit' callback. */
+    if(factory_interceptor == NULL) return -ENOMEM;
+
+    return 0;
+}
+
+static void interceptor_exit(struct kunit* test)
+{
+    kunit_coi_stop(test);
+
+    if(factory_interceptor)
+    {
+        kedr_coi_factory_interceptor_destroy(factory_interceptor);
+        factory_interceptor = NULL;
+    }
+
+    if(interceptor)
+    {
+        kedr_coi_interceptor_destroy(interceptor);
+        interceptor = NULL;
+    }
+}
+
+//******************************** Indirect ********************************//
+static void indirect_base(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_object* object = &ctx->objects[0];
+
+    kunit_coi_start(test, false);
+    KUNIT_COI_WATCH(test, object);
+
+    object->ops->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+
+    object->ops->op2(object, NULL);
+    KUNIT_EXPECT_EQ(test, op2_post1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op2_call_counter, 1);
+
+    KUNIT_EXPECT_EQ(test, kedr_coi_interceptor_forget(interceptor, object), 0);
+    // Object is no longer watched.
+    KUNIT_EXPECT_EQ(test, kedr_coi_interceptor_forget(interceptor, object), 1);
+}
+
+static void indirect_several_payloads(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_object* object = &ctx->objects[0];
+
+    kunit_coi_start(test, true);
+    KUNIT_COI_WATCH(test, object);
+
+    object->ops->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_pre2_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+}
+
+static void indirect_update(struct kunit* test)
+{
+    static struct test_operations test_operations_other =
+    {
+        .op1 = op1_orig,
+        .op2 = op2_orig
+    };
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_object* object = &ctx->objects[0];
+
+    kunit_coi_start(test, false);
+    KUNIT_COI_WATCH(test, object);
+    // Simple another call of 'watch'
+    KUNIT_COI_WATCH(test, object);
+
+    object->ops->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+
+    // Operations in the object was set to another ones
+    object->ops = &test_operations_other;
+    KUNIT_COI_WATCH(test, object);
+
+    reset_counters();
+    object->ops->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+
+    kedr_coi_interceptor_forget(interceptor, object);
+}
+
+static void indirect_pause(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_object* object = &ctx->objects[0];
+
+    kunit_coi_start(test, false);
+    KUNIT_COI_WATCH(test, object);
+
+    kedr_coi_interceptor_pause(interceptor);
+    KUNIT_EXPECT_TRUE(test, kedr_coi_interceptor_is_paused(interceptor));
+
+    object->ops->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 0);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+
+    kedr_coi_interceptor_resume(interceptor);
+    KUNIT_EXPECT_FALSE(test, kedr_coi_interceptor_is_paused(interceptor));
+
+    // Object should be intercepted without watching it again.
+    object->ops->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 2);
+}
+
+static void indirect_operation_disable(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_object* object = &ctx->objects[0];
+
+    kunit_coi_start(test, false);
+    KUNIT_COI_WATCH(test, object);
+
+    KUNIT_ASSERT_EQ(test, kedr_coi_interceptor_operation_disable(interceptor,
+        OPERATION_OFFSET(op1)), 0);
+
+    object->ops->op1(object, NULL);
+    object->ops->op2(object, NULL);
+    // Only disabled operation is affected.
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 0);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op2_post1_call_counter, 1);
+
+    KUNIT_ASSERT_EQ(test, kedr_coi_interceptor_operation_enable(interceptor,
+        OPERATION_OFFSET(op1)), 0);
+
+    object->ops->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+
+    // Offset without intermediate.
+    KUNIT_EXPECT_EQ(test, kedr_coi_interceptor_operation_disable(interceptor,
+        offsetof(struct test_operations, some_field)), -EINVAL);
+}
+
+static int unforgotten_counter;
+static const void* unforgotten_object;
+
+static void trace_unforgotten_object(const void* object)
+{
+    unforgotten_counter++;
+    unforgotten_object = object;
+}
+
+static void indirect_trace_unforgotten_object(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_object* object = &ctx->objects[0];
+
+    unforgotten_counter = 0;
+    unforgotten_object = NULL;
+
+    kedr_coi_interceptor_trace_unforgotten_object(interceptor,
+        &trace_unforgotten_object);
+
+    kunit_coi_start(test, false);
+    KUNIT_COI_WATCH(test, object);
+
+    // Object is left watched.
+    kunit_coi_stop(test);
+
+    KUNIT_EXPECT_EQ(test, unforgotten_counter, 1);
+    KUNIT_EXPECT_PTR_EQ(test, unforgotten_object, (const void*)object);
+}
+
+/*
+ * Average overhead of the call of intercepted operation with one
+ * pre-handler, compared to the call of original operation.
+ */
+static void indirect_perf_call(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_object* object = &ctx->objects[0];
+    kedr_coi_test_op_t volatile op_orig = op1_orig;
+    unsigned int i;
+    u64 time_orig, time_intercepted, overhead;
+
+    KUNIT_ASSERT_GT(test, perf_iterations, 0U);
+
+    kunit_coi_start(test, false);
+
+    time_orig = ktime_get_ns();
+    for(i = 0; i < perf_iterations; i++)
+        op_orig(object, NULL);
+    time_orig = ktime_get_ns() - time_orig;
+
+    KUNIT_COI_WATCH(test, object);
+
+    time_intercepted = ktime_get_ns();
+    for(i = 0; i < perf_iterations; i++)
+        object->ops->op1(object, NULL);
+    time_intercepted = ktime_get_ns() - time_intercepted;
+
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, (int)perf_iterations);
+
+    overhead = time_intercepted > time_orig
+        ? div_u64(time_intercepted - time_orig, perf_iterations) : 0;
+
+    kunit_info(test, "intercepted call overhead: %llu ns",
+        (unsigned long long)overhead);
+
+    if(max_call_overhead_ns)
+        KUNIT_EXPECT_LE(test, overhead, (u64)max_call_overhead_ns);
+}
+
+/* Average time of watching and forgetting the object. */
+static void indirect_perf_watch(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    unsigned int n_rounds;
+    unsigned int i, j;
+    u64 time, watch_time;
+
+    kunit_coi_start(test, false);
+
+    n_rounds = perf_iterations / KUNIT_PERF_OBJECTS;
+    if(n_rounds == 0) n_rounds = 1;
+
+    time = ktime_get_ns();
+    for(i = 0; i < n_rounds; i++)
+    {
+        for(j = 0; j < KUNIT_PERF_OBJECTS; j++)
+            KUNIT_COI_WATCH(test, &ctx->objects[j]);
+        for(j = 0; j < KUNIT_PERF_OBJECTS; j++)
+            kedr_coi_interceptor_forget(interceptor, &ctx->objects[j]);
+    }
+    time = ktime_get_ns() - time;
+
+    watch_time = div_u64(time, n_rounds * KUNIT_PERF_OBJECTS);
+
+    kunit_info(test, "watch and forget: %llu ns",
+        (unsigned long long)watch_time);
+
+    if(max_watch_ns)
+        KUNIT_EXPECT_LE(test, watch_time, (u64)max_watch_ns);
+}
+
+static struct kunit_case indirect_cases[] =
+{
+    KUNIT_CASE(indirect_base),
+    KUNIT_CASE(indirect_several_payloads),
+    KUNIT_CASE(indirect_update),
+    KUNIT_CASE(indirect_pause),
+    KUNIT_CASE(indirect_operation_disable),
+    KUNIT_CASE(indirect_trace_unforgotten_object),
+    KUNIT_CASE(indirect_perf_call),
+    KUNIT_CASE(indirect_perf_watch),
+    {}
+};
+
+static struct kunit_suite indirect_suite =
+{
+    .name = "kedr_coi_indirect",
+    .init = indirect_at_place_init,
+    .exit = interceptor_exit,
+    .test_cases = indirect_cases,
+};
+
+static struct kunit_suite indirect_use_copy_suite =
+{
+    .name = "kedr_coi_indirect_use_copy",
+    .init = indirect_use_copy_init,
+    .exit = interceptor_exit,
+    .test_cases = indirect_cases,
+};
+
+//********************************* Direct *********************************//
+static void direct_base(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_direct_object* object = &ctx->direct_objects[0];
+
+    kunit_coi_start(test, false);
+    KUNIT_COI_WATCH(test, object);
+
+    object->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+
+    object->op2(object, NULL);
+    KUNIT_EXPECT_EQ(test, op2_post1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op2_call_counter, 1);
+
+    KUNIT_EXPECT_EQ(test, kedr_coi_interceptor_forget(interceptor, object), 0);
+    // Operations should be restored.
+    KUNIT_EXPECT_PTR_EQ(test, object->op1, (kedr_coi_test_op_t)op1_orig);
+    KUNIT_EXPECT_PTR_EQ(test, object->op2, (kedr_coi_test_op_t)op2_orig);
+}
+
+static void direct_pause(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_direct_object* object = &ctx->direct_objects[0];
+
+    kunit_coi_start(test, false);
+    KUNIT_COI_WATCH(test, object);
+
+    kedr_coi_interceptor_pause(interceptor);
+    object->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 0);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+
+    kedr_coi_interceptor_resume(interceptor);
+    object->op1(object, NULL);
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 2);
+}
+
+static void direct_perf_call(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_direct_object* object = &ctx->direct_objects[0];
+    kedr_coi_test_op_t volatile op_orig = op1_orig;
+    unsigned int i;
+    u64 time_orig, time_intercepted, overhead;
+
+    KUNIT_ASSERT_GT(test, perf_iterations, 0U);
+
+    kunit_coi_start(test, false);
+
+    time_orig = ktime_get_ns();
+    for(i = 0; i < perf_iterations; i++)
+        op_orig(object, NULL);
+    time_orig = ktime_get_ns() - time_orig;
+
+    KUNIT_COI_WATCH(test, object);
+
+    time_intercepted = ktime_get_ns();
+    for(i = 0; i < perf_iterations; i++)
+        object->op1(object, NULL);
+    time_intercepted = ktime_get_ns() - time_intercepted;
+
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, (int)perf_iterations);
+
+    overhead = time_intercepted > time_orig
+        ? div_u64(time_intercepted - time_orig, perf_iterations) : 0;
+
+    kunit_info(test, "intercepted call overhead: %llu ns",
+        (unsigned long long)overhead);
+
+    if(max_call_overhead_ns)
+        KUNIT_EXPECT_LE(test, overhead, (u64)max_call_overhead_ns);
+}
+
+static struct kunit_case direct_cases[] =
+{
+    KUNIT_CASE(direct_base),
+    KUNIT_CASE(direct_pause),
+    KUNIT_CASE(direct_perf_call),
+    {}
+};
+
+static struct kunit_suite direct_suite =
+{
+    .name = "kedr_coi_direct",
+    .init = direct_init,
+    .exit = interceptor_exit,
+    .test_cases = direct_cases,
+};
+
+//********************************* Factory ********************************//
+static void factory_base(struct kunit* test)
+{
+    struct kunit_coi_context* ctx = test->priv;
+    struct test_factory* factory = &ctx->factory;
+    struct test_object* object = &ctx->objects[0];
+
+    kunit_coi_start(test, false);
+
+    KUNIT_ASSERT_GE(test, kedr_coi_factory_interceptor_watch(
+        factory_interceptor, factory), 0);
+
+    // As if object was created from prototype and its operation 1
+    // was called.
+    object->ops = factory->factory_ops;
+    object->ops->op1(object, factory);
+
+    KUNIT_EXPECT_EQ(test, op1_pre1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op1_call_counter, 1);
+
+    // Object is bound to the interceptor by the call.
+    object->ops->op2(object, NULL);
+    KUNIT_EXPECT_EQ(test, op2_post1_call_counter, 1);
+    KUNIT_EXPECT_EQ(test, op2_call_counter, 1);
+
+    // Object should be watched automatically.
+    KUNIT_EXPECT_EQ(test, kedr_coi_interceptor_forget(interceptor, object), 0);
+    kedr_coi_factory_interceptor_forget(factory_interceptor, factory);
+}
+
+static struct kunit_case factory_cases[] =
+{
+    KUNIT_CASE(factory_base),
+    {}
+};
+
+static struct kunit_suite factory_suite =
+{
+    .name = "kedr_coi_factory",
+    .init = factory_init,
+    .exit = interceptor_exit,
+    .test_cases = factory_cases,
+};
+
+kunit_test_suites(&indirect_suite, &indirect_use_copy_suite,
+    &direct_suite, &factory_suite);
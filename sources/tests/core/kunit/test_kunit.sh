@@ -0,0 +1,94 @@
+#!/bin/sh
+
+# Run KUnit suites of the core.
+#
+# Usage: test_kunit.sh <kunit_module> [dependency_module] ...
+#
+# Dependencies are loaded first, then module with suites is loaded,
+# which executes them. Results are taken from debugfs. If the module
+# isn't installed (KUnit isn't available for the kernel), test is
+# skipped.
+
+if test $# -lt 1; then
+    printf "Usage: $0 <kunit_module> [dependency_module] ...\n"
+    exit 1
+fi
+
+KERNEL_VERSION=`uname -r`
+
+# Suites contained in the module, see kedr_coi_core_kunit.c.
+suites="kedr_coi_indirect kedr_coi_indirect_use_copy kedr_coi_direct kedr_coi_factory"
+
+# Directory where KUnit exports results.
+kunit_dir="/sys/kernel/debug/kunit"
+
+get_precise_path()
+{
+    echo "$1" | sed -e "s/%kernel%/${KERNEL_VERSION}/"
+}
+
+get_module_name()
+{
+    echo "$1" | sed -e "s/.\{0,\}\///; s/\.ko$//"
+}
+
+kunit_module=`get_precise_path $1`
+shift
+
+if ! test -f "${kunit_module}"; then
+    printf "Module with KUnit suites is not built for this kernel, test is skipped.\n"
+    exit 0
+fi
+
+modules_for_unload=
+
+unload_modules()
+{
+    for module in $modules_for_unload; do
+        /sbin/rmmod $module
+    done
+}
+
+while test $# -ne 0; do
+    dependency_module=`get_precise_path $1`
+    if ! /sbin/insmod $dependency_module; then
+        printf "Failed to load module '$dependency_module' needed for test.\n"
+        unload_modules
+        exit 1
+    fi
+    module_name=`get_module_name $dependency_module`
+    modules_for_unload="$module_name $modules_for_unload"
+    shift
+done
+
+# Suites are executed when module is loaded.
+if ! /sbin/insmod ${kunit_module}; then
+    printf "Failed to load module with KUnit suites.\n"
+    unload_modules
+    exit 1
+fi
+
+result=0
+for suite in $suites; do
+    results_file="${kunit_dir}/${suite}/results"
+    if ! test -r "${results_file}"; then
+        printf "Results of suite '$suite' are not available (is debugfs mounted?).\n"
+        result=1
+        continue
+    fi
+    # Results are in KTAP format.
+    if grep -q "^[[:space:]]*not ok" "${results_file}"; then
+        printf "Suite '$suite' failed:\n"
+        cat "${results_file}"
+        result=1
+    fi
+done
+
+if ! /sbin/rmmod `get_module_name ${kunit_module}`; then
+    printf "Errors occures during test module unloading.\n"
+    result=1
+fi
+
+unload_modules
+
+exit $result
@@ -0,0 +1,164 @@
+/*
+ * Check that decision of the mechanism selector is cached per
+ * operations pointer, so selector isn't called again when same
+ * operations are instrumented second time.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct test_operations, op_name)
+#include "test_harness.h"
+
+/* Operations for test */
+struct test_operations
+{
+    kedr_coi_test_op_t op1;
+};
+
+
+struct test_object
+{
+    int some_field;
+    const struct test_operations* ops;
+};
+
+
+int op1_call_counter = 0;
+KEDR_COI_TEST_DEFINE_OP_ORIG(op1_orig, op1_call_counter);
+
+struct test_operations test_operations_orig =
+{
+    .op1 = op1_orig,
+};
+
+struct kedr_coi_interceptor* interceptor;
+
+KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_repl, OPERATION_OFFSET(op1), interceptor);
+
+static struct kedr_coi_intermediate intermediate_operations[] =
+{
+    INTERMEDIATE(op1, op1_repl),
+    INTERMEDIATE_FINAL
+};
+
+
+int op1_pre1_call_counter;
+KEDR_COI_TEST_DEFINE_HANDLER_FUNC(op1_pre1, op1_pre1_call_counter)
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    HANDLER(op1, op1_pre1),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_payload payload =
+{
+    .pre_handlers = pre_handlers,
+};
+
+/* Selector which counts its calls. */
+int selector_call_counter;
+
+static bool replace_at_place_counted(const void* ops)
+{
+    (void)ops;
+    selector_call_counter++;
+    return 0;
+}
+
+//******************Test infrastructure**********************************//
+int test_init(void)
+{
+    interceptor = kedr_coi_interceptor_create("Interceptor with counted selector",
+        offsetof(struct test_object, ops),
+        sizeof(struct test_operations),
+        intermediate_operations);
+    
+    if(interceptor == NULL)
+    {
+        pr_err("Failed to create interceptor for test.");
+        return -EINVAL;
+    }
+    
+    kedr_coi_interceptor_mechanism_selector(interceptor,
+        &replace_at_place_counted);
+    
+    return 0;
+}
+void test_cleanup(void)
+{
+    kedr_coi_interceptor_destroy(interceptor);
+}
+
+// Test itself
+int test_run(void)
+{
+    int result;
+    int i;
+    struct test_object object = {.ops = &test_operations_orig};
+    
+    result = kedr_coi_payload_register(interceptor, &payload);
+    
+    if(result)
+    {
+        pr_err("Failed to register payload.");
+        goto err_payload;
+    }
+    
+    result = kedr_coi_interceptor_start(interceptor);
+    if(result)
+    {
+        pr_err("Interceptor failed to start.");
+        goto err_start;
+    }
+    
+    selector_call_counter = 0;
+    /*
+     * After forgetting the only object, instrumentation of the
+     * operations is dropped, so second watch instruments them again.
+     */
+    for(i = 0; i < 2; i++)
+    {
+        result = kedr_coi_interceptor_watch(interceptor, &object);
+        if(result < 0)
+        {
+            pr_err("Interceptor failed to watch for an object.");
+            goto err_watch;
+        }
+
+        op1_pre1_call_counter = 0;
+        
+        object.ops->op1(&object, NULL);
+        
+        if(op1_pre1_call_counter == 0)
+        {
+            pr_err("Pre handler for operation 1 wasn't called.");
+            result = -EINVAL;
+            goto err_test;
+        }
+        
+        kedr_coi_interceptor_forget(interceptor, &object);
+    }
+    
+    if(selector_call_counter != 1)
+    {
+        pr_err("Selector was called %d times, but should be called once.",
+            selector_call_counter);
+        result = -EINVAL;
+        goto err_watch;
+    }
+    
+    kedr_coi_interceptor_stop(interceptor);
+    kedr_coi_payload_unregister(interceptor, &payload);
+
+    return 0;
+
+err_test:
+    kedr_coi_interceptor_forget(interceptor, &object);
+err_watch:
+    kedr_coi_interceptor_stop(interceptor);
+err_start:
+    kedr_coi_payload_unregister(interceptor, &payload);
+err_payload:
+    return result;
+}
@@ -0,0 +1,1111 @@
+/*
+ * Stress test for concurrent use of the interceptors.
+ *
+ * Thread on every online CPU performs random operations with its own
+ * objects: watching, forgetting, updating of operations and calls of
+ * the operations. Objects are of four kinds: watched by indirect
+ * interceptor with 'at place' mechanism, by indirect interceptor with
+ * 'use copy' mechanism, created from the factory watched by factory
+ * interceptor, and watched by direct interceptor. Objects of different
+ * threads share the interceptors and operations structures.
+ *
+ * Another thread periodically stops interceptors, registers or
+ * unregisters additional payload and starts them again. Other threads
+ * are blocked at that moment.
+ *
+ * After every call the test verifies, that call reaches original
+ * operation of the object, and that handlers are called only for
+ * watched objects and only for payloads registered.
+ *
+ * Number of operations of every type and their throughput are printed
+ * into the system log.
+ */
+
+#include <kedr-coi/operations_interception.h>
+
+#define OPERATION_OFFSET(op_name) offsetof(struct stress_operations, op_name)
+#include "test_harness.h"
+#include "test_harness_factory.h"
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/rwsem.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+
+#ifndef READ_ONCE
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define WRITE_ONCE(x, val) (ACCESS_ONCE(x) = (val))
+#endif
+
+static unsigned int duration = 5;
+module_param(duration, uint, S_IRUGO);
+MODULE_PARM_DESC(duration, "Duration of the test, in seconds");
+
+static unsigned int n_objects = 16;
+module_param(n_objects, uint, S_IRUGO);
+MODULE_PARM_DESC(n_objects, "Number of objects of every kind per thread");
+
+static unsigned int max_threads = 0;
+module_param(max_threads, uint, S_IRUGO);
+MODULE_PARM_DESC(max_threads,
+    "Maximum number of threads, 0 - number of online CPUs");
+
+static unsigned int payload_interval_ms = 100;
+module_param(payload_interval_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(payload_interval_ms,
+    "Interval between registering and unregistering of the payload, "
+    "in milliseconds (0 - payload isn't changed)");
+
+/* Operations made by thread between checks of 'stop' flag. */
+#define STRESS_BATCH 64
+
+/* Number of different operations structures for every kind of objects. */
+#define STRESS_VARIANTS 4
+
+//************************* Objects and operations ***********************//
+typedef void (*stress_op_t)(void* object, void* data);
+
+/*
+ * State of the object, known to the thread owned it.
+ *
+ * Should be the first field of every object, so original operations
+ * and handlers may access it.
+ */
+struct stress_header
+{
+    // Variant of operations which should be called.
+    int variant;
+    bool watched;
+
+    unsigned int orig_calls;
+    unsigned int pre_calls;
+    unsigned int pre2_calls;
+};
+
+struct stress_operations
+{
+    void* some_field;
+    stress_op_t op1;
+    void* other_fields[3];
+    stress_op_t op2;
+};
+
+/* Object for indirect interceptors */
+struct stress_object
+{
+    struct stress_header h;
+    const struct stress_operations* ops;
+};
+
+/* Object for direct interceptor */
+struct stress_direct_object
+{
+    struct stress_header h;
+    stress_op_t op1;
+    void* other_fields[3];
+    stress_op_t op2;
+};
+
+struct stress_factory
+{
+    int some_fields[3];
+    const struct stress_operations* factory_ops;
+};
+
+enum stress_kind
+{
+    stress_kind_at_place,
+    stress_kind_use_copy,
+    stress_kind_factory,
+    stress_kind_direct,
+
+    stress_kind_count
+};
+
+static const char* stress_kind_names[stress_kind_count] =
+{
+    [stress_kind_at_place] = "indirect (at place)",
+    [stress_kind_use_copy] = "indirect (use copy)",
+    [stress_kind_factory] = "factory",
+    [stress_kind_direct] = "direct",
+};
+
+/* Number of calls reached original operation of incorrect variant. */
+static atomic_t stress_misdirected_calls = ATOMIC_INIT(0);
+
+/* Number of objects left watched when interceptor is stopped. */
+static atomic_t stress_unforgotten_objects = ATOMIC_INIT(0);
+
+static void stress_trace_unforgotten_object(const void* object)
+{
+    atomic_inc(&stress_unforgotten_objects);
+}
+
+#define STRESS_DEFINE_ORIG(n) \
+static void op_orig##n(void* object, void* data) \
+{ \
+    struct stress_header* h = object; \
+    if(h->variant != n) atomic_inc(&stress_misdirected_calls); \
+    h->orig_calls++; \
+}
+
+STRESS_DEFINE_ORIG(0)
+STRESS_DEFINE_ORIG(1)
+STRESS_DEFINE_ORIG(2)
+STRESS_DEFINE_ORIG(3)
+
+static const stress_op_t op_origs[STRESS_VARIANTS] =
+{
+    op_orig0, op_orig1, op_orig2, op_orig3
+};
+
+/*
+ * Operations structures for indirect kinds of objects.
+ *
+ * Modified by 'at place' mechanism, so they aren't const.
+ */
+static struct stress_operations stress_ops[stress_kind_direct][STRESS_VARIANTS];
+
+//************************* Interceptors **********************************//
+static struct kedr_coi_interceptor* at_place_interceptor;
+static struct kedr_coi_interceptor* use_copy_interceptor;
+static struct kedr_coi_interceptor* direct_interceptor;
+/* Created for 'use_copy_interceptor'. */
+static struct kedr_coi_factory_interceptor* factory_interceptor;
+
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_at_place_repl,
+    OPERATION_OFFSET(op1), at_place_interceptor);
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op2_at_place_repl,
+    OPERATION_OFFSET(op2), at_place_interceptor);
+
+static struct kedr_coi_intermediate at_place_intermediates[] =
+{
+    INTERMEDIATE(op1, op1_at_place_repl),
+    INTERMEDIATE(op2, op2_at_place_repl),
+    INTERMEDIATE_FINAL
+};
+
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_use_copy_repl,
+    OPERATION_OFFSET(op1), use_copy_interceptor);
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op2_use_copy_repl,
+    OPERATION_OFFSET(op2), use_copy_interceptor);
+
+static struct kedr_coi_intermediate use_copy_intermediates[] =
+{
+    INTERMEDIATE(op1, op1_use_copy_repl),
+    INTERMEDIATE(op2, op2_use_copy_repl),
+    INTERMEDIATE_FINAL
+};
+
+static void* get_factory(void* data)
+{
+    return data;
+}
+
+static KEDR_COI_TEST_DEFINE_FACTORY_INTERMEDIATE_FUNC(op1_factory_repl,
+    get_factory, OPERATION_OFFSET(op1), factory_interceptor);
+
+static struct kedr_coi_intermediate factory_intermediates[] =
+{
+    INTERMEDIATE(op1, op1_factory_repl),
+    INTERMEDIATE_FINAL
+};
+
+/* Handlers count calls in the object's header. */
+static void op1_pre(void* object, void* data,
+    struct kedr_coi_operation_call_info* info, int unused)
+{
+    ((struct stress_header*)object)->pre_calls++;
+}
+
+static void op1_pre2(void* object, void* data,
+    struct kedr_coi_operation_call_info* info, int unused)
+{
+    ((struct stress_header*)object)->pre2_calls++;
+}
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    HANDLER(op1, op1_pre),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_handler pre_handlers2[] =
+{
+    HANDLER(op1, op1_pre2),
+    kedr_coi_handler_end
+};
+
+/* Operations of direct interceptor are placed in the object itself. */
+#undef OPERATION_OFFSET
+#define OPERATION_OFFSET(op_name) offsetof(struct stress_direct_object, op_name)
+
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op1_direct_repl,
+    OPERATION_OFFSET(op1), direct_interceptor);
+static KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(op2_direct_repl,
+    OPERATION_OFFSET(op2), direct_interceptor);
+
+static struct kedr_coi_intermediate direct_intermediates[] =
+{
+    INTERMEDIATE(op1, op1_direct_repl),
+    INTERMEDIATE(op2, op2_direct_repl),
+    INTERMEDIATE_FINAL
+};
+
+static struct kedr_coi_handler direct_pre_handlers[] =
+{
+    HANDLER(op1, op1_pre),
+    kedr_coi_handler_end
+};
+
+static struct kedr_coi_handler direct_pre_handlers2[] =
+{
+    HANDLER(op1, op1_pre2),
+    kedr_coi_handler_end
+};
+
+#undef OPERATION_OFFSET
+
+/* Interceptors in the order of starting. */
+enum stress_interceptor_index
+{
+    stress_interceptor_at_place,
+    stress_interceptor_use_copy,
+    stress_interceptor_direct,
+
+    stress_interceptor_count
+};
+
+static struct kedr_coi_interceptor** stress_interceptors[stress_interceptor_count] =
+{
+    [stress_interceptor_at_place] = &at_place_interceptor,
+    [stress_interceptor_use_copy] = &use_copy_interceptor,
+    [stress_interceptor_direct] = &direct_interceptor,
+};
+
+/* Payload is always registered, payload2 - periodically. */
+static struct kedr_coi_payload payloads[stress_interceptor_count] =
+{
+    [stress_interceptor_at_place] = {.pre_handlers = pre_handlers},
+    [stress_interceptor_use_copy] = {.pre_handlers = pre_handlers},
+    [stress_interceptor_direct] = {.pre_handlers = direct_pre_handlers},
+};
+
+static struct kedr_coi_payload payloads2[stress_interceptor_count] =
+{
+    [stress_interceptor_at_place] = {.pre_handlers = pre_handlers2},
+    [stress_interceptor_use_copy] = {.pre_handlers = pre_handlers2},
+    [stress_interceptor_direct] = {.pre_handlers = direct_pre_handlers2},
+};
+
+static bool payload2_registered;
+
+static struct kedr_coi_interceptor* stress_kind_interceptor(enum stress_kind kind)
+{
+    switch(kind)
+    {
+    case stress_kind_at_place:
+        return at_place_interceptor;
+    case stress_kind_direct:
+        return direct_interceptor;
+    default:
+        // Objects created from the factory are watched by base interceptor.
+        return use_copy_interceptor;
+    }
+}
+
+//****************************** Threads **********************************//
+enum stress_op
+{
+    stress_op_call,
+    stress_op_watch,
+    stress_op_forget,
+    stress_op_update,
+    stress_op_payload,
+
+    stress_op_count
+};
+
+static const char* stress_op_names[stress_op_count] =
+{
+    [stress_op_call] = "call",
+    [stress_op_watch] = "watch",
+    [stress_op_forget] = "forget",
+    [stress_op_update] = "update",
+    [stress_op_payload] = "payload",
+};
+
+struct stress_thread
+{
+    struct task_struct* task;
+    unsigned int index;
+    unsigned int random;
+
+    struct stress_object* objects[stress_kind_direct];
+    struct stress_direct_object* direct_objects;
+    struct stress_factory factory;
+
+    u64 counts[stress_op_count];
+    int result;
+};
+
+static struct stress_thread* stress_threads;
+static unsigned int stress_n_threads;
+
+/*
+ * Workers take the semaphore for read while perform operations,
+ * restart of the interceptors is performed with semaphore taken for
+ * write.
+ */
+static DECLARE_RWSEM(stress_sem);
+
+static int stress_stop;
+
+/* Simple pseudo-random generator (xorshift). */
+static unsigned int stress_random(struct stress_thread* t)
+{
+    unsigned int x = t->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return t->random = x;
+}
+
+static struct stress_header* stress_object(struct stress_thread* t,
+    enum stress_kind kind, unsigned int i)
+{
+    if(kind == stress_kind_direct)
+        return &t->direct_objects[i].h;
+    else
+        return &t->objects[kind][i].h;
+}
+
+/* Set original operations of given variant for the object. */
+static void stress_object_set_ops(enum stress_kind kind,
+    struct stress_header* h, int variant)
+{
+    h->variant = variant;
+
+    if(kind == stress_kind_direct)
+    {
+        struct stress_direct_object* object = (void*)h;
+
+        object->op1 = op_origs[variant];
+        object->op2 = op_origs[variant];
+    }
+    else
+    {
+        struct stress_object* object = (void*)h;
+
+        object->ops = &stress_ops[kind][variant];
+    }
+}
+
+/* Whether object has original operations of its variant. */
+static bool stress_object_is_restored(enum stress_kind kind,
+    struct stress_header* h)
+{
+    if(kind == stress_kind_direct)
+    {
+        struct stress_direct_object* object = (void*)h;
+
+        return (object->op1 == op_origs[h->variant])
+            && (object->op2 == op_origs[h->variant]);
+    }
+    else
+    {
+        struct stress_object* object = (void*)h;
+
+        return object->ops == &stress_ops[kind][h->variant];
+    }
+}
+
+/*
+ * Call operation of the object and check the result.
+ *
+ * Return 0 on success.
+ */
+static int stress_call(struct stress_thread* t, enum stress_kind kind,
+    struct stress_header* h, bool call_op1)
+{
+    unsigned int orig_calls = h->orig_calls;
+    unsigned int pre_calls = h->pre_calls;
+    unsigned int pre2_calls = h->pre2_calls;
+    bool handlers_expected = h->watched && call_op1;
+
+    if(kind == stress_kind_direct)
+    {
+        struct stress_direct_object* object = (void*)h;
+
+        if(call_op1)
+            object->op1(object, NULL);
+        else
+            object->op2(object, NULL);
+    }
+    else
+    {
+        struct stress_object* object = (void*)h;
+        // Factory is needed only for objects just created from it.
+        void* data = (kind == stress_kind_factory) ? &t->factory : NULL;
+
+        if(call_op1)
+            object->ops->op1(object, data);
+        else
+            object->ops->op2(object, data);
+    }
+
+    if(h->orig_calls != orig_calls + 1)
+    {
+        pr_err("Call of operation of %s object %p reached original "
+            "operation %u times.", stress_kind_names[kind], h,
+            h->orig_calls - orig_calls);
+        return -EINVAL;
+    }
+
+    if(h->pre_calls != pre_calls + (handlers_expected ? 1 : 0))
+    {
+        pr_err("Handler was called %u times for %s %s object %p.",
+            h->pre_calls - pre_calls,
+            h->watched ? "watched" : "not watched",
+            stress_kind_names[kind], h);
+        return -EINVAL;
+    }
+
+    if(h->pre2_calls != pre2_calls
+        + ((handlers_expected && payload2_registered) ? 1 : 0))
+    {
+        pr_err("Handler of the second payload was called %u times for "
+            "%s %s object %p (payload is %s).",
+            h->pre2_calls - pre2_calls,
+            h->watched ? "watched" : "not watched",
+            stress_kind_names[kind], h,
+            payload2_registered ? "registered" : "not registered");
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int stress_watch(struct stress_thread* t, enum stress_kind kind,
+    struct stress_header* h)
+{
+    int result;
+
+    if((kind == stress_kind_factory) && !h->watched)
+    {
+        struct stress_object* object = (void*)h;
+
+        // As if object was created from the factory. It becomes
+        // watched at the first call.
+        object->ops = t->factory.factory_ops;
+        h->variant = 0;
+        h->watched = true;
+
+        return stress_call(t, kind, h, true);
+    }
+
+    result = kedr_coi_interceptor_watch(stress_kind_interceptor(kind), h);
+    if(result < 0)
+    {
+        pr_err("Failed to watch for %s object %p: %d.",
+            stress_kind_names[kind], h, result);
+        return result;
+    }
+    h->watched = true;
+
+    return 0;
+}
+
+static int stress_forget(struct stress_thread* t, enum stress_kind kind,
+    struct stress_header* h)
+{
+    int result;
+
+    result = kedr_coi_interceptor_forget(stress_kind_interceptor(kind), h);
+    if(result != (h->watched ? 0 : 1))
+    {
+        pr_err("Forgetting of %s %s object %p returns %d.",
+            h->watched ? "watched" : "not watched",
+            stress_kind_names[kind], h, result);
+        return -EINVAL;
+    }
+
+    if(!h->watched) return 0;
+
+    h->watched = false;
+
+    if(kind == stress_kind_factory)
+    {
+        // Operations are restored to ones of the factory.
+        stress_object_set_ops(kind, h, h->variant);
+    }
+    else if(!stress_object_is_restored(kind, h))
+    {
+        pr_err("Operations of %s object %p aren't restored after forget.",
+            stress_kind_names[kind], h);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int stress_update(struct stress_thread* t, enum stress_kind kind,
+    struct stress_header* h)
+{
+    int result;
+
+    // As if operations were set to another ones outside of the interceptor.
+    stress_object_set_ops(kind, h,
+        stress_random(t) % STRESS_VARIANTS);
+
+    if(!h->watched) return 0;
+
+    result = kedr_coi_interceptor_watch(stress_kind_interceptor(kind), h);
+    if(result < 0)
+    {
+        pr_err("Failed to update watching for %s object %p: %d.",
+            stress_kind_names[kind], h, result);
+        return result;
+    }
+
+    return 0;
+}
+
+/* Perform one random operation. */
+static int stress_step(struct stress_thread* t)
+{
+    unsigned int r = stress_random(t);
+    enum stress_kind kind = (r >> 4) % stress_kind_count;
+    struct stress_header* h = stress_object(t, kind,
+        (r >> 8) % n_objects);
+    enum stress_op op;
+
+    // Calls are more frequent than other operations.
+    switch(r % 16)
+    {
+    case 0: case 1:
+        op = stress_op_watch;
+        break;
+    case 2: case 3:
+        op = stress_op_forget;
+        break;
+    case 4: case 5:
+        op = stress_op_update;
+        break;
+    default:
+        op = stress_op_call;
+    }
+
+    t->counts[op]++;
+
+    switch(op)
+    {
+    case stress_op_watch:
+        return stress_watch(t, kind, h);
+    case stress_op_forget:
+        return stress_forget(t, kind, h);
+    case stress_op_update:
+        return stress_update(t, kind, h);
+    default:
+        return stress_call(t, kind, h, r & 0x80000000);
+    }
+}
+
+static int stress_thread_func(void* data)
+{
+    struct stress_thread* t = data;
+    int i;
+
+    while(!READ_ONCE(stress_stop))
+    {
+        down_read(&stress_sem);
+        for(i = 0; (i < STRESS_BATCH) && !t->result; i++)
+            t->result = stress_step(t);
+        up_read(&stress_sem);
+
+        if(t->result)
+        {
+            // Stop other threads too.
+            WRITE_ONCE(stress_stop, 1);
+            break;
+        }
+
+        cond_resched();
+    }
+
+    return 0;
+}
+
+/* Watch for factories of all threads. */
+static int stress_factories_watch(void)
+{
+    unsigned int i;
+    int result;
+
+    for(i = 0; i < stress_n_threads; i++)
+    {
+        struct stress_thread* t = &stress_threads[i];
+
+        t->factory.factory_ops = &stress_ops[stress_kind_factory][0];
+        result = kedr_coi_factory_interceptor_watch(factory_interceptor,
+            &t->factory);
+        if(result < 0)
+        {
+            pr_err("Failed to watch for the factory: %d.", result);
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int stress_interceptors_start(void)
+{
+    int i;
+    int result;
+
+    for(i = 0; i < stress_interceptor_count; i++)
+    {
+        result = kedr_coi_interceptor_start(*stress_interceptors[i]);
+        if(result)
+        {
+            pr_err("Failed to start interceptor: %d.", result);
+            goto err;
+        }
+    }
+
+    return 0;
+
+err:
+    for(--i; i >= 0; i--)
+        kedr_coi_interceptor_stop(*stress_interceptors[i]);
+    return result;
+}
+
+static void stress_interceptors_stop(void)
+{
+    int i;
+
+    for(i = stress_interceptor_count - 1; i >= 0; i--)
+        kedr_coi_interceptor_stop(*stress_interceptors[i]);
+}
+
+static int stress_payloads_register(struct kedr_coi_payload* p)
+{
+    int i;
+    int result;
+
+    for(i = 0; i < stress_interceptor_count; i++)
+    {
+        result = kedr_coi_payload_register(*stress_interceptors[i], &p[i]);
+        if(result)
+        {
+            pr_err("Failed to register payload: %d.", result);
+            goto err;
+        }
+    }
+
+    return 0;
+
+err:
+    for(--i; i >= 0; i--)
+        kedr_coi_payload_unregister(*stress_interceptors[i], &p[i]);
+    return result;
+}
+
+static void stress_payloads_unregister(struct kedr_coi_payload* p)
+{
+    int i;
+
+    for(i = 0; i < stress_interceptor_count; i++)
+        kedr_coi_payload_unregister(*stress_interceptors[i], &p[i]);
+}
+
+/* Forget everything watched by the threads. */
+static int stress_forget_all(void)
+{
+    unsigned int i, j;
+    int kind;
+    int result = 0;
+
+    for(i = 0; i < stress_n_threads; i++)
+    {
+        struct stress_thread* t = &stress_threads[i];
+
+        for(kind = 0; kind < stress_kind_count; kind++)
+        {
+            for(j = 0; j < n_objects; j++)
+            {
+                int result_forget = stress_forget(t, kind,
+                    stress_object(t, kind, j));
+                if(result_forget) result = result_forget;
+            }
+        }
+
+        kedr_coi_factory_interceptor_forget(factory_interceptor, &t->factory);
+    }
+
+    return result;
+}
+
+/*
+ * Register or unregister second payload.
+ *
+ * Interceptors should be stopped for that, so all objects are forgotten
+ * before. Threads will watch them again.
+ */
+static int stress_payload_toggle(void)
+{
+    int result;
+
+    result = stress_forget_all();
+    if(result) return result;
+
+    stress_interceptors_stop();
+
+    if(payload2_registered)
+    {
+        stress_payloads_unregister(payloads2);
+        payload2_registered = false;
+    }
+    else
+    {
+        result = stress_payloads_register(payloads2);
+        if(result) return result;
+        payload2_registered = true;
+    }
+
+    result = stress_interceptors_start();
+    if(result) return result;
+
+    return stress_factories_watch();
+}
+
+static struct task_struct* stress_payload_task;
+static int stress_payload_result;
+static u64 stress_payload_count;
+
+static int stress_payload_thread_func(void* data)
+{
+    while(!READ_ONCE(stress_stop))
+    {
+        msleep(payload_interval_ms);
+
+        down_write(&stress_sem);
+        stress_payload_result = stress_payload_toggle();
+        up_write(&stress_sem);
+
+        if(stress_payload_result)
+        {
+            WRITE_ONCE(stress_stop, 1);
+            break;
+        }
+        stress_payload_count++;
+    }
+
+    return 0;
+}
+
+static void stress_threads_free(void)
+{
+    unsigned int i;
+    int kind;
+
+    for(i = 0; i < stress_n_threads; i++)
+    {
+        for(kind = 0; kind < stress_kind_direct; kind++)
+            kfree(stress_threads[i].objects[kind]);
+        kfree(stress_threads[i].direct_objects);
+    }
+
+    kfree(stress_threads);
+    stress_threads = NULL;
+}
+
+static int stress_threads_alloc(void)
+{
+    unsigned int i, j;
+    int kind;
+
+    stress_n_threads = max_threads ? max_threads : num_online_cpus();
+
+    stress_threads = kcalloc(stress_n_threads, sizeof(*stress_threads),
+        GFP_KERNEL);
+    if(stress_threads == NULL) return -ENOMEM;
+
+    for(i = 0; i < stress_n_threads; i++)
+    {
+        struct stress_thread* t = &stress_threads[i];
+
+        t->index = i;
+        t->random = 2463534242u + i;
+
+        for(kind = 0; kind < stress_kind_direct; kind++)
+        {
+            t->objects[kind] = kcalloc(n_objects, sizeof(*t->objects[kind]),
+                GFP_KERNEL);
+            if(t->objects[kind] == NULL) goto err;
+        }
+
+        t->direct_objects = kcalloc(n_objects, sizeof(*t->direct_objects),
+            GFP_KERNEL);
+        if(t->direct_objects == NULL) goto err;
+
+        for(kind = 0; kind < stress_kind_count; kind++)
+        {
+            for(j = 0; j < n_objects; j++)
+                stress_object_set_ops(kind, stress_object(t, kind, j),
+                    j % STRESS_VARIANTS);
+        }
+    }
+
+    return 0;
+
+err:
+    stress_threads_free();
+    return -ENOMEM;
+}
+
+/* Run threads for 'duration' seconds. */
+static int stress_threads_run(void)
+{
+    unsigned int i;
+    int cpu = -1;
+    int result = 0;
+    unsigned int n_started;
+
+    WRITE_ONCE(stress_stop, 0);
+
+    for(i = 0; i < stress_n_threads; i++)
+    {
+        struct task_struct* task;
+
+        cpu = cpumask_next(cpu, cpu_online_mask);
+        if(cpu >= nr_cpu_ids) cpu = cpumask_first(cpu_online_mask);
+
+        task = kthread_create(stress_thread_func, &stress_threads[i],
+            "kedr_coi_stress/%u", i);
+        if(IS_ERR(task))
+        {
+            pr_err("Failed to create stress thread.");
+            result = PTR_ERR(task);
+            break;
+        }
+        // Thread may finish before kthread_stop() is called.
+        get_task_struct(task);
+        kthread_bind(task, cpu);
+        stress_threads[i].task = task;
+        wake_up_process(task);
+    }
+    n_started = i;
+
+    if(!result && payload_interval_ms)
+    {
+        stress_payload_task = kthread_run(stress_payload_thread_func, NULL,
+            "kedr_coi_stress_payload");
+        if(IS_ERR(stress_payload_task))
+        {
+            pr_err("Failed to create payload thread.");
+            result = PTR_ERR(stress_payload_task);
+            stress_payload_task = NULL;
+        }
+        else
+        {
+            get_task_struct(stress_payload_task);
+        }
+    }
+
+    if(!result)
+    {
+        unsigned long end = jiffies + msecs_to_jiffies(duration * 1000);
+
+        while(!READ_ONCE(stress_stop) && time_before(jiffies, end))
+            msleep(100);
+    }
+
+    WRITE_ONCE(stress_stop, 1);
+
+    if(stress_payload_task)
+    {
+        kthread_stop(stress_payload_task);
+        put_task_struct(stress_payload_task);
+        stress_payload_task = NULL;
+    }
+
+    for(i = 0; i < n_started; i++)
+    {
+        kthread_stop(stress_threads[i].task);
+        put_task_struct(stress_threads[i].task);
+
+        if(stress_threads[i].result) result = stress_threads[i].result;
+    }
+
+    if(stress_payload_result) result = stress_payload_result;
+
+    return result;
+}
+
+static void stress_report(void)
+{
+    u64 counts[stress_op_count] = {0};
+    unsigned int i;
+    int op;
+
+    for(i = 0; i < stress_n_threads; i++)
+    {
+        for(op = 0; op < stress_op_count; op++)
+            counts[op] += stress_threads[i].counts[op];
+    }
+    counts[stress_op_payload] = stress_payload_count;
+
+    pr_info("Stress test: %u threads, %u objects of every kind per thread, "
+        "%u seconds.", stress_n_threads, n_objects, duration);
+
+    for(op = 0; op < stress_op_count; op++)
+    {
+        pr_info("Stress test: %s - %llu operations, %llu per second.",
+            stress_op_names[op], (unsigned long long)counts[op],
+            (unsigned long long)div_u64(counts[op], duration ? duration : 1));
+    }
+}
+
+//******************Test infrastructure**********************************//
+int test_init(void)
+{
+    int kind, variant;
+
+    for(kind = 0; kind < stress_kind_direct; kind++)
+    {
+        for(variant = 0; variant < STRESS_VARIANTS; variant++)
+        {
+            stress_ops[kind][variant].op1 = op_origs[variant];
+            stress_ops[kind][variant].op2 = op_origs[variant];
+        }
+    }
+
+    if(n_objects == 0)
+    {
+        pr_err("Number of objects should be positive.");
+        return -EINVAL;
+    }
+
+    at_place_interceptor = kedr_coi_interceptor_create_at_place(
+        "Stress indirect interceptor (at place)",
+        offsetof(struct stress_object, ops),
+        sizeof(struct stress_operations),
+        at_place_intermediates);
+    if(at_place_interceptor == NULL) goto err_at_place;
+
+    use_copy_interceptor = kedr_coi_interceptor_create_use_copy(
+        "Stress indirect interceptor (use copy)",
+        offsetof(struct stress_object, ops),
+        sizeof(struct stress_operations),
+        use_copy_intermediates);
+    if(use_copy_interceptor == NULL) goto err_use_copy;
+
+    direct_interceptor = kedr_coi_interceptor_create_direct(
+        "Stress direct interceptor",
+        sizeof(struct stress_direct_object),
+        direct_intermediates);
+    if(direct_interceptor == NULL) goto err_direct;
+
+    factory_interceptor = kedr_coi_factory_interceptor_create(
+        use_copy_interceptor,
+        "Stress factory interceptor",
+        offsetof(struct stress_factory, factory_ops),
+        factory_intermediates);
+    if(factory_interceptor == NULL) goto err_factory;
+
+    kedr_coi_interceptor_trace_unforgotten_object(at_place_interceptor,
+        &stress_trace_unforgotten_object);
+    kedr_coi_interceptor_trace_unforgotten_object(use_copy_interceptor,
+        &stress_trace_unforgotten_object);
+    kedr_coi_interceptor_trace_unforgotten_object(direct_interceptor,
+        &stress_trace_unforgotten_object);
+
+    return 0;
+
+err_factory:
+    kedr_coi_interceptor_destroy(direct_interceptor);
+err_direct:
+    kedr_coi_interceptor_destroy(use_copy_interceptor);
+err_use_copy:
+    kedr_coi_interceptor_destroy(at_place_interceptor);
+err_at_place:
+    pr_err("Failed to create interceptors for test.");
+    return -EINVAL;
+}
+
+void test_cleanup(void)
+{
+    kedr_coi_factory_interceptor_destroy(factory_interceptor);
+    kedr_coi_interceptor_destroy(direct_interceptor);
+    kedr_coi_interceptor_destroy(use_copy_interceptor);
+    kedr_coi_interceptor_destroy(at_place_interceptor);
+}
+
+// Test itself
+int test_run(void)
+{
+    int result;
+    int misdirected_calls;
+
+    result = stress_threads_alloc();
+    if(result)
+    {
+        pr_err("Failed to allocate objects for test.");
+        goto err_alloc;
+    }
+
+    result = stress_payloads_register(payloads);
+    if(result) goto err_payload;
+
+    result = stress_interceptors_start();
+    if(result) goto err_start;
+
+    result = stress_factories_watch();
+    if(result) goto err_test;
+
+    result = stress_threads_run();
+
+    stress_report();
+
+    misdirected_calls = atomic_read(&stress_misdirected_calls);
+    if(misdirected_calls)
+    {
+        pr_err("%d calls reached original operation of another object.",
+            misdirected_calls);
+        result = -EINVAL;
+    }
+
+    if(stress_forget_all()) result = -EINVAL;
+
+err_test:
+    stress_interceptors_stop();
+
+    if(atomic_read(&stress_unforgotten_objects))
+    {
+        pr_err("%d objects weren't forgotten before interceptor stopped.",
+            atomic_read(&stress_unforgotten_objects));
+        result = -EINVAL;
+    }
+err_start:
+    stress_payloads_unregister(payloads);
+    if(payload2_registered)
+    {
+        stress_payloads_unregister(payloads2);
+        payload2_registered = false;
+    }
+err_payload:
+    stress_threads_free();
+err_alloc:
+    return result;
+}
@@ -13,13 +13,15 @@ typedef void (*kedr_coi_test_op_t)(void* object, void* another_object);
 
 #define INTERMEDIATE(op_name, op_repl) {\
     .operation_offset = OPERATION_OFFSET(op_name),\
-    .repl = (void*)&op_repl\
+    .repl = (void*)&op_repl,\
+    .name = #op_name\
 }
 
 #define INTERMEDIATE_INTERNAL_ONLY(op_name, op_repl) {\
     .operation_offset = OPERATION_OFFSET(op_name),\
     .repl = (void*)&op_repl,\
-    .internal_only = true\
+    .internal_only = true,\
+    .name = #op_name\
 }
 
 #define HANDLER_FUNC_CHECKED(handler_func, type) BUILD_BUG_ON_ZERO(!__builtin_types_compatible_p(typeof(&handler_func), type)) + (char*)&handler_func
@@ -48,6 +50,7 @@ static inline void intermediate_func_common(void* object,
     void (*op_orig)(void* object, void* data);
     struct kedr_coi_operation_call_info call_info;
     struct kedr_coi_intermediate_info info; 
+    struct kedr_coi_hook_context hook_context;
     
     kedr_coi_interceptor_get_intermediate_info(interceptor, object, operation_offset, &info); 
 
@@ -55,6 +58,18 @@ static inline void intermediate_func_common(void* object,
     call_info.op_orig = info.op_orig;
     op_orig = (typeof(op_orig))info.op_orig;
 
+    if(info.hooks)
+    {
+        hook_context.operation_offset = operation_offset;
+        hook_context.object = object;
+        hook_context.return_address = call_info.return_address;
+        hook_context.n_args = 2;
+        hook_context.args[0] = (u64)(unsigned long)object;
+        hook_context.args[1] = (u64)(unsigned long)data;
+        hook_context.return_value = 0;
+        kedr_coi_hook_pre(info.hooks, &hook_context);
+    }
+
     if(info.pre)
     {
         void (**pre_handler)(void* object, void* data, struct kedr_coi_operation_call_info* info);
@@ -76,6 +91,8 @@ static inline void intermediate_func_common(void* object,
         }
     }
 
+    if(info.hooks)
+        kedr_coi_hook_post(info.hooks, &hook_context);
 }
 
 #define KEDR_COI_TEST_DEFINE_INTERMEDIATE_FUNC(func_name, operation_offset, interceptor)  \
@@ -16,6 +16,7 @@ static inline void factory_intermediate_func_common(void* object,
     void (*op_chained)(void* object, void* data);
     struct kedr_coi_intermediate_info info;
     struct kedr_coi_operation_call_info call_info;
+    struct kedr_coi_hook_context hook_context;
     
     int result = kedr_coi_factory_interceptor_bind_object(interceptor,
         object,
@@ -29,6 +30,18 @@ static inline void factory_intermediate_func_common(void* object,
     call_info.op_orig = info.op_orig;
     op_chained = (typeof(op_chained))info.op_chained;
 
+    if(info.hooks)
+    {
+        hook_context.operation_offset = operation_offset;
+        hook_context.object = object;
+        hook_context.return_address = call_info.return_address;
+        hook_context.n_args = 2;
+        hook_context.args[0] = (u64)(unsigned long)object;
+        hook_context.args[1] = (u64)(unsigned long)data;
+        hook_context.return_value = 0;
+        kedr_coi_hook_pre(info.hooks, &hook_context);
+    }
+
     if(info.pre)
     {
         void (**pre_handler)(void* object, void* data, struct kedr_coi_operation_call_info* info);
@@ -52,6 +65,9 @@ static inline void factory_intermediate_func_common(void* object,
             (*post_handler)(object, data, &call_info);
         }
     }
+
+    if(info.hooks)
+        kedr_coi_hook_post(info.hooks, &hook_context);
 }
 
 #define KEDR_COI_TEST_DEFINE_FACTORY_INTERMEDIATE_FUNC(func_name, get_factory, operation_offset, interceptor)  \
@@ -0,0 +1,254 @@
+#! /usr/bin/python
+
+# Compare results of the benchmark with the baseline.
+#
+# Usage: perf_compare.py [options] baseline.json result.tsv...
+#
+# Every result file is an output of the benchmark: tab-separated lines
+# with the header line '# <column>\t<column>...' before them. Other
+# comment lines describe configuration of the benchmark (kernel, number
+# of CPUs, etc.).
+#
+# Lines are identified by the values of the key columns (--keys). For
+# other columns the name determines whether the value is compared:
+#
+#  - '*_ns', '*_per_call', '*_per_object' - lower is better,
+#  - '*_per_sec' - higher is better,
+#  - others, and maximums ('*max*') which are too noisy, are only stored.
+#
+# When several result files are given (several runs of the benchmark),
+# the best value of every compared column is used.
+#
+# Results are written in JSON (--output). If the baseline does not exist
+# or --update is given, results are written as the baseline too.
+#
+# Exit status is 0 if no value is worse than the baseline by more than
+# the threshold (--threshold, in percents), 1 otherwise and 2 on error.
+
+import argparse
+import json
+import os
+import sys
+
+FORMAT_VERSION = 1
+
+LOWER_IS_BETTER = ("_ns", "_per_call", "_per_object")
+HIGHER_IS_BETTER = ("_per_sec",)
+
+
+def column_direction(name):
+    """Return -1 if lower value is better, 1 if higher, 0 if not compared."""
+    if "max" in name:
+        return 0
+    if name.endswith(LOWER_IS_BETTER):
+        return -1
+    if name.endswith(HIGHER_IS_BETTER):
+        return 1
+    return 0
+
+
+def parse_number(value):
+    try:
+        return int(value)
+    except ValueError:
+        pass
+    try:
+        return float(value)
+    except ValueError:
+        return None
+
+
+def read_results(path, keys):
+    """Return (config lines, columns, {key: {column: value}})."""
+    config = []
+    columns = None
+    results = {}
+
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not line:
+                continue
+            if line.startswith("#"):
+                text = line[1:].strip()
+                if "\t" in text:
+                    columns = text.split("\t")
+                else:
+                    config.append(text)
+                continue
+
+            if columns is None:
+                raise ValueError("%s: no header before results" % path)
+
+            values = line.split("\t")
+            if len(values) != len(columns):
+                raise ValueError("%s: wrong number of columns in '%s'"
+                                 % (path, line))
+            row = dict(zip(columns, values))
+
+            try:
+                key = "/".join(row[k] for k in keys)
+            except KeyError as e:
+                raise ValueError("%s: no key column %s" % (path, e))
+
+            results[key] = dict((name, parse_number(value))
+                                for name, value in row.items()
+                                if name not in keys)
+
+    if columns is None:
+        raise ValueError("%s: no results" % path)
+
+    return config, columns, results
+
+
+def merge_best(current, results):
+    """Merge results of one more run into current ones, keeping the best."""
+    for key, row in results.items():
+        best = current.setdefault(key, row)
+        if best is row:
+            continue
+        for name, value in row.items():
+            direction = column_direction(name)
+            old = best.get(name)
+            if direction == 0 or value is None or old is None:
+                continue
+            if (value - old) * direction > 0:
+                best[name] = value
+
+
+def compare(baseline, current, threshold):
+    """Print comparison and return number of regressions."""
+    regressions = 0
+
+    for key in sorted(baseline["results"]):
+        base_row = baseline["results"][key]
+        row = current["results"].get(key)
+        if row is None:
+            print("%s: no result" % key)
+            regressions += 1
+            continue
+
+        for name in sorted(base_row):
+            direction = column_direction(name)
+            base_value = base_row[name]
+            value = row.get(name)
+            if direction == 0 or base_value is None or value is None:
+                continue
+            if base_value == 0:
+                continue
+
+            change = (value - base_value) * 100.0 / base_value
+            status = ""
+            if -change * direction > threshold:
+                status = "REGRESSION"
+                regressions += 1
+            elif change * direction > threshold:
+                status = "improved"
+            print("%s %s: %s -> %s (%+.1f%%) %s"
+                  % (key, name, base_value, value, change, status))
+
+    for key in sorted(set(current["results"]) - set(baseline["results"])):
+        print("%s: not in the baseline" % key)
+
+    return regressions
+
+
+def write_json(path, data):
+    directory = os.path.dirname(path)
+    if directory and not os.path.isdir(directory):
+        os.makedirs(directory)
+    with open(path, "w") as f:
+        json.dump(data, f, indent=1, sort_keys=True)
+        f.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare results of the benchmark with the baseline.")
+    parser.add_argument("--benchmark", required=True)
+    parser.add_argument("--kernel", required=True)
+    parser.add_argument("--keys", required=True,
+                        help="comma-separated names of the key columns")
+    parser.add_argument("--config", default="",
+                        help="parameters of the benchmark")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed degradation, in percents")
+    parser.add_argument("--output", help="file for the results in JSON")
+    parser.add_argument("--update", action="store_true",
+                        help="replace the baseline with the results")
+    parser.add_argument("baseline")
+    parser.add_argument("results", nargs="+")
+    args = parser.parse_args()
+
+    keys = args.keys.split(",")
+
+    config = None
+    columns = None
+    results = {}
+    try:
+        for path in args.results:
+            run_config, run_columns, run_results = read_results(path, keys)
+            if config is None:
+                config, columns = run_config, run_columns
+            elif run_columns != columns:
+                raise ValueError("%s: columns differ from other runs" % path)
+            merge_best(results, run_results)
+    except (IOError, ValueError) as e:
+        sys.stderr.write("%s\n" % e)
+        return 2
+
+    if args.config:
+        config.append(args.config)
+
+    current = {
+        "version": FORMAT_VERSION,
+        "benchmark": args.benchmark,
+        "kernel": args.kernel,
+        "config": config,
+        "columns": columns,
+        "keys": keys,
+        "runs": len(args.results),
+        "results": results,
+    }
+
+    if args.output:
+        write_json(args.output, current)
+
+    if args.update or not os.path.exists(args.baseline):
+        write_json(args.baseline, current)
+        print("Baseline is written to %s." % args.baseline)
+        return 0
+
+    try:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    except (IOError, ValueError) as e:
+        sys.stderr.write("Failed to read baseline %s: %s\n"
+                         % (args.baseline, e))
+        return 2
+
+    if baseline.get("version") != FORMAT_VERSION or \
+            baseline.get("keys") != keys:
+        sys.stderr.write("Baseline %s has another format, "
+                         "update it.\n" % args.baseline)
+        return 2
+
+    if baseline.get("config") != config:
+        sys.stderr.write("Baseline %s is obtained with another "
+                         "configuration:\n  %s\ncurrent one is:\n  %s\n"
+                         "Update the baseline.\n"
+                         % (args.baseline, "\n  ".join(baseline["config"]),
+                            "\n  ".join(config)))
+        return 2
+
+    regressions = compare(baseline, current, args.threshold)
+    if regressions:
+        print("%d regression(s) beyond %g%% threshold." %
+              (regressions, args.threshold))
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,337 @@
+/*
+ * Benchmark of the core data structures built for userspace.
+ *
+ * Measures average time of the basic operations:
+ *
+ *   hash_add, hash_find, hash_remove - operations with hash table;
+ *   watch, forget - watching and forgetting objects by instrumentor;
+ *   get_orig - search of the original operation for watched object,
+ *       which is performed on every intercepted call;
+ *   interception_info - search of the handlers for the operation,
+ *       which is also performed on every intercepted call.
+ *
+ * Objects are accessed in pseudo-random order with fixed seed, so
+ * results are comparable between runs. Result is printed as
+ * tab-separated lines:
+ *
+ *   <test> <objects> <operations> <ns_per_operation>
+ *
+ * Being a normal process, the benchmark may be run under perf or
+ * valgrind for profile the core code.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+#include <getopt.h>
+
+extern "C" {
+#include "kedr_coi_hash_table.h"
+#include "kedr_coi_instrumentor_internal.h"
+#include "payloads.h"
+
+#include <linux/sched.h>
+}
+
+/* Parameters */
+static size_t n_objects = 10000;
+static size_t n_calls = 1000000;
+
+/* Operations and objects */
+struct bench_operations
+{
+    int (*op1)(void* object);
+    int (*op2)(void* object);
+};
+
+struct bench_object
+{
+    const struct bench_operations* ops;
+};
+
+static int op1_orig(void* object) { return 1; }
+static int op2_orig(void* object) { return 2; }
+static int op1_repl(void* object) { return 10; }
+
+#define OP_OFFSET(op) offsetof(struct bench_operations, op)
+
+static const struct kedr_coi_replacement replacements[] =
+{
+    {OP_OFFSET(op1), (void*)&op1_repl, replace_all},
+    {(size_t)-1}
+};
+
+static bool replace_at_place_never(const void* ops)
+{
+    return false;
+}
+
+static const struct kedr_coi_intermediate intermediates[] =
+{
+    {OP_OFFSET(op1), (void*)&op1_repl, 0, false, "op1"},
+    {(size_t)-1}
+};
+
+static void op1_pre(void* object, struct kedr_coi_operation_call_info* info)
+{
+}
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    {OP_OFFSET(op1), (void*)&op1_pre, false},
+    {(size_t)-1}
+};
+
+/*
+ * Simple pseudo-random generator (xorshift). Fixed seed makes the order
+ * the same for every run, so results are comparable.
+ */
+static unsigned int bench_random(unsigned int* state)
+{
+    unsigned int x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+/* Fill 'order' with shuffled indices 0..n-1. */
+static void bench_shuffle(std::vector<size_t>& order)
+{
+    unsigned int state = 2463534242u;
+    size_t i;
+
+    for(i = 0; i < order.size(); i++) order[i] = i;
+
+    for(i = order.size(); i > 1; i--)
+        std::swap(order[i - 1], order[bench_random(&state) % i]);
+}
+
+static void bench_result(const char* test, size_t n_ops, u64 time)
+{
+    printf("%s\t%zu\t%zu\t%.1f\n", test, n_objects, n_ops,
+        n_ops ? (double)time / n_ops : 0.0);
+}
+
+/* Avoid the calls being optimized out. */
+static volatile unsigned long bench_sink;
+
+static int bench_hash_table(const std::vector<size_t>& order)
+{
+    struct kedr_coi_hash_table table;
+    std::vector<struct kedr_coi_hash_elem> elems(n_objects);
+    unsigned long found = 0;
+    u64 start;
+    size_t i;
+
+    if(kedr_coi_hash_table_init(&table)) return 1;
+
+    for(i = 0; i < n_objects; i++)
+        kedr_coi_hash_elem_init(&elems[i], &elems[i]);
+
+    start = local_clock();
+    for(i = 0; i < n_objects; i++)
+    {
+        if(kedr_coi_hash_table_add_elem(&table, &elems[order[i]]))
+        {
+            fprintf(stderr, "Failed to add element into hash table.\n");
+            return 1;
+        }
+    }
+    bench_result("hash_add", n_objects, local_clock() - start);
+
+    start = local_clock();
+    for(i = 0; i < n_calls; i++)
+    {
+        found += kedr_coi_hash_table_find_elem(&table,
+            &elems[order[i % n_objects]]) != NULL;
+    }
+    bench_result("hash_find", n_calls, local_clock() - start);
+    bench_sink = found;
+
+    start = local_clock();
+    for(i = 0; i < n_objects; i++)
+        kedr_coi_hash_table_remove_elem(&table, &elems[order[i]]);
+    bench_result("hash_remove", n_objects, local_clock() - start);
+
+    kedr_coi_hash_table_destroy(&table, NULL, NULL);
+
+    return 0;
+}
+
+static int bench_instrumentor(const std::vector<size_t>& order)
+{
+    static const struct bench_operations ops = {op1_orig, op2_orig};
+    struct kedr_coi_instrumentor* instrumentor;
+    std::vector<struct bench_object> objects(n_objects);
+    unsigned long found = 0;
+    void* op;
+    u64 start;
+    size_t i;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    if(instrumentor == NULL) return 1;
+
+    for(i = 0; i < n_objects; i++) objects[i].ops = &ops;
+
+    start = local_clock();
+    for(i = 0; i < n_objects; i++)
+    {
+        struct bench_object* object = &objects[order[i]];
+
+        if(kedr_coi_instrumentor_watch(instrumentor, object,
+            (const void**)&object->ops) != 0)
+        {
+            fprintf(stderr, "Failed to watch object.\n");
+            kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+            return 1;
+        }
+    }
+    bench_result("watch", n_objects, local_clock() - start);
+
+    start = local_clock();
+    for(i = 0; i < n_calls; i++)
+    {
+        struct bench_object* object = &objects[order[i % n_objects]];
+
+        kedr_coi_instrumentor_get_orig_operation(instrumentor, object,
+            object->ops, OP_OFFSET(op1), &op);
+        found += (op == (void*)&op1_orig);
+    }
+    bench_result("get_orig", n_calls, local_clock() - start);
+    bench_sink = found;
+
+    start = local_clock();
+    for(i = 0; i < n_objects; i++)
+    {
+        struct bench_object* object = &objects[order[i]];
+
+        kedr_coi_instrumentor_forget(instrumentor, object,
+            (const void**)&object->ops);
+    }
+    bench_result("forget", n_objects, local_clock() - start);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+
+    return 0;
+}
+
+static int bench_payloads(void)
+{
+    struct operation_payloads payloads;
+    struct kedr_coi_payload payload = {NULL, pre_handlers, NULL};
+    void* const* pre;
+    void* const* post;
+    void* measure;
+    unsigned long found = 0;
+    u64 start;
+    size_t i;
+
+    if(operation_payloads_init(&payloads, intermediates, "benchmark"))
+        return 1;
+    if(operation_payloads_add(&payloads, &payload)) goto err_add;
+    if(operation_payloads_use(&payloads, 0)) goto err_use;
+
+    start = local_clock();
+    for(i = 0; i < n_calls; i++)
+    {
+        operation_payloads_get_interception_info(&payloads, OP_OFFSET(op1),
+            0, &pre, &post, &measure);
+        found += (pre[0] != NULL);
+    }
+    bench_result("interception_info", n_calls, local_clock() - start);
+    bench_sink = found;
+
+    operation_payloads_unuse(&payloads);
+    operation_payloads_remove(&payloads, &payload);
+    operation_payloads_destroy(&payloads);
+
+    return 0;
+
+err_use:
+    operation_payloads_remove(&payloads, &payload);
+err_add:
+    operation_payloads_destroy(&payloads);
+    return 1;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [--objects N] [--calls N]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] =
+    {
+        {"objects", required_argument, NULL, 'n'},
+        {"calls", required_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    int result;
+
+    while((opt = getopt_long(argc, argv, "n:c:", options, NULL)) != -1)
+    {
+        switch(opt)
+        {
+        case 'n':
+            n_objects = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            n_calls = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if((optind != argc) || (n_objects == 0))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(kedr_coi_instrumentors_init())
+    {
+        fprintf(stderr, "Failed to initialize instrumentors.\n");
+        return 1;
+    }
+
+    std::vector<size_t> order(n_objects);
+    bench_shuffle(order);
+
+    printf("# test\tobjects\toperations\tns_per_operation\n");
+
+    result = bench_hash_table(order)
+        || bench_instrumentor(order)
+        || bench_payloads();
+
+    kedr_coi_instrumentors_destroy();
+
+    return result;
+}
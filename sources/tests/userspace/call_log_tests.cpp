@@ -0,0 +1,409 @@
+/*
+ * Tests for the log of intercepted calls (tools/call_reader).
+ *
+ * Log is written from call records and read back. Besides the round
+ * trip, the exact bytes of the written log are checked, because format
+ * of the log should be stable.
+ *
+ * Same framework as in unit_tests.cpp: test fails on the first
+ * unsatisfied CHECK(). Names of the tests to run may be passed as
+ * arguments, by default all tests are run.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <string>
+#include <unistd.h>
+
+#include "kedr_coi_call_log.h"
+
+/* Test framework */
+static bool test_failed;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+            #cond); \
+        test_failed = true; \
+        return; \
+    } } while(0)
+
+struct test_case
+{
+    const char* name;
+    void (*func)(void);
+};
+
+/* Log file used by the tests. */
+static std::string log_path;
+
+static struct kedr_coi_call_record make_record(__u16 type,
+    __u64 timestamp, __u64 object, __u32 operation_offset,
+    __u64 duration, __s64 return_value)
+{
+    struct kedr_coi_call_record record;
+
+    memset(&record, 0, sizeof(record));
+    record.type = type;
+    record.timestamp = timestamp;
+    record.object = object;
+    record.operation_offset = operation_offset;
+    record.duration = duration;
+    record.return_value = return_value;
+    record.interceptor_id = 3;
+    record.pid = 100;
+    record.cpu = 1;
+
+    return record;
+}
+
+static std::vector<unsigned char> read_file(const char* path)
+{
+    std::vector<unsigned char> data;
+    FILE* f = fopen(path, "rb");
+    int c;
+
+    if(f == NULL) return data;
+    while((c = fgetc(f)) != EOF) data.push_back(c);
+    fclose(f);
+
+    return data;
+}
+
+static bool write_file(const char* path, const std::vector<unsigned char>& data)
+{
+    FILE* f = fopen(path, "wb");
+    bool result;
+
+    if(f == NULL) return false;
+    result = data.empty() || (fwrite(&data[0], data.size(), 1, f) == 1);
+
+    return !fclose(f) && result;
+}
+
+/* Read all events of the log. Return false on error. */
+static bool read_log(const char* path,
+    std::vector<struct kedr_coi_call_log_event>& events,
+    std::vector<std::string>& names)
+{
+    struct kedr_coi_call_log_reader* reader;
+    struct kedr_coi_call_log_event event;
+    int result;
+
+    reader = kedr_coi_call_log_reader_open(path);
+    if(reader == NULL) return false;
+
+    while((result = kedr_coi_call_log_read(reader, &event)) > 0)
+    {
+        names.push_back(event.name ? event.name : "");
+        event.name = NULL;
+        events.push_back(event);
+    }
+
+    kedr_coi_call_log_reader_close(reader);
+
+    return result == 0;
+}
+
+/* Watch, calls and forget of the object, then the same address again. */
+static void test_call_log_round_trip(void)
+{
+    struct kedr_coi_call_log_writer* writer;
+    struct kedr_coi_call_record record;
+    std::vector<struct kedr_coi_call_log_event> events;
+    std::vector<std::string> names;
+
+    writer = kedr_coi_call_log_writer_open(log_path.c_str());
+    CHECK(writer != NULL);
+
+    CHECK(kedr_coi_call_log_write_interceptor(writer, 3, "file_ops") == 0);
+    CHECK(kedr_coi_call_log_write_operation(writer, 3, 16, "read") == 0);
+
+    record = make_record(kedr_coi_call_record_type_watch,
+        1000000, 0xffff880012345678ULL, 0, 0, 0);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    record = make_record(kedr_coi_call_record_type_call,
+        1000500, 0xffff880012345678ULL, 16, 300, 4096);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    // Records of different CPUs may come slightly out of order.
+    record = make_record(kedr_coi_call_record_type_call,
+        1000400, 0xffff880012345678ULL, 16, 50, -22);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    // Another object, watched before recording.
+    record = make_record(kedr_coi_call_record_type_call,
+        1000600, 0xffff880087654321ULL, 16, 0, 0);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    record = make_record(kedr_coi_call_record_type_forget,
+        2000000, 0xffff880012345678ULL, 0, 0, 0);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    // Address is reused by the new object.
+    record = make_record(kedr_coi_call_record_type_watch,
+        2000100, 0xffff880012345678ULL, 0, 0, 0);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    CHECK(kedr_coi_call_log_write_lost(writer, 1, 7) == 0);
+
+    CHECK(kedr_coi_call_log_writer_close(writer) == 0);
+
+    CHECK(read_log(log_path.c_str(), events, names));
+    CHECK(events.size() == 9);
+
+    CHECK(events[0].type == kedr_coi_call_log_event_interceptor);
+    CHECK(events[0].interceptor_id == 3);
+    CHECK(names[0] == "file_ops");
+
+    CHECK(events[1].type == kedr_coi_call_log_event_operation);
+    CHECK(events[1].operation_offset == 16);
+    CHECK(names[1] == "read");
+
+    CHECK(events[2].type == kedr_coi_call_log_event_watch);
+    CHECK(events[2].timestamp == 1000000);
+    CHECK(events[2].object == 1);
+
+    CHECK(events[3].type == kedr_coi_call_log_event_call);
+    CHECK(events[3].timestamp == 1000500);
+    CHECK(events[3].interceptor_id == 3);
+    CHECK(events[3].operation_offset == 16);
+    CHECK(events[3].object == 1);
+    CHECK(events[3].duration == 300);
+    CHECK(events[3].return_value == 4096);
+    CHECK(events[3].pid == 100);
+    CHECK(events[3].cpu == 1);
+
+    CHECK(events[4].timestamp == 1000400);
+    CHECK(events[4].return_value == -22);
+
+    CHECK(events[5].object == 2);
+    CHECK(events[5].duration == 0);
+
+    CHECK(events[6].type == kedr_coi_call_log_event_forget);
+    CHECK(events[6].timestamp == 2000000);
+    CHECK(events[6].object == 1);
+
+    CHECK(events[7].type == kedr_coi_call_log_event_watch);
+    CHECK(events[7].object == 3);
+
+    CHECK(events[8].type == kedr_coi_call_log_event_lost);
+    CHECK(events[8].cpu == 1);
+    CHECK(events[8].lost == 7);
+}
+
+/* Exact bytes of the log: the format should not change. */
+static void test_call_log_format(void)
+{
+    static const unsigned char expected[] =
+    {
+        // Header: magic, version 1, flags.
+        'K', 'C', 'O', 'I', 'L', 'O', 'G', 0, 1, 0, 0, 0, 0, 0, 0, 0,
+        // Interceptor 3 "fops".
+        1, 5, 3, 'f', 'o', 'p', 's',
+        // Watch at 100: timestamp delta 100 (zigzag 200), interceptor,
+        // object 1.
+        4, 4, 0xc8, 0x01, 3, 1,
+        // Call at 90: delta -10 (zigzag 19), interceptor, offset 16,
+        // object 1, duration 5, return -1 (zigzag 1), pid 100, cpu 1.
+        3, 8, 19, 3, 16, 1, 5, 1, 100, 1,
+        // Lost: cpu 1, 2 records.
+        6, 2, 1, 2,
+    };
+    struct kedr_coi_call_log_writer* writer;
+    struct kedr_coi_call_record record;
+    std::vector<unsigned char> data;
+
+    writer = kedr_coi_call_log_writer_open(log_path.c_str());
+    CHECK(writer != NULL);
+
+    CHECK(kedr_coi_call_log_write_interceptor(writer, 3, "fops") == 0);
+    record = make_record(kedr_coi_call_record_type_watch, 100, 0x1000, 0, 0, 0);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    record = make_record(kedr_coi_call_record_type_call, 90, 0x1000, 16, 5, -1);
+    CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    CHECK(kedr_coi_call_log_write_lost(writer, 1, 2) == 0);
+
+    CHECK(kedr_coi_call_log_writer_close(writer) == 0);
+
+    data = read_file(log_path.c_str());
+    CHECK(data.size() == sizeof(expected));
+    CHECK(memcmp(&data[0], expected, sizeof(expected)) == 0);
+}
+
+/* Events with unknown tags and unknown trailing fields are skipped. */
+static void test_call_log_unknown_events(void)
+{
+    static const unsigned char log[] =
+    {
+        'K', 'C', 'O', 'I', 'L', 'O', 'G', 0, 1, 0, 0, 0, 0, 0, 0, 0,
+        // Unknown event.
+        200, 3, 1, 2, 3,
+        // Watch with additional field.
+        4, 5, 0xc8, 0x01, 3, 1, 42,
+    };
+    std::vector<struct kedr_coi_call_log_event> events;
+    std::vector<std::string> names;
+
+    CHECK(write_file(log_path.c_str(),
+        std::vector<unsigned char>(log, log + sizeof(log))));
+
+    CHECK(read_log(log_path.c_str(), events, names));
+    CHECK(events.size() == 1);
+    CHECK(events[0].type == kedr_coi_call_log_event_watch);
+    CHECK(events[0].timestamp == 100);
+    CHECK(events[0].object == 1);
+}
+
+/* Bad header and truncated events are reported. */
+static void test_call_log_corrupted(void)
+{
+    static const unsigned char log[] =
+    {
+        'K', 'C', 'O', 'I', 'L', 'O', 'G', 0, 1, 0, 0, 0, 0, 0, 0, 0,
+        4, 4, 0xc8, 0x01, 3,
+    };
+    std::vector<unsigned char> data(log, log + sizeof(log));
+    std::vector<struct kedr_coi_call_log_event> events;
+    std::vector<std::string> names;
+
+    CHECK(write_file(log_path.c_str(), data));
+    errno = 0;
+    CHECK(!read_log(log_path.c_str(), events, names));
+    CHECK(errno == EPROTO);
+
+    // Unsupported version.
+    data[8] = 2;
+    CHECK(write_file(log_path.c_str(), data));
+    CHECK(kedr_coi_call_log_reader_open(log_path.c_str()) == NULL);
+    CHECK(errno == EPROTO);
+
+    // Not a log.
+    data[0] = 'X';
+    CHECK(write_file(log_path.c_str(), data));
+    CHECK(kedr_coi_call_log_reader_open(log_path.c_str()) == NULL);
+    CHECK(errno == EPROTO);
+}
+
+/* Many objects: table of objects grows and addresses are reused. */
+static void test_call_log_many_objects(void)
+{
+    const unsigned int n_objects = 10000;
+    struct kedr_coi_call_log_writer* writer;
+    struct kedr_coi_call_record record;
+    std::vector<struct kedr_coi_call_log_event> events;
+    std::vector<std::string> names;
+    unsigned int i;
+
+    writer = kedr_coi_call_log_writer_open(log_path.c_str());
+    CHECK(writer != NULL);
+
+    for(i = 0; i < n_objects; i++)
+    {
+        record = make_record(kedr_coi_call_record_type_watch, i,
+            0x10000 + i * 64, 0, 0, 0);
+        CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    }
+    // Forget every second object, so remaining ones should be found.
+    for(i = 0; i < n_objects; i += 2)
+    {
+        record = make_record(kedr_coi_call_record_type_forget, n_objects + i,
+            0x10000 + i * 64, 0, 0, 0);
+        CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    }
+    for(i = 0; i < n_objects; i++)
+    {
+        record = make_record(kedr_coi_call_record_type_call, 2 * n_objects + i,
+            0x10000 + i * 64, 16, 1, 0);
+        CHECK(kedr_coi_call_log_write_record(writer, &record) == 0);
+    }
+
+    CHECK(kedr_coi_call_log_writer_close(writer) == 0);
+
+    CHECK(read_log(log_path.c_str(), events, names));
+    CHECK(events.size() == n_objects * 2 + n_objects / 2);
+
+    for(i = 0; i < n_objects; i++)
+    {
+        const struct kedr_coi_call_log_event& call =
+            events[n_objects + n_objects / 2 + i];
+
+        CHECK(call.type == kedr_coi_call_log_event_call);
+        if(i % 2)
+            CHECK(call.object == i + 1);
+        else
+            CHECK(call.object > n_objects);
+    }
+}
+
+static struct test_case tests[] =
+{
+    {"call_log_round_trip", test_call_log_round_trip},
+    {"call_log_format", test_call_log_format},
+    {"call_log_unknown_events", test_call_log_unknown_events},
+    {"call_log_corrupted", test_call_log_corrupted},
+    {"call_log_many_objects", test_call_log_many_objects},
+};
+
+static bool test_is_selected(const char* name, int argc, char** argv)
+{
+    int i;
+
+    if(argc < 2) return true;
+
+    for(i = 1; i < argc; i++)
+        if(!strcmp(argv[i], name)) return true;
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    char path[] = "/tmp/kedr_coi_call_log_XXXXXX";
+    int n_failed = 0;
+    int n_run = 0;
+    size_t i;
+    int fd;
+
+    fd = mkstemp(path);
+    if(fd == -1)
+    {
+        perror("Failed to create temporary file");
+        return 1;
+    }
+    close(fd);
+    log_path = path;
+
+    for(i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        if(!test_is_selected(tests[i].name, argc, argv)) continue;
+
+        test_failed = false;
+        tests[i].func();
+        n_run++;
+
+        if(test_failed) n_failed++;
+        printf("%s: %s\n", tests[i].name, test_failed ? "FAILED" : "OK");
+    }
+
+    unlink(path);
+
+    printf("%d of %d tests failed.\n", n_failed, n_run);
+
+    return n_failed ? 1 : 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * Tests for the per-CPU ring buffers of call records.
+ *
+ * Source file of the core is included here, so the tests may set its
+ * module parameters and check its internal state. Buffers are read as
+ * the userspace reader does, via layout reported in the mapped area.
+ *
+ * Same framework as in unit_tests.cpp: test fails on the first
+ * unsatisfied CHECK(). Names of the tests to run may be passed as
+ * arguments, by default all tests are run.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_call_records.c"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Defined by kedr_coi_debugfs.c, which is not built. */
+struct dentry* kedr_coi_debugfs_root = NULL;
+
+/* Test framework */
+static bool test_failed;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+            #cond); \
+        test_failed = true; \
+        return; \
+    } } while(0)
+
+struct test_case
+{
+    const char* name;
+    void (*func)(void);
+};
+
+/*
+ * Initialize buffers with one page of records (64 records) per CPU.
+ *
+ * Module is loaded once in the kernel, here counters of the current CPU
+ * are reset for every test.
+ */
+static int records_init(bool overwrite)
+{
+    struct call_records_cpu* records = this_cpu_ptr(&records_cpu);
+
+    records->head = 0;
+    records->dropped = 0;
+
+    call_records_pages = 1;
+    call_records_overwrite = overwrite;
+
+    return kedr_coi_call_records_init();
+}
+
+/* Record with 'object' equal to 'n'. */
+static void records_write(unsigned long n)
+{
+    kedr_coi_call_records_write(kedr_coi_call_record_type_call, 1,
+        8, (const void*)n, NULL, NULL, 0, 0);
+}
+
+/*
+ * Header of the buffer of current CPU, as the reader sees it: 'info' is
+ * the layout read from the start of the area.
+ */
+static struct kedr_coi_call_records_header* reader_header(
+    const struct kedr_coi_call_records_info* info)
+{
+    return (void*)((char*)records_area + info->buffers_offset
+        + (size_t)smp_processor_id() * info->buffer_size);
+}
+
+/* Record with given index, as the reader sees it. */
+static const struct kedr_coi_call_record* reader_record(
+    const struct kedr_coi_call_records_info* info, u64 index)
+{
+    const char* records = (const char*)reader_header(info)
+        + info->records_offset;
+
+    return (const void*)(records + (index % info->n_records)
+        * info->record_size);
+}
+
+/* New records are dropped when the buffer is full */
+static void test_records_drop(void)
+{
+    struct kedr_coi_call_records_info info;
+    struct kedr_coi_call_records_header* header;
+    unsigned long i;
+
+    CHECK(records_init(false) == 0);
+    info = *records_info;
+    CHECK(info.version == KEDR_COI_CALL_RECORDS_VERSION);
+    CHECK(info.n_records == PAGE_SIZE / sizeof(struct kedr_coi_call_record));
+    CHECK(info.n_cpus == nr_cpu_ids);
+    CHECK(!info.overwrite);
+
+    header = reader_header(records_info);
+
+    for(i = 0; i < 65; i++) records_write(i);
+    CHECK(header->head == 64);
+    CHECK(header->dropped == 1);
+    CHECK(reader_record(records_info, 63)->object == 63);
+
+    // Reader consumes some records, new ones wrap around.
+    header->tail = 10;
+    for(i = 100; i < 111; i++) records_write(i);
+    CHECK(header->head == 74);
+    CHECK(header->dropped == 2);
+    CHECK(reader_record(records_info, 64)->object == 100);
+    CHECK(reader_record(records_info, 73)->object == 109);
+    // Not consumed records are intact.
+    CHECK(reader_record(records_info, 10)->object == 10);
+    CHECK(reader_record(records_info, 73)->cpu == smp_processor_id());
+    CHECK(reader_record(records_info, 73)->pid == current->pid);
+
+    kedr_coi_call_records_destroy();
+}
+
+/* Oldest records are overwritten when the buffer is full */
+static void test_records_overwrite(void)
+{
+    struct kedr_coi_call_records_header* header;
+    unsigned long i;
+
+    CHECK(records_init(true) == 0);
+    CHECK(records_info->overwrite);
+
+    header = reader_header(records_info);
+
+    for(i = 0; i < 100; i++) records_write(i);
+    CHECK(header->head == 100);
+    CHECK(header->dropped == 0);
+
+    // Only the last records are available, in order of writing.
+    for(i = 100 - records_info->n_records; i < 100; i++)
+    {
+        const struct kedr_coi_call_record* record =
+            reader_record(records_info, i);
+
+        CHECK(record->object == i);
+        if(i > 100 - records_info->n_records)
+            CHECK(record->timestamp
+                >= reader_record(records_info, i - 1)->timestamp);
+    }
+
+    kedr_coi_call_records_destroy();
+}
+
+/* Mapped memory may be changed by userspace, kernel doesn't use it */
+static void test_records_layout(void)
+{
+    struct kedr_coi_call_records_info info;
+    struct kedr_coi_call_records_header* header;
+
+    CHECK(records_init(false) == 0);
+    info = *records_info;
+    header = reader_header(&info);
+
+    records_write(1);
+
+    records_info->n_cpus = 1;
+    records_info->buffer_size = 0;
+    records_info->records_offset = 0;
+    records_info->n_records = 1;
+    header->head = 1000;
+
+    records_write(2);
+    CHECK(header->head == 2);
+    CHECK(reader_record(&info, 0)->object == 1);
+    CHECK(reader_record(&info, 1)->object == 2);
+
+    kedr_coi_call_records_destroy();
+}
+
+/* Records may be disabled, number of pages is checked */
+static void test_records_params(void)
+{
+    call_records_pages = 0;
+    CHECK(kedr_coi_call_records_init() == 0);
+    CHECK(records_area == NULL);
+    // Nothing is written.
+    records_write(1);
+    kedr_coi_call_records_destroy();
+
+    call_records_pages = 3;
+    CHECK(kedr_coi_call_records_init() == -EINVAL);
+    CHECK(records_area == NULL);
+}
+
+static const struct test_case tests[] =
+{
+    {"records_drop", test_records_drop},
+    {"records_overwrite", test_records_overwrite},
+    {"records_layout", test_records_layout},
+    {"records_params", test_records_params},
+};
+
+static bool test_is_selected(const char* name, int argc, char** argv)
+{
+    int i;
+
+    if(argc < 2) return true;
+
+    for(i = 1; i < argc; i++)
+        if(!strcmp(argv[i], name)) return true;
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    long n_allocated;
+    int n_failed = 0;
+    int n_run = 0;
+    size_t i;
+
+    n_allocated = kedr_coi_shim_get_n_allocated();
+
+    // Errors are expected in some tests.
+    kedr_coi_shim_set_quiet(1);
+
+    for(i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        if(!test_is_selected(tests[i].name, argc, argv)) continue;
+
+        test_failed = false;
+        tests[i].func();
+        n_run++;
+
+        if(test_failed) n_failed++;
+        printf("%s: %s\n", tests[i].name, test_failed ? "FAILED" : "OK");
+    }
+
+    if(kedr_coi_shim_get_n_allocated() != n_allocated)
+    {
+        printf("Memory leak: %ld blocks are not freed.\n",
+            kedr_coi_shim_get_n_allocated() - n_allocated);
+        n_failed++;
+    }
+
+    printf("%d of %d tests failed.\n", n_failed, n_run);
+
+    return n_failed ? 1 : 0;
+}
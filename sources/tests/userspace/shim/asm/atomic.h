@@ -0,0 +1,97 @@
+/*
+ * Userspace replacement of <asm/atomic.h>, based on GCC atomic builtins.
+ */
+
+#ifndef KEDR_COI_SHIM_ASM_ATOMIC_H
+#define KEDR_COI_SHIM_ASM_ATOMIC_H
+
+#include <linux/types.h>
+
+typedef struct { int counter; } atomic_t;
+typedef struct { long long counter; } atomic64_t;
+
+#define ATOMIC_INIT(i) { (i) }
+#define ATOMIC64_INIT(i) { (i) }
+
+#define cmpxchg(ptr, old, new_val) \
+    ({ typeof(*(ptr)) __old = (old); \
+       __atomic_compare_exchange_n((ptr), &__old, (new_val), 0, \
+           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+       __old; })
+
+#define xchg(ptr, val) __atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+
+static inline int atomic_read(const atomic_t* v)
+{
+    return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_set(atomic_t* v, int i)
+{
+    __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_add(int i, atomic_t* v)
+{
+    __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_sub(int i, atomic_t* v)
+{
+    __atomic_sub_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_inc(atomic_t* v)
+{
+    atomic_add(1, v);
+}
+
+static inline void atomic_dec(atomic_t* v)
+{
+    atomic_sub(1, v);
+}
+
+static inline int atomic_add_return(int i, atomic_t* v)
+{
+    return __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline int atomic_sub_return(int i, atomic_t* v)
+{
+    return __atomic_sub_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+#define atomic_inc_return(v) atomic_add_return(1, (v))
+#define atomic_dec_return(v) atomic_sub_return(1, (v))
+#define atomic_dec_and_test(v) (atomic_sub_return(1, (v)) == 0)
+#define atomic_inc_and_test(v) (atomic_add_return(1, (v)) == 0)
+
+static inline int atomic_cmpxchg(atomic_t* v, int old, int new_val)
+{
+    return cmpxchg(&v->counter, old, new_val);
+}
+
+static inline long long atomic64_read(const atomic64_t* v)
+{
+    return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);
+}
+
+static inline void atomic64_set(atomic64_t* v, long long i)
+{
+    __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED);
+}
+
+static inline void atomic64_add(long long i, atomic64_t* v)
+{
+    __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline long long atomic64_add_return(long long i, atomic64_t* v)
+{
+    return __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+#define atomic64_inc(v) atomic64_add(1, (v))
+#define atomic64_inc_return(v) atomic64_add_return(1, (v))
+
+#endif /* KEDR_COI_SHIM_ASM_ATOMIC_H */
@@ -0,0 +1,388 @@
+/*
+ * Userspace implementation of the kernel functions used by the core.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/smp.h>
+#include <linux/sched.h>
+#include <linux/pid_namespace.h>
+#include <linux/jiffies.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+#include <linux/rcupdate.h>
+
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+
+/* Messages */
+static int quiet;
+static unsigned long n_warnings;
+
+void kedr_coi_shim_set_quiet(int q)
+{
+    quiet = q;
+}
+
+unsigned long kedr_coi_shim_get_n_warnings(void)
+{
+    return __atomic_load_n(&n_warnings, __ATOMIC_RELAXED);
+}
+
+int printk(const char* fmt, ...)
+{
+    char buf[512];
+    const char* src;
+    char* dest = buf;
+    int level = 6;
+    va_list args;
+    int result;
+
+    if((fmt[0] == '<') && (fmt[1] >= '0') && (fmt[1] <= '7')
+        && (fmt[2] == '>'))
+    {
+        level = fmt[1] - '0';
+        fmt += 3;
+    }
+
+    if(level <= 4) __atomic_add_fetch(&n_warnings, 1, __ATOMIC_RELAXED);
+    if(quiet) return 0;
+
+    // Drop kernel-specific modifiers of "%p", like in "%pF".
+    for(src = fmt; *src && (dest < buf + sizeof(buf) - 1); src++)
+    {
+        *dest++ = *src;
+        if((src[0] == '%') && (src[1] == 'p'))
+        {
+            *dest++ = *++src;
+            while((src[1] >= 'A') && (src[1] <= 'Z')) src++;
+        }
+    }
+    *dest = '\0';
+
+    va_start(args, fmt);
+    result = vfprintf(stderr, buf, args);
+    va_end(args);
+    fputc('\n', stderr);
+
+    return result;
+}
+
+void kedr_coi_shim_bug(const char* file, int line, const char* cond)
+{
+    fprintf(stderr, "BUG at %s:%d: %s\n", file, line, cond);
+    abort();
+}
+
+/* Memory allocations */
+static long alloc_fail_after = -1;
+static long n_allocated;
+
+void kedr_coi_shim_fail_alloc(long n)
+{
+    __atomic_store_n(&alloc_fail_after, n, __ATOMIC_SEQ_CST);
+}
+
+long kedr_coi_shim_get_n_allocated(void)
+{
+    return __atomic_load_n(&n_allocated, __ATOMIC_SEQ_CST);
+}
+
+/* Return non-zero if current allocation should fail. */
+static int alloc_should_fail(void)
+{
+    long n = __atomic_load_n(&alloc_fail_after, __ATOMIC_SEQ_CST);
+
+    while(n > 0)
+    {
+        if(__atomic_compare_exchange_n(&alloc_fail_after, &n, n - 1, 0,
+            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            return 0;
+    }
+
+    return n == 0;
+}
+
+void* kmalloc(size_t size, gfp_t flags)
+{
+    void* p;
+
+    if(alloc_should_fail()) return NULL;
+
+    p = (flags & __GFP_ZERO) ? calloc(1, size ? size : 1)
+        : malloc(size ? size : 1);
+    if(p) __atomic_add_fetch(&n_allocated, 1, __ATOMIC_SEQ_CST);
+
+    return p;
+}
+
+void* krealloc(const void* p, size_t new_size, gfp_t flags)
+{
+    void* p_new;
+
+    if(p == NULL) return kmalloc(new_size, flags);
+    if(alloc_should_fail()) return NULL;
+
+    p_new = realloc((void*)p, new_size ? new_size : 1);
+
+    return p_new;
+}
+
+void kfree(const void* p)
+{
+    if(p == NULL) return;
+
+    __atomic_sub_fetch(&n_allocated, 1, __ATOMIC_SEQ_CST);
+    free((void*)p);
+}
+
+/* Processors */
+static int n_processors;
+static __thread int processor_id = -1;
+
+int kedr_coi_shim_processor_id(void)
+{
+    if(unlikely(processor_id == -1))
+        processor_id = __atomic_fetch_add(&n_processors, 1, __ATOMIC_RELAXED)
+            % NR_CPUS;
+
+    return processor_id;
+}
+
+/* Tasks */
+static int n_tasks;
+static __thread struct task_struct current_task;
+
+struct pid_namespace init_pid_ns;
+
+struct task_struct* kedr_coi_shim_current(void)
+{
+    if(unlikely(current_task.thread_pid.nr == 0))
+    {
+        current_task.thread_pid.nr = __atomic_add_fetch(&n_tasks, 1,
+            __ATOMIC_RELAXED);
+        current_task.pid = current_task.thread_pid.nr;
+        snprintf(current_task.comm, sizeof(current_task.comm), "task-%d",
+            current_task.thread_pid.nr);
+    }
+
+    return &current_task;
+}
+
+struct pid* find_pid_ns(int nr, struct pid_namespace* ns)
+{
+    struct task_struct* task = kedr_coi_shim_current();
+
+    return task_pid_nr(task) == nr ? &task->thread_pid : NULL;
+}
+
+struct task_struct* pid_task(struct pid* pid, enum pid_type type)
+{
+    return pid ? container_of(pid, struct task_struct, thread_pid) : NULL;
+}
+
+/* Time */
+u64 local_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+unsigned long kedr_coi_shim_jiffies(void)
+{
+    return local_clock() / (NSEC_PER_SEC / HZ);
+}
+
+/* Seq files */
+void kedr_coi_shim_seq_init(struct seq_file* m)
+{
+    memset(m, 0, sizeof(*m));
+}
+
+void kedr_coi_shim_seq_destroy(struct seq_file* m)
+{
+    free(m->buf);
+    memset(m, 0, sizeof(*m));
+}
+
+static void seq_reserve(struct seq_file* m, size_t len)
+{
+    size_t size = m->size ? m->size : 256;
+
+    if(m->count + len + 1 <= m->size) return;
+
+    while(m->count + len + 1 > size) size *= 2;
+
+    m->buf = realloc(m->buf, size);
+    BUG_ON(m->buf == NULL);
+    m->size = size;
+}
+
+void seq_printf(struct seq_file* m, const char* fmt, ...)
+{
+    char tmp[1];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+
+    seq_reserve(m, len);
+
+    va_start(args, fmt);
+    vsnprintf(m->buf + m->count, len + 1, fmt, args);
+    va_end(args);
+
+    m->count += len;
+}
+
+void seq_puts(struct seq_file* m, const char* s)
+{
+    size_t len = strlen(s);
+
+    seq_reserve(m, len);
+    memcpy(m->buf + m->count, s, len + 1);
+    m->count += len;
+}
+
+void seq_putc(struct seq_file* m, char c)
+{
+    seq_reserve(m, 1);
+    m->buf[m->count++] = c;
+    m->buf[m->count] = '\0';
+}
+
+/* Works */
+static pthread_mutex_t works_lock = PTHREAD_MUTEX_INITIALIZER;
+// Signaled when work is queued.
+static pthread_cond_t works_queued = PTHREAD_COND_INITIALIZER;
+// Signaled when work is executed.
+static pthread_cond_t works_done = PTHREAD_COND_INITIALIZER;
+static LIST_HEAD(works);
+static int worker_created;
+// Increased every time a work is taken from the queue or finished.
+static unsigned long works_seq;
+
+static void* worker_func(void* data)
+{
+    struct work_struct* work;
+
+    pthread_mutex_lock(&works_lock);
+    while(1)
+    {
+        while(list_empty(&works))
+            pthread_cond_wait(&works_queued, &works_lock);
+
+        work = list_first_entry(&works, struct work_struct, entry);
+        list_del_init(&work->entry);
+        work->running = 1;
+        works_seq++;
+        pthread_mutex_unlock(&works_lock);
+
+        work->func(work);
+
+        pthread_mutex_lock(&works_lock);
+        work->running = 0;
+        works_seq++;
+        pthread_cond_broadcast(&works_done);
+    }
+
+    return NULL;
+}
+
+bool schedule_work(struct work_struct* work)
+{
+    pthread_t worker;
+    bool result = false;
+
+    pthread_mutex_lock(&works_lock);
+    if(!worker_created)
+    {
+        BUG_ON(pthread_create(&worker, NULL, worker_func, NULL));
+        pthread_detach(worker);
+        worker_created = 1;
+    }
+
+    if(list_empty(&work->entry))
+    {
+        list_add_tail(&work->entry, &works);
+        pthread_cond_signal(&works_queued);
+        result = true;
+    }
+    pthread_mutex_unlock(&works_lock);
+
+    return result;
+}
+
+bool cancel_work_sync(struct work_struct* work)
+{
+    bool result = false;
+
+    pthread_mutex_lock(&works_lock);
+    if(!list_empty(&work->entry))
+    {
+        list_del_init(&work->entry);
+        result = true;
+    }
+    while(work->running)
+        pthread_cond_wait(&works_done, &works_lock);
+    pthread_mutex_unlock(&works_lock);
+
+    return result;
+}
+
+void flush_scheduled_work(void)
+{
+    pthread_mutex_lock(&works_lock);
+    while(!list_empty(&works) || works_seq % 2)
+        pthread_cond_wait(&works_done, &works_lock);
+    pthread_mutex_unlock(&works_lock);
+}
+
+/* RCU */
+static pthread_rwlock_t rcu_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+void rcu_read_lock(void)
+{
+    pthread_rwlock_rdlock(&rcu_lock);
+}
+
+void rcu_read_unlock(void)
+{
+    pthread_rwlock_unlock(&rcu_lock);
+}
+
+void synchronize_rcu(void)
+{
+    pthread_rwlock_wrlock(&rcu_lock);
+    pthread_rwlock_unlock(&rcu_lock);
+}
+
+void call_rcu(struct rcu_head* head, void (*func)(struct rcu_head* head))
+{
+    synchronize_rcu();
+    func(head);
+}
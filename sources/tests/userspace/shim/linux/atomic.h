@@ -0,0 +1,10 @@
+/*
+ * Userspace replacement of <linux/atomic.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_ATOMIC_H
+#define KEDR_COI_SHIM_LINUX_ATOMIC_H
+
+#include <asm/atomic.h>
+
+#endif /* KEDR_COI_SHIM_LINUX_ATOMIC_H */
@@ -0,0 +1,11 @@
+/*
+ * Userspace replacement of <linux/cache.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_CACHE_H
+#define KEDR_COI_SHIM_LINUX_CACHE_H
+
+#define L1_CACHE_BYTES 64
+#define SMP_CACHE_BYTES L1_CACHE_BYTES
+
+#endif /* KEDR_COI_SHIM_LINUX_CACHE_H */
@@ -0,0 +1,12 @@
+/*
+ * Userspace replacement of <linux/cgroup.h>.
+ *
+ * CONFIG_CGROUPS is not defined, so all tasks are in the same cgroup.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_CGROUP_H
+#define KEDR_COI_SHIM_LINUX_CGROUP_H
+
+#include <linux/sched.h>
+
+#endif /* KEDR_COI_SHIM_LINUX_CGROUP_H */
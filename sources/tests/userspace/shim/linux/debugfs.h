@@ -0,0 +1,26 @@
+/*
+ * Userspace replacement of <linux/debugfs.h>.
+ *
+ * Files are not created: debugfs is reported as not available.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_DEBUGFS_H
+#define KEDR_COI_SHIM_LINUX_DEBUGFS_H
+
+#include <linux/types.h>
+#include <linux/fs.h>
+
+struct dentry;
+
+static inline struct dentry* debugfs_create_file(const char* name,
+    umode_t mode, struct dentry* parent, void* data,
+    const struct file_operations* fops)
+{
+    return NULL;
+}
+
+static inline void debugfs_remove(struct dentry* dentry)
+{
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_DEBUGFS_H */
@@ -0,0 +1,35 @@
+/*
+ * Userspace replacement of <linux/err.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_ERR_H
+#define KEDR_COI_SHIM_LINUX_ERR_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+
+#define MAX_ERRNO 4095
+
+#define IS_ERR_VALUE(x) unlikely((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
+
+static inline void* ERR_PTR(long error)
+{
+    return (void*)error;
+}
+
+static inline long PTR_ERR(const void* ptr)
+{
+    return (long)ptr;
+}
+
+static inline bool IS_ERR_OR_NULL(const void* ptr)
+{
+    return !ptr || IS_ERR_VALUE((unsigned long)ptr);
+}
+
+static inline bool IS_ERR(const void* ptr)
+{
+    return IS_ERR_VALUE((unsigned long)ptr);
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_ERR_H */
@@ -0,0 +1,34 @@
+/*
+ * Userspace replacement of <linux/fs.h>.
+ *
+ * Only declarations needed for define file operations: files are not
+ * emulated.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_FS_H
+#define KEDR_COI_SHIM_LINUX_FS_H
+
+#include <linux/types.h>
+
+struct module;
+struct inode;
+struct file;
+struct vm_area_struct;
+
+struct file_operations
+{
+    struct module* owner;
+    loff_t (*llseek)(struct file* filp, loff_t offset, int whence);
+    ssize_t (*read)(struct file* filp, char __user* buf, size_t count,
+        loff_t* pos);
+    int (*mmap)(struct file* filp, struct vm_area_struct* vma);
+    int (*open)(struct inode* inode, struct file* filp);
+    int (*release)(struct inode* inode, struct file* filp);
+};
+
+static inline int nonseekable_open(struct inode* inode, struct file* filp)
+{
+    return 0;
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_FS_H */
@@ -0,0 +1,39 @@
+/*
+ * Userspace replacement of <linux/hash.h>.
+ *
+ * Multiplicative hashing as in the kernel, so distribution of the
+ * pointers among buckets is the same as in the kernel module.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_HASH_H
+#define KEDR_COI_SHIM_LINUX_HASH_H
+
+#include <linux/types.h>
+
+#define GOLDEN_RATIO_32 0x61C88647
+#define GOLDEN_RATIO_64 0x61C8864680B583EBull
+
+static inline u32 hash_32(u32 val, unsigned int bits)
+{
+    return (val * GOLDEN_RATIO_32) >> (32 - bits);
+}
+
+static inline u32 hash_64(u64 val, unsigned int bits)
+{
+    return (u32)((val * GOLDEN_RATIO_64) >> (64 - bits));
+}
+
+static inline u32 hash_long(unsigned long val, unsigned int bits)
+{
+    if(sizeof(val) == 8)
+        return hash_64(val, bits);
+    else
+        return hash_32(val, bits);
+}
+
+static inline u32 hash_ptr(const void* ptr, unsigned int bits)
+{
+    return hash_long((unsigned long)ptr, bits);
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_HASH_H */
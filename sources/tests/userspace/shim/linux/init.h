@@ -0,0 +1,13 @@
+/*
+ * Userspace replacement of <linux/init.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_INIT_H
+#define KEDR_COI_SHIM_LINUX_INIT_H
+
+#include <linux/types.h>
+
+#define __init
+#define __exit
+
+#endif /* KEDR_COI_SHIM_LINUX_INIT_H */
@@ -0,0 +1,11 @@
+/*
+ * Userspace replacement of <linux/irqflags.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_IRQFLAGS_H
+#define KEDR_COI_SHIM_LINUX_IRQFLAGS_H
+
+/* Interrupts are emulated in <linux/spinlock.h>. */
+#include <linux/spinlock.h>
+
+#endif /* KEDR_COI_SHIM_LINUX_IRQFLAGS_H */
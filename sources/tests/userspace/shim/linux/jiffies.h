@@ -0,0 +1,38 @@
+/*
+ * Userspace replacement of <linux/jiffies.h>.
+ *
+ * Jiffies are calculated from the monotonic clock.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_JIFFIES_H
+#define KEDR_COI_SHIM_LINUX_JIFFIES_H
+
+#include <linux/types.h>
+
+#define HZ 1000
+
+#define NSEC_PER_USEC 1000L
+#define NSEC_PER_MSEC 1000000L
+#define NSEC_PER_SEC 1000000000L
+#define MSEC_PER_SEC 1000L
+
+unsigned long kedr_coi_shim_jiffies(void);
+
+#define jiffies kedr_coi_shim_jiffies()
+
+#define time_after(a, b) ((long)((b) - (a)) < 0)
+#define time_before(a, b) time_after(b, a)
+#define time_after_eq(a, b) ((long)((a) - (b)) >= 0)
+#define time_before_eq(a, b) time_after_eq(b, a)
+
+static inline unsigned long msecs_to_jiffies(unsigned int m)
+{
+    return m * HZ / MSEC_PER_SEC;
+}
+
+static inline unsigned int jiffies_to_msecs(unsigned long j)
+{
+    return j * MSEC_PER_SEC / HZ;
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_JIFFIES_H */
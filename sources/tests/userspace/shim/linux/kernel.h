@@ -0,0 +1,64 @@
+/*
+ * Userspace replacement of <linux/kernel.h>: common macros, messages
+ * and assertions.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_KERNEL_H
+#define KEDR_COI_SHIM_LINUX_KERNEL_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#define container_of(ptr, type, member) \
+    ((type*)((char*)(ptr) - offsetof(type, member)))
+
+#define BUILD_BUG_ON(cond) _Static_assert(!(cond), #cond)
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((typeof(x))(a) - 1))
+
+#define min_t(type, x, y) ((type)(x) < (type)(y) ? (type)(x) : (type)(y))
+#define max_t(type, x, y) ((type)(x) > (type)(y) ? (type)(x) : (type)(y))
+
+#define KERN_ERR "<3>"
+#define KERN_WARNING "<4>"
+#define KERN_INFO "<6>"
+#define KERN_DEBUG "<7>"
+
+/*
+ * Messages are printed to stderr, unless they are suppressed with
+ * kedr_coi_shim_set_quiet(). Kernel-specific formats like "%pF" are
+ * printed as plain pointers.
+ */
+int printk(const char* fmt, ...);
+
+#define pr_err(fmt, ...) printk(KERN_ERR fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...) printk(KERN_WARNING fmt, ##__VA_ARGS__)
+#define pr_warning pr_warn
+#define pr_info(fmt, ...) printk(KERN_INFO fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...) do {} while(0)
+
+/* Number of messages printed with KERN_ERR or KERN_WARNING level. */
+unsigned long kedr_coi_shim_get_n_warnings(void);
+void kedr_coi_shim_set_quiet(int quiet);
+
+void kedr_coi_shim_bug(const char* file, int line, const char* cond);
+
+#define BUG() kedr_coi_shim_bug(__FILE__, __LINE__, "BUG()")
+#define BUG_ON(cond) \
+    do { if(unlikely(cond)) kedr_coi_shim_bug(__FILE__, __LINE__, #cond); } while(0)
+#define WARN_ON(cond) \
+    ({ int __ret = !!(cond); \
+       if(unlikely(__ret)) printk(KERN_WARNING "WARN_ON(%s) at %s:%d", \
+           #cond, __FILE__, __LINE__); \
+       unlikely(__ret); })
+
+static inline void cond_resched(void) {}
+static inline void might_sleep(void) {}
+
+#endif /* KEDR_COI_SHIM_LINUX_KERNEL_H */
@@ -0,0 +1,195 @@
+/*
+ * Userspace replacement of <linux/list.h>.
+ *
+ * Only the part of the kernel API used by KEDR COI is provided. Cursors
+ * of hlist_for_each_entry*() are 'type *pos', as in kernels since 3.9.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_LIST_H
+#define KEDR_COI_SHIM_LINUX_LIST_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+
+#define LIST_POISON1 ((void*)0x100)
+#define LIST_POISON2 ((void*)0x200)
+
+/* Doubly linked list with head. */
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+
+#define LIST_HEAD(name) struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head* list)
+{
+    list->next = list;
+    list->prev = list;
+}
+
+static inline void __list_add(struct list_head* new_elem,
+    struct list_head* prev, struct list_head* next)
+{
+    next->prev = new_elem;
+    new_elem->next = next;
+    new_elem->prev = prev;
+    prev->next = new_elem;
+}
+
+static inline void list_add(struct list_head* new_elem, struct list_head* head)
+{
+    __list_add(new_elem, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head* new_elem,
+    struct list_head* head)
+{
+    __list_add(new_elem, head->prev, head);
+}
+
+static inline void __list_del(struct list_head* prev, struct list_head* next)
+{
+    next->prev = prev;
+    prev->next = next;
+}
+
+static inline void list_del(struct list_head* entry)
+{
+    __list_del(entry->prev, entry->next);
+    entry->next = (struct list_head*)LIST_POISON1;
+    entry->prev = (struct list_head*)LIST_POISON2;
+}
+
+static inline void list_del_init(struct list_head* entry)
+{
+    __list_del(entry->prev, entry->next);
+    INIT_LIST_HEAD(entry);
+}
+
+static inline void list_move_tail(struct list_head* list,
+    struct list_head* head)
+{
+    __list_del(list->prev, list->next);
+    list_add_tail(list, head);
+}
+
+static inline int list_empty(const struct list_head* head)
+{
+    return head->next == head;
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define list_first_entry(ptr, type, member) \
+    list_entry((ptr)->next, type, member)
+
+#define list_for_each(pos, head) \
+    for(pos = (head)->next; pos != (head); pos = pos->next)
+
+#define list_for_each_entry(pos, head, member) \
+    for(pos = list_entry((head)->next, typeof(*pos), member); \
+        &pos->member != (head); \
+        pos = list_entry(pos->member.next, typeof(*pos), member))
+
+#define list_for_each_entry_reverse(pos, head, member) \
+    for(pos = list_entry((head)->prev, typeof(*pos), member); \
+        &pos->member != (head); \
+        pos = list_entry(pos->member.prev, typeof(*pos), member))
+
+#define list_for_each_entry_continue_reverse(pos, head, member) \
+    for(pos = list_entry(pos->member.prev, typeof(*pos), member); \
+        &pos->member != (head); \
+        pos = list_entry(pos->member.prev, typeof(*pos), member))
+
+#define list_for_each_entry_safe(pos, n, head, member) \
+    for(pos = list_entry((head)->next, typeof(*pos), member), \
+        n = list_entry(pos->member.next, typeof(*pos), member); \
+        &pos->member != (head); \
+        pos = n, n = list_entry(n->member.next, typeof(*n), member))
+
+/* Singly linked list with head, used for hash tables. */
+#define INIT_HLIST_HEAD(ptr) ((ptr)->first = NULL)
+
+static inline void INIT_HLIST_NODE(struct hlist_node* h)
+{
+    h->next = NULL;
+    h->pprev = NULL;
+}
+
+static inline int hlist_unhashed(const struct hlist_node* h)
+{
+    return !h->pprev;
+}
+
+static inline int hlist_empty(const struct hlist_head* h)
+{
+    return !h->first;
+}
+
+static inline void __hlist_del(struct hlist_node* n)
+{
+    struct hlist_node* next = n->next;
+    struct hlist_node** pprev = n->pprev;
+
+    *pprev = next;
+    if(next) next->pprev = pprev;
+}
+
+static inline void hlist_del(struct hlist_node* n)
+{
+    __hlist_del(n);
+    n->next = (struct hlist_node*)LIST_POISON1;
+    n->pprev = (struct hlist_node**)LIST_POISON2;
+}
+
+static inline void hlist_del_init(struct hlist_node* n)
+{
+    if(!hlist_unhashed(n))
+    {
+        __hlist_del(n);
+        INIT_HLIST_NODE(n);
+    }
+}
+
+static inline void hlist_add_head(struct hlist_node* n, struct hlist_head* h)
+{
+    struct hlist_node* first = h->first;
+
+    n->next = first;
+    if(first) first->pprev = &n->next;
+    h->first = n;
+    n->pprev = &h->first;
+}
+
+/* Add 'n' before 'next', which is in the list. */
+static inline void hlist_add_before(struct hlist_node* n,
+    struct hlist_node* next)
+{
+    n->pprev = next->pprev;
+    n->next = next;
+    next->pprev = &n->next;
+    *(n->pprev) = n;
+}
+
+#define hlist_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define hlist_for_each(pos, head) \
+    for(pos = (head)->first; pos; pos = pos->next)
+
+#define hlist_for_each_safe(pos, n, head) \
+    for(pos = (head)->first; pos && ({ n = pos->next; 1; }); pos = n)
+
+#define hlist_entry_safe(ptr, type, member) \
+    ({ typeof(ptr) ____ptr = (ptr); \
+       ____ptr ? hlist_entry(____ptr, type, member) : NULL; \
+    })
+
+#define hlist_for_each_entry(pos, head, member) \
+    for(pos = hlist_entry_safe((head)->first, typeof(*(pos)), member); \
+        pos; \
+        pos = hlist_entry_safe((pos)->member.next, typeof(*(pos)), member))
+
+#define hlist_for_each_entry_safe(pos, n, head, member) \
+    for(pos = hlist_entry_safe((head)->first, typeof(*pos), member); \
+        pos && ({ n = pos->member.next; 1; }); \
+        pos = hlist_entry_safe(n, typeof(*pos), member))
+
+#endif /* KEDR_COI_SHIM_LINUX_LIST_H */
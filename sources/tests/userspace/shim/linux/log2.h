@@ -0,0 +1,15 @@
+/*
+ * Userspace replacement of <linux/log2.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_LOG2_H
+#define KEDR_COI_SHIM_LINUX_LOG2_H
+
+#include <linux/types.h>
+
+static inline bool is_power_of_2(unsigned long n)
+{
+    return (n != 0) && ((n & (n - 1)) == 0);
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_LOG2_H */
@@ -0,0 +1,29 @@
+/*
+ * Userspace replacement of <linux/math64.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_MATH64_H
+#define KEDR_COI_SHIM_LINUX_MATH64_H
+
+#include <linux/types.h>
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+    return dividend / divisor;
+}
+
+static inline s64 div64_s64(s64 dividend, s64 divisor)
+{
+    return dividend / divisor;
+}
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+    return dividend / divisor;
+}
+
+#define do_div(n, base) \
+    ({ u32 __base = (base); u32 __rem = (n) % __base; \
+       (n) = (n) / __base; __rem; })
+
+#endif /* KEDR_COI_SHIM_LINUX_MATH64_H */
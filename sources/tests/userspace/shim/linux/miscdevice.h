@@ -0,0 +1,30 @@
+/*
+ * Userspace replacement of <linux/miscdevice.h>.
+ *
+ * Registration of the device always succeeds and does nothing.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_MISCDEVICE_H
+#define KEDR_COI_SHIM_LINUX_MISCDEVICE_H
+
+#include <linux/fs.h>
+
+#define MISC_DYNAMIC_MINOR 255
+
+struct miscdevice
+{
+    int minor;
+    const char* name;
+    const struct file_operations* fops;
+};
+
+static inline int misc_register(struct miscdevice* misc)
+{
+    return 0;
+}
+
+static inline void misc_deregister(struct miscdevice* misc)
+{
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_MISCDEVICE_H */
@@ -0,0 +1,29 @@
+/*
+ * Userspace replacement of <linux/mm.h>.
+ *
+ * Mapping into userspace is not emulated: tests access the memory
+ * directly.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_MM_H
+#define KEDR_COI_SHIM_LINUX_MM_H
+
+#include <linux/types.h>
+
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1UL << PAGE_SHIFT)
+
+struct vm_area_struct
+{
+    unsigned long vm_start;
+    unsigned long vm_end;
+    unsigned long vm_pgoff;
+};
+
+static inline int remap_vmalloc_range(struct vm_area_struct* vma,
+    void* addr, unsigned long pgoff)
+{
+    return 0;
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_MM_H */
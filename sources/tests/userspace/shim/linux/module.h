@@ -0,0 +1,64 @@
+/*
+ * Userspace replacement of <linux/module.h>.
+ *
+ * Tests may define their own 'modules' for payloads and check their
+ * reference counters.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_MODULE_H
+#define KEDR_COI_SHIM_LINUX_MODULE_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/err.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/cache.h>
+#include <linux/irqflags.h>
+#include <asm/atomic.h>
+
+#define MODULE_NAME_LEN 56
+
+struct module
+{
+    char name[MODULE_NAME_LEN];
+    atomic_t refcnt;
+    // If non-zero, try_module_get() fails as for unloading module.
+    int is_going;
+};
+
+#define THIS_MODULE ((struct module*)NULL)
+
+#define MODULE_LICENSE(license)
+#define MODULE_AUTHOR(author)
+#define MODULE_DESCRIPTION(description)
+#define EXPORT_SYMBOL(sym)
+#define EXPORT_SYMBOL_GPL(sym)
+#define module_init(fn)
+#define module_exit(fn)
+
+static inline const char* module_name(const struct module* mod)
+{
+    return mod ? mod->name : "kernel";
+}
+
+static inline int try_module_get(struct module* mod)
+{
+    if(mod == NULL) return 1;
+    if(mod->is_going) return 0;
+    atomic_inc(&mod->refcnt);
+    return 1;
+}
+
+static inline void __module_get(struct module* mod)
+{
+    if(mod) atomic_inc(&mod->refcnt);
+}
+
+static inline void module_put(struct module* mod)
+{
+    if(mod) atomic_dec(&mod->refcnt);
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_MODULE_H */
@@ -0,0 +1,33 @@
+/*
+ * Userspace replacement of <linux/moduleparam.h>.
+ *
+ * Parameters keep their default values.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_MODULEPARAM_H
+#define KEDR_COI_SHIM_LINUX_MODULEPARAM_H
+
+/*
+ * <sys/stat.h> is not included: in C++ it includes the system
+ * <linux/types.h>, which is shadowed by the shim one.
+ */
+#ifndef S_IRUSR
+#define S_IRUSR 00400
+#define S_IWUSR 00200
+#endif
+
+#define S_IRUGO 00444
+#define S_IWUGO 00222
+
+#define module_param(name, type, perm) \
+    static const void* const __kedr_coi_param_##name \
+    __attribute__((unused)) = &(name)
+
+#define module_param_named(name, value, type, perm) \
+    module_param(value, type, perm)
+
+#define MODULE_PARM_DESC(name, desc) \
+    static const char __kedr_coi_param_desc_##name[] \
+    __attribute__((unused)) = desc
+
+#endif /* KEDR_COI_SHIM_LINUX_MODULEPARAM_H */
@@ -0,0 +1,55 @@
+/*
+ * Userspace replacement of <linux/mutex.h>, based on pthread mutex.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_MUTEX_H
+#define KEDR_COI_SHIM_LINUX_MUTEX_H
+
+#include <pthread.h>
+
+struct mutex
+{
+    pthread_mutex_t m;
+};
+
+#define DEFINE_MUTEX(name) struct mutex name = { PTHREAD_MUTEX_INITIALIZER }
+
+static inline void mutex_init(struct mutex* lock)
+{
+    pthread_mutex_init(&lock->m, NULL);
+}
+
+static inline void mutex_destroy(struct mutex* lock)
+{
+    pthread_mutex_destroy(&lock->m);
+}
+
+static inline void mutex_lock(struct mutex* lock)
+{
+    pthread_mutex_lock(&lock->m);
+}
+
+/* Thread cannot be killed while waiting, so lock always succeeds. */
+static inline int mutex_lock_killable(struct mutex* lock)
+{
+    mutex_lock(lock);
+    return 0;
+}
+
+static inline int mutex_lock_interruptible(struct mutex* lock)
+{
+    mutex_lock(lock);
+    return 0;
+}
+
+static inline int mutex_trylock(struct mutex* lock)
+{
+    return pthread_mutex_trylock(&lock->m) == 0;
+}
+
+static inline void mutex_unlock(struct mutex* lock)
+{
+    pthread_mutex_unlock(&lock->m);
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_MUTEX_H */
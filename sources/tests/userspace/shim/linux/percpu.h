@@ -0,0 +1,41 @@
+/*
+ * Userspace replacement of <linux/percpu.h>.
+ *
+ * Statically defined per-cpu variables are thread-local ones.
+ * Dynamically allocated per-cpu data are arrays with NR_CPUS elements.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_PERCPU_H
+#define KEDR_COI_SHIM_LINUX_PERCPU_H
+
+#include <linux/types.h>
+#include <linux/smp.h>
+#include <linux/slab.h>
+
+#define DEFINE_PER_CPU(type, name) __thread type name
+#define DECLARE_PER_CPU(type, name) extern __thread type name
+
+#define this_cpu_read(var) (var)
+#define this_cpu_write(var, val) ((var) = (val))
+#define this_cpu_inc(var) ((var)++)
+#define this_cpu_dec(var) ((var)--)
+#define this_cpu_add(var, val) ((var) += (val))
+#define this_cpu_inc_return(var) (++(var))
+#define __this_cpu_inc(var) this_cpu_inc(var)
+#define __this_cpu_read(var) this_cpu_read(var)
+
+#define alloc_percpu(type) \
+    ((type*)kcalloc(NR_CPUS, sizeof(type), GFP_KERNEL))
+#define free_percpu(ptr) kfree(ptr)
+
+/*
+ * Variables of other threads are not accessible, so only variable of
+ * the current 'processor' may be referred.
+ */
+#define per_cpu(var, cpu) \
+    (*({ BUG_ON((cpu) != smp_processor_id()); &(var); }))
+
+#define per_cpu_ptr(ptr, cpu) (&(ptr)[(cpu)])
+#define this_cpu_ptr(ptr) per_cpu_ptr(ptr, smp_processor_id())
+
+#endif /* KEDR_COI_SHIM_LINUX_PERCPU_H */
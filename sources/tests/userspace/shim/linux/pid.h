@@ -0,0 +1,28 @@
+/*
+ * Userspace replacement of <linux/pid.h>.
+ *
+ * Only task of the current thread may be found by pid.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_PID_H
+#define KEDR_COI_SHIM_LINUX_PID_H
+
+#include <linux/types.h>
+
+struct task_struct;
+struct pid_namespace;
+
+struct pid
+{
+    int nr;
+};
+
+enum pid_type
+{
+    PIDTYPE_PID,
+};
+
+struct pid* find_pid_ns(int nr, struct pid_namespace* ns);
+struct task_struct* pid_task(struct pid* pid, enum pid_type type);
+
+#endif /* KEDR_COI_SHIM_LINUX_PID_H */
@@ -0,0 +1,17 @@
+/*
+ * Userspace replacement of <linux/pid_namespace.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_PID_NAMESPACE_H
+#define KEDR_COI_SHIM_LINUX_PID_NAMESPACE_H
+
+#include <linux/pid.h>
+
+struct pid_namespace
+{
+    unsigned int level;
+};
+
+extern struct pid_namespace init_pid_ns;
+
+#endif /* KEDR_COI_SHIM_LINUX_PID_NAMESPACE_H */
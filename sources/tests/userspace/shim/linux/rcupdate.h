@@ -0,0 +1,38 @@
+/*
+ * Userspace replacement of <linux/rcupdate.h>.
+ *
+ * Read-side critical sections hold a global read-write lock for read,
+ * so synchronize_rcu() waits for them by taking that lock for write.
+ * This is much slower than real RCU, but has the same guarantees.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_RCUPDATE_H
+#define KEDR_COI_SHIM_LINUX_RCUPDATE_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+
+struct rcu_head
+{
+    struct rcu_head* next;
+    void (*func)(struct rcu_head* head);
+};
+
+void rcu_read_lock(void);
+void rcu_read_unlock(void);
+void synchronize_rcu(void);
+/*
+ * Callback is called synchronously after grace period, so it may not
+ * be called inside read-side critical section.
+ */
+void call_rcu(struct rcu_head* head, void (*func)(struct rcu_head* head));
+
+#define rcu_barrier() do {} while(0)
+
+#define rcu_dereference(p) __atomic_load_n(&(p), __ATOMIC_CONSUME)
+#define rcu_dereference_protected(p, c) (p)
+#define rcu_access_pointer(p) READ_ONCE(p)
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#define RCU_INIT_POINTER(p, v) ((p) = (v))
+
+#endif /* KEDR_COI_SHIM_LINUX_RCUPDATE_H */
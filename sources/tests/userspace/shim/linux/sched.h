@@ -0,0 +1,47 @@
+/*
+ * Userspace replacement of <linux/sched.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_SCHED_H
+#define KEDR_COI_SHIM_LINUX_SCHED_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+
+#include <linux/string.h>
+#include <linux/pid.h>
+
+#define TASK_COMM_LEN 16
+
+/*
+ * Every thread is a task with its own pid, which is given in order of
+ * the first use, starting with 1.
+ */
+struct task_struct
+{
+    pid_t pid;
+    struct pid thread_pid;
+    char comm[TASK_COMM_LEN];
+};
+
+struct task_struct* kedr_coi_shim_current(void);
+
+#define current kedr_coi_shim_current()
+
+static inline pid_t task_pid_nr(struct task_struct* task)
+{
+    return task->thread_pid.nr;
+}
+
+#define get_task_comm(buf, task) strcpy(buf, (task)->comm)
+
+/* Monotonic time in nanoseconds. */
+u64 local_clock(void);
+
+#define sched_clock() local_clock()
+
+static inline void schedule(void)
+{
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_SCHED_H */
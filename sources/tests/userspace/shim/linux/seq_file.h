@@ -0,0 +1,58 @@
+/*
+ * Userspace replacement of <linux/seq_file.h>.
+ *
+ * Output is collected into the growing buffer, which may be inspected
+ * by the tests.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_SEQ_FILE_H
+#define KEDR_COI_SHIM_LINUX_SEQ_FILE_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+
+struct seq_file
+{
+    char* buf;
+    size_t size;
+    size_t count;
+};
+
+void seq_printf(struct seq_file* m, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+void seq_puts(struct seq_file* m, const char* s);
+void seq_putc(struct seq_file* m, char c);
+
+/* Files are not emulated, these are only for define file operations. */
+struct inode;
+struct file;
+
+static inline ssize_t seq_read(struct file* filp, char __user* buf,
+    size_t count, loff_t* pos)
+{
+    return -ENOSYS;
+}
+
+static inline loff_t seq_lseek(struct file* filp, loff_t offset,
+    int whence)
+{
+    return -ENOSYS;
+}
+
+static inline int single_open(struct file* filp,
+    int (*show)(struct seq_file* m, void* v), void* data)
+{
+    return -ENOSYS;
+}
+
+static inline int single_release(struct inode* inode, struct file* filp)
+{
+    return 0;
+}
+
+/* Initialize empty output. */
+void kedr_coi_shim_seq_init(struct seq_file* m);
+/* Free collected output. */
+void kedr_coi_shim_seq_destroy(struct seq_file* m);
+
+#endif /* KEDR_COI_SHIM_LINUX_SEQ_FILE_H */
@@ -0,0 +1,47 @@
+/*
+ * Userspace replacement of <linux/slab.h>.
+ *
+ * Allocations are performed by malloc(). For test error paths,
+ * allocations may be forced to fail, see kedr_coi_shim_fail_alloc().
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_SLAB_H
+#define KEDR_COI_SHIM_LINUX_SLAB_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/string.h>
+
+#define GFP_KERNEL 0x10u
+#define GFP_ATOMIC 0x20u
+#define GFP_NOWAIT GFP_ATOMIC
+#define __GFP_ZERO 0x100u
+
+#define ZERO_SIZE_PTR ((void*)16)
+
+void* kmalloc(size_t size, gfp_t flags);
+void* krealloc(const void* p, size_t new_size, gfp_t flags);
+void kfree(const void* p);
+
+static inline void* kzalloc(size_t size, gfp_t flags)
+{
+    return kmalloc(size, flags | __GFP_ZERO);
+}
+
+static inline void* kcalloc(size_t n, size_t size, gfp_t flags)
+{
+    if(size != 0 && n > (size_t)-1 / size) return NULL;
+    return kzalloc(n * size, flags);
+}
+
+/*
+ * Make allocation number 'n' (counted from this call, starting with 0)
+ * and all subsequent ones fail. Negative 'n' disables failures.
+ */
+void kedr_coi_shim_fail_alloc(long n);
+
+/* Number of allocated and not freed blocks. */
+long kedr_coi_shim_get_n_allocated(void);
+
+#endif /* KEDR_COI_SHIM_LINUX_SLAB_H */
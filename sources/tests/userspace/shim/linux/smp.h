@@ -0,0 +1,28 @@
+/*
+ * Userspace replacement of <linux/smp.h>.
+ *
+ * Every thread is given its own 'processor', so per-cpu data are
+ * per-thread ones. Threads share a processor only when there are more
+ * than NR_CPUS of them, which is not a case for tests.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_SMP_H
+#define KEDR_COI_SHIM_LINUX_SMP_H
+
+#define NR_CPUS 256
+
+#define nr_cpu_ids NR_CPUS
+
+int kedr_coi_shim_processor_id(void);
+
+#define smp_processor_id() kedr_coi_shim_processor_id()
+#define raw_smp_processor_id() kedr_coi_shim_processor_id()
+#define get_cpu() smp_processor_id()
+#define put_cpu() do {} while(0)
+
+#define num_possible_cpus() NR_CPUS
+
+#define for_each_possible_cpu(cpu) for((cpu) = 0; (cpu) < NR_CPUS; (cpu)++)
+#define for_each_online_cpu(cpu) for_each_possible_cpu(cpu)
+
+#endif /* KEDR_COI_SHIM_LINUX_SMP_H */
@@ -0,0 +1,21 @@
+/*
+ * Userspace replacement of <linux/sort.h>.
+ *
+ * Elements are always swapped by qsort(), so 'swap_func' should be NULL.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_SORT_H
+#define KEDR_COI_SHIM_LINUX_SORT_H
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+
+static inline void sort(void* base, size_t num, size_t size,
+    int (*cmp_func)(const void*, const void*),
+    void (*swap_func)(void*, void*, int))
+{
+    BUG_ON(swap_func != NULL);
+    qsort(base, num, size, cmp_func);
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_SORT_H */
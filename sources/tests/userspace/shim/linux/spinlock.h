@@ -0,0 +1,71 @@
+/*
+ * Userspace replacement of <linux/spinlock.h>.
+ *
+ * Spinlock is a test-and-set lock, so it may be initialized statically
+ * and has no destructor, like the kernel one. Interrupts do not exist
+ * in userspace, so '_irqsave' and '_bh' variants are the same as plain
+ * ones.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_SPINLOCK_H
+#define KEDR_COI_SHIM_LINUX_SPINLOCK_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+
+#include <sched.h>
+
+typedef struct
+{
+    volatile int locked;
+} spinlock_t;
+
+#define __SPIN_LOCK_UNLOCKED(name) { 0 }
+#define DEFINE_SPINLOCK(name) spinlock_t name = __SPIN_LOCK_UNLOCKED(name)
+
+static inline void spin_lock_init(spinlock_t* lock)
+{
+    lock->locked = 0;
+}
+
+static inline void spin_lock(spinlock_t* lock)
+{
+    while(__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE))
+    {
+        while(__atomic_load_n(&lock->locked, __ATOMIC_RELAXED))
+            sched_yield();
+    }
+}
+
+static inline int spin_trylock(spinlock_t* lock)
+{
+    return !__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE);
+}
+
+/* Lock validator does not exist in userspace. */
+#define SINGLE_DEPTH_NESTING 1
+#define spin_lock_nested(lock, subclass) spin_lock(lock)
+
+static inline void spin_unlock(spinlock_t* lock)
+{
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+#define local_irq_save(flags) do { (flags) = 0; barrier(); } while(0)
+#define local_irq_restore(flags) do { (void)(flags); barrier(); } while(0)
+#define local_irq_disable() barrier()
+#define local_irq_enable() barrier()
+
+#define spin_lock_irqsave(lock, flags) \
+    do { local_irq_save(flags); spin_lock(lock); } while(0)
+#define spin_unlock_irqrestore(lock, flags) \
+    do { spin_unlock(lock); local_irq_restore(flags); } while(0)
+#define spin_lock_irq(lock) spin_lock(lock)
+#define spin_unlock_irq(lock) spin_unlock(lock)
+#define spin_lock_bh(lock) spin_lock(lock)
+#define spin_unlock_bh(lock) spin_unlock(lock)
+
+#define preempt_disable() barrier()
+#define preempt_enable() barrier()
+
+#endif /* KEDR_COI_SHIM_LINUX_SPINLOCK_H */
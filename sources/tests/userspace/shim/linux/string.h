@@ -0,0 +1,10 @@
+/*
+ * Userspace replacement of <linux/string.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_STRING_H
+#define KEDR_COI_SHIM_LINUX_STRING_H
+
+#include <string.h>
+
+#endif /* KEDR_COI_SHIM_LINUX_STRING_H */
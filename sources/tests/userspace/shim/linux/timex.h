@@ -0,0 +1,30 @@
+/*
+ * Userspace replacement of <linux/timex.h>.
+ *
+ * Cycles are read from the time stamp counter where it is available and
+ * are nanoseconds otherwise.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_TIMEX_H
+#define KEDR_COI_SHIM_LINUX_TIMEX_H
+
+#include <linux/types.h>
+#include <linux/sched.h>
+
+typedef u64 cycles_t;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+static inline cycles_t get_cycles(void)
+{
+    return __rdtsc();
+}
+#else
+static inline cycles_t get_cycles(void)
+{
+    return local_clock();
+}
+#endif
+
+#endif /* KEDR_COI_SHIM_LINUX_TIMEX_H */
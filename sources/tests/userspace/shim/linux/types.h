@@ -0,0 +1,52 @@
+/*
+ * Userspace replacement of <linux/types.h>.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_TYPES_H
+#define KEDR_COI_SHIM_LINUX_TYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+/* Types of the headers shared with userspace. */
+typedef uint8_t __u8;
+typedef uint16_t __u16;
+typedef uint32_t __u32;
+typedef uint64_t __u64;
+typedef int32_t __s32;
+typedef int64_t __s64;
+
+typedef unsigned int gfp_t;
+typedef unsigned short umode_t;
+
+#define __user
+#define __percpu
+#define __must_check
+
+struct list_head
+{
+    struct list_head *next, *prev;
+};
+
+struct hlist_head
+{
+    struct hlist_node* first;
+};
+
+struct hlist_node
+{
+    struct hlist_node *next, **pprev;
+};
+
+#endif /* KEDR_COI_SHIM_LINUX_TYPES_H */
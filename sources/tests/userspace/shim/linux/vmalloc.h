@@ -0,0 +1,34 @@
+/*
+ * Userspace replacement of <linux/vmalloc.h>.
+ *
+ * Memory is allocated with kmalloc(), so it is counted and may be
+ * forced to fail as well.
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_VMALLOC_H
+#define KEDR_COI_SHIM_LINUX_VMALLOC_H
+
+#include <linux/slab.h>
+
+static inline void* vmalloc(unsigned long size)
+{
+    return kmalloc(size, GFP_KERNEL);
+}
+
+static inline void* vzalloc(unsigned long size)
+{
+    return kzalloc(size, GFP_KERNEL);
+}
+
+/* Zeroed memory, as in the kernel. */
+static inline void* vmalloc_user(unsigned long size)
+{
+    return vzalloc(size);
+}
+
+static inline void vfree(const void* addr)
+{
+    kfree(addr);
+}
+
+#endif /* KEDR_COI_SHIM_LINUX_VMALLOC_H */
@@ -0,0 +1,38 @@
+/*
+ * Userspace replacement of <linux/workqueue.h>.
+ *
+ * Works are executed by the single worker thread, which is created on
+ * the first schedule_work().
+ */
+
+#ifndef KEDR_COI_SHIM_LINUX_WORKQUEUE_H
+#define KEDR_COI_SHIM_LINUX_WORKQUEUE_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+
+struct work_struct;
+
+typedef void (*work_func_t)(struct work_struct* work);
+
+struct work_struct
+{
+    work_func_t func;
+    // Element in the queue of the worker; empty if work is not queued.
+    struct list_head entry;
+    // Whether work is executed now.
+    int running;
+};
+
+#define INIT_WORK(work, f) \
+    do { (work)->func = (f); INIT_LIST_HEAD(&(work)->entry); \
+         (work)->running = 0; } while(0)
+
+/* Return false if work is already queued. */
+bool schedule_work(struct work_struct* work);
+/* Return true if work was queued. */
+bool cancel_work_sync(struct work_struct* work);
+/* Wait until all works queued before are executed. */
+void flush_scheduled_work(void);
+
+#endif /* KEDR_COI_SHIM_LINUX_WORKQUEUE_H */
@@ -0,0 +1,41 @@
+/*
+ * Mechanism selector for userspace build of the core.
+ *
+ * Userspace has no modules, so there is nothing to cache: decision is
+ * made by the selector itself on every call.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_mechanism_selector.h"
+
+int kedr_coi_mechanism_selector_init(void)
+{
+    return 0;
+}
+
+void kedr_coi_mechanism_selector_destroy(void)
+{
+}
+
+bool kedr_coi_mechanism_selector_call(bool (*selector)(const void* ops),
+    const void* ops)
+{
+    return selector(ops);
+}
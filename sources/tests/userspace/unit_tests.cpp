@@ -0,0 +1,1162 @@
+/*
+ * Unit tests for the core data structures built for userspace:
+ * hash table, instrumentors, payloads and tables of statistic.
+ *
+ * Every test is a function which checks conditions with CHECK().
+ * Test fails on the first unsatisfied condition. Names of the tests to
+ * run may be passed as arguments, by default all tests are run.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+#include <pthread.h>
+
+extern "C" {
+#include "kedr_coi_hash_table.h"
+#include "kedr_coi_instrumentor_internal.h"
+#include "payloads.h"
+#include "kedr_coi_stat_table.h"
+#include "kedr_coi_callers.h"
+#include "kedr_coi_tasks.h"
+
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+}
+
+/* Test framework */
+static bool test_failed;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+            #cond); \
+        test_failed = true; \
+        return; \
+    } } while(0)
+
+struct test_case
+{
+    const char* name;
+    void (*func)(void);
+};
+
+/* Operations and objects used by tests */
+struct test_operations
+{
+    int (*op1)(void* object);
+    int (*op2)(void* object);
+    int (*op3)(void* object);
+};
+
+struct test_object
+{
+    const struct test_operations* ops;
+};
+
+/* Object which contains its operations directly. */
+struct test_direct_object
+{
+    int (*op1)(void* object);
+    int (*op2)(void* object);
+};
+
+static int op1_orig(void* object) { return 1; }
+static int op2_orig(void* object) { return 2; }
+static int op1_repl(void* object) { return 10; }
+static int op2_repl(void* object) { return 20; }
+static int op3_repl(void* object) { return 30; }
+
+#define OP_OFFSET(op) offsetof(struct test_operations, op)
+#define DIRECT_OP_OFFSET(op) offsetof(struct test_direct_object, op)
+
+static const struct kedr_coi_replacement replacements[] =
+{
+    {OP_OFFSET(op1), (void*)&op1_repl, replace_all},
+    {OP_OFFSET(op3), (void*)&op3_repl, replace_null},
+    {(size_t)-1}
+};
+
+static const struct kedr_coi_replacement direct_replacements[] =
+{
+    {DIRECT_OP_OFFSET(op2), (void*)&op2_repl, replace_not_null},
+    {(size_t)-1}
+};
+
+static bool replace_at_place_never(const void* ops)
+{
+    return false;
+}
+
+static bool replace_at_place_always(const void* ops)
+{
+    return true;
+}
+
+static void trace_unforgotten_count(const void* object, void* user_data)
+{
+    (*(int*)user_data)++;
+}
+
+/* Hash table */
+static void free_elem_count(struct kedr_coi_hash_elem* elem, void* data)
+{
+    (*(int*)data)++;
+}
+
+static void test_hash_table_base(void)
+{
+    struct kedr_coi_hash_table table;
+    std::vector<struct kedr_coi_hash_elem> elems(100);
+    struct kedr_coi_hash_table_stat stat;
+    int n_freed = 0;
+    size_t i;
+
+    CHECK(kedr_coi_hash_table_init(&table) == 0);
+
+    for(i = 0; i < elems.size(); i++)
+    {
+        kedr_coi_hash_elem_init(&elems[i], &elems[i]);
+        CHECK(kedr_coi_hash_table_add_elem(&table, &elems[i]) == 0);
+    }
+
+    for(i = 0; i < elems.size(); i++)
+        CHECK(kedr_coi_hash_table_find_elem(&table, &elems[i]) == &elems[i]);
+    CHECK(kedr_coi_hash_table_find_elem(&table, &table) == NULL);
+
+    kedr_coi_hash_table_get_stat(&table, &stat);
+    CHECK(stat.n_elems == elems.size());
+    CHECK(stat.n_buckets_used <= stat.n_buckets);
+    CHECK(stat.max_chain * stat.n_buckets_used >= stat.n_elems);
+
+    for(i = 0; i < elems.size(); i += 2)
+        kedr_coi_hash_table_remove_elem(&table, &elems[i]);
+
+    for(i = 0; i < elems.size(); i++)
+    {
+        CHECK(kedr_coi_hash_table_find_elem(&table, &elems[i])
+            == ((i % 2) ? &elems[i] : NULL));
+    }
+
+    kedr_coi_hash_table_destroy(&table, &free_elem_count, &n_freed);
+    CHECK(n_freed == (int)elems.size() / 2);
+}
+
+/* Indirect instrumentor, operations are copied */
+static void test_instrumentor_copy(void)
+{
+    static const struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object object1 = {&ops}, object2 = {&ops};
+    struct kedr_coi_instrumentor* instrumentor;
+    struct kedr_coi_hash_table_stat stat;
+    size_t n_idata;
+    void* op;
+    int n_unforgotten = 0;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    CHECK(instrumentor != NULL);
+
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    CHECK(object1.ops != &ops);
+    CHECK(object1.ops->op1 == &op1_repl);
+    CHECK(object1.ops->op2 == &op2_orig);
+    // Original operation is NULL, so it is replaced.
+    CHECK(object1.ops->op3 == &op3_repl);
+    // Original operations are not changed.
+    CHECK(ops.op1 == &op1_orig);
+
+    // Repeated watch only updates the watch.
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object1,
+        (const void**)&object1.ops) == 1);
+
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object2,
+        (const void**)&object2.ops) == 0);
+    // Replaced operations are shared.
+    CHECK(object2.ops == object1.ops);
+
+    kedr_coi_instrumentor_get_stat(instrumentor, &stat, &n_idata);
+    CHECK(stat.n_elems == 2);
+    // Instrument data are searchable by original and replaced operations.
+    CHECK(n_idata == 2);
+
+    CHECK(kedr_coi_instrumentor_get_orig_operation(instrumentor, &object1,
+        object1.ops, OP_OFFSET(op1), &op) == 0);
+    CHECK(op == (void*)&op1_orig);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    CHECK(object1.ops == &ops);
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object1,
+        (const void**)&object1.ops) == 1);
+
+    // Not watched object with instrumented operations.
+    CHECK(kedr_coi_instrumentor_get_orig_operation(instrumentor, &object1,
+        object2.ops, OP_OFFSET(op1), &op) == 1);
+    CHECK(op == (void*)&op1_orig);
+
+    // Watch for object2 is left, it should be reported.
+    kedr_coi_instrumentor_destroy(instrumentor, &trace_unforgotten_count,
+        &n_unforgotten);
+    CHECK(n_unforgotten == 1);
+}
+
+/* Indirect instrumentor, operations are replaced at place */
+static void test_instrumentor_at_place(void)
+{
+    static struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object object1 = {&ops}, object2 = {&ops};
+    struct kedr_coi_instrumentor* instrumentor;
+    void* op;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_always);
+    CHECK(instrumentor != NULL);
+
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object2,
+        (const void**)&object2.ops) == 0);
+    CHECK(object1.ops == &ops);
+    CHECK(ops.op1 == &op1_repl);
+    // Original operation is NULL, so it is replaced.
+    CHECK(ops.op3 == &op3_repl);
+
+    CHECK(kedr_coi_instrumentor_get_orig_operation(instrumentor, &object1,
+        object1.ops, OP_OFFSET(op3), &op) == 0);
+    CHECK(op == NULL);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    // Operations are still used by object2.
+    CHECK(ops.op1 == &op1_repl);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object2,
+        (const void**)&object2.ops) == 0);
+    CHECK(ops.op1 == &op1_orig);
+    CHECK(ops.op3 == NULL);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+}
+
+/* Direct instrumentor */
+static void test_instrumentor_direct(void)
+{
+    struct test_direct_object object = {op1_orig, op2_orig};
+    struct kedr_coi_instrumentor* instrumentor;
+
+    instrumentor = kedr_coi_instrumentor_create_direct(sizeof(object),
+        direct_replacements);
+    CHECK(instrumentor != NULL);
+
+    CHECK(kedr_coi_instrumentor_watch_direct(instrumentor, &object) == 0);
+    CHECK(object.op1 == &op1_orig);
+    CHECK(object.op2 == &op2_repl);
+
+    CHECK(kedr_coi_instrumentor_forget_direct(instrumentor, &object,
+        false) == 0);
+    CHECK(object.op2 == &op2_orig);
+    CHECK(kedr_coi_instrumentor_forget_direct(instrumentor, &object,
+        false) == 1);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+}
+
+/* Hierarchy of watches */
+static void test_instrumentor_hierarchy(void)
+{
+    static const struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object parent = {&ops};
+    struct test_object children[3] = {{&ops}, {&ops}, {&ops}};
+    struct kedr_coi_instrumentor* instrumentor;
+    struct kedr_coi_hash_table_stat stat;
+    size_t n_idata;
+    int i;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    CHECK(instrumentor != NULL);
+
+    // Parent should be watched.
+    CHECK(kedr_coi_instrumentor_watch_child(instrumentor, &children[0],
+        (const void**)&children[0].ops, instrumentor, &parent) == -ENOENT);
+
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &parent,
+        (const void**)&parent.ops) == 0);
+    CHECK(kedr_coi_instrumentor_watch_child(instrumentor, &children[0],
+        (const void**)&children[0].ops, instrumentor, &parent) == 0);
+    // Grandchildren.
+    for(i = 1; i < 3; i++)
+    {
+        CHECK(kedr_coi_instrumentor_watch_child(instrumentor, &children[i],
+            (const void**)&children[i].ops, instrumentor, &children[0]) == 0);
+    }
+    // Cycles are not allowed.
+    CHECK(kedr_coi_instrumentor_watch_child(instrumentor, &parent,
+        (const void**)&parent.ops, instrumentor, &children[2]) == -EINVAL);
+
+    CHECK(kedr_coi_instrumentor_forget_children(instrumentor, &parent) == 0);
+
+    kedr_coi_instrumentor_get_stat(instrumentor, &stat, &n_idata);
+    CHECK(stat.n_elems == 1);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &parent,
+        (const void**)&parent.ops) == 0);
+    CHECK(kedr_coi_instrumentor_forget_children(instrumentor, &parent) == 1);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+}
+
+/* Subtree moved to another root takes lock of its new hierarchy */
+static void test_instrumentor_hierarchy_move(void)
+{
+    static const struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object roots[2] = {{&ops}, {&ops}};
+    struct test_object children[3] = {{&ops}, {&ops}, {&ops}};
+    struct kedr_coi_instrumentor* instrumentor;
+    struct kedr_coi_hash_table_stat stat;
+    size_t n_idata;
+    int i;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    CHECK(instrumentor != NULL);
+
+    for(i = 0; i < 2; i++)
+    {
+        CHECK(kedr_coi_instrumentor_watch(instrumentor, &roots[i],
+            (const void**)&roots[i].ops) == 0);
+    }
+    CHECK(kedr_coi_instrumentor_watch_child(instrumentor, &children[0],
+        (const void**)&children[0].ops, instrumentor, &roots[0]) == 0);
+    for(i = 1; i < 3; i++)
+    {
+        CHECK(kedr_coi_instrumentor_watch_child(instrumentor, &children[i],
+            (const void**)&children[i].ops, instrumentor, &children[0]) == 0);
+    }
+    // Second root gets the subtree.
+    CHECK(kedr_coi_instrumentor_watch_child(instrumentor, &children[0],
+        (const void**)&children[0].ops, instrumentor, &roots[1]) == 1);
+
+    CHECK(kedr_coi_instrumentor_forget_children(instrumentor, &roots[0]) == 0);
+    kedr_coi_instrumentor_get_stat(instrumentor, &stat, &n_idata);
+    CHECK(stat.n_elems == 5);
+
+    // Moved watch is forgotten with the lock of its new hierarchy.
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &children[2],
+        (const void**)&children[2].ops) == 0);
+    CHECK(children[2].ops == &ops);
+
+    CHECK(kedr_coi_instrumentor_forget_children(instrumentor, &roots[1]) == 0);
+    kedr_coi_instrumentor_get_stat(instrumentor, &stat, &n_idata);
+    CHECK(stat.n_elems == 2);
+
+    for(i = 0; i < 2; i++)
+    {
+        CHECK(kedr_coi_instrumentor_forget(instrumentor, &roots[i],
+            (const void**)&roots[i].ops) == 0);
+    }
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+}
+
+/* Failed allocations shouldn't break instrumentor or leak memory */
+static void test_instrumentor_no_memory(void)
+{
+    static const struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object object = {&ops};
+    struct kedr_coi_instrumentor* instrumentor;
+    long n_allocated = kedr_coi_shim_get_n_allocated();
+    long n;
+    int result;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    CHECK(instrumentor != NULL);
+
+    // Fail every allocation in turn until watch succeeds.
+    for(n = 0; ; n++)
+    {
+        kedr_coi_shim_fail_alloc(n);
+        result = kedr_coi_instrumentor_watch(instrumentor, &object,
+            (const void**)&object.ops);
+        kedr_coi_shim_fail_alloc(-1);
+
+        if(result == 0) break;
+
+        CHECK(result == -ENOMEM);
+        CHECK(object.ops == &ops);
+    }
+    CHECK(n > 0);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object,
+        (const void**)&object.ops) == 0);
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+
+    CHECK(kedr_coi_shim_get_n_allocated() == n_allocated);
+}
+
+/* Memory accounting */
+static void test_instrumentor_memory(void)
+{
+    static const struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object object1 = {&ops}, object2 = {&ops};
+    struct kedr_coi_instrumentor* instrumentor;
+    struct kedr_coi_instrumentor_memory memory;
+    unsigned long n_refused, n_evicted;
+    size_t hash_heads;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    CHECK(instrumentor != NULL);
+
+    kedr_coi_instrumentor_get_memory(instrumentor, &memory, &n_refused,
+        &n_evicted);
+    CHECK(memory.watch_data == 0);
+    CHECK(memory.idata == 0);
+    CHECK(memory.ops_copies == 0);
+    CHECK(memory.hash_heads > 0);
+    hash_heads = memory.hash_heads;
+
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object2,
+        (const void**)&object2.ops) == 0);
+
+    kedr_coi_instrumentor_get_memory(instrumentor, &memory, &n_refused,
+        &n_evicted);
+    CHECK(memory.watch_data > 0);
+    CHECK(memory.idata > 0);
+    // Operations are shared, so only one copy is made.
+    CHECK(memory.ops_copies == sizeof(ops));
+    CHECK(memory.foreign == 0);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object2,
+        (const void**)&object2.ops) == 0);
+
+    kedr_coi_instrumentor_get_memory(instrumentor, &memory, &n_refused,
+        &n_evicted);
+    CHECK(memory.watch_data == 0);
+    CHECK(memory.idata == 0);
+    CHECK(memory.ops_copies == 0);
+    CHECK(memory.hash_heads == hash_heads);
+    CHECK(n_refused == 0 && n_evicted == 0);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+}
+
+/* Quota on memory, refusing and evicting watches */
+static void test_instrumentor_quota(void)
+{
+    static const struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object object1 = {&ops}, object2 = {&ops}, object3 = {&ops};
+    struct kedr_coi_instrumentor* instrumentor;
+    struct kedr_coi_instrumentor_memory memory;
+    unsigned long n_refused, n_evicted;
+    size_t quota;
+    void* op;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    CHECK(instrumentor != NULL);
+
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object2,
+        (const void**)&object2.ops) == 0);
+
+    // Quota allows exactly two watches.
+    kedr_coi_instrumentor_get_memory(instrumentor, &memory, &n_refused,
+        &n_evicted);
+    quota = memory.watch_data + memory.idata + memory.ops_copies
+        + memory.hash_heads + memory.foreign;
+
+    kedr_coi_instrumentor_set_quota(instrumentor, quota, false);
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object3,
+        (const void**)&object3.ops) == -EDQUOT);
+    CHECK(object3.ops == &ops);
+    // Update of existed watch is not limited.
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object1,
+        (const void**)&object1.ops) == 1);
+
+    kedr_coi_instrumentor_set_quota(instrumentor, quota, true);
+    // Use object1, so it gets second chance and object2 is evicted.
+    CHECK(kedr_coi_instrumentor_get_orig_operation(instrumentor, &object1,
+        object1.ops, OP_OFFSET(op1), &op) == 0);
+    CHECK(kedr_coi_instrumentor_watch(instrumentor, &object3,
+        (const void**)&object3.ops) == 0);
+    CHECK(object3.ops != &ops);
+    CHECK(object1.ops != &ops);
+    // Evicted object is not accessed, but still works.
+    CHECK(object2.ops != &ops);
+    CHECK(kedr_coi_instrumentor_get_orig_operation(instrumentor, &object2,
+        object2.ops, OP_OFFSET(op1), &op) == 1);
+    CHECK(op == (void*)&op1_orig);
+    // Forget of evicted object restores its operations.
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object2,
+        (const void**)&object2.ops) == 1);
+    CHECK(object2.ops == &ops);
+
+    kedr_coi_instrumentor_get_memory(instrumentor, &memory, &n_refused,
+        &n_evicted);
+    CHECK(n_refused == 1);
+    CHECK(n_evicted == 1);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object1,
+        (const void**)&object1.ops) == 0);
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &object3,
+        (const void**)&object3.ops) == 0);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+}
+
+/* Garbage collection of watches for dead objects */
+static const void* dead_object;
+
+static bool object_is_alive_test(const void* object)
+{
+    return object != dead_object;
+}
+
+static void test_instrumentor_collect(void)
+{
+    static const struct test_operations ops = {op1_orig, op2_orig, NULL};
+    struct test_object objects[3] = {{&ops}, {&ops}, {&ops}};
+    struct kedr_coi_instrumentor* instrumentor;
+    struct kedr_coi_hash_table_stat stat;
+    size_t n_idata;
+    size_t pos = 0;
+    size_t n_collected = 0;
+    int i;
+
+    instrumentor = kedr_coi_instrumentor_create(
+        sizeof(ops), replacements, &replace_at_place_never);
+    CHECK(instrumentor != NULL);
+
+    for(i = 0; i < 3; i++)
+    {
+        CHECK(kedr_coi_instrumentor_watch(instrumentor, &objects[i],
+            (const void**)&objects[i].ops) == 0);
+    }
+
+    dead_object = &objects[1];
+    // Walk by one chain until the end of the table.
+    while(!kedr_coi_instrumentor_collect(instrumentor, &pos, 1,
+        &object_is_alive_test, &n_collected));
+    CHECK(pos == 0);
+    CHECK(n_collected == 1);
+
+    kedr_coi_instrumentor_get_stat(instrumentor, &stat, &n_idata);
+    CHECK(stat.n_elems == 2);
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &objects[1],
+        (const void**)&objects[1].ops) == 1);
+
+    // Whole table at once.
+    dead_object = &objects[2];
+    n_collected = 0;
+    CHECK(kedr_coi_instrumentor_collect(instrumentor, &pos, (unsigned)-1,
+        &object_is_alive_test, &n_collected));
+    CHECK(n_collected == 1);
+    // Dead object is not accessed.
+    CHECK(objects[2].ops != &ops);
+
+    CHECK(kedr_coi_instrumentor_forget(instrumentor, &objects[0],
+        (const void**)&objects[0].ops) == 0);
+    CHECK(objects[0].ops == &ops);
+
+    kedr_coi_instrumentor_destroy(instrumentor, NULL, NULL);
+}
+
+/* Payloads */
+static const struct kedr_coi_intermediate intermediates[] =
+{
+    {OP_OFFSET(op1), (void*)&op1_repl, 0, false, "op1"},
+    {OP_OFFSET(op2), (void*)&op2_repl, 0, false, "op2"},
+    {(size_t)-1}
+};
+
+static void op1_pre(void* object, struct kedr_coi_operation_call_info* info)
+{
+}
+
+static void op1_post(void* object, struct kedr_coi_operation_call_info* info)
+{
+}
+
+static struct kedr_coi_handler pre_handlers[] =
+{
+    {OP_OFFSET(op1), (void*)&op1_pre, false},
+    {(size_t)-1}
+};
+
+static struct kedr_coi_handler post_handlers[] =
+{
+    {OP_OFFSET(op1), (void*)&op1_post, true},
+    {(size_t)-1}
+};
+
+static void test_payloads_base(void)
+{
+    struct operation_payloads payloads;
+    struct module mod = {"test_payload"};
+    struct kedr_coi_payload payload = {&mod, pre_handlers, post_handlers};
+    const struct kedr_coi_replacement* repl;
+    void* const* pre;
+    void* const* post;
+    void* measure;
+    struct seq_file m;
+
+    CHECK(operation_payloads_init(&payloads, intermediates, "test") == 0);
+
+    CHECK(operation_payloads_has_operation(&payloads, OP_OFFSET(op2)));
+    CHECK(!operation_payloads_has_operation(&payloads, OP_OFFSET(op3)));
+    CHECK(operation_payloads_find_operation_by_name(&payloads, "op2")
+        == OP_OFFSET(op2));
+    CHECK(!strcmp(operation_payloads_get_operation_name(&payloads,
+        OP_OFFSET(op1)), "op1"));
+
+    CHECK(operation_payloads_add(&payloads, &payload) == 0);
+    CHECK(operation_payloads_add(&payloads, &payload) != 0);
+
+    CHECK(operation_payloads_use(&payloads, 0) == 0);
+    CHECK(atomic_read(&mod.refcnt) == 1);
+    // Used payload cannot be removed.
+    CHECK(operation_payloads_remove(&payloads, &payload) != 0);
+
+    // Only op1 has handlers, external post handler requires NULL one.
+    repl = operation_payloads_get_replacements(&payloads);
+    CHECK(repl != NULL);
+    CHECK(repl[0].operation_offset == OP_OFFSET(op1));
+    CHECK(repl[0].repl == (void*)&op1_repl);
+    CHECK(repl[0].mode == replace_all);
+    CHECK(repl[1].operation_offset == (size_t)-1);
+
+    operation_payloads_get_interception_info(&payloads, OP_OFFSET(op1), 0,
+        &pre, &post, &measure);
+    CHECK(pre[0] == (void*)&op1_pre);
+    CHECK(pre[1] == NULL);
+    CHECK(post[0] == (void*)&op1_post);
+    CHECK(post[1] == NULL);
+
+    operation_payloads_get_interception_info(&payloads, OP_OFFSET(op1), 1,
+        &pre, &post, &measure);
+    CHECK(pre == NULL || pre[0] == NULL);
+    CHECK(post[0] == (void*)&op1_post);
+
+    kedr_coi_shim_seq_init(&m);
+    operation_payloads_report(&payloads, &m);
+    CHECK(m.buf != NULL && strstr(m.buf, "test_payload") != NULL);
+    kedr_coi_shim_seq_destroy(&m);
+
+    operation_payloads_unuse(&payloads);
+    CHECK(atomic_read(&mod.refcnt) == 0);
+
+    CHECK(operation_payloads_remove(&payloads, &payload) == 0);
+    operation_payloads_destroy(&payloads);
+}
+
+/* Toggling state of the payload reuses handler sets */
+static void test_payloads_state_toggle(void)
+{
+    struct operation_payloads payloads;
+    struct module mod = {"test_payload"};
+    struct kedr_coi_payload payload = {&mod, pre_handlers, post_handlers};
+    void* const* pre;
+    void* const* post;
+    void* measure;
+    long n_allocated = 0;
+    int i;
+
+    CHECK(operation_payloads_init(&payloads, intermediates, "test") == 0);
+    CHECK(operation_payloads_add(&payloads, &payload) == 0);
+    CHECK(operation_payloads_use(&payloads, 0) == 0);
+
+    for(i = 0; i < 10; i++)
+    {
+        CHECK(operation_payloads_set_state(&payloads, "test_payload",
+            payload_state_disabled) == 0);
+        operation_payloads_get_interception_info(&payloads, OP_OFFSET(op1),
+            0, &pre, &post, &measure);
+        CHECK(pre == NULL || pre[0] == NULL);
+
+        CHECK(operation_payloads_set_state(&payloads, "test_payload",
+            payload_state_normal) == 0);
+        operation_payloads_get_interception_info(&payloads, OP_OFFSET(op1),
+            0, &pre, &post, &measure);
+        CHECK(pre[0] == (void*)&op1_pre);
+        CHECK(post[0] == (void*)&op1_post);
+
+        // Sets are allocated only by the first toggle.
+        if(i == 1) n_allocated = kedr_coi_shim_get_n_allocated();
+        else if(i > 1) CHECK(kedr_coi_shim_get_n_allocated() == n_allocated);
+    }
+
+    operation_payloads_unuse(&payloads);
+    CHECK(operation_payloads_remove(&payloads, &payload) == 0);
+    operation_payloads_destroy(&payloads);
+}
+
+/* Payload of unloading module cannot be used */
+static void test_payloads_module_going(void)
+{
+    struct operation_payloads payloads;
+    struct module mod = {"test_payload"};
+    struct kedr_coi_payload payload = {&mod, pre_handlers, NULL};
+    void* const* pre;
+    void* const* post;
+    void* measure;
+
+    CHECK(operation_payloads_init(&payloads, intermediates, "test") == 0);
+    CHECK(operation_payloads_add(&payloads, &payload) == 0);
+
+    mod.is_going = 1;
+    CHECK(operation_payloads_use(&payloads, 0) == 0);
+
+    // Payload is not fixed, so its handlers are not used.
+    CHECK(operation_payloads_get_replacements(&payloads) == NULL);
+    operation_payloads_get_interception_info(&payloads, OP_OFFSET(op1), 0,
+        &pre, &post, &measure);
+    CHECK(pre == NULL || pre[0] == NULL);
+
+    operation_payloads_unuse(&payloads);
+    CHECK(operation_payloads_remove(&payloads, &payload) == 0);
+    operation_payloads_destroy(&payloads);
+}
+
+/* Statistic table: the coldest entry is evicted, its calls are lost */
+static const struct kedr_coi_stat_entry* stat_entry_find(
+    const struct kedr_coi_stat_entry* entries, int n, u64 key)
+{
+    int i;
+
+    for(i = 0; i < n; i++)
+        if(entries[i].key == key) return &entries[i];
+
+    return NULL;
+}
+
+static void test_stat_table_lost(void)
+{
+    struct kedr_coi_stat_table* table;
+    struct kedr_coi_stat_entry* entries;
+    const struct kedr_coi_stat_entry* entry;
+    int n;
+    u64 lost;
+    u64 key;
+    int i;
+
+    // 4 entries per CPU.
+    table = kedr_coi_stat_table_create(2, false);
+    CHECK(table != NULL);
+
+    // Key 'k' is called 'k' times.
+    for(key = 1; key <= 4; key++)
+        for(i = 0; i < (int)key; i++)
+            kedr_coi_stat_table_account(table, OP_OFFSET(op1), key, 10, 6);
+
+    entries = kedr_coi_stat_table_collect(table, &n, &lost);
+    CHECK(entries != NULL);
+    CHECK(n == 4);
+    CHECK(lost == 0);
+    // Sorted by number of calls.
+    CHECK(entries[0].key == 4);
+    CHECK(entries[0].count == 4);
+    CHECK(entries[0].time == 40);
+    CHECK(entries[0].self_time == 24);
+    CHECK(entries[3].key == 1);
+    vfree(entries);
+
+    // No place for the new key, so the coldest one is evicted.
+    kedr_coi_stat_table_account(table, OP_OFFSET(op1), 5, 10, 6);
+
+    entries = kedr_coi_stat_table_collect(table, &n, &lost);
+    CHECK(entries != NULL);
+    CHECK(n == 4);
+    CHECK(lost == 1);
+    CHECK(stat_entry_find(entries, n, 1) == NULL);
+    entry = stat_entry_find(entries, n, 5);
+    CHECK(entry != NULL);
+    CHECK(entry->count == 1);
+    CHECK(entry->time == 10);
+    CHECK(entry->error == 0);
+    vfree(entries);
+
+    // Same key for other operation is a different entry.
+    kedr_coi_stat_table_account(table, OP_OFFSET(op2), 4, 10, 6);
+
+    entries = kedr_coi_stat_table_collect(table, &n, &lost);
+    CHECK(entries != NULL);
+    CHECK(lost == 2);
+    CHECK(entries[0].key == 4);
+    CHECK(entries[0].operation_offset == OP_OFFSET(op1));
+    CHECK(entries[0].count == 4);
+    vfree(entries);
+
+    kedr_coi_stat_table_destroy(table);
+}
+
+/* Aggregation by caller and by enclosing call */
+static const char* test_operation_name(size_t operation_offset, void* data)
+{
+    return operation_offset == OP_OFFSET(op1) ? "op1" : NULL;
+}
+
+static void test_callers(void)
+{
+    struct kedr_coi_callers* callers;
+    struct kedr_coi_hook_context parent;
+    struct kedr_coi_hook_context ctx;
+    struct seq_file m;
+    char line[64];
+    int i;
+
+    callers = kedr_coi_callers_create(true);
+    CHECK(callers != NULL);
+
+    memset(&parent, 0, sizeof(parent));
+    parent.interceptor_id = 7;
+    parent.operation_offset = OP_OFFSET(op1);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.interceptor_id = 7;
+    ctx.operation_offset = OP_OFFSET(op1);
+
+    // Outermost calls from one place, nested calls from another one.
+    ctx.return_address = (void*)0x1000;
+    for(i = 0; i < 3; i++)
+        kedr_coi_callers_account(callers, &ctx, 300, 100);
+
+    ctx.return_address = (void*)0x2000;
+    ctx.parent = &parent;
+    kedr_coi_callers_account(callers, &ctx, 50, 50);
+    ctx.operation_offset = OP_OFFSET(op2);
+    kedr_coi_callers_account(callers, &ctx, 50, 50);
+
+    kedr_coi_shim_seq_init(&m);
+    CHECK(kedr_coi_callers_report(callers, &m, 7, test_operation_name,
+        NULL) == 0);
+    CHECK(m.buf != NULL);
+    CHECK(strstr(m.buf, "# callers: 3, lost calls: 0\n") != NULL);
+    // Average time is shown.
+    CHECK(strstr(m.buf, "3\t300\t100\top1\t") != NULL);
+    CHECK(strstr(m.buf, "# enclosing calls: 3, lost calls: 0\n") != NULL);
+    CHECK(strstr(m.buf, "3\t300\t100\top1\t-\n") != NULL);
+    CHECK(strstr(m.buf, "1\t50\t50\top1\t7:op1\n") != NULL);
+    // Unknown operation is shown by offset.
+    snprintf(line, sizeof(line), "1\t50\t50\t%zu\t7:op1\n",
+        OP_OFFSET(op2));
+    CHECK(strstr(m.buf, line) != NULL);
+    kedr_coi_shim_seq_destroy(&m);
+
+    kedr_coi_callers_destroy(callers);
+}
+
+/* Space-Saving: new key inherits count of the evicted one as error */
+static void test_stat_table_space_saving(void)
+{
+    struct kedr_coi_stat_table* table;
+    struct kedr_coi_stat_entry* entries;
+    const struct kedr_coi_stat_entry* entry;
+    int n;
+    u64 lost;
+    u64 key;
+    int i;
+
+    table = kedr_coi_stat_table_create(2, true);
+    CHECK(table != NULL);
+
+    for(key = 1; key <= 4; key++)
+        for(i = 0; i < (int)key; i++)
+            kedr_coi_stat_table_account(table, OP_OFFSET(op1), key, 10, 6);
+
+    kedr_coi_stat_table_account(table, OP_OFFSET(op1), 5, 10, 6);
+
+    entries = kedr_coi_stat_table_collect(table, &n, &lost);
+    CHECK(entries != NULL);
+    CHECK(n == 4);
+    // Nothing is lost, count of key 1 is given to the key 5.
+    CHECK(lost == 0);
+    CHECK(stat_entry_find(entries, n, 1) == NULL);
+    entry = stat_entry_find(entries, n, 5);
+    CHECK(entry != NULL);
+    CHECK(entry->count == 2);
+    CHECK(entry->error == 1);
+    // Time is not inherited.
+    CHECK(entry->time == 10);
+    CHECK(entry->self_time == 6);
+    vfree(entries);
+
+    kedr_coi_stat_table_destroy(table);
+}
+
+/*
+ * Space-Saving on a stream with heavy hitters: counts are never
+ * underestimated, overestimation is bounded by error, and every key
+ * with more than N/m calls is kept (m - number of entries).
+ */
+#define SPACE_SAVING_KEYS 256
+#define SPACE_SAVING_CALLS 20000
+
+static void test_stat_table_space_saving_bound(void)
+{
+    struct kedr_coi_stat_table* table;
+    struct kedr_coi_stat_entry* entries;
+    const struct kedr_coi_stat_entry* entry;
+    std::vector<u64> counts(SPACE_SAVING_KEYS, 0);
+    unsigned int seed = 1;
+    int n;
+    u64 lost;
+    u64 key;
+    int i;
+
+    // 16 entries per CPU, all of them are probed.
+    table = kedr_coi_stat_table_create(4, true);
+    CHECK(table != NULL);
+
+    for(i = 0; i < SPACE_SAVING_CALLS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        // Keys 0 and 1 take a quarter of calls each.
+        if((seed >> 16) % 4 < 2)
+            key = (seed >> 16) % 2;
+        else
+            key = (seed >> 8) % SPACE_SAVING_KEYS;
+
+        counts[key]++;
+        kedr_coi_stat_table_account(table, OP_OFFSET(op1), key, 1, 1);
+    }
+
+    entries = kedr_coi_stat_table_collect(table, &n, &lost);
+    CHECK(entries != NULL);
+    CHECK(n == 16);
+    CHECK(lost == 0);
+
+    for(i = 0; i < n; i++)
+    {
+        CHECK(entries[i].count >= counts[entries[i].key]);
+        CHECK(entries[i].count - entries[i].error
+            <= counts[entries[i].key]);
+    }
+
+    for(key = 0; key < SPACE_SAVING_KEYS; key++)
+    {
+        if(counts[key] <= SPACE_SAVING_CALLS / 16) continue;
+
+        entry = stat_entry_find(entries, n, key);
+        CHECK(entry != NULL);
+    }
+    // Heavy hitters are on the top.
+    CHECK(entries[0].key < 2);
+    CHECK(entries[1].key < 2);
+    vfree(entries);
+
+    kedr_coi_stat_table_destroy(table);
+}
+
+/* Entries for the same key on different CPUs are merged */
+static void* stat_table_account_thread(void* data)
+{
+    struct kedr_coi_stat_table* table = (struct kedr_coi_stat_table*)data;
+
+    kedr_coi_stat_table_account(table, OP_OFFSET(op1), 1, 10, 10);
+    kedr_coi_stat_table_account(table, OP_OFFSET(op1), 2, 10, 10);
+
+    return NULL;
+}
+
+static void test_stat_table_merge(void)
+{
+    struct kedr_coi_stat_table* table;
+    struct kedr_coi_stat_entry* entries;
+    pthread_t thread;
+    int n;
+    u64 lost;
+
+    table = kedr_coi_stat_table_create(2, false);
+    CHECK(table != NULL);
+
+    kedr_coi_stat_table_account(table, OP_OFFSET(op1), 1, 10, 10);
+    // Other thread works on other CPU.
+    CHECK(pthread_create(&thread, NULL, stat_table_account_thread,
+        table) == 0);
+    CHECK(pthread_join(thread, NULL) == 0);
+
+    entries = kedr_coi_stat_table_collect(table, &n, &lost);
+    CHECK(entries != NULL);
+    CHECK(n == 2);
+    CHECK(lost == 0);
+    CHECK(entries[0].key == 1);
+    CHECK(entries[0].count == 2);
+    CHECK(entries[0].time == 20);
+    CHECK(entries[1].key == 2);
+    CHECK(entries[1].count == 1);
+    vfree(entries);
+
+    kedr_coi_stat_table_destroy(table);
+}
+
+/* Aggregation by task: every thread is a task with its own pid */
+static void* tasks_account_thread(void* data)
+{
+    struct kedr_coi_tasks* tasks = (struct kedr_coi_tasks*)data;
+    int i;
+
+    for(i = 0; i < 2; i++)
+        kedr_coi_tasks_account(tasks, OP_OFFSET(op1), 20, 20);
+
+    return (void*)(long)task_pid_nr(current);
+}
+
+static void test_tasks(void)
+{
+    struct kedr_coi_tasks* tasks;
+    struct seq_file m;
+    pthread_t thread;
+    void* thread_pid;
+    pid_t pid = task_pid_nr(current);
+    char line[64];
+    int i;
+
+    tasks = kedr_coi_tasks_create(false);
+    CHECK(tasks != NULL);
+    CHECK(!kedr_coi_tasks_latency(tasks));
+
+    for(i = 0; i < 3; i++)
+        kedr_coi_tasks_account(tasks, OP_OFFSET(op1), 10, 10);
+    kedr_coi_tasks_account(tasks, OP_OFFSET(op2), 10, 10);
+
+    CHECK(pthread_create(&thread, NULL, tasks_account_thread, tasks) == 0);
+    CHECK(pthread_join(thread, &thread_pid) == 0);
+    CHECK((long)thread_pid != pid);
+
+    kedr_coi_shim_seq_init(&m);
+    CHECK(kedr_coi_tasks_report_pids(tasks, &m, test_operation_name,
+        NULL) == 0);
+    CHECK(m.buf != NULL);
+    CHECK(strstr(m.buf, "# entries: 3, lost calls: 0\n") != NULL);
+    // Time is not collected.
+    snprintf(line, sizeof(line), "3\t-\t-\top1\t%d\t%s\n", pid,
+        current->comm);
+    CHECK(strstr(m.buf, line) != NULL);
+    // Exited task has no name.
+    snprintf(line, sizeof(line), "2\t-\t-\top1\t%ld\t-\n",
+        (long)thread_pid);
+    CHECK(strstr(m.buf, line) != NULL);
+    kedr_coi_shim_seq_destroy(&m);
+
+    // Without cgroups all calls are in the same one.
+    kedr_coi_shim_seq_init(&m);
+    CHECK(kedr_coi_tasks_report_cgroups(tasks, &m, test_operation_name,
+        NULL) == 0);
+    CHECK(m.buf != NULL);
+    CHECK(strstr(m.buf, "# entries: 2, lost calls: 0\n") != NULL);
+    CHECK(strstr(m.buf, "5\t-\t-\top1\t0\n") != NULL);
+    kedr_coi_shim_seq_destroy(&m);
+
+    kedr_coi_tasks_destroy(tasks);
+}
+
+static const struct test_case tests[] =
+{
+    {"hash_table_base", test_hash_table_base},
+    {"instrumentor_copy", test_instrumentor_copy},
+    {"instrumentor_at_place", test_instrumentor_at_place},
+    {"instrumentor_direct", test_instrumentor_direct},
+    {"instrumentor_hierarchy", test_instrumentor_hierarchy},
+    {"instrumentor_hierarchy_move", test_instrumentor_hierarchy_move},
+    {"instrumentor_no_memory", test_instrumentor_no_memory},
+    {"instrumentor_memory", test_instrumentor_memory},
+    {"instrumentor_quota", test_instrumentor_quota},
+    {"instrumentor_collect", test_instrumentor_collect},
+    {"payloads_base", test_payloads_base},
+    {"payloads_module_going", test_payloads_module_going},
+    {"payloads_state_toggle", test_payloads_state_toggle},
+    {"stat_table_lost", test_stat_table_lost},
+    {"callers", test_callers},
+    {"stat_table_space_saving", test_stat_table_space_saving},
+    {"stat_table_space_saving_bound", test_stat_table_space_saving_bound},
+    {"stat_table_merge", test_stat_table_merge},
+    {"tasks", test_tasks},
+};
+
+static bool test_is_selected(const char* name, int argc, char** argv)
+{
+    int i;
+
+    if(argc < 2) return true;
+
+    for(i = 1; i < argc; i++)
+        if(!strcmp(argv[i], name)) return true;
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    long n_allocated;
+    int n_failed = 0;
+    int n_run = 0;
+    size_t i;
+
+    n_allocated = kedr_coi_shim_get_n_allocated();
+
+    if(kedr_coi_instrumentors_init())
+    {
+        fprintf(stderr, "Failed to initialize instrumentors.\n");
+        return 1;
+    }
+
+    // Errors are expected in some tests.
+    kedr_coi_shim_set_quiet(1);
+
+    for(i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        if(!test_is_selected(tests[i].name, argc, argv)) continue;
+
+        test_failed = false;
+        tests[i].func();
+        n_run++;
+
+        if(test_failed) n_failed++;
+        printf("%s: %s\n", tests[i].name, test_failed ? "FAILED" : "OK");
+    }
+
+    kedr_coi_instrumentors_destroy();
+
+    if(kedr_coi_shim_get_n_allocated() != n_allocated)
+    {
+        printf("Memory leak: %ld blocks are not freed.\n",
+            kedr_coi_shim_get_n_allocated() - n_allocated);
+        n_failed++;
+    }
+
+    printf("%d of %d tests failed.\n", n_failed, n_run);
+
+    return n_failed ? 1 : 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Print call records, stored by KEDR COI core, in text form.
+ *
+ * Usage: kedr_coi_call_dump [-f] [device]
+ *
+ * With '-f' records are printed until interrupted, otherwise only
+ * records currently in the buffers are printed.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_call_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define RECORDS_PER_READ 256
+
+static volatile sig_atomic_t stopped = 0;
+
+static void stop_handler(int sig)
+{
+    (void)sig;
+    stopped = 1;
+}
+
+static void print_record(const struct kedr_coi_call_record* record)
+{
+    static const char* types[] = {"call", "watch", "forget"};
+
+    printf("%llu %s cpu=%u pid=%u interceptor=%u offset=%u object=0x%llx "
+        "op=0x%llx caller=0x%llx ret=%lld duration=%llu\n",
+        (unsigned long long)record->timestamp,
+        record->type < 3 ? types[record->type] : "unknown",
+        record->cpu,
+        record->pid,
+        record->interceptor_id,
+        record->operation_offset,
+        (unsigned long long)record->object,
+        (unsigned long long)record->op_orig,
+        (unsigned long long)record->return_address,
+        (long long)record->return_value,
+        (unsigned long long)record->duration);
+}
+
+int main(int argc, char** argv)
+{
+    struct kedr_coi_call_reader* reader;
+    struct kedr_coi_call_record records[RECORDS_PER_READ];
+    const char* path = NULL;
+    int follow = 0;
+    int n_cpus;
+    int cpu;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-f"))
+            follow = 1;
+        else
+            path = argv[i];
+    }
+
+    reader = kedr_coi_call_reader_open(path);
+    if(reader == NULL)
+    {
+        perror("Failed to open call records");
+        return 1;
+    }
+
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+
+    n_cpus = kedr_coi_call_reader_n_cpus(reader);
+
+    while(!stopped)
+    {
+        int n_total = 0;
+
+        for(cpu = 0; cpu < n_cpus; cpu++)
+        {
+            int n = kedr_coi_call_reader_read(reader, cpu, records,
+                RECORDS_PER_READ);
+
+            for(i = 0; i < n; i++)
+                print_record(&records[i]);
+
+            n_total += n;
+        }
+
+        if(n_total == 0)
+        {
+            if(!follow) break;
+            usleep(10000);
+        }
+    }
+
+    for(cpu = 0; cpu < n_cpus; cpu++)
+    {
+        unsigned long long lost = kedr_coi_call_reader_lost(reader, cpu);
+        if(lost)
+            fprintf(stderr, "CPU %d: %llu records lost.\n", cpu, lost);
+    }
+
+    kedr_coi_call_reader_close(reader);
+
+    return 0;
+}
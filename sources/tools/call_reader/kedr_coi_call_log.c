@@ -0,0 +1,671 @@
+/*
+ * Writing and reading of the log of intercepted calls.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_call_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define LOG_HEADER_SIZE 16
+
+/* Payload of any event except ones with names fits into this size. */
+#define LOG_PAYLOAD_MAX 96
+
+/* Events with larger payload are treated as corrupted. */
+#define LOG_PAYLOAD_LIMIT (1 << 20)
+
+/* Initial number of slots in the table of objects, power of 2. */
+#define OBJECTS_TABLE_INITIAL 1024
+
+//************************** Encoding *********************************//
+static size_t put_varint(unsigned char* buf, __u64 val)
+{
+    size_t n = 0;
+
+    while(val >= 0x80)
+    {
+        buf[n++] = (unsigned char)(val | 0x80);
+        val >>= 7;
+    }
+    buf[n++] = (unsigned char)val;
+
+    return n;
+}
+
+static __u64 zigzag_encode(__s64 val)
+{
+    return ((__u64)val << 1) ^ (__u64)(val >> 63);
+}
+
+static __s64 zigzag_decode(__u64 val)
+{
+    return (__s64)(val >> 1) ^ -(__s64)(val & 1);
+}
+
+static void put_u32_le(unsigned char* buf, __u32 val)
+{
+    buf[0] = val & 0xff;
+    buf[1] = (val >> 8) & 0xff;
+    buf[2] = (val >> 16) & 0xff;
+    buf[3] = (val >> 24) & 0xff;
+}
+
+static __u32 get_u32_le(const unsigned char* buf)
+{
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((__u32)buf[3] << 24);
+}
+
+//*********************** Table of objects ****************************//
+/*
+ * Maps (interceptor, address) pair into dense identificator of the
+ * object. Open addressing with linear probing; slot is free if its
+ * 'id' is 0.
+ */
+struct object_slot
+{
+    __u64 address;
+    __u32 interceptor_id;
+    __u64 id;
+};
+
+struct objects_table
+{
+    struct object_slot* slots;
+    /* Number of slots minus 1. */
+    size_t mask;
+    size_t count;
+    /* Identificator for the next new object. */
+    __u64 next_id;
+};
+
+static size_t objects_table_hash(__u64 address, __u32 interceptor_id)
+{
+    __u64 x = address ^ ((__u64)interceptor_id << 48);
+
+    // Finalizer of MurmurHash3: objects are usually aligned.
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+
+    return (size_t)x;
+}
+
+static int objects_table_init(struct objects_table* table)
+{
+    table->slots = calloc(OBJECTS_TABLE_INITIAL, sizeof(*table->slots));
+    if(table->slots == NULL) return -1;
+
+    table->mask = OBJECTS_TABLE_INITIAL - 1;
+    table->count = 0;
+    table->next_id = 1;
+
+    return 0;
+}
+
+static void objects_table_destroy(struct objects_table* table)
+{
+    free(table->slots);
+}
+
+static struct object_slot* objects_table_lookup(struct objects_table* table,
+    __u64 address, __u32 interceptor_id)
+{
+    size_t i = objects_table_hash(address, interceptor_id) & table->mask;
+
+    for(;; i = (i + 1) & table->mask)
+    {
+        struct object_slot* slot = &table->slots[i];
+
+        if(slot->id == 0) return slot;
+        if((slot->address == address)
+            && (slot->interceptor_id == interceptor_id))
+            return slot;
+    }
+}
+
+static int objects_table_grow(struct objects_table* table)
+{
+    struct object_slot* old_slots = table->slots;
+    size_t old_size = table->mask + 1;
+    size_t i;
+
+    table->slots = calloc(old_size * 2, sizeof(*table->slots));
+    if(table->slots == NULL)
+    {
+        table->slots = old_slots;
+        return -1;
+    }
+    table->mask = old_size * 2 - 1;
+
+    for(i = 0; i < old_size; i++)
+    {
+        if(old_slots[i].id == 0) continue;
+
+        *objects_table_lookup(table, old_slots[i].address,
+            old_slots[i].interceptor_id) = old_slots[i];
+    }
+
+    free(old_slots);
+
+    return 0;
+}
+
+/*
+ * Return identificator of the object, new one is assigned if object
+ * is not in the table.
+ *
+ * Return 0 on error.
+ */
+static __u64 objects_table_get(struct objects_table* table,
+    __u64 address, __u32 interceptor_id)
+{
+    struct object_slot* slot;
+
+    if(address == 0) return 0;
+
+    slot = objects_table_lookup(table, address, interceptor_id);
+    if(slot->id != 0) return slot->id;
+
+    // Keep load factor not more than 1/2.
+    if((table->count + 1) * 2 > table->mask + 1)
+    {
+        if(objects_table_grow(table)) return 0;
+        slot = objects_table_lookup(table, address, interceptor_id);
+    }
+
+    slot->address = address;
+    slot->interceptor_id = interceptor_id;
+    slot->id = table->next_id++;
+    table->count++;
+
+    return slot->id;
+}
+
+/* Remove the slot, shifting back slots of the same probe sequence. */
+static void objects_table_remove(struct objects_table* table,
+    struct object_slot* slot)
+{
+    size_t i = slot - table->slots;
+    size_t j = i;
+
+    for(;;)
+    {
+        size_t home;
+
+        j = (j + 1) & table->mask;
+        if(table->slots[j].id == 0) break;
+
+        home = objects_table_hash(table->slots[j].address,
+            table->slots[j].interceptor_id) & table->mask;
+        // Slot 'j' may be moved to 'i' if 'home' is not in (i, j].
+        if(((j - home) & table->mask) >= ((j - i) & table->mask))
+        {
+            table->slots[i] = table->slots[j];
+            i = j;
+        }
+    }
+
+    table->slots[i].id = 0;
+    table->count--;
+}
+
+//***************************** Writer ********************************//
+struct kedr_coi_call_log_writer
+{
+    FILE* f;
+    /* Timestamp of the last event which has it. */
+    __u64 timestamp;
+    struct objects_table objects;
+    /* Non-zero if writing has failed. */
+    int error;
+};
+
+struct kedr_coi_call_log_writer* kedr_coi_call_log_writer_open(
+    const char* path)
+{
+    struct kedr_coi_call_log_writer* writer;
+    unsigned char header[LOG_HEADER_SIZE];
+    int saved_errno;
+
+    writer = malloc(sizeof(*writer));
+    if(writer == NULL) return NULL;
+
+    if(objects_table_init(&writer->objects)) goto err_objects;
+
+    writer->f = fopen(path, "wb");
+    if(writer->f == NULL) goto err_open;
+
+    writer->timestamp = 0;
+    writer->error = 0;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, KEDR_COI_CALL_LOG_MAGIC, sizeof(KEDR_COI_CALL_LOG_MAGIC));
+    put_u32_le(header + 8, KEDR_COI_CALL_LOG_VERSION);
+    put_u32_le(header + 12, 0);
+
+    if(fwrite(header, sizeof(header), 1, writer->f) != 1) goto err_header;
+
+    return writer;
+
+err_header:
+    saved_errno = errno;
+    fclose(writer->f);
+    errno = saved_errno;
+err_open:
+    objects_table_destroy(&writer->objects);
+err_objects:
+    free(writer);
+    return NULL;
+}
+
+int kedr_coi_call_log_writer_close(struct kedr_coi_call_log_writer* writer)
+{
+    int result = writer->error ? -1 : 0;
+
+    if(fclose(writer->f)) result = -1;
+
+    objects_table_destroy(&writer->objects);
+    free(writer);
+
+    return result;
+}
+
+static int writer_put_event(struct kedr_coi_call_log_writer* writer,
+    enum kedr_coi_call_log_event_type type,
+    const unsigned char* payload, size_t size,
+    const char* name)
+{
+    unsigned char prefix[1 + 10];
+    size_t name_len = name ? strlen(name) : 0;
+    size_t n;
+
+    prefix[0] = type;
+    n = 1 + put_varint(prefix + 1, size + name_len);
+
+    if((fwrite(prefix, n, 1, writer->f) != 1)
+        || (fwrite(payload, size, 1, writer->f) != 1)
+        || (name_len && (fwrite(name, name_len, 1, writer->f) != 1)))
+    {
+        writer->error = 1;
+        return -1;
+    }
+
+    return 0;
+}
+
+static size_t writer_put_timestamp(struct kedr_coi_call_log_writer* writer,
+    unsigned char* buf, __u64 timestamp)
+{
+    __s64 delta = (__s64)(timestamp - writer->timestamp);
+
+    writer->timestamp = timestamp;
+
+    return put_varint(buf, zigzag_encode(delta));
+}
+
+int kedr_coi_call_log_write_interceptor(
+    struct kedr_coi_call_log_writer* writer,
+    __u32 interceptor_id, const char* name)
+{
+    unsigned char payload[LOG_PAYLOAD_MAX];
+    size_t n = put_varint(payload, interceptor_id);
+
+    return writer_put_event(writer, kedr_coi_call_log_event_interceptor,
+        payload, n, name);
+}
+
+int kedr_coi_call_log_write_operation(
+    struct kedr_coi_call_log_writer* writer,
+    __u32 interceptor_id, __u32 operation_offset, const char* name)
+{
+    unsigned char payload[LOG_PAYLOAD_MAX];
+    size_t n = put_varint(payload, interceptor_id);
+
+    n += put_varint(payload + n, operation_offset);
+
+    return writer_put_event(writer, kedr_coi_call_log_event_operation,
+        payload, n, name);
+}
+
+int kedr_coi_call_log_write_record(struct kedr_coi_call_log_writer* writer,
+    const struct kedr_coi_call_record* record)
+{
+    unsigned char payload[LOG_PAYLOAD_MAX];
+    enum kedr_coi_call_log_event_type type;
+    struct object_slot* slot = NULL;
+    __u64 object;
+    size_t n;
+    int result;
+
+    switch(record->type)
+    {
+    case kedr_coi_call_record_type_call:
+        type = kedr_coi_call_log_event_call;
+        break;
+    case kedr_coi_call_record_type_watch:
+        type = kedr_coi_call_log_event_watch;
+        break;
+    case kedr_coi_call_record_type_forget:
+        type = kedr_coi_call_log_event_forget;
+        break;
+    default:
+        // Records of newer core, unknown for us.
+        return 0;
+    }
+
+    if(type == kedr_coi_call_log_event_forget)
+    {
+        slot = objects_table_lookup(&writer->objects, record->object,
+            record->interceptor_id);
+        // Object watched before recording has been started.
+        object = slot->id ? slot->id : writer->objects.next_id++;
+    }
+    else
+    {
+        object = objects_table_get(&writer->objects, record->object,
+            record->interceptor_id);
+        if((object == 0) && (record->object != 0))
+        {
+            writer->error = 1;
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    n = writer_put_timestamp(writer, payload, record->timestamp);
+    n += put_varint(payload + n, record->interceptor_id);
+
+    if(type == kedr_coi_call_log_event_call)
+    {
+        n += put_varint(payload + n, record->operation_offset);
+        n += put_varint(payload + n, object);
+        n += put_varint(payload + n, record->duration);
+        n += put_varint(payload + n, zigzag_encode(record->return_value));
+        n += put_varint(payload + n, record->pid);
+        n += put_varint(payload + n, record->cpu);
+    }
+    else
+    {
+        n += put_varint(payload + n, object);
+    }
+
+    result = writer_put_event(writer, type, payload, n, NULL);
+
+    // Address may be reused by another object after it is forgotten.
+    if(slot && slot->id) objects_table_remove(&writer->objects, slot);
+
+    return result;
+}
+
+int kedr_coi_call_log_write_lost(struct kedr_coi_call_log_writer* writer,
+    __u32 cpu, __u64 lost)
+{
+    unsigned char payload[LOG_PAYLOAD_MAX];
+    size_t n = put_varint(payload, cpu);
+
+    n += put_varint(payload + n, lost);
+
+    return writer_put_event(writer, kedr_coi_call_log_event_lost,
+        payload, n, NULL);
+}
+
+//***************************** Reader ********************************//
+struct kedr_coi_call_log_reader
+{
+    FILE* f;
+    __u64 timestamp;
+    /* Payload of the current event, with space for terminating zero. */
+    unsigned char* payload;
+    size_t payload_size;
+};
+
+/* Cursor over the payload of the event. */
+struct payload_cursor
+{
+    const unsigned char* p;
+    const unsigned char* end;
+};
+
+static int cursor_get_varint(struct payload_cursor* cursor, __u64* val)
+{
+    __u64 result = 0;
+    int shift;
+
+    for(shift = 0; (shift < 64) && (cursor->p < cursor->end); shift += 7)
+    {
+        unsigned char b = *cursor->p++;
+
+        result |= (__u64)(b & 0x7f) << shift;
+        if(!(b & 0x80))
+        {
+            *val = result;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static int cursor_get_u32(struct payload_cursor* cursor, __u32* val)
+{
+    __u64 v;
+
+    if(cursor_get_varint(cursor, &v) || (v > 0xffffffffULL)) return -1;
+    *val = (__u32)v;
+
+    return 0;
+}
+
+/* Read varint from the file. Return 0 on success, -1 on error or EOF. */
+static int file_get_varint(FILE* f, __u64* val)
+{
+    __u64 result = 0;
+    int shift;
+
+    for(shift = 0; shift < 64; shift += 7)
+    {
+        int c = fgetc(f);
+
+        if(c == EOF) return -1;
+
+        result |= (__u64)(c & 0x7f) << shift;
+        if(!(c & 0x80))
+        {
+            *val = result;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+struct kedr_coi_call_log_reader* kedr_coi_call_log_reader_open(
+    const char* path)
+{
+    struct kedr_coi_call_log_reader* reader;
+    unsigned char header[LOG_HEADER_SIZE];
+    int saved_errno;
+
+    reader = malloc(sizeof(*reader));
+    if(reader == NULL) return NULL;
+
+    reader->f = fopen(path, "rb");
+    if(reader->f == NULL) goto err_open;
+
+    if((fread(header, sizeof(header), 1, reader->f) != 1)
+        || memcmp(header, KEDR_COI_CALL_LOG_MAGIC,
+            sizeof(KEDR_COI_CALL_LOG_MAGIC))
+        || (get_u32_le(header + 8) != KEDR_COI_CALL_LOG_VERSION))
+    {
+        errno = EPROTO;
+        goto err_header;
+    }
+
+    reader->timestamp = 0;
+    reader->payload = NULL;
+    reader->payload_size = 0;
+
+    return reader;
+
+err_header:
+    saved_errno = errno;
+    fclose(reader->f);
+    errno = saved_errno;
+err_open:
+    free(reader);
+    return NULL;
+}
+
+void kedr_coi_call_log_reader_close(struct kedr_coi_call_log_reader* reader)
+{
+    free(reader->payload);
+    fclose(reader->f);
+    free(reader);
+}
+
+/* Read payload of given size into reader's buffer. */
+static int reader_get_payload(struct kedr_coi_call_log_reader* reader,
+    size_t size)
+{
+    if(size + 1 > reader->payload_size)
+    {
+        unsigned char* payload = realloc(reader->payload, size + 1);
+        if(payload == NULL) return -1;
+
+        reader->payload = payload;
+        reader->payload_size = size + 1;
+    }
+
+    if(size && (fread(reader->payload, size, 1, reader->f) != 1))
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    reader->payload[size] = '\0';
+
+    return 0;
+}
+
+static int reader_get_timestamp(struct kedr_coi_call_log_reader* reader,
+    struct payload_cursor* cursor, __u64* timestamp)
+{
+    __u64 delta;
+
+    if(cursor_get_varint(cursor, &delta)) return -1;
+
+    reader->timestamp += (__u64)zigzag_decode(delta);
+    *timestamp = reader->timestamp;
+
+    return 0;
+}
+
+/* Parse payload of the event with known type. */
+static int reader_parse_event(struct kedr_coi_call_log_reader* reader,
+    struct payload_cursor* cursor,
+    struct kedr_coi_call_log_event* event)
+{
+    __u64 return_value;
+
+    switch(event->type)
+    {
+    case kedr_coi_call_log_event_interceptor:
+        if(cursor_get_u32(cursor, &event->interceptor_id)) return -1;
+        event->name = (const char*)cursor->p;
+        break;
+    case kedr_coi_call_log_event_operation:
+        if(cursor_get_u32(cursor, &event->interceptor_id)
+            || cursor_get_u32(cursor, &event->operation_offset))
+            return -1;
+        event->name = (const char*)cursor->p;
+        break;
+    case kedr_coi_call_log_event_call:
+        if(reader_get_timestamp(reader, cursor, &event->timestamp)
+            || cursor_get_u32(cursor, &event->interceptor_id)
+            || cursor_get_u32(cursor, &event->operation_offset)
+            || cursor_get_varint(cursor, &event->object)
+            || cursor_get_varint(cursor, &event->duration)
+            || cursor_get_varint(cursor, &return_value)
+            || cursor_get_u32(cursor, &event->pid)
+            || cursor_get_u32(cursor, &event->cpu))
+            return -1;
+        event->return_value = zigzag_decode(return_value);
+        break;
+    case kedr_coi_call_log_event_watch:
+    case kedr_coi_call_log_event_forget:
+        if(reader_get_timestamp(reader, cursor, &event->timestamp)
+            || cursor_get_u32(cursor, &event->interceptor_id)
+            || cursor_get_varint(cursor, &event->object))
+            return -1;
+        break;
+    case kedr_coi_call_log_event_lost:
+        if(cursor_get_u32(cursor, &event->cpu)
+            || cursor_get_varint(cursor, &event->lost))
+            return -1;
+        break;
+    }
+
+    return 0;
+}
+
+int kedr_coi_call_log_read(struct kedr_coi_call_log_reader* reader,
+    struct kedr_coi_call_log_event* event)
+{
+    for(;;)
+    {
+        struct payload_cursor cursor;
+        __u64 size;
+        int tag;
+
+        tag = fgetc(reader->f);
+        if(tag == EOF) return ferror(reader->f) ? -1 : 0;
+
+        if(file_get_varint(reader->f, &size) || (size > LOG_PAYLOAD_LIMIT))
+        {
+            errno = EPROTO;
+            return -1;
+        }
+
+        if(reader_get_payload(reader, (size_t)size)) return -1;
+
+        if((tag < kedr_coi_call_log_event_interceptor)
+            || (tag > kedr_coi_call_log_event_lost))
+            continue;
+
+        memset(event, 0, sizeof(*event));
+        event->type = tag;
+
+        cursor.p = reader->payload;
+        cursor.end = reader->payload + size;
+
+        if(reader_parse_event(reader, &cursor, event))
+        {
+            errno = EPROTO;
+            return -1;
+        }
+
+        return 1;
+    }
+}
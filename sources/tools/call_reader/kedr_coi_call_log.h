@@ -0,0 +1,168 @@
+#ifndef KEDR_COI_CALL_LOG_H
+#define KEDR_COI_CALL_LOG_H
+
+/*
+ * Log of intercepted calls: compact binary file for offline analysis.
+ *
+ * Log is written from the call records (see <kedr-coi/call_records.h>)
+ * and may be analyzed without KEDR COI core or the workload which
+ * produced it.
+ *
+ * Format of the file is stable: new versions of the tools read logs
+ * written by older ones. All integers are little-endian.
+ *
+ *  - header, 16 bytes: magic KEDR_COI_CALL_LOG_MAGIC (8 bytes),
+ *    version (4 bytes), flags (4 bytes, 0),
+ *  - sequence of events until the end of file.
+ *
+ * Every event is: tag (1 byte), length of the payload (varint), payload.
+ * Events with unknown tags are skipped by the reader, so new events may
+ * be added without changing the version. New fields may be appended to
+ * the payload of existing events without names; the reader ignores them.
+ *
+ * Fields of the payload are varints (unsigned LEB128). Signed fields are
+ * zigzag-encoded. Strings occupy the rest of the payload, without
+ * terminating zero.
+ *
+ * Payloads of the events, in order of fields:
+ *
+ *  interceptor: interceptor_id, name
+ *  operation:   interceptor_id, operation_offset, name
+ *  call:        timestamp, interceptor_id, operation_offset, object,
+ *               duration, return_value (signed), pid, cpu
+ *  watch:       timestamp, interceptor_id, object
+ *  forget:      timestamp, interceptor_id, object
+ *  lost:        cpu, number of records lost
+ *
+ * 'timestamp' is stored as signed difference with the timestamp of the
+ * previous event which has it (with 0 for the first one).
+ *
+ * 'object' is not an address but a dense identificator, starting from 1.
+ * Identificator is assigned when object is seen for the first time
+ * by the interceptor and is never reused: when object is forgotten,
+ * the same address watched again gets new identificator.
+ */
+
+#include <kedr-coi/call_records.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KEDR_COI_CALL_LOG_MAGIC "KCOILOG"
+
+/* Version of the format, changed only on incompatible changes. */
+#define KEDR_COI_CALL_LOG_VERSION 1
+
+/* Tags of the events. Values are part of the format. */
+enum kedr_coi_call_log_event_type
+{
+    kedr_coi_call_log_event_interceptor = 1,
+    kedr_coi_call_log_event_operation = 2,
+    kedr_coi_call_log_event_call = 3,
+    kedr_coi_call_log_event_watch = 4,
+    kedr_coi_call_log_event_forget = 5,
+    kedr_coi_call_log_event_lost = 6,
+};
+
+/*
+ * Event read from the log. Only fields listed for the event type in the
+ * format description are meaningful, others are 0.
+ */
+struct kedr_coi_call_log_event
+{
+    enum kedr_coi_call_log_event_type type;
+    /* Absolute timestamp, in nanoseconds. */
+    __u64 timestamp;
+    __u32 interceptor_id;
+    __u32 operation_offset;
+    __u64 object;
+    __u64 duration;
+    __s64 return_value;
+    __u32 pid;
+    __u32 cpu;
+    /* For 'lost' event. */
+    __u64 lost;
+    /*
+     * For 'interceptor' and 'operation' events. Valid until the next
+     * event is read.
+     */
+    const char* name;
+};
+
+struct kedr_coi_call_log_writer;
+
+/*
+ * Create log file and write its header.
+ *
+ * Return NULL on error, errno is set in that case.
+ */
+struct kedr_coi_call_log_writer* kedr_coi_call_log_writer_open(
+    const char* path);
+
+/*
+ * Flush and close the log.
+ *
+ * Return 0 on success, -1 if some data cannot be written (errno is set).
+ */
+int kedr_coi_call_log_writer_close(struct kedr_coi_call_log_writer* writer);
+
+/*
+ * Write name of the interceptor or of its operation.
+ *
+ * Names should be written before the records which refer to them,
+ * because the reader sees events only in order.
+ *
+ * Return 0 on success, -1 on error.
+ */
+int kedr_coi_call_log_write_interceptor(
+    struct kedr_coi_call_log_writer* writer,
+    __u32 interceptor_id, const char* name);
+
+int kedr_coi_call_log_write_operation(
+    struct kedr_coi_call_log_writer* writer,
+    __u32 interceptor_id, __u32 operation_offset, const char* name);
+
+/*
+ * Write event for the call record. Address of the object is replaced
+ * with its dense identificator.
+ *
+ * Records should be written in order of their timestamps for get
+ * compact log, though it is not required.
+ *
+ * Return 0 on success, -1 on error.
+ */
+int kedr_coi_call_log_write_record(struct kedr_coi_call_log_writer* writer,
+    const struct kedr_coi_call_record* record);
+
+/* Write number of records lost for given CPU since the last such event. */
+int kedr_coi_call_log_write_lost(struct kedr_coi_call_log_writer* writer,
+    __u32 cpu, __u64 lost);
+
+struct kedr_coi_call_log_reader;
+
+/*
+ * Open log and check its header.
+ *
+ * Return NULL on error, errno is set in that case. EPROTO means that
+ * the file is not a log or its version is not supported.
+ */
+struct kedr_coi_call_log_reader* kedr_coi_call_log_reader_open(
+    const char* path);
+
+void kedr_coi_call_log_reader_close(struct kedr_coi_call_log_reader* reader);
+
+/*
+ * Read next event from the log.
+ *
+ * Return 1 if event is read, 0 at the end of the log and -1 on error
+ * (errno is EPROTO if the log is corrupted or truncated).
+ */
+int kedr_coi_call_log_read(struct kedr_coi_call_log_reader* reader,
+    struct kedr_coi_call_log_event* event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEDR_COI_CALL_LOG_H */
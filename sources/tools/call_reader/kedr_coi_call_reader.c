@@ -0,0 +1,195 @@
+/*
+ * Reading of call records from userspace.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_call_reader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+struct kedr_coi_call_reader
+{
+    int fd;
+
+    void* area;
+    size_t area_size;
+
+    const struct kedr_coi_call_records_info* info;
+
+    /* Records overwritten before they have been read, per CPU. */
+    unsigned long long* overwritten;
+};
+
+static struct kedr_coi_call_records_header* reader_buffer(
+    struct kedr_coi_call_reader* reader, int cpu)
+{
+    return (void*)((char*)reader->area + reader->info->buffers_offset
+        + (size_t)cpu * reader->info->buffer_size);
+}
+
+static const struct kedr_coi_call_record* reader_record(
+    struct kedr_coi_call_reader* reader,
+    struct kedr_coi_call_records_header* header,
+    __u64 index)
+{
+    const struct kedr_coi_call_record* records = (const void*)
+        ((const char*)header + reader->info->records_offset);
+
+    return &records[index & (reader->info->n_records - 1)];
+}
+
+struct kedr_coi_call_reader* kedr_coi_call_reader_open(const char* path)
+{
+    struct kedr_coi_call_reader* reader;
+    struct kedr_coi_call_records_info info;
+    long page_size = sysconf(_SC_PAGESIZE);
+    void* info_page;
+    int saved_errno;
+
+    if(path == NULL) path = "/dev/" KEDR_COI_CALL_RECORDS_DEVICE;
+
+    reader = malloc(sizeof(*reader));
+    if(reader == NULL) return NULL;
+
+    reader->fd = open(path, O_RDWR);
+    if(reader->fd == -1) goto err_open;
+
+    // Map info page at first for determine size of the whole area.
+    info_page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if(info_page == MAP_FAILED) goto err_map_info;
+
+    memcpy(&info, info_page, sizeof(info));
+    munmap(info_page, page_size);
+
+    if(info.version != KEDR_COI_CALL_RECORDS_VERSION)
+    {
+        errno = EPROTO;
+        goto err_map_info;
+    }
+
+    reader->area_size = info.buffers_offset
+        + (size_t)info.n_cpus * info.buffer_size;
+    reader->area = mmap(NULL, reader->area_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, reader->fd, 0);
+    if(reader->area == MAP_FAILED) goto err_map_info;
+
+    reader->info = reader->area;
+
+    reader->overwritten = calloc(info.n_cpus, sizeof(*reader->overwritten));
+    if(reader->overwritten == NULL) goto err_overwritten;
+
+    return reader;
+
+err_overwritten:
+    munmap(reader->area, reader->area_size);
+err_map_info:
+    saved_errno = errno;
+    close(reader->fd);
+    errno = saved_errno;
+err_open:
+    free(reader);
+    return NULL;
+}
+
+void kedr_coi_call_reader_close(struct kedr_coi_call_reader* reader)
+{
+    free(reader->overwritten);
+    munmap(reader->area, reader->area_size);
+    close(reader->fd);
+    free(reader);
+}
+
+int kedr_coi_call_reader_n_cpus(struct kedr_coi_call_reader* reader)
+{
+    return reader->info->n_cpus;
+}
+
+int kedr_coi_call_reader_read(struct kedr_coi_call_reader* reader,
+    int cpu, struct kedr_coi_call_record* records, int n)
+{
+    struct kedr_coi_call_records_header* header = reader_buffer(reader, cpu);
+    volatile __u64* head_p = &header->head;
+    __u64 n_records = reader->info->n_records;
+    __u64 head, tail;
+    int i = 0;
+
+    tail = header->tail;
+    head = *head_p;
+    // Paired with smp_wmb() in the kernel.
+    __sync_synchronize();
+
+    if(head - tail > n_records)
+    {
+        // Oldest records are overwritten.
+        reader->overwritten[cpu] += head - tail - n_records;
+        tail = head - n_records;
+    }
+
+    for(; (i < n) && (tail != head); i++, tail++)
+    {
+        records[i] = *reader_record(reader, header, tail);
+    }
+
+    if(reader->info->overwrite && (i > 0))
+    {
+        /*
+         * Kernel may overwrite records while they are copied.
+         * Record with index 'j' may be corrupted if kernel has started
+         * to write record with index 'j + n_records'. Discard such
+         * records.
+         */
+        __u64 start = tail - i;
+        __u64 head_new;
+
+        __sync_synchronize();
+        head_new = *head_p;
+
+        if(head_new + 1 > start + n_records)
+        {
+            __u64 first_valid = head_new + 1 - n_records;
+            int n_invalid = (first_valid >= tail)
+                ? i : (int)(first_valid - start);
+
+            reader->overwritten[cpu] += n_invalid;
+            memmove(records, records + n_invalid,
+                (i - n_invalid) * sizeof(*records));
+            i -= n_invalid;
+        }
+    }
+
+    // Records should be read before they are released to the kernel.
+    __sync_synchronize();
+    header->tail = tail;
+
+    return i;
+}
+
+unsigned long long kedr_coi_call_reader_lost(
+    struct kedr_coi_call_reader* reader, int cpu)
+{
+    struct kedr_coi_call_records_header* header = reader_buffer(reader, cpu);
+
+    return header->dropped + reader->overwritten[cpu];
+}
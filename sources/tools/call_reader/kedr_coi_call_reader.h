@@ -0,0 +1,52 @@
+#ifndef KEDR_COI_CALL_READER_H
+#define KEDR_COI_CALL_READER_H
+
+/*
+ * Reading of call records, stored by KEDR COI core, from userspace.
+ *
+ * Reader maps buffers of all CPUs and consumes records from them.
+ * Only one reader should be active at a time.
+ */
+
+#include <kedr-coi/call_records.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct kedr_coi_call_reader;
+
+/*
+ * Open device with call records and map buffers.
+ *
+ * If 'path' is NULL, "/dev/kedr_coi_calls" is used.
+ *
+ * Return NULL on error, errno is set in that case.
+ */
+struct kedr_coi_call_reader* kedr_coi_call_reader_open(const char* path);
+
+void kedr_coi_call_reader_close(struct kedr_coi_call_reader* reader);
+
+/* Number of per-CPU buffers. */
+int kedr_coi_call_reader_n_cpus(struct kedr_coi_call_reader* reader);
+
+/*
+ * Consume up to 'n' records from the buffer of given CPU.
+ *
+ * Return number of records read.
+ */
+int kedr_coi_call_reader_read(struct kedr_coi_call_reader* reader,
+    int cpu, struct kedr_coi_call_record* records, int n);
+
+/*
+ * Return number of records lost for given CPU: dropped by the kernel
+ * because buffer was full or overwritten before they were read.
+ */
+unsigned long long kedr_coi_call_reader_lost(
+    struct kedr_coi_call_reader* reader, int cpu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEDR_COI_CALL_READER_H */
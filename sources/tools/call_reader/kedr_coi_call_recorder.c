@@ -0,0 +1,376 @@
+/*
+ * Record intercepted calls into the log for offline analysis.
+ *
+ * Usage: kedr_coi_call_recorder [-d debugfs-dir] [-t seconds]
+ *            [-i interceptor]... -o log [device]
+ *
+ * Records are read from the buffers of KEDR COI core until interrupted
+ * or until given number of seconds is elapsed, and are written into the
+ * log (see kedr_coi_call_log.h) in order of their timestamps.
+ *
+ * Names of the interceptors and of their operations are taken from
+ * KEDR COI directory in debugfs ('/sys/kernel/debug/kedr_coi' by
+ * default). For every interceptor given with '-i' recording is enabled
+ * via its 'record_mode' file while the tool works. Otherwise only
+ * records stored by handlers and by interceptors with recording enabled
+ * in other way get into the log.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_call_reader.h"
+#include "kedr_coi_call_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+
+#define RECORDS_PER_READ 256
+
+#define DEBUGFS_DIR_DEFAULT "/sys/kernel/debug/kedr_coi"
+
+static volatile sig_atomic_t stopped = 0;
+
+static void stop_handler(int sig)
+{
+    (void)sig;
+    stopped = 1;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-d debugfs-dir] [-t seconds] "
+        "[-i interceptor]... -o log [device]\n", prog);
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Write operations of the interceptor, listed in its 'operations' file. */
+static int write_operations(struct kedr_coi_call_log_writer* writer,
+    const char* path, unsigned int interceptor_id)
+{
+    FILE* f;
+    char line[256];
+    int result = 0;
+
+    f = fopen(path, "r");
+    if(f == NULL) return 0;
+
+    while(!result && fgets(line, sizeof(line), f))
+    {
+        // Named operations: "<name>\t<state>\t<offset>".
+        char* name = strtok(line, "\t\n");
+        char* state = strtok(NULL, "\t\n");
+        char* offset = strtok(NULL, "\t\n");
+
+        if((name == NULL) || (state == NULL) || (offset == NULL)) continue;
+
+        result = kedr_coi_call_log_write_operation(writer, interceptor_id,
+            strtoul(offset, NULL, 10), name);
+    }
+
+    fclose(f);
+
+    return result;
+}
+
+/*
+ * Write names of all interceptors and of their operations.
+ *
+ * Every subdirectory with 'id' file corresponds to the interceptor.
+ */
+static int write_names(struct kedr_coi_call_log_writer* writer,
+    const char* debugfs_dir)
+{
+    DIR* dir;
+    struct dirent* entry;
+    char path[512];
+    int result = 0;
+
+    dir = opendir(debugfs_dir);
+    if(dir == NULL)
+    {
+        fprintf(stderr, "Cannot open %s, interceptors will be referred "
+            "by identificators.\n", debugfs_dir);
+        return 0;
+    }
+
+    while(!result && ((entry = readdir(dir)) != NULL))
+    {
+        unsigned int id;
+        FILE* f;
+
+        if(entry->d_name[0] == '.') continue;
+
+        snprintf(path, sizeof(path), "%s/%s/id", debugfs_dir, entry->d_name);
+        f = fopen(path, "r");
+        if(f == NULL) continue;
+
+        if(fscanf(f, "%u", &id) != 1)
+        {
+            fclose(f);
+            continue;
+        }
+        fclose(f);
+
+        result = kedr_coi_call_log_write_interceptor(writer, id,
+            entry->d_name);
+        if(result) break;
+
+        snprintf(path, sizeof(path), "%s/%s/operations", debugfs_dir,
+            entry->d_name);
+        result = write_operations(writer, path, id);
+    }
+
+    closedir(dir);
+
+    return result;
+}
+
+/* Write 'value' into 'record_mode' file of every given interceptor. */
+static void set_record_mode(const char* debugfs_dir,
+    char** interceptors, int n_interceptors, int value)
+{
+    char path[512];
+    int i;
+
+    for(i = 0; i < n_interceptors; i++)
+    {
+        FILE* f;
+
+        snprintf(path, sizeof(path), "%s/%s/record_mode", debugfs_dir,
+            interceptors[i]);
+        f = fopen(path, "w");
+        if((f == NULL) || (fprintf(f, "%d\n", value) < 0) || fclose(f))
+        {
+            fprintf(stderr, "Failed to set recording mode for interceptor "
+                "'%s'.\n", interceptors[i]);
+        }
+    }
+}
+
+static int record_compare(const void* a, const void* b)
+{
+    const struct kedr_coi_call_record* ra = a;
+    const struct kedr_coi_call_record* rb = b;
+
+    if(ra->timestamp != rb->timestamp)
+        return ra->timestamp < rb->timestamp ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Read records from the buffers of all CPUs and write them sorted.
+ *
+ * Return number of records written or -1 on error.
+ */
+static int record_batch(struct kedr_coi_call_reader* reader,
+    struct kedr_coi_call_log_writer* writer,
+    struct kedr_coi_call_record* records,
+    unsigned long long* lost)
+{
+    int n_cpus = kedr_coi_call_reader_n_cpus(reader);
+    int n_total = 0;
+    int cpu;
+    int i;
+
+    for(cpu = 0; cpu < n_cpus; cpu++)
+    {
+        unsigned long long lost_cpu;
+
+        n_total += kedr_coi_call_reader_read(reader, cpu, records + n_total,
+            RECORDS_PER_READ);
+
+        lost_cpu = kedr_coi_call_reader_lost(reader, cpu);
+        if(lost_cpu != lost[cpu])
+        {
+            if(kedr_coi_call_log_write_lost(writer, cpu,
+                lost_cpu - lost[cpu]))
+                return -1;
+            lost[cpu] = lost_cpu;
+        }
+    }
+
+    qsort(records, n_total, sizeof(*records), record_compare);
+
+    for(i = 0; i < n_total; i++)
+    {
+        if(kedr_coi_call_log_write_record(writer, &records[i])) return -1;
+    }
+
+    return n_total;
+}
+
+int main(int argc, char** argv)
+{
+    struct kedr_coi_call_reader* reader;
+    struct kedr_coi_call_log_writer* writer;
+    struct kedr_coi_call_record* records;
+    unsigned long long* lost;
+    const char* debugfs_dir = DEBUGFS_DIR_DEFAULT;
+    const char* log_path = NULL;
+    const char* path = NULL;
+    char** interceptors;
+    int n_interceptors = 0;
+    unsigned int duration = 0;
+    unsigned long long n_written = 0;
+    double start;
+    int n_cpus;
+    int n;
+    int opt;
+    int result = 0;
+
+    interceptors = calloc(argc, sizeof(*interceptors));
+    if(interceptors == NULL)
+    {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        return 1;
+    }
+
+    while((opt = getopt(argc, argv, "d:t:i:o:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 'd':
+            debugfs_dir = optarg;
+            break;
+        case 't':
+            duration = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            interceptors[n_interceptors++] = optarg;
+            break;
+        case 'o':
+            log_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if((log_path == NULL) || (optind < argc - 1))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if(optind == argc - 1) path = argv[optind];
+
+    reader = kedr_coi_call_reader_open(path);
+    if(reader == NULL)
+    {
+        perror("Failed to open call records");
+        return 1;
+    }
+
+    n_cpus = kedr_coi_call_reader_n_cpus(reader);
+
+    records = calloc((size_t)n_cpus * RECORDS_PER_READ, sizeof(*records));
+    lost = calloc(n_cpus, sizeof(*lost));
+    if((records == NULL) || (lost == NULL))
+    {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        result = 1;
+        goto out_reader;
+    }
+
+    writer = kedr_coi_call_log_writer_open(log_path);
+    if(writer == NULL)
+    {
+        perror("Failed to create log");
+        result = 1;
+        goto out_reader;
+    }
+
+    if(write_names(writer, debugfs_dir))
+    {
+        perror("Failed to write log");
+        result = 1;
+        goto out_writer;
+    }
+
+    // Records stored before the start are not interesting.
+    for(n = 0; n < n_cpus; n++)
+    {
+        while(kedr_coi_call_reader_read(reader, n, records,
+            RECORDS_PER_READ) > 0);
+        lost[n] = kedr_coi_call_reader_lost(reader, n);
+    }
+
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+
+    set_record_mode(debugfs_dir, interceptors, n_interceptors, 1);
+
+    start = time_now();
+    n = 0;
+
+    while(!stopped && (!duration || (time_now() - start < duration)))
+    {
+        n = record_batch(reader, writer, records, lost);
+        if(n < 0) break;
+
+        n_written += n;
+        if(n == 0) usleep(10000);
+    }
+
+    set_record_mode(debugfs_dir, interceptors, n_interceptors, 0);
+
+    // Records stored before recording has been disabled.
+    while(n >= 0)
+    {
+        n = record_batch(reader, writer, records, lost);
+        if(n <= 0) break;
+        n_written += n;
+    }
+
+    if(n < 0)
+    {
+        perror("Failed to write log");
+        result = 1;
+    }
+
+out_writer:
+    if(kedr_coi_call_log_writer_close(writer) && !result)
+    {
+        perror("Failed to write log");
+        result = 1;
+    }
+
+    if(!result)
+        fprintf(stderr, "%llu records are written.\n", n_written);
+
+out_reader:
+    free(lost);
+    free(records);
+    kedr_coi_call_reader_close(reader);
+    free(interceptors);
+
+    return result;
+}
@@ -0,0 +1,560 @@
+/*
+ * Analyze the log of intercepted calls, written by kedr_coi_call_recorder.
+ *
+ * Usage: kedr_coi_call_replay [-d] log
+ *
+ * Events of the log are replayed in order, and the report is printed:
+ *
+ *  - for every operation: number of calls and their rate, number of
+ *    calls which return error (value from -4095 to -1) and distribution
+ *    of the call time (minimum, mean, percentiles and maximum),
+ *  - for every interceptor: number of objects watched and forgotten
+ *    during recording, number of objects alive at the end and
+ *    distribution of the lifetime of the objects, which have been both
+ *    watched and forgotten during recording.
+ *
+ * Percentiles are computed from log-linear histograms, so they are
+ * accurate up to 1/8 of the value.
+ *
+ * With '-d' events are printed in text form instead of the report.
+ */
+
+/* ========================================================================
+ * Copyright (C) 2011, Andrey V. Tsyvarev  <tsyvarev@ispras.ru>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ======================================================================== */
+
+#include "kedr_coi_call_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * Histogram: values less than HIST_SUB are stored exactly, others are
+ * split into HIST_SUB buckets per power of 2.
+ */
+#define HIST_SUB_BITS 3
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/* Return values from this range are errors. */
+#define MAX_ERRNO 4095
+
+struct histogram
+{
+    unsigned long long count;
+    double sum;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long long buckets[HIST_BUCKETS];
+};
+
+struct operation_stat
+{
+    unsigned int interceptor_id;
+    unsigned int operation_offset;
+    char* name;
+
+    unsigned long long calls;
+    unsigned long long errors;
+    /* Time of the calls, for which it is known. */
+    struct histogram time;
+};
+
+struct interceptor_stat
+{
+    unsigned int id;
+    char* name;
+
+    unsigned long long watched;
+    unsigned long long forgotten;
+    unsigned long long alive;
+    /* Objects which have been watched before recording. */
+    unsigned long long untracked;
+    struct histogram lifetime;
+};
+
+enum object_state
+{
+    object_state_unknown = 0,
+    object_state_watched,
+    /* Object is seen without being watched, its lifetime is unknown. */
+    object_state_untracked,
+    object_state_forgotten,
+};
+
+struct object_stat
+{
+    unsigned long long watch_time;
+    unsigned int interceptor_id;
+    enum object_state state;
+};
+
+struct replay
+{
+    struct operation_stat* operations;
+    size_t n_operations;
+
+    struct interceptor_stat* interceptors;
+    size_t n_interceptors;
+
+    /* Indexed by dense identificator of the object. */
+    struct object_stat* objects;
+    size_t objects_size;
+
+    unsigned long long first_time;
+    unsigned long long last_time;
+    unsigned long long n_calls;
+    unsigned long long lost;
+};
+
+//*************************** Histogram *******************************//
+static int hist_index(unsigned long long val)
+{
+    int msb;
+
+    if(val < HIST_SUB) return (int)val;
+
+    msb = 63 - __builtin_clzll(val);
+
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB
+        + (int)((val >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* The least value which falls into the bucket. */
+static unsigned long long hist_bucket_value(int index)
+{
+    int shift;
+
+    if(index < HIST_SUB) return index;
+
+    shift = index / HIST_SUB - 1;
+
+    return (unsigned long long)(HIST_SUB + index % HIST_SUB) << shift;
+}
+
+static void hist_add(struct histogram* hist, unsigned long long val)
+{
+    if((hist->count == 0) || (val < hist->min)) hist->min = val;
+    if(val > hist->max) hist->max = val;
+
+    hist->count++;
+    hist->sum += val;
+    hist->buckets[hist_index(val)]++;
+}
+
+static unsigned long long hist_percentile(const struct histogram* hist,
+    double percent)
+{
+    unsigned long long rank = (unsigned long long)(hist->count * percent / 100);
+    unsigned long long seen = 0;
+    int i;
+
+    for(i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+        if(seen > rank)
+        {
+            unsigned long long val = hist_bucket_value(i);
+
+            if(val < hist->min) return hist->min;
+            return val > hist->max ? hist->max : val;
+        }
+    }
+
+    return hist->max;
+}
+
+/* Print min, mean, p50, p90, p99 and max, divided by 'unit'. */
+static void hist_print(const struct histogram* hist, unsigned long long unit)
+{
+    if(hist->count == 0)
+    {
+        printf("%10s %10s %10s %10s %10s %10s", "-", "-", "-", "-", "-", "-");
+        return;
+    }
+
+    printf("%10llu %10.0f %10llu %10llu %10llu %10llu",
+        hist->min / unit,
+        hist->sum / hist->count / unit,
+        hist_percentile(hist, 50) / unit,
+        hist_percentile(hist, 90) / unit,
+        hist_percentile(hist, 99) / unit,
+        hist->max / unit);
+}
+
+//**************************** Tables *********************************//
+static struct operation_stat* replay_operation(struct replay* replay,
+    unsigned int interceptor_id, unsigned int operation_offset)
+{
+    static size_t last = 0;
+    struct operation_stat* operation;
+    size_t i;
+
+    // Calls of the same operation usually go in series.
+    if((last < replay->n_operations)
+        && (replay->operations[last].interceptor_id == interceptor_id)
+        && (replay->operations[last].operation_offset == operation_offset))
+        return &replay->operations[last];
+
+    for(i = 0; i < replay->n_operations; i++)
+    {
+        operation = &replay->operations[i];
+        if((operation->interceptor_id == interceptor_id)
+            && (operation->operation_offset == operation_offset))
+        {
+            last = i;
+            return operation;
+        }
+    }
+
+    operation = realloc(replay->operations,
+        (replay->n_operations + 1) * sizeof(*operation));
+    if(operation == NULL) return NULL;
+    replay->operations = operation;
+
+    operation = &replay->operations[replay->n_operations];
+    memset(operation, 0, sizeof(*operation));
+    operation->interceptor_id = interceptor_id;
+    operation->operation_offset = operation_offset;
+
+    last = replay->n_operations++;
+
+    return operation;
+}
+
+static struct interceptor_stat* replay_interceptor(struct replay* replay,
+    unsigned int id)
+{
+    struct interceptor_stat* interceptor;
+    size_t i;
+
+    for(i = 0; i < replay->n_interceptors; i++)
+    {
+        if(replay->interceptors[i].id == id) return &replay->interceptors[i];
+    }
+
+    interceptor = realloc(replay->interceptors,
+        (replay->n_interceptors + 1) * sizeof(*interceptor));
+    if(interceptor == NULL) return NULL;
+    replay->interceptors = interceptor;
+
+    interceptor = &replay->interceptors[replay->n_interceptors++];
+    memset(interceptor, 0, sizeof(*interceptor));
+    interceptor->id = id;
+
+    return interceptor;
+}
+
+static struct object_stat* replay_object(struct replay* replay,
+    unsigned long long id)
+{
+    if(id >= replay->objects_size)
+    {
+        size_t size = replay->objects_size ? replay->objects_size : 1024;
+        struct object_stat* objects;
+
+        while(size <= id) size *= 2;
+
+        objects = realloc(replay->objects, size * sizeof(*objects));
+        if(objects == NULL) return NULL;
+
+        memset(objects + replay->objects_size, 0,
+            (size - replay->objects_size) * sizeof(*objects));
+        replay->objects = objects;
+        replay->objects_size = size;
+    }
+
+    return &replay->objects[id];
+}
+
+//***************************** Events ********************************//
+static const char* interceptor_name(struct replay* replay, unsigned int id)
+{
+    static char buf[32];
+    size_t i;
+
+    for(i = 0; i < replay->n_interceptors; i++)
+    {
+        if((replay->interceptors[i].id == id) && replay->interceptors[i].name)
+            return replay->interceptors[i].name;
+    }
+
+    snprintf(buf, sizeof(buf), "%u", id);
+    return buf;
+}
+
+static const char* operation_name(struct operation_stat* operation)
+{
+    static char buf[32];
+
+    if(operation->name) return operation->name;
+
+    snprintf(buf, sizeof(buf), "%u", operation->operation_offset);
+    return buf;
+}
+
+static void dump_event(struct replay* replay,
+    const struct kedr_coi_call_log_event* event,
+    struct operation_stat* operation)
+{
+    switch(event->type)
+    {
+    case kedr_coi_call_log_event_interceptor:
+        printf("interceptor %u %s\n", event->interceptor_id, event->name);
+        break;
+    case kedr_coi_call_log_event_operation:
+        printf("operation %u %u %s\n", event->interceptor_id,
+            event->operation_offset, event->name);
+        break;
+    case kedr_coi_call_log_event_call:
+        printf("%llu call %s.%s object=%llu duration=%llu ret=%lld "
+            "pid=%u cpu=%u\n",
+            (unsigned long long)event->timestamp,
+            interceptor_name(replay, event->interceptor_id),
+            operation_name(operation),
+            (unsigned long long)event->object,
+            (unsigned long long)event->duration,
+            (long long)event->return_value,
+            event->pid, event->cpu);
+        break;
+    case kedr_coi_call_log_event_watch:
+    case kedr_coi_call_log_event_forget:
+        printf("%llu %s %s object=%llu\n",
+            (unsigned long long)event->timestamp,
+            event->type == kedr_coi_call_log_event_watch ? "watch" : "forget",
+            interceptor_name(replay, event->interceptor_id),
+            (unsigned long long)event->object);
+        break;
+    case kedr_coi_call_log_event_lost:
+        printf("lost cpu=%u %llu\n", event->cpu,
+            (unsigned long long)event->lost);
+        break;
+    }
+}
+
+/* Account the object which is seen in the call or in the forget event. */
+static void replay_object_seen(struct object_stat* object,
+    struct interceptor_stat* interceptor)
+{
+    if(object->state == object_state_unknown)
+    {
+        object->state = object_state_untracked;
+        interceptor->untracked++;
+        interceptor->alive++;
+    }
+}
+
+static int replay_event(struct replay* replay,
+    const struct kedr_coi_call_log_event* event, int dump)
+{
+    struct operation_stat* operation = NULL;
+    struct interceptor_stat* interceptor = NULL;
+    struct object_stat* object = NULL;
+
+    if(event->type != kedr_coi_call_log_event_lost)
+    {
+        interceptor = replay_interceptor(replay, event->interceptor_id);
+        if(interceptor == NULL) return -1;
+    }
+
+    if((event->type == kedr_coi_call_log_event_call)
+        || (event->type == kedr_coi_call_log_event_operation))
+    {
+        operation = replay_operation(replay, event->interceptor_id,
+            event->operation_offset);
+        if(operation == NULL) return -1;
+    }
+
+    if(event->object)
+    {
+        object = replay_object(replay, event->object);
+        if(object == NULL) return -1;
+        object->interceptor_id = event->interceptor_id;
+    }
+
+    if(event->timestamp)
+    {
+        if(!replay->first_time || (event->timestamp < replay->first_time))
+            replay->first_time = event->timestamp;
+        if(event->timestamp > replay->last_time)
+            replay->last_time = event->timestamp;
+    }
+
+    switch(event->type)
+    {
+    case kedr_coi_call_log_event_interceptor:
+        free(interceptor->name);
+        interceptor->name = strdup(event->name);
+        break;
+    case kedr_coi_call_log_event_operation:
+        free(operation->name);
+        operation->name = strdup(event->name);
+        break;
+    case kedr_coi_call_log_event_call:
+        replay->n_calls++;
+        operation->calls++;
+        if((event->return_value < 0) && (event->return_value >= -MAX_ERRNO))
+            operation->errors++;
+        if(event->duration) hist_add(&operation->time, event->duration);
+        if(object) replay_object_seen(object, interceptor);
+        break;
+    case kedr_coi_call_log_event_watch:
+        if(object == NULL) break;
+        object->state = object_state_watched;
+        object->watch_time = event->timestamp;
+        interceptor->watched++;
+        interceptor->alive++;
+        break;
+    case kedr_coi_call_log_event_forget:
+        if(object == NULL) break;
+        replay_object_seen(object, interceptor);
+        if(object->state == object_state_watched)
+            hist_add(&interceptor->lifetime,
+                event->timestamp - object->watch_time);
+        object->state = object_state_forgotten;
+        interceptor->forgotten++;
+        interceptor->alive--;
+        break;
+    case kedr_coi_call_log_event_lost:
+        replay->lost += event->lost;
+        break;
+    }
+
+    if(dump) dump_event(replay, event, operation);
+
+    return 0;
+}
+
+//***************************** Report ********************************//
+static void print_report(struct replay* replay)
+{
+    double duration = (replay->last_time - replay->first_time) / 1e9;
+    size_t i;
+
+    printf("Duration: %.3f s, calls: %llu, records lost: %llu\n",
+        duration, replay->n_calls, replay->lost);
+
+    printf("\n%-32s %10s %12s %10s %10s %10s %10s %10s %10s %10s\n",
+        "operation", "calls", "calls/s", "errors",
+        "min_ns", "mean_ns", "p50_ns", "p90_ns", "p99_ns", "max_ns");
+
+    for(i = 0; i < replay->n_operations; i++)
+    {
+        struct operation_stat* operation = &replay->operations[i];
+        char name[256];
+
+        if(operation->calls == 0) continue;
+
+        snprintf(name, sizeof(name), "%s.%s",
+            interceptor_name(replay, operation->interceptor_id),
+            operation_name(operation));
+
+        printf("%-32s %10llu %12.1f %10llu ", name, operation->calls,
+            duration > 0 ? operation->calls / duration : 0.0,
+            operation->errors);
+        hist_print(&operation->time, 1);
+        printf("\n");
+    }
+
+    printf("\n%-32s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+        "interceptor", "watched", "forgotten", "alive", "untracked",
+        "min_us", "mean_us", "p50_us", "p90_us", "p99_us", "max_us");
+
+    for(i = 0; i < replay->n_interceptors; i++)
+    {
+        struct interceptor_stat* interceptor = &replay->interceptors[i];
+
+        if(!interceptor->watched && !interceptor->forgotten
+            && !interceptor->untracked)
+            continue;
+
+        printf("%-32s %10llu %10llu %10llu %10llu ",
+            interceptor_name(replay, interceptor->id),
+            interceptor->watched, interceptor->forgotten,
+            interceptor->alive, interceptor->untracked);
+        hist_print(&interceptor->lifetime, 1000);
+        printf("\n");
+    }
+}
+
+static void replay_destroy(struct replay* replay)
+{
+    size_t i;
+
+    for(i = 0; i < replay->n_operations; i++)
+        free(replay->operations[i].name);
+    for(i = 0; i < replay->n_interceptors; i++)
+        free(replay->interceptors[i].name);
+
+    free(replay->operations);
+    free(replay->interceptors);
+    free(replay->objects);
+}
+
+int main(int argc, char** argv)
+{
+    struct kedr_coi_call_log_reader* reader;
+    struct kedr_coi_call_log_event event;
+    struct replay replay;
+    const char* path = NULL;
+    int dump = 0;
+    int result;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-d"))
+            dump = 1;
+        else
+            path = argv[i];
+    }
+
+    if(path == NULL)
+    {
+        fprintf(stderr, "Usage: %s [-d] log\n", argv[0]);
+        return 1;
+    }
+
+    reader = kedr_coi_call_log_reader_open(path);
+    if(reader == NULL)
+    {
+        perror("Failed to open log");
+        return 1;
+    }
+
+    memset(&replay, 0, sizeof(replay));
+
+    while((result = kedr_coi_call_log_read(reader, &event)) > 0)
+    {
+        if(replay_event(&replay, &event, dump))
+        {
+            fprintf(stderr, "Failed to allocate memory.\n");
+            break;
+        }
+    }
+
+    if(result < 0) perror("Failed to read log");
+
+    if(!dump) print_report(&replay);
+
+    replay_destroy(&replay);
+    kedr_coi_call_log_reader_close(reader);
+
+    return result != 0;
+}